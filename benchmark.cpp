@@ -0,0 +1,486 @@
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "linear_algebra.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Benchmarks every operation declared in linear_algebra.h, for float and double, over fixed
+size storages from 2x2 to 16x16, small_dynamic_matrix storages from 2x2 to 8x8 and dynamic
+size storages from 16x16 to 4096x4096.
+
+Each case is warmed up while the iteration count is calibrated: the count doubles until a
+batch takes at least --min-time seconds. The batch is then timed --repetitions times and the
+median is reported as ns/op, with GFLOP/s and GB/s derived from a nominal operation count and
+the bytes the operation must read and write at least once. Those models are the textbook ones
+(2n^3 for a multiply, 2n^3/3 for an LU factorisation...), so the closed forms used for the
+smallest fixed sizes report an equivalent rate rather than the flops actually executed.
+Vector operations run on 1 x n^2 vectors so their sizes line up with the square cases.
+
+Square inputs are diagonally dominant and symmetric, so every factorisation succeeds and
+determinants stay near one whatever the size. Results are printed as a table and, with
+--json, written as JSON for tracking across commits.
+
+    lin_alg_bench [--filter text] [--scalar float|double|half|bf16] [--storage fixed|small|dynamic]
+                  [--min-size n] [--max-size n] [--repetitions n] [--min-time seconds]
+                  [--json file|-]
+*/
+
+namespace {
+    struct bench_options
+    {
+        std::string filter;                 // Substring the operation name must contain
+        std::string scalar;                 // float, double, half, bf16 or empty for all
+        std::string storage;                // fixed, small, dynamic or empty for all
+        size_t min_size = 16;               // Dynamic sizes only; fixed sizes always run 2 to 16, small 2 to 8
+        size_t max_size = 4096;
+        size_t repetitions = 5;
+        double min_time = 0.05;             // Seconds per timed batch
+        std::string json;                   // Output file, "-" for stdout
+    };
+
+    struct bench_result
+    {
+        std::string op;
+        std::string scalar;
+        std::string storage;
+        size_t rows;
+        size_t cols;
+        size_t iterations;                  // Calls per timed batch
+        std::vector<double> ns_per_op;      // One entry per repetition
+        double flops;                       // Per call
+        double bytes;                       // Per call
+        double median() const;
+    };
+
+    class bench_suite
+    {
+    public:
+        explicit bench_suite(bench_options opts);
+        template<class F>
+        void run(char const* op, char const* scalar, char const* storage, size_t rows, size_t cols, double flops, double bytes, F&& f);
+        void print_table(std::ostream& os) const;
+        void write_json(std::ostream& os) const;
+        bench_options const& options() const noexcept;
+    private:
+        bench_options _Options;
+        std::vector<bench_result> _Results;
+    };
+
+    // Keeps the compiler from discarding a result or hoisting a call out of the timing loop
+    template<class T>
+    void do_not_optimize(T const& value)
+    {
+#if defined __GNUC__ || defined __clang__
+        asm volatile("" : : "r"(&value) : "memory");
+#else
+        static void const* volatile sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    template<class Scalar>
+    constexpr char const* scalar_name = std::is_same_v<Scalar, float> ? "float" : std::is_same_v<Scalar, double> ? "double"
+        : std::is_same_v<Scalar, std::experimental::la::half> ? "half" : "bf16";
+}
+
+////////////////////////////////////////////////////////
+// bench_suite implementation
+////////////////////////////////////////////////////////
+double bench_result::median() const
+{
+    auto sorted = ns_per_op;
+    std::sort(sorted.begin(), sorted.end());
+    auto const mid = sorted.size() / 2;
+    return sorted.size() % 2 == 1 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+}
+
+bench_suite::bench_suite(bench_options opts)
+    : _Options(std::move(opts))
+{}
+
+bench_options const& bench_suite::options() const noexcept
+{
+    return _Options;
+}
+
+template<class F>
+void bench_suite::run(char const* op, char const* scalar, char const* storage, size_t rows, size_t cols, double flops, double bytes, F&& f)
+{
+    if (!_Options.filter.empty() && std::strstr(op, _Options.filter.c_str()) == nullptr) return;
+    using clock = std::chrono::steady_clock;
+    auto batch = [&](size_t iterations)
+    {
+        auto const start = clock::now();
+        for (auto i = size_t(0); i < iterations; ++i) do_not_optimize(f());
+        return std::chrono::duration<double>(clock::now() - start).count();
+    };
+
+    // Warm up and calibrate
+    auto iterations = size_t(1);
+    while (batch(iterations) < _Options.min_time && iterations < (size_t(1) << 30)) iterations *= 2;
+
+    auto res = bench_result{ op, scalar, storage, rows, cols, iterations, {}, flops, bytes };
+    for (auto r = size_t(0); r < std::max(_Options.repetitions, size_t(1)); ++r)
+    {
+        res.ns_per_op.push_back(batch(iterations) * 1e9 / double(iterations));
+    }
+    _Results.push_back(std::move(res));
+
+    auto const& last = _Results.back();
+    std::fprintf(stderr, "%-24s %-6s %-7s %5zux%-5zu %14.1f ns/op\n", op, scalar, storage, rows, cols, last.median());
+}
+
+void bench_suite::print_table(std::ostream& os) const
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %-6s %-7s %11s %14s %10s %10s\n", "operation", "scalar", "storage", "size", "ns/op", "GFLOP/s", "GB/s");
+    os << line;
+    for (auto const& res : _Results)
+    {
+        auto const ns = res.median();
+        auto const size = std::to_string(res.rows) + "x" + std::to_string(res.cols);
+        char gflops[16] = "-";
+        if (res.flops > 0.0) std::snprintf(gflops, sizeof(gflops), "%.2f", res.flops / ns);
+        std::snprintf(line, sizeof(line), "%-24s %-6s %-7s %11s %14.1f %10s %10.2f\n", res.op.c_str(), res.scalar.c_str(), res.storage.c_str(),
+            size.c_str(), ns, gflops, res.bytes / ns);
+        os << line;
+    }
+}
+
+void bench_suite::write_json(std::ostream& os) const
+{
+    static char const* const simd_names[] = { "scalar", "sse2", "avx2", "avx512" };
+    auto const level = std::experimental::la::detail::active_simd_level();
+    os << "{\n  \"context\": {\n";
+#if defined __clang__
+    os << "    \"compiler\": \"clang " << __clang_major__ << "." << __clang_minor__ << "\",\n";
+#elif defined __GNUC__
+    os << "    \"compiler\": \"gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "\",\n";
+#elif defined _MSC_VER
+    os << "    \"compiler\": \"msvc " << _MSC_VER << "\",\n";
+#else
+    os << "    \"compiler\": \"unknown\",\n";
+#endif
+#if defined NDEBUG
+    os << "    \"assertions\": false,\n";
+#else
+    os << "    \"assertions\": true,\n";
+#endif
+    os << "    \"simd_level\": \"" << simd_names[static_cast<int>(level)] << "\",\n";
+    os << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    os << "    \"repetitions\": " << _Options.repetitions << ",\n";
+    os << "    \"min_time\": " << _Options.min_time << "\n  },\n";
+    os << "  \"benchmarks\": [";
+    for (auto i = size_t(0); i < _Results.size(); ++i)
+    {
+        auto const& res = _Results[i];
+        auto const ns = res.median();
+        auto const [lo, hi] = std::minmax_element(res.ns_per_op.begin(), res.ns_per_op.end());
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    { \"operation\": \"" << res.op << "\", \"scalar\": \"" << res.scalar << "\", \"storage\": \"" << res.storage
+            << "\", \"rows\": " << res.rows << ", \"cols\": " << res.cols << ", \"iterations\": " << res.iterations
+            << ", \"ns_per_op\": " << ns << ", \"ns_per_op_min\": " << *lo << ", \"ns_per_op_max\": " << *hi
+            << ", \"flops\": " << res.flops << ", \"bytes\": " << res.bytes
+            << ", \"gflops\": " << res.flops / ns << ", \"gbytes_per_second\": " << res.bytes / ns << " }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+////////////////////////////////////////////////////////
+// Cases
+////////////////////////////////////////////////////////
+namespace {
+    // Diagonally dominant and symmetric: invertible, positive definite, determinant near one
+    template<class Rep>
+    void fill_square(std::experimental::la::matrix<Rep>& mat, size_t seed)
+    {
+        using scalar_t = typename Rep::scalar_t;
+        auto const n = mat.data().rows();
+        for (auto i = size_t(0); i < n; ++i)
+        {
+            for (auto j = size_t(0); j < n; ++j)
+            {
+                auto const off = scalar_t(int((i + j + seed) * 7 % 17) - 8) / scalar_t(16 * n);
+                mat(i, j) = i == j ? scalar_t(1) + off : off;
+            }
+        }
+    }
+
+    template<class Rep>
+    void fill_vector(std::experimental::la::matrix<Rep>& vec, size_t seed)
+    {
+        using scalar_t = typename Rep::scalar_t;
+        auto const n = vec.data().cols();
+        for (auto j = size_t(0); j < n; ++j) vec(0, j) = scalar_t(int((j + seed) * 7 % 17) - 8) / scalar_t(8);
+    }
+
+    template<class Rep, class VecRep>
+    void common_benchmarks(bench_suite& suite, char const* storage, std::experimental::la::matrix<Rep> const& a,
+        std::experimental::la::matrix<Rep> const& b, std::experimental::la::matrix<Rep> const& id,
+        std::experimental::la::matrix<VecRep> const& x, std::experimental::la::matrix<VecRep> const& y)
+    {
+        using namespace std::experimental::la;
+        using scalar_t = typename Rep::scalar_t;
+        auto const n = a.data().rows();
+        auto const dn = double(n);
+        auto const nn = dn * dn;
+        auto const s = double(sizeof(scalar_t));
+        auto const scalar = scalar_name<scalar_t>;
+        auto square = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, storage, n, n, flops, bytes, f); };
+        auto vector = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, storage, 1, n * n, flops, bytes, f); };
+        do_not_optimize(a);
+        do_not_optimize(b);
+        do_not_optimize(id);
+        do_not_optimize(x);
+        do_not_optimize(y);
+
+        // Equality compares equal operands so it cannot stop at the first element
+        auto const a2 = a;
+        do_not_optimize(a2);
+        square("equal", 0.0, 2.0 * nn * s, [&] { return a == a2; });
+        square("not_equal", 0.0, 2.0 * nn * s, [&] { return a != a2; });
+
+        // Element-wise operators
+        square("scalar_multiply", nn, 2.0 * nn * s, [&] { return matrix<Rep>(a * scalar_t(2)); });
+        square("divide", nn, 2.0 * nn * s, [&] { return matrix<Rep>(a / scalar_t(2)); });
+        square("add", nn, 3.0 * nn * s, [&] { return matrix<Rep>(a + b); });
+        square("subtract", nn, 3.0 * nn * s, [&] { return matrix<Rep>(a - b); });
+        auto acc = a;
+        square("add_assign", nn, 3.0 * nn * s, [&]() -> auto const& { return acc += b; });
+        square("subtract_assign", nn, 3.0 * nn * s, [&]() -> auto const& { return acc -= b; });
+
+        // Matrix operators and functions
+        square("multiply", 2.0 * nn * dn, 3.0 * nn * s, [&] { return a * b; });
+        square("transpose", 0.0, 2.0 * nn * s, [&] { return transpose(a); });
+        square("transpose_inplace", 0.0, 2.0 * nn * s, [&]() -> auto const& { transpose_inplace(acc); return acc; });
+        square("submatrix", 0.0, 2.0 * nn * s, [&] { return submatrix(a, 0, 0); });
+
+        // In-place updates; acc stays bounded as gemm halves it and the identity leaves it alone
+        square("gemm", 2.0 * nn * dn, 4.0 * nn * s, [&]() -> auto const& { gemm(scalar_t(1), a, b, scalar_t(0.5), acc); return acc; });
+        square("multiply_assign", 2.0 * nn * dn, 3.0 * nn * s, [&]() -> auto const& { return acc *= id; });
+
+        // Vector functions
+        auto const len = nn;
+        vector("inner_product", 2.0 * len, 2.0 * len * s, [&] { return inner_product(x, y); });
+        vector("modulus", 2.0 * len, len * s, [&] { return modulus(x); });
+        vector("modulus_squared", 2.0 * len, len * s, [&] { return modulus_squared(x); });
+        vector("unit", 3.0 * len, 2.0 * len * s, [&] { return unit(x); });
+        auto y_acc = y;
+        vector("axpby", 3.0 * len, 3.0 * len * s, [&]() -> auto const& { axpby(scalar_t(1), x, scalar_t(0.5), y_acc); return y_acc; });
+
+        // SquareMatrix predicates and functions; is_identity gets the identity so it reads everything
+        square("is_identity", 0.0, nn * s, [&] { return is_identity(id); });
+        square("is_invertible", 2.0 * nn * dn / 3.0, nn * s, [&] { return is_invertible(a); });
+        square("determinant", 2.0 * nn * dn / 3.0, nn * s, [&] { return determinant(a); });
+        square("classical_adjoint", 2.0 * nn * dn, 2.0 * nn * s, [&] { return classical_adjoint(a); });
+        square("inverse", 2.0 * nn * dn, 2.0 * nn * s, [&] { return inverse(a); });
+
+        // Decompositions and solvers, with n right-hand sides
+        auto const la = lu(a);
+        auto const ch = cholesky(a);
+        square("lu", 2.0 * nn * dn / 3.0, 2.0 * nn * s, [&] { return lu(a); });
+        square("cholesky", nn * dn / 3.0, 2.0 * nn * s, [&] { return cholesky(a); });
+        square("solve", 2.0 * nn * dn / 3.0 + 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(a, b); });
+        square("solve_lu", 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(la, b); });
+        square("solve_cholesky", 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(ch, b); });
+    }
+
+    template<class Scalar, size_t N>
+    void fixed_benchmarks(bench_suite& suite)
+    {
+        using namespace std::experimental::la;
+        using rep_t = matrix_traits<fixed_size_matrix<Scalar, N, N>>;
+        auto a = matrix<rep_t>{};
+        auto b = matrix<rep_t>{};
+        auto const id = identity<rep_t>();
+        auto x = matrix<matrix_traits<fixed_size_matrix<Scalar, 1, N * N>>>{};
+        auto y = x;
+        fill_square(a, 0);
+        fill_square(b, 5);
+        fill_vector(x, 0);
+        fill_vector(y, 3);
+        common_benchmarks(suite, "fixed", a, b, id, x, y);
+        suite.run("identity", scalar_name<Scalar>, "fixed", N, N, 0.0, double(N * N * sizeof(Scalar)), [] { return identity<rep_t>(); });
+    }
+
+    // Storages sized at run time: dynamic_size_matrix, and small_dynamic_matrix holding its elements inline
+    template<class Storage>
+    void dynamic_benchmarks(bench_suite& suite, char const* storage, size_t n)
+    {
+        using namespace std::experimental::la;
+        using Scalar = typename Storage::scalar_t;
+        using rep_t = matrix_traits<Storage>;
+        auto a = matrix<rep_t>{ std::pair(n, n) };
+        auto b = matrix<rep_t>{ std::pair(n, n) };
+        auto id = matrix<rep_t>{ std::pair(n, n) };
+        auto x = matrix<rep_t>{ std::pair(size_t(1), n * n) };
+        auto y = matrix<rep_t>{ std::pair(size_t(1), n * n) };
+        fill_square(a, 0);
+        fill_square(b, 5);
+        std::fill(id.data().begin(), id.data().begin() + n * n, Scalar(0));
+        for (auto i = size_t(0); i < n; ++i) id(i, i) = Scalar(1);
+        fill_vector(x, 0);
+        fill_vector(y, 3);
+        common_benchmarks(suite, storage, a, b, id, x, y);
+
+        auto& pool = default_thread_pool();
+        auto const dn = double(n);
+        auto const nn = dn * dn;
+        auto const s = double(sizeof(Scalar));
+        auto const scalar = scalar_name<Scalar>;
+        auto square = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, storage, n, n, flops, bytes, f); };
+        auto vector = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, storage, 1, n * n, flops, bytes, f); };
+
+        // Strassen-Winograd at the conventional flop count, so its rate compares with multiply's;
+        // orders within strassen_cutoff() measure the fallback
+        square("strassen_multiply", 2.0 * nn * dn, 3.0 * nn * s, [&] { return strassen_multiply(a, b); });
+        square("strassen_multiply[pool]", 2.0 * nn * dn, 3.0 * nn * s, [&] { return strassen_multiply(pool, a, b); });
+
+        // Parallel overloads on the default pool; small sizes measure the sequential fallback
+        square("multiply[pool]", 2.0 * nn * dn, 3.0 * nn * s, [&] { return multiply(pool, a, b); });
+        square("scalar_multiply[pool]", nn, 2.0 * nn * s, [&] { return multiply(pool, a, Scalar(2)); });
+        square("divide[pool]", nn, 2.0 * nn * s, [&] { return divide(pool, a, Scalar(2)); });
+        square("add[pool]", nn, 3.0 * nn * s, [&] { return add(pool, a, b); });
+        square("subtract[pool]", nn, 3.0 * nn * s, [&] { return subtract(pool, a, b); });
+        square("transpose[pool]", 0.0, 2.0 * nn * s, [&] { return transpose(pool, a); });
+        vector("inner_product[pool]", 2.0 * nn, 2.0 * nn * s, [&] { return inner_product(pool, x, y); });
+        vector("modulus[pool]", 2.0 * nn, nn * s, [&] { return modulus(pool, x); });
+        vector("modulus_squared[pool]", 2.0 * nn, nn * s, [&] { return modulus_squared(pool, x); });
+        square("determinant[pool]", 2.0 * nn * dn / 3.0, nn * s, [&] { return determinant(pool, a); });
+        square("inverse[pool]", 2.0 * nn * dn, 2.0 * nn * s, [&] { return inverse(pool, a); });
+        square("lu[pool]", 2.0 * nn * dn / 3.0, 2.0 * nn * s, [&] { return lu(pool, a); });
+        square("cholesky[pool]", nn * dn / 3.0, 2.0 * nn * s, [&] { return cholesky(pool, a); });
+        auto const la = lu(pool, a);
+        auto const ch = cholesky(pool, a);
+        square("solve[pool]", 2.0 * nn * dn / 3.0 + 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(pool, a, b); });
+        square("solve_lu[pool]", 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(pool, la, b); });
+        square("solve_cholesky[pool]", 2.0 * nn * dn, 3.0 * nn * s, [&] { return solve(pool, ch, b); });
+    }
+
+    template<class Scalar>
+    void scalar_benchmarks(bench_suite& suite)
+    {
+        auto const& opts = suite.options();
+        if (!opts.scalar.empty() && opts.scalar != scalar_name<Scalar>) return;
+        if (opts.storage.empty() || opts.storage == "fixed")
+        {
+            fixed_benchmarks<Scalar, 2>(suite);
+            fixed_benchmarks<Scalar, 3>(suite);
+            fixed_benchmarks<Scalar, 4>(suite);
+            fixed_benchmarks<Scalar, 6>(suite);
+            fixed_benchmarks<Scalar, 8>(suite);
+            fixed_benchmarks<Scalar, 12>(suite);
+            fixed_benchmarks<Scalar, 16>(suite);
+        }
+        if (opts.storage.empty() || opts.storage == "small")
+        {
+            using storage_t = std::experimental::la::small_dynamic_matrix<Scalar, 64>;
+            for (auto n : { size_t(2), size_t(3), size_t(4), size_t(6), size_t(8) }) dynamic_benchmarks<storage_t>(suite, "small", n);
+        }
+        if (opts.storage.empty() || opts.storage == "dynamic")
+        {
+            for (auto n = size_t(16); n <= opts.max_size; n *= 2)
+            {
+                if (n >= opts.min_size) dynamic_benchmarks<std::experimental::la::dynamic_size_matrix<Scalar>>(suite, "dynamic", n);
+            }
+        }
+    }
+
+    // Reduced precision storage runs the bandwidth-bound kernels that widen to float
+    template<class Scalar>
+    void reduced_benchmarks(bench_suite& suite)
+    {
+        using namespace std::experimental::la;
+        using rep_t = matrix_traits<dynamic_size_matrix<Scalar>>;
+        auto const& opts = suite.options();
+        if (!opts.scalar.empty() && opts.scalar != scalar_name<Scalar>) return;
+        if (!opts.storage.empty() && opts.storage != "dynamic") return;
+        auto& pool = default_thread_pool();
+        for (auto n = size_t(16); n <= opts.max_size; n *= 2)
+        {
+            if (n < opts.min_size) continue;
+            auto a = matrix<rep_t>{ std::pair(n, n) };
+            auto b = matrix<rep_t>{ std::pair(n, n) };
+            auto x = matrix<rep_t>{ std::pair(size_t(1), n * n) };
+            auto y = matrix<rep_t>{ std::pair(size_t(1), n * n) };
+            fill_square(a, 0);
+            fill_square(b, 5);
+            fill_vector(x, 0);
+            fill_vector(y, 3);
+            do_not_optimize(a);
+            do_not_optimize(b);
+            do_not_optimize(x);
+            do_not_optimize(y);
+            auto const dn = double(n);
+            auto const nn = dn * dn;
+            auto const s = double(sizeof(Scalar));
+            auto const scalar = scalar_name<Scalar>;
+            auto square = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, "dynamic", n, n, flops, bytes, f); };
+            auto vector = [&](char const* op, double flops, double bytes, auto&& f) { suite.run(op, scalar, "dynamic", 1, n * n, flops, bytes, f); };
+            square("scalar_multiply", nn, 2.0 * nn * s, [&] { return matrix<rep_t>(a * Scalar(2.0f)); });
+            square("add", nn, 3.0 * nn * s, [&] { return matrix<rep_t>(a + b); });
+            square("multiply", 2.0 * nn * dn, 3.0 * nn * s, [&] { return a * b; });
+            square("multiply[pool]", 2.0 * nn * dn, 3.0 * nn * s, [&] { return multiply(pool, a, b); });
+            vector("inner_product", 2.0 * nn, 2.0 * nn * s, [&] { return inner_product(x, y); });
+            vector("modulus", 2.0 * nn, nn * s, [&] { return modulus(x); });
+            vector("inner_product[pool]", 2.0 * nn, 2.0 * nn * s, [&] { return inner_product(pool, x, y); });
+        }
+    }
+
+    [[noreturn]] void usage(char const* name)
+    {
+        std::fprintf(stderr, "usage: %s [--filter text] [--scalar float|double|half|bf16] [--storage fixed|small|dynamic] [--min-size n] [--max-size n]"
+            " [--repetitions n] [--min-time seconds] [--json file|-]\n", name);
+        std::exit(2);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto opts = bench_options{};
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string(argv[i]);
+        if (i + 1 >= argc) usage(argv[0]);
+        auto const value = std::string(argv[++i]);
+        if (arg == "--filter") opts.filter = value;
+        else if (arg == "--scalar") opts.scalar = value;
+        else if (arg == "--storage") opts.storage = value;
+        else if (arg == "--min-size") opts.min_size = std::stoul(value);
+        else if (arg == "--max-size") opts.max_size = std::stoul(value);
+        else if (arg == "--repetitions") opts.repetitions = std::stoul(value);
+        else if (arg == "--min-time") opts.min_time = std::stod(value);
+        else if (arg == "--json") opts.json = value;
+        else usage(argv[0]);
+    }
+
+    auto suite = bench_suite(opts);
+    scalar_benchmarks<float>(suite);
+    scalar_benchmarks<double>(suite);
+    reduced_benchmarks<std::experimental::la::half>(suite);
+    reduced_benchmarks<std::experimental::la::bfloat16>(suite);
+
+    suite.print_table(std::cout);
+    if (opts.json == "-") suite.write_json(std::cout);
+    else if (!opts.json.empty())
+    {
+        auto os = std::ofstream(opts.json);
+        if (!os)
+        {
+            std::fprintf(stderr, "cannot open %s\n", opts.json.c_str());
+            return 1;
+        }
+        suite.write_json(os);
+    }
+}
@@ -2,6 +2,14 @@
 #define LINEAR_ALGEBRA_18_07_29_15_04_10
 
 #include <initializer_list>
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "matrix_expression.h"
+#include "matrix_decomposition.h"
+#include "matrix_thread_pool.h"
+#include "matrix_instrument.h"
 
 namespace std::experimental::la {
     ////////////////////////////////////////////////////////
@@ -15,8 +23,14 @@ namespace std::experimental::la {
         // Constructors
         constexpr matrix() = default;
         constexpr explicit matrix(const matrix_t&) noexcept;
+        constexpr explicit matrix(matrix_t&&) noexcept;
         constexpr matrix(std::initializer_list<scalar_t>) noexcept;
         constexpr matrix(std::pair<size_t, size_t>) noexcept;
+        template<class Expr, class = std::enable_if_t<std::is_same_v<typename Expr::rep_t, Rep>>>
+        constexpr matrix(matrix_expression<Expr> const&) noexcept;       // Evaluates the expression in one pass
+        // Assignment
+        template<class Expr, class = std::enable_if_t<std::is_same_v<typename Expr::rep_t, Rep>>>
+        constexpr matrix<Rep>& operator=(matrix_expression<Expr> const& rhs) noexcept;
         // Accessors
         constexpr matrix_t const& data() const noexcept;
         constexpr matrix_t& data() noexcept;
@@ -31,34 +45,82 @@ namespace std::experimental::la {
         // Matrix binary operators
         constexpr matrix<Rep>& operator+=(matrix<Rep> const& rhs) noexcept;
         constexpr matrix<Rep>& operator-=(matrix<Rep> const& rhs) noexcept;
+        constexpr matrix<Rep>& operator*=(matrix<Rep> const& rhs);             // rhs square; see multiply_assign in matrix_traits.h
+        template<class Expr, class = std::enable_if_t<std::is_same_v<typename Expr::rep_t, Rep>>>
+        constexpr matrix<Rep>& operator+=(matrix_expression<Expr> const& rhs) noexcept;
+        template<class Expr, class = std::enable_if_t<std::is_same_v<typename Expr::rep_t, Rep>>>
+        constexpr matrix<Rep>& operator-=(matrix_expression<Expr> const& rhs) noexcept;
         
         matrix_t _Data;
     };
     
     // Scalar binary operators
-    template<class Rep>
-    constexpr matrix<Rep> operator*(matrix<Rep> const& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept;
+    // These and the element-wise matrix operators accept matrices or expressions and return
+    // an expression, evaluated when assigned to a matrix (see matrix_expression.h)
+    template<class M, class = std::enable_if_t<detail::is_matrix_operand_v<M>>>
+    constexpr auto operator*(M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs) noexcept;
     
-    template<class Rep>
-    constexpr matrix<Rep> operator*(typename matrix<Rep>::scalar_t const& rhs, matrix<Rep> const& lhs) noexcept;
+    template<class M, class = std::enable_if_t<detail::is_matrix_operand_v<M>>>
+    constexpr auto operator*(typename detail::operand_rep_t<M>::scalar_t const& lhs, M&& rhs) noexcept;
     
-    template<class Rep>
-    constexpr matrix<Rep> operator/(matrix<Rep> const& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept;
+    template<class M, class = std::enable_if_t<detail::is_matrix_operand_v<M>>>
+    constexpr auto operator/(M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs) noexcept;
+    
+    // A temporary matrix operand is updated in place and returned, reusing its storage.
+    // Views are excluded, as updating one would write through to the matrix it views
+    template<class Rep, class = std::enable_if_t<!detail::is_view_rep_v<Rep>>>
+    constexpr matrix<Rep> operator*(matrix<Rep>&& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept;
+    
+    template<class Rep, class = std::enable_if_t<!detail::is_view_rep_v<Rep>>>
+    constexpr matrix<Rep> operator*(typename matrix<Rep>::scalar_t const& lhs, matrix<Rep>&& rhs) noexcept;
+    
+    template<class Rep, class = std::enable_if_t<!detail::is_view_rep_v<Rep>>>
+    constexpr matrix<Rep> operator/(matrix<Rep>&& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept;
     
     // Matrix binary operators
-    template<class Rep>
-    constexpr matrix<Rep> operator+(matrix<Rep> const& lhs, matrix<Rep> const& rhs) noexcept;
+    template<class Lhs, class Rhs, class = std::enable_if_t<std::is_same_v<detail::operand_rep_t<Lhs>, detail::operand_rep_t<Rhs>>>>
+    constexpr auto operator+(Lhs&& lhs, Rhs&& rhs) noexcept;
     
-    template<class Rep>
-    constexpr matrix<Rep> operator-(matrix<Rep> const& lhs, matrix<Rep> const& rhs) noexcept;
+    template<class Lhs, class Rhs, class = std::enable_if_t<std::is_same_v<detail::operand_rep_t<Lhs>, detail::operand_rep_t<Rhs>>>>
+    constexpr auto operator-(Lhs&& lhs, Rhs&& rhs) noexcept;
+    
+    template<class Rep, class Rhs, class = std::enable_if_t<std::is_same_v<Rep, detail::operand_rep_t<Rhs>>>>
+    constexpr matrix<Rep> operator+(matrix<Rep>&& lhs, Rhs&& rhs) noexcept;
+    
+    template<class Lhs, class Rep, class = std::enable_if_t<std::is_same_v<detail::operand_rep_t<Lhs>, Rep>>>
+    constexpr matrix<Rep> operator+(Lhs&& lhs, matrix<Rep>&& rhs) noexcept;
+    
+    template<class Rep, class = std::enable_if_t<!detail::is_view_rep_v<Rep>>>
+    constexpr matrix<Rep> operator+(matrix<Rep>&& lhs, matrix<Rep>&& rhs) noexcept;
+    
+    template<class Rep, class Rhs, class = std::enable_if_t<std::is_same_v<Rep, detail::operand_rep_t<Rhs>>>>
+    constexpr matrix<Rep> operator-(matrix<Rep>&& lhs, Rhs&& rhs) noexcept;
+    
+    template<class Lhs, class Rep, class = std::enable_if_t<std::is_same_v<detail::operand_rep_t<Lhs>, Rep>>>
+    constexpr matrix<Rep> operator-(Lhs&& lhs, matrix<Rep>&& rhs) noexcept;
+    
+    template<class Rep, class = std::enable_if_t<!detail::is_view_rep_v<Rep>>>
+    constexpr matrix<Rep> operator-(matrix<Rep>&& lhs, matrix<Rep>&& rhs) noexcept;
     
     template<class Rep1, class Rep2>
-    constexpr auto operator*(matrix<Rep1> const& lhs, matrix<Rep2> const& rhs) noexcept;
+    constexpr auto operator*(matrix<Rep1> const& lhs, matrix<Rep2> const& rhs)
+        noexcept(noexcept(Rep1::template matrix_multiply<Rep2>(std::declval<typename Rep1::matrix_t const&>(), std::declval<typename Rep2::matrix_t const&>())));
+    
+    // Strassen-Winograd product, for large float and double operands whose accuracy needs
+    // allow its normwise error bound (see matrix_strassen.h); other operands multiply as usual
+    template<class Rep1, class Rep2>
+    matrix<typename Rep1::template multiply_t<Rep2>> strassen_multiply(matrix<Rep1> const& lhs, matrix<Rep2> const& rhs);
     
     // Matrix Functions
     template<class Rep>
     constexpr auto transpose(matrix<Rep> const&) noexcept;
     
+    // Transposes without a second buffer: square matrices by swapping tiles across the
+    // diagonal, rectangular ones by following the permutation's cycles, which needs a
+    // storage with reshape() such as dynamic_size_matrix and a bit of workspace per element
+    template<class Rep>
+    constexpr void transpose_inplace(matrix<Rep>&);
+    
     template<class Rep>
     constexpr auto submatrix(matrix<Rep> const&, size_t p, size_t q) noexcept;
     
@@ -80,20 +142,140 @@ namespace std::experimental::la {
     constexpr bool is_identity(matrix<Rep> const&) noexcept;
     
     template<class Rep>
-    constexpr bool is_invertible(matrix<Rep> const&) noexcept;
+    constexpr bool is_invertible(matrix<Rep> const&) noexcept(noexcept(Rep::is_invertible(std::declval<typename Rep::matrix_t const&>())));
     
     // SquareMatrix functions
     template<class Rep>
     constexpr matrix<Rep> identity() noexcept;
     
     template<class Rep>
-    constexpr typename Rep::scalar_t determinant(matrix<Rep> const&) noexcept;
+    constexpr typename Rep::scalar_t determinant(matrix<Rep> const&) noexcept(noexcept(Rep::determinant(std::declval<typename Rep::matrix_t const&>())));
     
     template<class Rep>
-    constexpr matrix<typename Rep::transpose_t> classical_adjoint(matrix<Rep> const&) noexcept;
+    constexpr matrix<typename Rep::transpose_t> classical_adjoint(matrix<Rep> const&) noexcept(noexcept(Rep::classical_adjoint(std::declval<typename Rep::matrix_t const&>())));
     
     template<class Rep>
     constexpr matrix<Rep> inverse(matrix<Rep> const&);
+    
+    // Linear systems
+    // The factorisations are computed once and can then solve against any number of
+    // right-hand sides, each solve costing only the triangular substitutions. A right-hand
+    // side passed as an rvalue is solved in place.
+    template<class M, class = std::enable_if_t<detail::is_matrix_operand_v<M>>>
+    constexpr lu_decomposition<typename detail::operand_rep_t<M>::matrix_t> lu(M&& mat);
+    
+    template<class M, class = std::enable_if_t<detail::is_matrix_operand_v<M>>>
+    constexpr cholesky_decomposition<typename detail::operand_rep_t<M>::matrix_t> cholesky(M&& mat);      // Symmetric positive definite only
+    
+    template<class Rep, class B, class = std::enable_if_t<detail::is_matrix_operand_v<B>>>
+    constexpr matrix<detail::operand_rep_t<B>> solve(matrix<Rep> const& a, B&& b);                    // b may hold several right-hand sides, one per column
+    
+    template<class Storage, class B, class = std::enable_if_t<detail::is_matrix_operand_v<B>>>
+    constexpr matrix<detail::operand_rep_t<B>> solve(lu_decomposition<Storage> const& a, B&& b);
+    
+    template<class Storage, class B, class = std::enable_if_t<detail::is_matrix_operand_v<B>>>
+    constexpr matrix<detail::operand_rep_t<B>> solve(cholesky_decomposition<Storage> const& a, B&& b);
+    
+    // In-place updates
+    // These accumulate into an existing matrix, in one pass over it, rather than returning a
+    // new one. Beyond the per-thread gemm workspace, which only grows, float and double
+    // operands allocate nothing. The destination must not overlap the other operands.
+    template<class Rep1, class Rep2>
+    constexpr void gemm(typename Rep1::scalar_t alpha, matrix<Rep1> const& a, matrix<Rep2> const& b,
+        typename Rep1::scalar_t beta, matrix<typename Rep1::template multiply_t<Rep2>>& c);                    // c = alpha * a * b + beta * c
+    
+    template<class Rep>
+    constexpr void axpy(typename Rep::scalar_t alpha, matrix<Rep> const& x, matrix<Rep>& y) noexcept;        // y = alpha * x + y
+    
+    template<class Rep>
+    constexpr void axpby(typename Rep::scalar_t alpha, matrix<Rep> const& x, typename Rep::scalar_t beta, matrix<Rep>& y) noexcept;    // y = alpha * x + beta * y
+    
+    template<class Rep, class Rep1, class Rep2>
+    constexpr void rank_1_update(typename Rep::scalar_t alpha, matrix<Rep1> const& x, matrix<Rep2> const& y, matrix<Rep>& a);      // a = alpha * x * transpose(y) + a, for vectors x and y
+    
+    template<class Rep1, class Rep2>
+    constexpr void rank_k_update(typename Rep1::scalar_t alpha, matrix<Rep1> const& a, typename Rep1::scalar_t beta, matrix<Rep2>& c); // c = alpha * a * transpose(a) + beta * c
+    
+    // Parallel overloads
+    // exec is a thread_pool or a standard execution policy (see matrix_thread_pool.h).
+    // Operands below the parallel thresholds are handled on the calling thread.
+    template<class Exec, class Rep1, class Rep2, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<typename Rep1::template multiply_t<Rep2>> multiply(Exec&& exec, matrix<Rep1> const& lhs, matrix<Rep2> const& rhs);
+    
+    template<class Exec, class Rep1, class Rep2, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<typename Rep1::template multiply_t<Rep2>> strassen_multiply(Exec&& exec, matrix<Rep1> const& lhs, matrix<Rep2> const& rhs);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    matrix<detail::operand_rep_t<M>> multiply(Exec&& exec, M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    matrix<detail::operand_rep_t<M>> divide(Exec&& exec, M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    matrix<detail::operand_rep_t<M>> add(Exec&& exec, M&& lhs, matrix<detail::operand_rep_t<M>> const& rhs);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    matrix<detail::operand_rep_t<M>> subtract(Exec&& exec, M&& lhs, matrix<detail::operand_rep_t<M>> const& rhs);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<typename Rep::transpose_t> transpose(Exec&& exec, matrix<Rep> const& mat);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    typename Rep::scalar_t inner_product(Exec&& exec, matrix<Rep> const& lhs, matrix<Rep> const& rhs);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    typename Rep::scalar_t modulus(Exec&& exec, matrix<Rep> const& vec);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    typename Rep::scalar_t modulus_squared(Exec&& exec, matrix<Rep> const& vec);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    typename Rep::scalar_t determinant(Exec&& exec, matrix<Rep> const& mat);
+    
+    template<class Exec, class Rep, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<Rep> inverse(Exec&& exec, matrix<Rep> const& mat);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    lu_decomposition<typename detail::operand_rep_t<M>::matrix_t> lu(Exec&& exec, M&& mat);
+    
+    template<class Exec, class M, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<M>>>
+    cholesky_decomposition<typename detail::operand_rep_t<M>::matrix_t> cholesky(Exec&& exec, M&& mat);
+    
+    template<class Exec, class Rep, class B, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<B>>>
+    matrix<detail::operand_rep_t<B>> solve(Exec&& exec, matrix<Rep> const& a, B&& b);
+    
+    template<class Exec, class Storage, class B, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<B>>>
+    matrix<detail::operand_rep_t<B>> solve(Exec&& exec, lu_decomposition<Storage> const& a, B&& b);
+    
+    template<class Exec, class Storage, class B, class = std::enable_if_t<detail::is_execution_v<Exec> && detail::is_matrix_operand_v<B>>>
+    matrix<detail::operand_rep_t<B>> solve(Exec&& exec, cholesky_decomposition<Storage> const& a, B&& b);
+    
+    template<class Exec, class Rep1, class Rep2, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    void gemm(Exec&& exec, typename Rep1::scalar_t alpha, matrix<Rep1> const& a, matrix<Rep2> const& b,
+        typename Rep1::scalar_t beta, matrix<typename Rep1::template multiply_t<Rep2>>& c);
+    
+    namespace detail {
+        // A matrix an operation may overwrite and return: rvalues are moved from, lvalues are
+        // copied keeping their allocator, and expressions are evaluated
+        template<class Rep>
+        constexpr matrix<Rep> working_copy(matrix<Rep> const& mat);
+        template<class Rep>
+        constexpr matrix<Rep> working_copy(matrix<Rep>&& mat) noexcept;
+        template<class E>
+        constexpr auto working_copy(matrix_expression<E> const& expr);
+        template<class View>
+        constexpr matrix<typename view_traits<View>::owning_rep_t> working_copy(matrix<view_traits<View>> const& mat);
+        template<class View>
+        constexpr matrix<typename view_traits<View>::owning_rep_t> working_copy(matrix<view_traits<View>>&& mat);
+
+        // Operand sizes for the instrumentation estimates, matrices and expressions alike
+        template<class M>
+        constexpr double operand_elements(M const& mat) noexcept;
+        template<class M>
+        constexpr double operand_bytes(M const& mat) noexcept;
+        template<class M>
+        constexpr double lu_flops(M const& mat) noexcept;              // 2n^3/3 for n x n
+    }
 }
 
 ////////////////////////////////////////////////////////
@@ -105,6 +287,11 @@ inline constexpr std::experimental::la::matrix<Rep>::matrix(const matrix_t& dat)
     : _Data(dat)
 {}
 
+template<class Rep>
+inline constexpr std::experimental::la::matrix<Rep>::matrix(matrix_t&& dat) noexcept
+    : _Data(std::move(dat))
+{}
+
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep>::matrix(std::initializer_list<scalar_t> il) noexcept
     : _Data(il)
@@ -115,6 +302,33 @@ inline constexpr std::experimental::la::matrix<Rep>::matrix(std::pair<size_t, si
     : _Data(size)
 {}
 
+template<class Rep>
+template<class Expr, class>
+inline constexpr std::experimental::la::matrix<Rep>::matrix(matrix_expression<Expr> const& expr) noexcept
+    : _Data(expr.self().size())
+{
+    _LA_INSTRUMENT("evaluate", detail::operand_elements(expr) * detail::expression_operations_v<Expr>, detail::operand_bytes(expr) * (detail::expression_operands_v<Expr> + 1),
+        detail::evaluate_expression(_Data, expr, [](const auto&, const auto& el) { return el; }));
+}
+
+// Assignment
+template<class Rep>
+template<class Expr, class>
+inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator=(matrix_expression<Expr> const& rhs) noexcept
+{
+    // Element i of the result depends only on element i of each operand, so the
+    // expression may safely refer to this matrix
+    _LA_INSTRUMENT("evaluate", detail::operand_elements(rhs) * detail::expression_operations_v<Expr>, detail::operand_bytes(rhs) * (detail::expression_operands_v<Expr> + 1), [&] {
+        auto const size = rhs.self().size();
+        if constexpr (std::is_move_assignable_v<matrix_t>)
+        {
+            if (size != std::pair(_Data.rows(), _Data.cols())) _Data = detail::make_storage<matrix_t>(_Data, size);
+        }
+        detail::evaluate_expression(_Data, rhs, [](const auto&, const auto& el) { return el; });
+    }());
+    return *this;
+}
+
 // Accessors
 template<class Rep>
 inline constexpr typename std::experimental::la::matrix<Rep>::matrix_t const& std::experimental::la::matrix<Rep>::data() const noexcept
@@ -144,27 +358,27 @@ inline constexpr typename std::experimental::la::matrix<Rep>::scalar_t& std::exp
 template<class Rep>
 inline constexpr bool std::experimental::la::matrix<Rep>::operator==(matrix<Rep> const& rhs) const noexcept
 {
-    return Rep::equal(data(), rhs.data());
+    return _LA_INSTRUMENT("equal", 0, 2 * detail::operand_bytes(*this), Rep::equal(data(), rhs.data()));
 }
 
 template<class Rep>
 inline constexpr bool std::experimental::la::matrix<Rep>::operator!=(matrix<Rep> const& rhs) const noexcept
 {
-    return Rep::not_equal(data(), rhs.data());
+    return _LA_INSTRUMENT("equal", 0, 2 * detail::operand_bytes(*this), Rep::not_equal(data(), rhs.data()));
 }
 
 // Scalar member binary operators
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator*=(typename matrix<Rep>::scalar_t const& rhs) noexcept
 {
-    Rep::scalar_multiply(_Data, rhs);
+    _LA_INSTRUMENT("scalar_multiply", detail::operand_elements(*this), 2 * detail::operand_bytes(*this), Rep::scalar_multiply(_Data, rhs));
     return *this;
 }
 
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator/=(typename matrix<Rep>::scalar_t const& rhs) noexcept
 {
-    Rep::divide(_Data, rhs);
+    _LA_INSTRUMENT("divide", detail::operand_elements(*this), 2 * detail::operand_bytes(*this), Rep::divide(_Data, rhs));
     return *this;
 }
 
@@ -172,110 +386,213 @@ inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matr
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator+=(matrix<Rep> const& rhs) noexcept
 {
-    Rep::add(_Data, rhs.data());
+    _LA_INSTRUMENT("add", detail::operand_elements(*this), 3 * detail::operand_bytes(*this), Rep::add(_Data, rhs.data()));
     return *this;
 }
 
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator-=(matrix<Rep> const& rhs) noexcept
 {
-    Rep::subtract(_Data, rhs.data());
+    _LA_INSTRUMENT("subtract", detail::operand_elements(*this), 3 * detail::operand_bytes(*this), Rep::subtract(_Data, rhs.data()));
     return *this;
 }
 
-// Scalar non-member binary operators
 template<class Rep>
-inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator*(std::experimental::la::matrix<Rep> const& lhs, typename std::experimental::la::matrix<Rep>::scalar_t const& rhs) noexcept
+inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator*=(matrix<Rep> const& rhs)
 {
-    auto res(lhs);
-    return res *= rhs;
+    _LA_INSTRUMENT("multiply_assign", 2 * detail::operand_elements(*this) * double(rhs.data().cols()), 2 * detail::operand_bytes(*this) + detail::operand_bytes(rhs),
+        Rep::multiply_assign(_Data, rhs.data()));
+    return *this;
 }
 
 template<class Rep>
-inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator*(typename std::experimental::la::matrix<Rep>::scalar_t const& lhs, std::experimental::la::matrix<Rep> const& rhs) noexcept
+template<class Expr, class>
+inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator+=(matrix_expression<Expr> const& rhs) noexcept
 {
-    auto res(rhs);
-    Rep::scalar_multiply(res.data(), lhs);
-    return res;
+    _LA_INSTRUMENT("evaluate", detail::operand_elements(rhs) * (detail::expression_operations_v<Expr> + 1), detail::operand_bytes(rhs) * (detail::expression_operands_v<Expr> + 2),
+        detail::evaluate_expression(_Data, rhs, [](const auto& lel, const auto& rel) { return lel + rel; }));
+    return *this;
 }
 
 template<class Rep>
-inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator/(std::experimental::la::matrix<Rep> const& lhs, typename std::experimental::la::matrix<Rep>::scalar_t const& rhs) noexcept
+template<class Expr, class>
+inline constexpr std::experimental::la::matrix<Rep>& std::experimental::la::matrix<Rep>::operator-=(matrix_expression<Expr> const& rhs) noexcept
+{
+    _LA_INSTRUMENT("evaluate", detail::operand_elements(rhs) * (detail::expression_operations_v<Expr> + 1), detail::operand_bytes(rhs) * (detail::expression_operands_v<Expr> + 2),
+        detail::evaluate_expression(_Data, rhs, [](const auto& lel, const auto& rel) { return lel - rel; }));
+    return *this;
+}
+
+// Scalar non-member binary operators
+template<class M, class>
+inline constexpr auto std::experimental::la::operator*(M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs) noexcept
+{
+    using scalar_t = typename detail::operand_rep_t<M>::scalar_t;
+    return matrix_scalar_expression<std::multiplies<>, detail::expression_operand_t<M>, scalar_t>(std::forward<M>(lhs), rhs);
+}
+
+template<class M, class>
+inline constexpr auto std::experimental::la::operator*(typename detail::operand_rep_t<M>::scalar_t const& lhs, M&& rhs) noexcept
+{
+    using scalar_t = typename detail::operand_rep_t<M>::scalar_t;
+    return matrix_scalar_expression<std::multiplies<>, detail::expression_operand_t<M>, scalar_t>(std::forward<M>(rhs), lhs);
+}
+
+template<class M, class>
+inline constexpr auto std::experimental::la::operator/(M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs) noexcept
+{
+    using scalar_t = typename detail::operand_rep_t<M>::scalar_t;
+    return matrix_scalar_expression<std::divides<>, detail::expression_operand_t<M>, scalar_t>(std::forward<M>(lhs), rhs);
+}
+
+template<class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator*(matrix<Rep>&& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept
+{
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+template<class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator*(typename matrix<Rep>::scalar_t const& lhs, matrix<Rep>&& rhs) noexcept
+{
+    rhs *= lhs;
+    return std::move(rhs);
+}
+
+template<class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator/(matrix<Rep>&& lhs, typename matrix<Rep>::scalar_t const& rhs) noexcept
 {
-    auto res(lhs);
-    return res /= rhs;
+    lhs /= rhs;
+    return std::move(lhs);
 }
 
 // Matrix non-member binary operators
-template<class Rep>
-inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator+(std::experimental::la::matrix<Rep> const& lhs, std::experimental::la::matrix<Rep> const& rhs) noexcept
+template<class Lhs, class Rhs, class>
+inline constexpr auto std::experimental::la::operator+(Lhs&& lhs, Rhs&& rhs) noexcept
 {
-    auto res(lhs);
-    return res += rhs;
+    return matrix_binary_expression<std::plus<>, detail::expression_operand_t<Lhs>, detail::expression_operand_t<Rhs>>(std::forward<Lhs>(lhs), std::forward<Rhs>(rhs));
 }
 
-template<class Rep>
-inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator-(std::experimental::la::matrix<Rep> const& lhs, std::experimental::la::matrix<Rep> const& rhs) noexcept
+template<class Lhs, class Rhs, class>
+inline constexpr auto std::experimental::la::operator-(Lhs&& lhs, Rhs&& rhs) noexcept
+{
+    return matrix_binary_expression<std::minus<>, detail::expression_operand_t<Lhs>, detail::expression_operand_t<Rhs>>(std::forward<Lhs>(lhs), std::forward<Rhs>(rhs));
+}
+
+template<class Rep, class Rhs, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator+(matrix<Rep>&& lhs, Rhs&& rhs) noexcept
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+template<class Lhs, class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator+(Lhs&& lhs, matrix<Rep>&& rhs) noexcept
+{
+    rhs = std::forward<Lhs>(lhs) + std::as_const(rhs);
+    return std::move(rhs);
+}
+
+template<class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator+(matrix<Rep>&& lhs, matrix<Rep>&& rhs) noexcept
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+template<class Rep, class Rhs, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator-(matrix<Rep>&& lhs, Rhs&& rhs) noexcept
 {
-    auto res(lhs);
-    return res -= rhs;
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+template<class Lhs, class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator-(Lhs&& lhs, matrix<Rep>&& rhs) noexcept
+{
+    rhs = std::forward<Lhs>(lhs) - std::as_const(rhs);
+    return std::move(rhs);
+}
+
+template<class Rep, class>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::operator-(matrix<Rep>&& lhs, matrix<Rep>&& rhs) noexcept
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+template<class Rep1, class Rep2>
+inline constexpr auto std::experimental::la::operator*(std::experimental::la::matrix<Rep1> const& lhs, std::experimental::la::matrix<Rep2> const& rhs)
+    noexcept(noexcept(Rep1::template matrix_multiply<Rep2>(std::declval<typename Rep1::matrix_t const&>(), std::declval<typename Rep2::matrix_t const&>())))
+{
+    return _LA_INSTRUMENT("multiply", 2 * detail::operand_elements(lhs) * double(rhs.data().cols()),
+        detail::operand_bytes(lhs) + detail::operand_bytes(rhs) + double(lhs.data().rows()) * double(rhs.data().cols()) * sizeof(typename Rep1::scalar_t),
+        matrix<typename Rep1::template multiply_t<Rep2>>(Rep1::template matrix_multiply<Rep2>(lhs.data(), rhs.data())));
 }
 
 template<class Rep1, class Rep2>
-inline constexpr auto std::experimental::la::operator*(std::experimental::la::matrix<Rep1> const& lhs, std::experimental::la::matrix<Rep2> const& rhs) noexcept
+inline std::experimental::la::matrix<typename Rep1::template multiply_t<Rep2>> std::experimental::la::strassen_multiply(matrix<Rep1> const& lhs, matrix<Rep2> const& rhs)
 {
-    return matrix<typename Rep1::template multiply_t<Rep2>>(Rep1::template matrix_multiply<Rep2>(lhs.data(), rhs.data()));
+    return _LA_INSTRUMENT("strassen_multiply", 2 * detail::operand_elements(lhs) * double(rhs.data().cols()),
+        detail::operand_bytes(lhs) + detail::operand_bytes(rhs) + double(lhs.data().rows()) * double(rhs.data().cols()) * sizeof(typename Rep1::scalar_t),
+        matrix<typename Rep1::template multiply_t<Rep2>>(Rep1::template strassen_multiply<Rep2>(nullptr, lhs.data(), rhs.data())));
 }
 
 // Matrix functions
 template<class Rep>
 inline constexpr auto std::experimental::la::transpose(matrix<Rep> const& mat) noexcept
 {
-    return matrix<typename Rep::transpose_t>(Rep::transpose(mat.data()));
+    return _LA_INSTRUMENT("transpose", 0, 2 * detail::operand_bytes(mat), matrix<typename Rep::transpose_t>(Rep::transpose(mat.data())));
+}
+
+template<class Rep>
+inline constexpr void std::experimental::la::transpose_inplace(matrix<Rep>& mat)
+{
+    _LA_INSTRUMENT("transpose_inplace", 0, 2 * detail::operand_bytes(mat), Rep::transpose_inplace(mat.data()));
 }
 
 template<class Rep>
 inline constexpr auto std::experimental::la::submatrix(matrix<Rep> const& mat, size_t p, size_t q) noexcept
 {
-    return matrix<typename Rep::submatrix_t>(Rep::submatrix(mat.data(), p, q));
+    return _LA_INSTRUMENT("submatrix", 0, 2 * detail::operand_bytes(mat), matrix<typename Rep::submatrix_t>(Rep::submatrix(mat.data(), p, q)));
 }
 
 // Vector functions
 template<class Rep>
 inline constexpr typename Rep::scalar_t std::experimental::la::inner_product(matrix<Rep> const& lhs, matrix<Rep> const& rhs) noexcept
 {
-    return Rep::inner_product(lhs.data(), rhs.data());
+    return _LA_INSTRUMENT("inner_product", 2 * detail::operand_elements(lhs), 2 * detail::operand_bytes(lhs), Rep::inner_product(lhs.data(), rhs.data()));
 }
 
 template<class Rep>
 inline constexpr typename Rep::scalar_t std::experimental::la::modulus(matrix<Rep> const& vec) noexcept
 {
-    return Rep::modulus(vec.data());
+    return _LA_INSTRUMENT("modulus", 2 * detail::operand_elements(vec), detail::operand_bytes(vec), Rep::modulus(vec.data()));
 }
 
 template<class Rep>
 inline constexpr typename Rep::scalar_t std::experimental::la::modulus_squared(matrix<Rep> const& vec) noexcept
 {
-    return Rep::modulus_squared(vec.data());
+    return _LA_INSTRUMENT("modulus_squared", 2 * detail::operand_elements(vec), detail::operand_bytes(vec), Rep::modulus_squared(vec.data()));
 }
 
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::unit(matrix<Rep> const& vec) noexcept
 {
-    return matrix<Rep>(Rep::unit(vec.data()));
+    return _LA_INSTRUMENT("unit", 3 * detail::operand_elements(vec), 3 * detail::operand_bytes(vec), matrix<Rep>(Rep::unit(vec.data())));
 }
 
 // Square matrix predicates
 template<class Rep>
 inline constexpr bool std::experimental::la::is_identity(matrix<Rep> const& mat) noexcept
 {
-    return Rep::is_identity(mat.data());
+    return _LA_INSTRUMENT("is_identity", 0, detail::operand_bytes(mat), Rep::is_identity(mat.data()));
 }
 
 template<class Rep>
-inline constexpr bool std::experimental::la::is_invertible(matrix<Rep> const& mat) noexcept
+inline constexpr bool std::experimental::la::is_invertible(matrix<Rep> const& mat) noexcept(noexcept(Rep::is_invertible(std::declval<typename Rep::matrix_t const&>())))
 {
-    return Rep::is_invertible(mat.data());
+    return _LA_INSTRUMENT("is_invertible", detail::lu_flops(mat), 2 * detail::operand_bytes(mat), Rep::is_invertible(mat.data()));
 }
 
 // SquareMatrix functions
@@ -286,21 +603,298 @@ inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::ident
 }
 
 template<class Rep>
-inline constexpr typename Rep::scalar_t std::experimental::la::determinant(matrix<Rep> const& mat) noexcept
+inline constexpr typename Rep::scalar_t std::experimental::la::determinant(matrix<Rep> const& mat) noexcept(noexcept(Rep::determinant(std::declval<typename Rep::matrix_t const&>())))
 {
-    return Rep::determinant(mat.data());
+    return _LA_INSTRUMENT("determinant", detail::lu_flops(mat), 2 * detail::operand_bytes(mat), Rep::determinant(mat.data()));
 }
 
 template<class Rep>
-inline constexpr std::experimental::la::matrix<typename Rep::transpose_t> std::experimental::la::classical_adjoint(matrix<Rep> const& mat) noexcept
+inline constexpr std::experimental::la::matrix<typename Rep::transpose_t> std::experimental::la::classical_adjoint(matrix<Rep> const& mat) noexcept(noexcept(Rep::classical_adjoint(std::declval<typename Rep::matrix_t const&>())))
 {
-    return matrix<typename Rep::transpose_t>(Rep::classical_adjoint(mat.data()));
+    return _LA_INSTRUMENT("classical_adjoint", 3 * detail::lu_flops(mat), 2 * detail::operand_bytes(mat), matrix<typename Rep::transpose_t>(Rep::classical_adjoint(mat.data())));
 }
 
 template<class Rep>
 inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::inverse(matrix<Rep> const& mat)
 {
-    return matrix<Rep>(Rep::inverse(mat.data()));
+    return _LA_INSTRUMENT("inverse", 3 * detail::lu_flops(mat), 2 * detail::operand_bytes(mat), matrix<Rep>(Rep::inverse(mat.data())));
+}
+
+// Linear systems
+template<class M, class>
+inline constexpr std::experimental::la::lu_decomposition<typename std::experimental::la::detail::operand_rep_t<M>::matrix_t> std::experimental::la::lu(M&& mat)
+{
+    return _LA_INSTRUMENT("lu", detail::lu_flops(mat), 2 * detail::operand_bytes(mat),
+        lu_decomposition<typename detail::operand_rep_t<M>::matrix_t>(std::move(detail::working_copy(std::forward<M>(mat)).data())));
+}
+
+template<class M, class>
+inline constexpr std::experimental::la::cholesky_decomposition<typename std::experimental::la::detail::operand_rep_t<M>::matrix_t> std::experimental::la::cholesky(M&& mat)
+{
+    return _LA_INSTRUMENT("cholesky", detail::lu_flops(mat) / 2, 2 * detail::operand_bytes(mat),
+        cholesky_decomposition<typename detail::operand_rep_t<M>::matrix_t>(std::move(detail::working_copy(std::forward<M>(mat)).data())));
+}
+
+template<class Rep, class B, class>
+inline constexpr std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(matrix<Rep> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.data().rows()) * detail::operand_elements(b), detail::operand_bytes(a) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        lu(a).solve_in_place(x.data());
+        return x;
+    }());
+}
+
+template<class Storage, class B, class>
+inline constexpr std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(lu_decomposition<Storage> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.size()) * detail::operand_elements(b), double(a.size()) * double(a.size()) * sizeof(typename Storage::scalar_t) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        a.solve_in_place(x.data());
+        return x;
+    }());
+}
+
+template<class Storage, class B, class>
+inline constexpr std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(cholesky_decomposition<Storage> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.size()) * detail::operand_elements(b), double(a.size()) * double(a.size()) * sizeof(typename Storage::scalar_t) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        a.solve_in_place(x.data());
+        return x;
+    }());
+}
+
+// In-place updates
+template<class Rep1, class Rep2>
+inline constexpr void std::experimental::la::gemm(typename Rep1::scalar_t alpha, matrix<Rep1> const& a, matrix<Rep2> const& b,
+    typename Rep1::scalar_t beta, matrix<typename Rep1::template multiply_t<Rep2>>& c)
+{
+    _LA_INSTRUMENT("gemm", 2 * detail::operand_elements(a) * double(b.data().cols()), detail::operand_bytes(a) + detail::operand_bytes(b) + 2 * detail::operand_bytes(c),
+        Rep1::template gemm<Rep2>(alpha, a.data(), b.data(), beta, c.data()));
+}
+
+template<class Rep>
+inline constexpr void std::experimental::la::axpy(typename Rep::scalar_t alpha, matrix<Rep> const& x, matrix<Rep>& y) noexcept
+{
+    _LA_INSTRUMENT("axpy", 2 * detail::operand_elements(y), 3 * detail::operand_bytes(y), Rep::axpby(alpha, x.data(), typename Rep::scalar_t(1), y.data()));
+}
+
+template<class Rep>
+inline constexpr void std::experimental::la::axpby(typename Rep::scalar_t alpha, matrix<Rep> const& x, typename Rep::scalar_t beta, matrix<Rep>& y) noexcept
+{
+    _LA_INSTRUMENT("axpby", 3 * detail::operand_elements(y), 3 * detail::operand_bytes(y), Rep::axpby(alpha, x.data(), beta, y.data()));
+}
+
+template<class Rep, class Rep1, class Rep2>
+inline constexpr void std::experimental::la::rank_1_update(typename Rep::scalar_t alpha, matrix<Rep1> const& x, matrix<Rep2> const& y, matrix<Rep>& a)
+{
+    _LA_INSTRUMENT("rank_1_update", 2 * detail::operand_elements(a), 2 * detail::operand_bytes(a) + detail::operand_bytes(x) + detail::operand_bytes(y),
+        Rep::template rank_1_update<Rep1, Rep2>(alpha, x.data(), y.data(), a.data()));
+}
+
+template<class Rep1, class Rep2>
+inline constexpr void std::experimental::la::rank_k_update(typename Rep1::scalar_t alpha, matrix<Rep1> const& a, typename Rep1::scalar_t beta, matrix<Rep2>& c)
+{
+    _LA_INSTRUMENT("rank_k_update", 2 * detail::operand_elements(a) * double(a.data().rows()), detail::operand_bytes(a) + 2 * detail::operand_bytes(c),
+        Rep1::template rank_k_update<Rep2>(alpha, a.data(), beta, c.data()));
+}
+
+// Parallel overloads
+template<class Exec, class Rep1, class Rep2, class>
+inline std::experimental::la::matrix<typename Rep1::template multiply_t<Rep2>> std::experimental::la::multiply(Exec&& exec, matrix<Rep1> const& lhs, matrix<Rep2> const& rhs)
+{
+    return _LA_INSTRUMENT("multiply", 2 * detail::operand_elements(lhs) * double(rhs.data().cols()),
+        detail::operand_bytes(lhs) + detail::operand_bytes(rhs) + double(lhs.data().rows()) * double(rhs.data().cols()) * sizeof(typename Rep1::scalar_t),
+        matrix<typename Rep1::template multiply_t<Rep2>>(Rep1::template matrix_multiply<Rep2>(detail::execution_pool(exec), lhs.data(), rhs.data())));
+}
+
+template<class Exec, class Rep1, class Rep2, class>
+inline std::experimental::la::matrix<typename Rep1::template multiply_t<Rep2>> std::experimental::la::strassen_multiply(Exec&& exec, matrix<Rep1> const& lhs, matrix<Rep2> const& rhs)
+{
+    return _LA_INSTRUMENT("strassen_multiply", 2 * detail::operand_elements(lhs) * double(rhs.data().cols()),
+        detail::operand_bytes(lhs) + detail::operand_bytes(rhs) + double(lhs.data().rows()) * double(rhs.data().cols()) * sizeof(typename Rep1::scalar_t),
+        matrix<typename Rep1::template multiply_t<Rep2>>(Rep1::template strassen_multiply<Rep2>(detail::execution_pool(exec), lhs.data(), rhs.data())));
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<M>> std::experimental::la::multiply(Exec&& exec, M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs)
+{
+    return _LA_INSTRUMENT("scalar_multiply", detail::operand_elements(lhs), 2 * detail::operand_bytes(lhs), [&] {
+        auto res = detail::working_copy(std::forward<M>(lhs));
+        detail::operand_rep_t<M>::scalar_multiply(detail::execution_pool(exec), res.data(), rhs);
+        return res;
+    }());
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<M>> std::experimental::la::divide(Exec&& exec, M&& lhs, typename detail::operand_rep_t<M>::scalar_t const& rhs)
+{
+    return _LA_INSTRUMENT("divide", detail::operand_elements(lhs), 2 * detail::operand_bytes(lhs), [&] {
+        auto res = detail::working_copy(std::forward<M>(lhs));
+        detail::operand_rep_t<M>::divide(detail::execution_pool(exec), res.data(), rhs);
+        return res;
+    }());
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<M>> std::experimental::la::add(Exec&& exec, M&& lhs, matrix<detail::operand_rep_t<M>> const& rhs)
+{
+    return _LA_INSTRUMENT("add", detail::operand_elements(lhs), 3 * detail::operand_bytes(lhs), [&] {
+        auto res = detail::working_copy(std::forward<M>(lhs));
+        detail::operand_rep_t<M>::add(detail::execution_pool(exec), res.data(), rhs.data());
+        return res;
+    }());
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<M>> std::experimental::la::subtract(Exec&& exec, M&& lhs, matrix<detail::operand_rep_t<M>> const& rhs)
+{
+    return _LA_INSTRUMENT("subtract", detail::operand_elements(lhs), 3 * detail::operand_bytes(lhs), [&] {
+        auto res = detail::working_copy(std::forward<M>(lhs));
+        detail::operand_rep_t<M>::subtract(detail::execution_pool(exec), res.data(), rhs.data());
+        return res;
+    }());
+}
+
+template<class Exec, class Rep, class>
+inline std::experimental::la::matrix<typename Rep::transpose_t> std::experimental::la::transpose(Exec&& exec, matrix<Rep> const& mat)
+{
+    return _LA_INSTRUMENT("transpose", 0, 2 * detail::operand_bytes(mat), matrix<typename Rep::transpose_t>(Rep::transpose(detail::execution_pool(exec), mat.data())));
+}
+
+template<class Exec, class Rep, class>
+inline typename Rep::scalar_t std::experimental::la::inner_product(Exec&& exec, matrix<Rep> const& lhs, matrix<Rep> const& rhs)
+{
+    return _LA_INSTRUMENT("inner_product", 2 * detail::operand_elements(lhs), 2 * detail::operand_bytes(lhs), Rep::inner_product(detail::execution_pool(exec), lhs.data(), rhs.data()));
+}
+
+template<class Exec, class Rep, class>
+inline typename Rep::scalar_t std::experimental::la::modulus(Exec&& exec, matrix<Rep> const& vec)
+{
+    return _LA_INSTRUMENT("modulus", 2 * detail::operand_elements(vec), detail::operand_bytes(vec), Rep::modulus(detail::execution_pool(exec), vec.data()));
+}
+
+template<class Exec, class Rep, class>
+inline typename Rep::scalar_t std::experimental::la::modulus_squared(Exec&& exec, matrix<Rep> const& vec)
+{
+    return _LA_INSTRUMENT("modulus_squared", 2 * detail::operand_elements(vec), detail::operand_bytes(vec), Rep::modulus_squared(detail::execution_pool(exec), vec.data()));
+}
+
+template<class Exec, class Rep, class>
+inline typename Rep::scalar_t std::experimental::la::determinant(Exec&& exec, matrix<Rep> const& mat)
+{
+    return _LA_INSTRUMENT("determinant", detail::lu_flops(mat), 2 * detail::operand_bytes(mat), Rep::determinant(detail::execution_pool(exec), mat.data()));
+}
+
+template<class Exec, class Rep, class>
+inline std::experimental::la::matrix<Rep> std::experimental::la::inverse(Exec&& exec, matrix<Rep> const& mat)
+{
+    return _LA_INSTRUMENT("inverse", 3 * detail::lu_flops(mat), 2 * detail::operand_bytes(mat), matrix<Rep>(Rep::inverse(detail::execution_pool(exec), mat.data())));
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::lu_decomposition<typename std::experimental::la::detail::operand_rep_t<M>::matrix_t> std::experimental::la::lu(Exec&& exec, M&& mat)
+{
+    return _LA_INSTRUMENT("lu", detail::lu_flops(mat), 2 * detail::operand_bytes(mat),
+        lu_decomposition<typename detail::operand_rep_t<M>::matrix_t>(std::move(detail::working_copy(std::forward<M>(mat)).data()), detail::execution_pool(exec)));
+}
+
+template<class Exec, class M, class>
+inline std::experimental::la::cholesky_decomposition<typename std::experimental::la::detail::operand_rep_t<M>::matrix_t> std::experimental::la::cholesky(Exec&& exec, M&& mat)
+{
+    return _LA_INSTRUMENT("cholesky", detail::lu_flops(mat) / 2, 2 * detail::operand_bytes(mat),
+        cholesky_decomposition<typename detail::operand_rep_t<M>::matrix_t>(std::move(detail::working_copy(std::forward<M>(mat)).data()), detail::execution_pool(exec)));
+}
+
+template<class Exec, class Rep, class B, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(Exec&& exec, matrix<Rep> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.data().rows()) * detail::operand_elements(b), detail::operand_bytes(a) + 2 * detail::operand_bytes(b), [&] {
+        auto* pool = detail::execution_pool(exec);
+        auto x = detail::working_copy(std::forward<B>(b));
+        lu(exec, a).solve_in_place(x.data(), pool);
+        return x;
+    }());
+}
+
+template<class Exec, class Storage, class B, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(Exec&& exec, lu_decomposition<Storage> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.size()) * detail::operand_elements(b), double(a.size()) * double(a.size()) * sizeof(typename Storage::scalar_t) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        a.solve_in_place(x.data(), detail::execution_pool(exec));
+        return x;
+    }());
+}
+
+template<class Exec, class Storage, class B, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(Exec&& exec, cholesky_decomposition<Storage> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.size()) * detail::operand_elements(b), double(a.size()) * double(a.size()) * sizeof(typename Storage::scalar_t) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        a.solve_in_place(x.data(), detail::execution_pool(exec));
+        return x;
+    }());
+}
+
+template<class Exec, class Rep1, class Rep2, class>
+inline void std::experimental::la::gemm(Exec&& exec, typename Rep1::scalar_t alpha, matrix<Rep1> const& a, matrix<Rep2> const& b,
+    typename Rep1::scalar_t beta, matrix<typename Rep1::template multiply_t<Rep2>>& c)
+{
+    _LA_INSTRUMENT("gemm", 2 * detail::operand_elements(a) * double(b.data().cols()), detail::operand_bytes(a) + detail::operand_bytes(b) + 2 * detail::operand_bytes(c),
+        Rep1::template gemm<Rep2>(detail::execution_pool(exec), alpha, a.data(), b.data(), beta, c.data()));
+}
+
+template<class Rep>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::detail::working_copy(matrix<Rep> const& mat)
+{
+    return matrix<Rep>(copy_storage(mat.data()));
+}
+
+template<class Rep>
+inline constexpr std::experimental::la::matrix<Rep> std::experimental::la::detail::working_copy(matrix<Rep>&& mat) noexcept
+{
+    return std::move(mat);
+}
+
+template<class E>
+inline constexpr auto std::experimental::la::detail::working_copy(matrix_expression<E> const& expr)
+{
+    return expr.eval();
+}
+
+template<class View>
+inline constexpr std::experimental::la::matrix<typename std::experimental::la::view_traits<View>::owning_rep_t> std::experimental::la::detail::working_copy(matrix<view_traits<View>> const& mat)
+{
+    return matrix<typename view_traits<View>::owning_rep_t>(view_traits<View>::copy(mat.data()));
+}
+
+template<class View>
+inline constexpr std::experimental::la::matrix<typename std::experimental::la::view_traits<View>::owning_rep_t> std::experimental::la::detail::working_copy(matrix<view_traits<View>>&& mat)
+{
+    // Moving a view would still share the viewed elements
+    return working_copy(std::as_const(mat));
+}
+
+template<class M>
+inline constexpr double std::experimental::la::detail::operand_elements(M const& mat) noexcept
+{
+    auto const size = expression_size(mat);
+    return double(size.first) * double(size.second);
+}
+
+template<class M>
+inline constexpr double std::experimental::la::detail::operand_bytes(M const& mat) noexcept
+{
+    return operand_elements(mat) * sizeof(remove_cvref_t<decltype(expression_element(mat, 0))>);
+}
+
+template<class M>
+inline constexpr double std::experimental::la::detail::lu_flops(M const& mat) noexcept
+{
+    auto const n = double(expression_size(mat).first);
+    return 2 * n * n * n / 3;
 }
 
 #endif
@@ -0,0 +1,78 @@
+#if !defined MATRIX_ALLOCATOR_26_10_18_17_31_52
+#define MATRIX_ALLOCATOR_26_10_18_17_31_52
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // aligned_allocator
+    ////////////////////////////////////////////////////////
+    // Allocates on Alignment-byte boundaries; the default of 64 is a cache line and a full
+    // AVX-512 register, so vector loads from the start of a buffer never split a line.
+    template<class T, size_t Alignment = 64>
+    struct aligned_allocator
+    {
+        static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0);
+
+        using value_type = T;
+        using is_always_equal = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        template<class U>
+        struct rebind
+        {
+            using other = aligned_allocator<U, Alignment>;
+        };
+
+        static constexpr size_t alignment = Alignment;
+
+        constexpr aligned_allocator() noexcept = default;
+        template<class U>
+        constexpr aligned_allocator(aligned_allocator<U, Alignment> const&) noexcept;
+        [[nodiscard]] T* allocate(size_t n);
+        void deallocate(T* p, size_t n) noexcept;
+    };
+
+    template<class T, class U, size_t Alignment>
+    constexpr bool operator==(aligned_allocator<T, Alignment> const&, aligned_allocator<U, Alignment> const&) noexcept;
+
+    template<class T, class U, size_t Alignment>
+    constexpr bool operator!=(aligned_allocator<T, Alignment> const&, aligned_allocator<U, Alignment> const&) noexcept;
+}
+
+////////////////////////////////////////////////////////
+// aligned_allocator implementation
+////////////////////////////////////////////////////////
+template<class T, size_t Alignment>
+template<class U>
+inline constexpr std::experimental::la::aligned_allocator<T, Alignment>::aligned_allocator(aligned_allocator<U, Alignment> const&) noexcept
+{}
+
+template<class T, size_t Alignment>
+inline T* std::experimental::la::aligned_allocator<T, Alignment>::allocate(size_t n)
+{
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+}
+
+template<class T, size_t Alignment>
+inline void std::experimental::la::aligned_allocator<T, Alignment>::deallocate(T* p, size_t) noexcept
+{
+    ::operator delete(p, std::align_val_t(Alignment));
+}
+
+template<class T, class U, size_t Alignment>
+inline constexpr bool std::experimental::la::operator==(aligned_allocator<T, Alignment> const&, aligned_allocator<U, Alignment> const&) noexcept
+{
+    return true;
+}
+
+template<class T, class U, size_t Alignment>
+inline constexpr bool std::experimental::la::operator!=(aligned_allocator<T, Alignment> const&, aligned_allocator<U, Alignment> const&) noexcept
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,387 @@
+#if !defined MATRIX_BATCH_26_10_18_18_05_13
+#define MATRIX_BATCH_26_10_18_18_05_13
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_simd.h"
+#include "matrix_allocator.h"
+#include "linear_algebra.h"
+
+/*
+Batches of small fixed size matrices, for throughput on many independent operations.
+
+A single 4 x 4 product is too short to keep a vector unit busy. matrix_batch stores its
+matrices interleaved in blocks of batch_lanes<Scalar> (a cache line of each element, so
+16 floats or 8 doubles): element (i, j) of every matrix in a block is contiguous, and each
+instruction of the batched kernels performs the same step of 4, 8 or 16 matrices at once,
+using the widest instruction set matrix_simd.h detects.
+
+The last block is padded to full width. Padding slots are computed along with the rest
+and never observed. Within a block elements are numbered row by row whatever the layout
+of Storage; get() and set() translate.
+*/
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // matrix_batch
+    ////////////////////////////////////////////////////////
+    template<class Storage>
+    struct matrix_batch
+    {
+        static_assert(std::is_base_of_v<fixed_size_matrix_t, Storage>, "matrix_batch holds fixed size matrices");
+
+        using scalar_t = typename Storage::scalar_t;
+        using matrix_t = Storage;
+        using element_t = matrix<matrix_traits<Storage>>;
+
+        constexpr static size_t row = Storage::row;
+        constexpr static size_t col = Storage::col;
+        constexpr static size_t lanes = detail::batch_lanes<scalar_t>;
+        constexpr static size_t block_size = row * col * lanes;        // Scalars per block
+
+        matrix_batch() = default;
+        explicit matrix_batch(size_t count);                              // count zero matrices
+        // Size
+        size_t size() const noexcept;
+        size_t blocks() const noexcept;
+        void resize(size_t count);
+        void push_back(element_t const&);
+        // Element access
+        element_t get(size_t k) const;
+        void set(size_t k, element_t const&);
+        scalar_t operator()(size_t k, size_t i, size_t j) const;       // Element (i, j) of matrix k
+        scalar_t& operator()(size_t k, size_t i, size_t j);
+        scalar_t* data() noexcept;
+        scalar_t const* data() const noexcept;
+
+        std::vector<scalar_t, aligned_allocator<scalar_t>> _Data;
+        size_t _Count = 0;
+
+    private:
+        static size_t offset(size_t k, size_t e) noexcept;
+    };
+
+    namespace detail {
+        // Keeps the batch overloads out of overload sets where a square matrix type is named explicitly
+        template<class Storage>
+        using is_batch_storage = std::enable_if_t<std::is_base_of_v<fixed_size_matrix_t, Storage>>;
+    }
+
+    // Batched operations, applied to every matrix of the batch.
+    // The result of multiply must not share storage with an operand.
+    template<class S1, class S2>
+    matrix_batch<typename S1::template multiply_t<S2>> operator*(matrix_batch<S1> const& lhs, matrix_batch<S2> const& rhs);
+
+    template<class Rep, class S2>
+    matrix_batch<typename Rep::matrix_t::template multiply_t<S2>> operator*(matrix<Rep> const& lhs, matrix_batch<S2> const& rhs);      // One matrix applied to every matrix or vector of rhs
+
+    template<class S1, class S2>
+    void multiply(matrix_batch<S1> const& lhs, matrix_batch<S2> const& rhs, matrix_batch<typename S1::template multiply_t<S2>>& res);
+
+    template<class Rep, class S2>
+    void multiply(matrix<Rep> const& lhs, matrix_batch<S2> const& rhs, matrix_batch<typename Rep::matrix_t::template multiply_t<S2>>& res);
+
+    template<class Storage, class = detail::is_batch_storage<Storage>>
+    matrix_batch<typename Storage::transpose_t> transpose(matrix_batch<Storage> const&);
+
+    template<class Storage, class = detail::is_batch_storage<Storage>>
+    std::vector<typename Storage::scalar_t> determinant(matrix_batch<Storage> const&);
+
+    template<class Storage, class = detail::is_batch_storage<Storage>>
+    matrix_batch<Storage> inverse(matrix_batch<Storage> const&);       // A singular matrix gives non-finite elements in its slot
+
+    namespace detail {
+        // Batched kernels at the active instruction set; 4 x 4 and smaller square matrices
+        // have closed forms for determinant and inverse, larger ones go one matrix at a time
+        template<class Scalar, size_t R, size_t K, size_t C>
+        void batch_multiply(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept;
+
+        template<class Scalar, size_t R, size_t K, size_t C>
+        void batch_multiply_shared(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept;
+
+        template<class Scalar, size_t N>
+        void batch_determinant(Scalar const* mat, Scalar* det, size_t blocks) noexcept;
+
+        template<class Scalar, size_t N>
+        void batch_inverse(Scalar const* mat, Scalar* res, size_t blocks) noexcept;
+
+        inline constexpr size_t batch_closed_form_size = 4;
+    }
+}
+
+////////////////////////////////////////////////////////
+// matrix_batch implementation
+////////////////////////////////////////////////////////
+template<class Storage>
+inline std::experimental::la::matrix_batch<Storage>::matrix_batch(size_t count)
+    : _Data((count + lanes - 1) / lanes * block_size)
+    , _Count(count)
+{}
+
+template<class Storage>
+inline size_t std::experimental::la::matrix_batch<Storage>::size() const noexcept
+{
+    return _Count;
+}
+
+template<class Storage>
+inline size_t std::experimental::la::matrix_batch<Storage>::blocks() const noexcept
+{
+    return _Data.size() / block_size;
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_batch<Storage>::resize(size_t count)
+{
+    // New slots in the current last block were padding, which operations compute into, so
+    // they are cleared; blocks added by the resize start zeroed
+    for (auto k = _Count; k < std::min(count, blocks() * lanes); ++k)
+    {
+        for (auto e = size_t(0); e < row * col; ++e) _Data[offset(k, e)] = scalar_t(0);
+    }
+    _Data.resize((count + lanes - 1) / lanes * block_size);
+    _Count = count;
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_batch<Storage>::push_back(element_t const& mat)
+{
+    resize(_Count + 1);
+    set(_Count - 1, mat);
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_batch<Storage>::element_t std::experimental::la::matrix_batch<Storage>::get(size_t k) const
+{
+    assert(k < _Count);
+    auto res = Storage{};
+    for (auto i = size_t(0); i < row; ++i)
+    {
+        for (auto j = size_t(0); j < col; ++j) res(i, j) = _Data[offset(k, i * col + j)];
+    }
+    return element_t(res);
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_batch<Storage>::set(size_t k, element_t const& mat)
+{
+    assert(k < _Count);
+    for (auto i = size_t(0); i < row; ++i)
+    {
+        for (auto j = size_t(0); j < col; ++j) _Data[offset(k, i * col + j)] = mat(i, j);
+    }
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_batch<Storage>::scalar_t std::experimental::la::matrix_batch<Storage>::operator()(size_t k, size_t i, size_t j) const
+{
+    return _Data[offset(k, i * col + j)];
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_batch<Storage>::scalar_t& std::experimental::la::matrix_batch<Storage>::operator()(size_t k, size_t i, size_t j)
+{
+    return _Data[offset(k, i * col + j)];
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_batch<Storage>::scalar_t* std::experimental::la::matrix_batch<Storage>::data() noexcept
+{
+    return _Data.data();
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_batch<Storage>::scalar_t const* std::experimental::la::matrix_batch<Storage>::data() const noexcept
+{
+    return _Data.data();
+}
+
+template<class Storage>
+inline size_t std::experimental::la::matrix_batch<Storage>::offset(size_t k, size_t e) noexcept
+{
+    return k / lanes * block_size + e * lanes + k % lanes;
+}
+
+////////////////////////////////////////////////////////
+// Batched operations implementation
+////////////////////////////////////////////////////////
+template<class S1, class S2>
+inline std::experimental::la::matrix_batch<typename S1::template multiply_t<S2>> std::experimental::la::operator*(matrix_batch<S1> const& lhs, matrix_batch<S2> const& rhs)
+{
+    auto res = matrix_batch<typename S1::template multiply_t<S2>>(lhs.size());
+    multiply(lhs, rhs, res);
+    return res;
+}
+
+template<class Rep, class S2>
+inline std::experimental::la::matrix_batch<typename Rep::matrix_t::template multiply_t<S2>> std::experimental::la::operator*(matrix<Rep> const& lhs, matrix_batch<S2> const& rhs)
+{
+    auto res = matrix_batch<typename Rep::matrix_t::template multiply_t<S2>>(rhs.size());
+    multiply(lhs, rhs, res);
+    return res;
+}
+
+template<class S1, class S2>
+inline void std::experimental::la::multiply(matrix_batch<S1> const& lhs, matrix_batch<S2> const& rhs, matrix_batch<typename S1::template multiply_t<S2>>& res)
+{
+    static_assert(S1::col == S2::row);
+    assert(lhs.size() == rhs.size());
+    if (res.size() != lhs.size()) res.resize(lhs.size());
+    detail::batch_multiply<typename S1::scalar_t, S1::row, S1::col, S2::col>(lhs.data(), rhs.data(), res.data(), lhs.blocks());
+}
+
+template<class Rep, class S2>
+inline void std::experimental::la::multiply(matrix<Rep> const& lhs, matrix_batch<S2> const& rhs, matrix_batch<typename Rep::matrix_t::template multiply_t<S2>>& res)
+{
+    using S1 = typename Rep::matrix_t;
+    static_assert(std::is_base_of_v<fixed_size_matrix_t, S1> && S1::col == S2::row);
+    if (res.size() != rhs.size()) res.resize(rhs.size());
+    if constexpr (detail::is_column_major_v<S1>)
+    {
+        // The kernel reads the shared matrix row by row
+        typename S1::scalar_t a[S1::row * S1::col];
+        for (auto i = size_t(0); i < S1::row; ++i)
+        {
+            for (auto j = size_t(0); j < S1::col; ++j) a[i * S1::col + j] = lhs(i, j);
+        }
+        detail::batch_multiply_shared<typename S1::scalar_t, S1::row, S1::col, S2::col>(a, rhs.data(), res.data(), rhs.blocks());
+    }
+    else
+    {
+        detail::batch_multiply_shared<typename S1::scalar_t, S1::row, S1::col, S2::col>(lhs.data()._Data, rhs.data(), res.data(), rhs.blocks());
+    }
+}
+
+template<class Storage, class>
+inline std::experimental::la::matrix_batch<typename Storage::transpose_t> std::experimental::la::transpose(matrix_batch<Storage> const& mat)
+{
+    // Whole element rows move at once, so there is nothing for a kernel to add
+    constexpr auto lanes = matrix_batch<Storage>::lanes;
+    auto res = matrix_batch<typename Storage::transpose_t>(mat.size());
+    for (auto b = size_t(0); b < mat.blocks(); ++b)
+    {
+        auto const* src = mat.data() + b * matrix_batch<Storage>::block_size;
+        auto* dst = res.data() + b * matrix_batch<Storage>::block_size;
+        for (auto i = size_t(0); i < Storage::row; ++i)
+        {
+            for (auto j = size_t(0); j < Storage::col; ++j) std::copy_n(src + (i * Storage::col + j) * lanes, lanes, dst + (j * Storage::row + i) * lanes);
+        }
+    }
+    return res;
+}
+
+template<class Storage, class>
+inline std::vector<typename Storage::scalar_t> std::experimental::la::determinant(matrix_batch<Storage> const& mat)
+{
+    static_assert(Storage::row == Storage::col);
+    using scalar_t = typename Storage::scalar_t;
+    auto res = std::vector<scalar_t>(mat.blocks() * matrix_batch<Storage>::lanes);
+    if constexpr (Storage::row <= detail::batch_closed_form_size)
+    {
+        detail::batch_determinant<scalar_t, Storage::row>(mat.data(), res.data(), mat.blocks());
+    }
+    else
+    {
+        for (auto k = size_t(0); k < mat.size(); ++k) res[k] = determinant(mat.get(k));
+    }
+    res.resize(mat.size());
+    return res;
+}
+
+template<class Storage, class>
+inline std::experimental::la::matrix_batch<Storage> std::experimental::la::inverse(matrix_batch<Storage> const& mat)
+{
+    static_assert(Storage::row == Storage::col);
+    auto res = matrix_batch<Storage>(mat.size());
+    if constexpr (Storage::row <= detail::batch_closed_form_size)
+    {
+        detail::batch_inverse<typename Storage::scalar_t, Storage::row>(mat.data(), res.data(), mat.blocks());
+    }
+    else
+    {
+        for (auto k = size_t(0); k < mat.size(); ++k) res.set(k, inverse(mat.get(k)));
+    }
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// batch kernel dispatch implementation
+////////////////////////////////////////////////////////
+template<class Scalar, size_t R, size_t K, size_t C>
+inline void std::experimental::la::detail::batch_multiply(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept
+{
+#if defined _LA_SIMD_X86
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        switch (active_simd_level())
+        {
+        case simd_level::avx512: return simd_avx512::batch_multiply<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        case simd_level::avx2: return simd_avx2::batch_multiply<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        case simd_level::sse2: return simd_sse2::batch_multiply<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        default: break;
+        }
+    }
+#endif
+    simd_scalar::batch_multiply<Scalar, R, K, C>(lhs, rhs, res, blocks);
+}
+
+template<class Scalar, size_t R, size_t K, size_t C>
+inline void std::experimental::la::detail::batch_multiply_shared(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept
+{
+#if defined _LA_SIMD_X86
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        switch (active_simd_level())
+        {
+        case simd_level::avx512: return simd_avx512::batch_multiply_shared<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        case simd_level::avx2: return simd_avx2::batch_multiply_shared<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        case simd_level::sse2: return simd_sse2::batch_multiply_shared<Scalar, R, K, C>(lhs, rhs, res, blocks);
+        default: break;
+        }
+    }
+#endif
+    simd_scalar::batch_multiply_shared<Scalar, R, K, C>(lhs, rhs, res, blocks);
+}
+
+template<class Scalar, size_t N>
+inline void std::experimental::la::detail::batch_determinant(Scalar const* mat, Scalar* det, size_t blocks) noexcept
+{
+#if defined _LA_SIMD_X86
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        switch (active_simd_level())
+        {
+        case simd_level::avx512: return simd_avx512::batch_determinant<Scalar, N>(mat, det, blocks);
+        case simd_level::avx2: return simd_avx2::batch_determinant<Scalar, N>(mat, det, blocks);
+        case simd_level::sse2: return simd_sse2::batch_determinant<Scalar, N>(mat, det, blocks);
+        default: break;
+        }
+    }
+#endif
+    simd_scalar::batch_determinant<Scalar, N>(mat, det, blocks);
+}
+
+template<class Scalar, size_t N>
+inline void std::experimental::la::detail::batch_inverse(Scalar const* mat, Scalar* res, size_t blocks) noexcept
+{
+#if defined _LA_SIMD_X86
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        switch (active_simd_level())
+        {
+        case simd_level::avx512: return simd_avx512::batch_inverse<Scalar, N>(mat, res, blocks);
+        case simd_level::avx2: return simd_avx2::batch_inverse<Scalar, N>(mat, res, blocks);
+        case simd_level::sse2: return simd_sse2::batch_inverse<Scalar, N>(mat, res, blocks);
+        default: break;
+        }
+    }
+#endif
+    simd_scalar::batch_inverse<Scalar, N>(mat, res, blocks);
+}
+
+#endif
@@ -0,0 +1,524 @@
+#if !defined MATRIX_DECOMPOSITION_26_10_18_15_22_09
+#define MATRIX_DECOMPOSITION_26_10_18_15_22_09
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_gemm.h"
+#include "matrix_out_of_core.h"
+#include "matrix_thread_pool.h"
+
+namespace std::experimental::la {
+    namespace detail {
+        // Row indices sized at compile time for fixed_size_matrix, at run time otherwise
+        template<class Storage, class = void>
+        struct index_vector
+        {
+            using type = std::vector<size_t>;
+            static type make(size_t n) { return type(n); }
+        };
+
+        template<class Storage>
+        struct index_vector<Storage, is_fixed_size<Storage>>
+        {
+            using type = std::array<size_t, Storage::row>;
+            static constexpr type make(size_t) noexcept { return type{}; }
+        };
+
+        template<class Storage>
+        using index_vector_t = typename index_vector<Storage>::type;
+
+        // Block size for the factorisations and triangular solves: work inside a block is done
+        // row by row, and everything it contributes to the rest of the matrix is one gemm call
+        inline constexpr size_t lu_block_size = 64;
+
+        // The kernels take an optional pool for the gemm updates and independent rows or
+        // columns; a null pool runs them sequentially
+        template<class Scalar>
+        void lu_factorize(Scalar* a, size_t n, size_t* pivot, bool& odd_permutation, thread_pool* pool = nullptr);
+
+        template<class Scalar>
+        bool cholesky_factorize(Scalar* a, size_t n, thread_pool* pool = nullptr);
+
+        // Solves T X = B in place for an n x n triangular T with arbitrary strides, so a
+        // transposed factor is just the same pointer with the strides swapped. X is n x nrhs
+        // with strides rsx and csx; independent columns of X are solved concurrently.
+        template<class Scalar>
+        void triangular_solve_in_place(Scalar const* t, ptrdiff_t rst, ptrdiff_t cst, size_t n, bool lower, bool unit_diagonal,
+            Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx, thread_pool* pool = nullptr);
+
+        // Swaps rows i and j of the strided ncols-wide matrix x
+        template<class Scalar>
+        void swap_rows(Scalar* x, size_t ncols, ptrdiff_t rsx, ptrdiff_t csx, size_t i, size_t j) noexcept;
+    }
+
+    ////////////////////////////////////////////////////////
+    // lu_decomposition
+    ////////////////////////////////////////////////////////
+    // PA = LU with partial pivoting, for square matrices. L (unit diagonal, not stored)
+    // and U are packed into a single matrix, and the row interchanges are kept LAPACK
+    // style: row k was swapped with row pivots()[k] at step k.
+    // The kernel works on the element buffer, so for column-major storage it factors the
+    // transpose: AQ = LU with column interchanges, and it is U that has the unit diagonal.
+    // determinant(), inverse() and solve() mean the same thing in either layout.
+    template<class Storage>
+    struct lu_decomposition
+    {
+        using scalar_t = typename Storage::scalar_t;
+        using matrix_t = typename Storage::matrix_t;
+        using pivot_t = detail::index_vector_t<Storage>;
+
+        constexpr explicit lu_decomposition(matrix_t const& mat, thread_pool* pool = nullptr);
+        constexpr explicit lu_decomposition(matrix_t&& mat, thread_pool* pool = nullptr);
+        constexpr matrix_t const& packed() const noexcept;
+        constexpr pivot_t const& pivots() const noexcept;
+        constexpr size_t size() const noexcept;
+        constexpr size_t rank() const noexcept;
+        constexpr bool is_invertible() const noexcept;
+        constexpr scalar_t determinant() const noexcept;
+        constexpr matrix_t inverse(thread_pool* pool = nullptr) const;
+        template<class Other> constexpr Other solve(Other b, thread_pool* pool = nullptr) const;
+        template<class Other> constexpr void solve_in_place(Other& b, thread_pool* pool = nullptr) const;
+
+        matrix_t _LU;
+        pivot_t _Pivot;
+        scalar_t _Tolerance = scalar_t(0);
+        bool _OddPermutation = false;
+
+    private:
+        constexpr void factorize(thread_pool* pool);
+    };
+
+    ////////////////////////////////////////////////////////
+    // cholesky_decomposition
+    ////////////////////////////////////////////////////////
+    // A = LL* for symmetric positive definite matrices, at half the cost of LU and with no
+    // pivoting. Only the lower triangle of the input is read; L is stored there and the
+    // strict upper triangle is zeroed. If a nonpositive pivot turns up the factorisation
+    // stops and is_positive_definite() returns false. For column-major storage the roles
+    // of the triangles swap: the upper triangle is read and factor() holds L*.
+    template<class Storage>
+    struct cholesky_decomposition
+    {
+        using scalar_t = typename Storage::scalar_t;
+        using matrix_t = typename Storage::matrix_t;
+
+        constexpr explicit cholesky_decomposition(matrix_t const& mat, thread_pool* pool = nullptr);
+        constexpr explicit cholesky_decomposition(matrix_t&& mat, thread_pool* pool = nullptr);
+        constexpr matrix_t const& factor() const noexcept;
+        constexpr size_t size() const noexcept;
+        constexpr bool is_positive_definite() const noexcept;
+        constexpr scalar_t determinant() const noexcept;
+        template<class Other> constexpr Other solve(Other b, thread_pool* pool = nullptr) const;
+        template<class Other> constexpr void solve_in_place(Other& b, thread_pool* pool = nullptr) const;
+
+        matrix_t _L;
+        bool _PositiveDefinite = false;
+    };
+}
+
+////////////////////////////////////////////////////////
+// lu kernels
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline void std::experimental::la::detail::lu_factorize(Scalar* a, size_t n, size_t* pivot, bool& odd_permutation, thread_pool* pool)
+{
+    using std::abs;
+    auto const lda = ptrdiff_t(n);
+    for (auto k = size_t(0); k < n; k += lu_block_size)
+    {
+        auto const nb = std::min(lu_block_size, n - k);
+        auto const end = k + nb;
+
+        // Factor the panel a[k:n, k:end], swapping whole rows so the rest of the matrix follows
+        for (auto j = k; j < end; ++j)
+        {
+            auto p = j;
+            auto max = abs(a[j * n + j]);
+            for (auto i = j + 1; i < n; ++i)
+            {
+                if (abs(a[i * n + j]) > max)
+                {
+                    max = abs(a[i * n + j]);
+                    p = i;
+                }
+            }
+            pivot[j] = p;
+            if (p != j)
+            {
+                std::swap_ranges(a + j * n, a + j * n + n, a + p * n);
+                odd_permutation = !odd_permutation;
+            }
+            auto const diag = a[j * n + j];
+            if (diag == Scalar(0)) continue;         // Singular column, nothing to eliminate
+            for (auto i = j + 1; i < n; ++i)
+            {
+                auto* row = a + i * n;
+                auto const l = row[j] /= diag;
+                auto const* u = a + j * n;
+                for (auto c = j + 1; c < end; ++c) row[c] -= l * u[c];
+            }
+        }
+        if (end == n) break;
+
+        // U12 = L11^-1 A12, by independent column ranges
+        parallel_chunks(pool, n - end, parallel_element_threshold / nb, [&](size_t c0, size_t c1) {
+            for (auto j = k; j < end; ++j)
+            {
+                auto const* u = a + j * n + end;
+                for (auto i = j + 1; i < end; ++i)
+                {
+                    auto* row = a + i * n + end;
+                    auto const l = a[i * n + j];
+                    for (auto c = c0; c < c1; ++c) row[c] -= l * u[c];
+                }
+            }
+        });
+
+        // A22 -= L21 U12
+        gemm(pool, n - end, n - end, nb, Scalar(-1), a + end * n + k, lda, ptrdiff_t(1), a + k * n + end, lda, ptrdiff_t(1),
+            Scalar(1), a + end * n + end, lda, ptrdiff_t(1));
+    }
+}
+
+template<class Scalar>
+inline bool std::experimental::la::detail::cholesky_factorize(Scalar* a, size_t n, thread_pool* pool)
+{
+    using std::sqrt;
+    auto const lda = ptrdiff_t(n);
+    for (auto k = size_t(0); k < n; k += lu_block_size)
+    {
+        auto const end = std::min(k + lu_block_size, n);
+
+        // Factor the diagonal block
+        for (auto j = k; j < end; ++j)
+        {
+            auto* rj = a + j * n;
+            for (auto p = k; p < j; ++p) rj[j] -= rj[p] * rj[p];
+            if (!(rj[j] > Scalar(0))) return false;
+            rj[j] = Scalar(sqrt(rj[j]));
+            for (auto i = j + 1; i < end; ++i)
+            {
+                auto* ri = a + i * n;
+                for (auto p = k; p < j; ++p) ri[j] -= ri[p] * rj[p];
+                ri[j] /= rj[j];
+            }
+        }
+        if (end == n) break;
+
+        // L21 = A21 L11^-*, one row at a time
+        parallel_chunks(pool, n - end, parallel_element_threshold / (lu_block_size * lu_block_size), [&](size_t r0, size_t r1) {
+            for (auto i = end + r0; i < end + r1; ++i)
+            {
+                auto* ri = a + i * n;
+                for (auto j = k; j < end; ++j)
+                {
+                    auto const* rj = a + j * n;
+                    for (auto p = k; p < j; ++p) ri[j] -= ri[p] * rj[p];
+                    ri[j] /= rj[j];
+                }
+            }
+        });
+
+        // A22 -= L21 L21*, lower triangle only, one block row at a time
+        auto const block_rows = (n - end + lu_block_size - 1) / lu_block_size;
+        auto const update = [&](size_t b) {
+            auto const i0 = end + b * lu_block_size;
+            auto const rows = std::min(lu_block_size, n - i0);
+            gemm(rows, i0 + rows - end, end - k, Scalar(-1), a + i0 * n + k, lda, ptrdiff_t(1), a + end * n + k, ptrdiff_t(1), lda,
+                Scalar(1), a + i0 * n + end, lda, ptrdiff_t(1));
+        };
+        if (pool && (n - end) * (n - end) * (end - k) / 2 >= parallel_gemm_threshold)
+        {
+            // Later block rows are longer, so hand them out first
+            pool->parallel_for(block_rows, [&](size_t b) { update(block_rows - 1 - b); });
+        }
+        else
+        {
+            for (auto b = size_t(0); b < block_rows; ++b) update(b);
+        }
+    }
+    for (auto i = size_t(0); i < n; ++i) std::fill(a + i * n + i + 1, a + i * n + n, Scalar(0));
+    return true;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::triangular_solve_in_place(Scalar const* t, ptrdiff_t rst, ptrdiff_t cst, size_t n, bool lower, bool unit_diagonal,
+    Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx, thread_pool* pool)
+{
+    if (pool && n * n * nrhs >= parallel_gemm_threshold)
+    {
+        parallel_chunks(pool, nrhs, gemm_dispatch<Scalar>().nr, [&](size_t c0, size_t c1) {
+            triangular_solve_in_place(t, rst, cst, n, lower, unit_diagonal, x + ptrdiff_t(c0) * csx, c1 - c0, rsx, csx);
+        });
+        return;
+    }
+
+    // Blocks of rows are solved one at a time, with the contribution of all previously
+    // solved rows applied by a single gemm
+    auto const at = [&](size_t i, size_t j) { return t[ptrdiff_t(i) * rst + ptrdiff_t(j) * cst]; };
+    auto const solve_block = [&](size_t i0, size_t end, size_t i) {
+        auto* xi = x + ptrdiff_t(i) * rsx;
+        for (auto j = i0; j < end; ++j)
+        {
+            auto const l = at(i, j);
+            auto const* xj = x + ptrdiff_t(j) * rsx;
+            for (auto c = size_t(0); c < nrhs; ++c) xi[ptrdiff_t(c) * csx] -= l * xj[ptrdiff_t(c) * csx];
+        }
+        if (!unit_diagonal)
+        {
+            auto const diag = at(i, i);
+            for (auto c = size_t(0); c < nrhs; ++c) xi[ptrdiff_t(c) * csx] /= diag;
+        }
+    };
+
+    if (lower)
+    {
+        // Forward substitution
+        for (auto i0 = size_t(0); i0 < n; i0 += lu_block_size)
+        {
+            auto const end = std::min(i0 + lu_block_size, n);
+            if (i0 > 0)
+            {
+                gemm(end - i0, nrhs, i0, Scalar(-1), t + ptrdiff_t(i0) * rst, rst, cst, x, rsx, csx, Scalar(1), x + ptrdiff_t(i0) * rsx, rsx, csx);
+            }
+            for (auto i = i0; i < end; ++i) solve_block(i0, i, i);
+        }
+    }
+    else
+    {
+        // Back substitution
+        for (auto end = n; end > 0;)
+        {
+            auto const i0 = end > lu_block_size ? end - lu_block_size : size_t(0);
+            if (end < n)
+            {
+                gemm(end - i0, nrhs, n - end, Scalar(-1), t + ptrdiff_t(i0) * rst + ptrdiff_t(end) * cst, rst, cst, x + ptrdiff_t(end) * rsx, rsx, csx, Scalar(1), x + ptrdiff_t(i0) * rsx, rsx, csx);
+            }
+            for (auto i = end; i-- > i0;) solve_block(i + 1, end, i);
+            end = i0;
+        }
+    }
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::swap_rows(Scalar* x, size_t ncols, ptrdiff_t rsx, ptrdiff_t csx, size_t i, size_t j) noexcept
+{
+    auto* xi = x + ptrdiff_t(i) * rsx;
+    auto* xj = x + ptrdiff_t(j) * rsx;
+    for (auto c = size_t(0); c < ncols; ++c) std::swap(xi[ptrdiff_t(c) * csx], xj[ptrdiff_t(c) * csx]);
+}
+
+////////////////////////////////////////////////////////
+// lu_decomposition implementation
+////////////////////////////////////////////////////////
+template<class Storage>
+inline constexpr std::experimental::la::lu_decomposition<Storage>::lu_decomposition(matrix_t const& mat, thread_pool* pool)
+    : _LU(detail::copy_storage(mat))
+    , _Pivot(detail::index_vector<Storage>::make(mat.rows()))
+{
+    factorize(pool);
+}
+
+template<class Storage>
+inline constexpr std::experimental::la::lu_decomposition<Storage>::lu_decomposition(matrix_t&& mat, thread_pool* pool)
+    : _LU(std::move(mat))
+    , _Pivot(detail::index_vector<Storage>::make(_LU.rows()))
+{
+    factorize(pool);
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::lu_decomposition<Storage>::factorize(thread_pool* pool)
+{
+    using std::abs;
+    assert(_LU.rows() == _LU.cols());
+    auto const n = _LU.rows();
+    auto max = scalar_t(0);
+    for (auto it = _LU.cbegin(); it != _LU.cend(); ++it) max = std::max(max, scalar_t(abs(*it)));
+    // Pivots at or below this are treated as zero when judging rank
+    _Tolerance = scalar_t(n) * std::numeric_limits<scalar_t>::epsilon() * max;
+    if constexpr (detail::is_out_of_core_v<Storage>)
+    {
+        if (detail::exceeds_out_of_core_budget<scalar_t>(n * n)) return detail::out_of_core_lu_factorize(_LU.begin(), n, _Pivot.data(), _OddPermutation, pool);
+    }
+    detail::lu_factorize(_LU.begin(), n, _Pivot.data(), _OddPermutation, pool);
+}
+
+template<class Storage>
+inline constexpr typename std::experimental::la::lu_decomposition<Storage>::matrix_t const& std::experimental::la::lu_decomposition<Storage>::packed() const noexcept
+{
+    return _LU;
+}
+
+template<class Storage>
+inline constexpr typename std::experimental::la::lu_decomposition<Storage>::pivot_t const& std::experimental::la::lu_decomposition<Storage>::pivots() const noexcept
+{
+    return _Pivot;
+}
+
+template<class Storage>
+inline constexpr size_t std::experimental::la::lu_decomposition<Storage>::size() const noexcept
+{
+    return _LU.rows();
+}
+
+template<class Storage>
+inline constexpr size_t std::experimental::la::lu_decomposition<Storage>::rank() const noexcept
+{
+    using std::abs;
+    auto const n = size();
+    auto res = size_t(0);
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        if (abs(_LU.cbegin()[i * n + i]) > _Tolerance) ++res;
+    }
+    return res;
+}
+
+template<class Storage>
+inline constexpr bool std::experimental::la::lu_decomposition<Storage>::is_invertible() const noexcept
+{
+    return rank() == size();
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::lu_decomposition<Storage>::determinant() const noexcept
+{
+    auto const n = size();
+    auto det = _OddPermutation ? scalar_t(-1) : scalar_t(1);
+    for (auto i = size_t(0); i < n; ++i) det *= _LU.cbegin()[i * n + i];
+    return det;
+}
+
+template<class Storage>
+inline constexpr typename std::experimental::la::lu_decomposition<Storage>::matrix_t std::experimental::la::lu_decomposition<Storage>::inverse(thread_pool* pool) const
+{
+    // Solve AX = I
+    auto const n = size();
+    auto res = detail::make_storage<matrix_t>(_LU, std::pair(n, n));
+    auto* x = res.begin();
+    std::fill(x, x + n * n, scalar_t(0));
+    for (auto i = size_t(0); i < n; ++i) x[i * n + i] = scalar_t(1);
+    solve_in_place(res, pool);
+    return res;
+}
+
+template<class Storage>
+template<class Other>
+inline constexpr Other std::experimental::la::lu_decomposition<Storage>::solve(Other b, thread_pool* pool) const
+{
+    solve_in_place(b, pool);
+    return b;
+}
+
+template<class Storage>
+template<class Other>
+inline constexpr void std::experimental::la::lu_decomposition<Storage>::solve_in_place(Other& b, thread_pool* pool) const
+{
+    auto const n = size();
+    auto const xv = detail::as_view(b);
+    assert(xv.rows() == n);
+    auto* x = xv.data();
+    auto const nrhs = xv.cols();
+    auto const rsx = xv.row_stride();
+    auto const csx = xv.col_stride();
+    auto const* lu = _LU.cbegin();
+    if constexpr (detail::is_column_major_v<Storage>)
+    {
+        // The buffer holds A*, so P A* = LU and A = U* L* P: solve U*Y = B, then L*Z = Y, then X = P*Z
+        detail::triangular_solve_in_place(lu, ptrdiff_t(1), ptrdiff_t(n), n, true, false, x, nrhs, rsx, csx, pool);
+        detail::triangular_solve_in_place(lu, ptrdiff_t(1), ptrdiff_t(n), n, false, true, x, nrhs, rsx, csx, pool);
+        for (auto k = n; k-- > 0;)
+        {
+            if (_Pivot[k] != k) detail::swap_rows(x, nrhs, rsx, csx, k, _Pivot[k]);
+        }
+    }
+    else
+    {
+        // LUX = PB
+        for (auto k = size_t(0); k < n; ++k)
+        {
+            if (_Pivot[k] != k) detail::swap_rows(x, nrhs, rsx, csx, k, _Pivot[k]);
+        }
+        detail::triangular_solve_in_place(lu, ptrdiff_t(n), ptrdiff_t(1), n, true, true, x, nrhs, rsx, csx, pool);
+        detail::triangular_solve_in_place(lu, ptrdiff_t(n), ptrdiff_t(1), n, false, false, x, nrhs, rsx, csx, pool);
+    }
+}
+
+////////////////////////////////////////////////////////
+// cholesky_decomposition implementation
+////////////////////////////////////////////////////////
+template<class Storage>
+inline constexpr std::experimental::la::cholesky_decomposition<Storage>::cholesky_decomposition(matrix_t const& mat, thread_pool* pool)
+    : _L(detail::copy_storage(mat))
+{
+    assert(_L.rows() == _L.cols());
+    _PositiveDefinite = detail::cholesky_factorize(_L.begin(), _L.rows(), pool);
+}
+
+template<class Storage>
+inline constexpr std::experimental::la::cholesky_decomposition<Storage>::cholesky_decomposition(matrix_t&& mat, thread_pool* pool)
+    : _L(std::move(mat))
+{
+    assert(_L.rows() == _L.cols());
+    _PositiveDefinite = detail::cholesky_factorize(_L.begin(), _L.rows(), pool);
+}
+
+template<class Storage>
+inline constexpr typename std::experimental::la::cholesky_decomposition<Storage>::matrix_t const& std::experimental::la::cholesky_decomposition<Storage>::factor() const noexcept
+{
+    return _L;
+}
+
+template<class Storage>
+inline constexpr size_t std::experimental::la::cholesky_decomposition<Storage>::size() const noexcept
+{
+    return _L.rows();
+}
+
+template<class Storage>
+inline constexpr bool std::experimental::la::cholesky_decomposition<Storage>::is_positive_definite() const noexcept
+{
+    return _PositiveDefinite;
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::cholesky_decomposition<Storage>::determinant() const noexcept
+{
+    assert(_PositiveDefinite);
+    auto const n = size();
+    auto det = scalar_t(1);
+    for (auto i = size_t(0); i < n; ++i) det *= _L.cbegin()[i * n + i];
+    return det * det;
+}
+
+template<class Storage>
+template<class Other>
+inline constexpr Other std::experimental::la::cholesky_decomposition<Storage>::solve(Other b, thread_pool* pool) const
+{
+    solve_in_place(b, pool);
+    return b;
+}
+
+template<class Storage>
+template<class Other>
+inline constexpr void std::experimental::la::cholesky_decomposition<Storage>::solve_in_place(Other& b, thread_pool* pool) const
+{
+    // LL*X = B, with L read from the buffer as row-major; A is symmetric, so this holds in either layout
+    assert(_PositiveDefinite);
+    auto const n = size();
+    auto const xv = detail::as_view(b);
+    assert(xv.rows() == n);
+    auto const* l = _L.cbegin();
+    detail::triangular_solve_in_place(l, ptrdiff_t(n), ptrdiff_t(1), n, true, false, xv.data(), xv.cols(), xv.row_stride(), xv.col_stride(), pool);
+    detail::triangular_solve_in_place(l, ptrdiff_t(1), ptrdiff_t(n), n, false, false, xv.data(), xv.cols(), xv.row_stride(), xv.col_stride(), pool);
+}
+
+#endif
@@ -0,0 +1,307 @@
+#if !defined MATRIX_EXPRESSION_26_10_18_13_05_51
+#define MATRIX_EXPRESSION_26_10_18_13_05_51
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/*
+Lazy element-wise matrix expressions.
+
+The non-member +, - and scalar * and / operators return lightweight expression nodes
+rather than matrices. Nothing is computed until the expression is assigned to a matrix,
+compared, or eval()ed, at which point the whole tree is evaluated element by element
+in a single loop, with one allocation for the result.
+
+Operands that are lvalues are held by reference and operands that are rvalues are moved
+into the node, so an expression built from temporaries may safely be stored with auto.
+An expression built from named matrices must not outlive them.
+*/
+
+namespace std::experimental::la {
+    template <class Rep>
+    struct matrix;
+
+    template<class View>
+    struct view_traits;
+
+    template<class Sparse>
+    struct sparse_traits;
+
+    template<class Structured>
+    struct structured_traits;
+
+    ////////////////////////////////////////////////////////
+    // matrix_expression
+    ////////////////////////////////////////////////////////
+    template<class Derived>
+    struct matrix_expression
+    {
+        constexpr Derived const& self() const noexcept;
+        constexpr auto eval() const;
+    };
+
+    template<class Op, class Lhs, class Rhs>
+    struct matrix_binary_expression;
+
+    template<class Op, class Lhs, class Scalar>
+    struct matrix_scalar_expression;
+
+    namespace detail {
+        template<class T>
+        using remove_cvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+        // rep_t is only present for matrices and expressions, so these fail softly for anything else
+        template<class T, class = void>
+        struct operand_traits {};
+
+        template<class Rep>
+        struct operand_traits<matrix<Rep>>
+        {
+            using rep_t = Rep;
+        };
+
+        template<class E>
+        struct operand_traits<E, std::enable_if_t<std::is_base_of_v<matrix_expression<E>, E>>>
+        {
+            using rep_t = typename E::rep_t;
+        };
+
+        // A view takes part in expressions as the owning matrix it would be copied into
+        template<class View>
+        struct operand_traits<matrix<view_traits<View>>>
+        {
+            using rep_t = typename view_traits<View>::owning_rep_t;
+        };
+
+        // Sparse and structured matrices have no element-wise form and are not operands at all
+        template<class Sparse>
+        struct operand_traits<matrix<sparse_traits<Sparse>>> {};
+
+        template<class Structured>
+        struct operand_traits<matrix<structured_traits<Structured>>> {};
+
+        template<class Rep>
+        inline constexpr bool is_view_rep_v = false;
+
+        template<class View>
+        inline constexpr bool is_view_rep_v<view_traits<View>> = true;
+
+        template<class T>
+        using operand_rep_t = typename operand_traits<remove_cvref_t<T>>::rep_t;
+
+        template<class T, class = void>
+        inline constexpr bool is_matrix_operand_v = false;
+
+        template<class T>
+        inline constexpr bool is_matrix_operand_v<T, std::void_t<operand_rep_t<T>>> = true;
+
+        template<class T>
+        inline constexpr bool is_matrix_expression_v = std::is_base_of_v<matrix_expression<remove_cvref_t<T>>, remove_cvref_t<T>>;
+
+        // Lvalue operands are referenced, rvalue operands are owned by the node
+        template<class T>
+        using expression_operand_t = std::conditional_t<std::is_lvalue_reference_v<T>, remove_cvref_t<T> const&, remove_cvref_t<T>>;
+
+        template<class Rep>
+        constexpr typename Rep::scalar_t expression_element(matrix<Rep> const& mat, size_t i) noexcept;
+        template<class View>
+        constexpr typename View::scalar_t expression_element(matrix<view_traits<View>> const& mat, size_t i) noexcept;
+        template<class E>
+        constexpr auto expression_element(matrix_expression<E> const& expr, size_t i) noexcept;
+
+        template<class Rep>
+        constexpr std::pair<size_t, size_t> expression_size(matrix<Rep> const& mat) noexcept;
+        template<class E>
+        constexpr std::pair<size_t, size_t> expression_size(matrix_expression<E> const& expr) noexcept;
+
+        // The single fused loop: out[i] = op(out[i], expr[i]) for every element
+        template<class Storage, class E, class Op>
+        constexpr void evaluate_expression(Storage& out, matrix_expression<E> const& expr, Op op) noexcept;
+
+        // Operations per element, and matrices read, in an expression tree (see matrix_instrument.h)
+        template<class T>
+        inline constexpr size_t expression_operations_v = 0;
+        template<class Op, class Lhs, class Rhs>
+        inline constexpr size_t expression_operations_v<matrix_binary_expression<Op, Lhs, Rhs>> = 1 + expression_operations_v<remove_cvref_t<Lhs>> + expression_operations_v<remove_cvref_t<Rhs>>;
+        template<class Op, class Lhs, class Scalar>
+        inline constexpr size_t expression_operations_v<matrix_scalar_expression<Op, Lhs, Scalar>> = 1 + expression_operations_v<remove_cvref_t<Lhs>>;
+
+        template<class T>
+        inline constexpr size_t expression_operands_v = 1;
+        template<class Op, class Lhs, class Rhs>
+        inline constexpr size_t expression_operands_v<matrix_binary_expression<Op, Lhs, Rhs>> = expression_operands_v<remove_cvref_t<Lhs>> + expression_operands_v<remove_cvref_t<Rhs>>;
+        template<class Op, class Lhs, class Scalar>
+        inline constexpr size_t expression_operands_v<matrix_scalar_expression<Op, Lhs, Scalar>> = expression_operands_v<remove_cvref_t<Lhs>>;
+    }
+
+    template<class Op, class Lhs, class Rhs>
+    struct matrix_binary_expression : matrix_expression<matrix_binary_expression<Op, Lhs, Rhs>>
+    {
+        using rep_t = detail::operand_rep_t<Lhs>;
+        using scalar_t = typename rep_t::scalar_t;
+
+        template<class L, class R>
+        constexpr matrix_binary_expression(L&& lhs, R&& rhs) noexcept;
+        constexpr std::pair<size_t, size_t> size() const noexcept;
+        constexpr scalar_t operator[](size_t i) const noexcept;
+
+        Lhs _Lhs;
+        Rhs _Rhs;
+    };
+
+    template<class Op, class Lhs, class Scalar>
+    struct matrix_scalar_expression : matrix_expression<matrix_scalar_expression<Op, Lhs, Scalar>>
+    {
+        using rep_t = detail::operand_rep_t<Lhs>;
+        using scalar_t = typename rep_t::scalar_t;
+
+        template<class L>
+        constexpr matrix_scalar_expression(L&& lhs, Scalar const& rhs) noexcept;
+        constexpr std::pair<size_t, size_t> size() const noexcept;
+        constexpr scalar_t operator[](size_t i) const noexcept;
+
+        Lhs _Lhs;
+        Scalar _Rhs;
+    };
+
+    // Equality against expressions, evaluated without materialising the expression
+    template<class Lhs, class Rhs, class = std::enable_if_t<(detail::is_matrix_expression_v<Lhs> || detail::is_matrix_expression_v<Rhs>)
+        && std::is_same_v<detail::operand_rep_t<Lhs>, detail::operand_rep_t<Rhs>>>>
+    constexpr bool operator==(Lhs const& lhs, Rhs const& rhs) noexcept;
+
+    template<class Lhs, class Rhs, class = std::enable_if_t<(detail::is_matrix_expression_v<Lhs> || detail::is_matrix_expression_v<Rhs>)
+        && std::is_same_v<detail::operand_rep_t<Lhs>, detail::operand_rep_t<Rhs>>>>
+    constexpr bool operator!=(Lhs const& lhs, Rhs const& rhs) noexcept;
+}
+
+////////////////////////////////////////////////////////
+// matrix_expression implementation
+////////////////////////////////////////////////////////
+template<class Derived>
+inline constexpr Derived const& std::experimental::la::matrix_expression<Derived>::self() const noexcept
+{
+    return static_cast<Derived const&>(*this);
+}
+
+template<class Derived>
+inline constexpr auto std::experimental::la::matrix_expression<Derived>::eval() const
+{
+    return matrix<typename Derived::rep_t>(self());
+}
+
+template<class Rep>
+inline constexpr typename Rep::scalar_t std::experimental::la::detail::expression_element(matrix<Rep> const& mat, size_t i) noexcept
+{
+    return mat.data().cbegin()[i];
+}
+
+template<class View>
+inline constexpr typename View::scalar_t std::experimental::la::detail::expression_element(matrix<view_traits<View>> const& mat, size_t i) noexcept
+{
+    // Elements are numbered in row-major order whatever the strides of the view
+    auto const& view = mat.data();
+    return view(i / view.cols(), i % view.cols());
+}
+
+template<class E>
+inline constexpr auto std::experimental::la::detail::expression_element(matrix_expression<E> const& expr, size_t i) noexcept
+{
+    return expr.self()[i];
+}
+
+template<class Rep>
+inline constexpr std::pair<size_t, size_t> std::experimental::la::detail::expression_size(matrix<Rep> const& mat) noexcept
+{
+    return { mat.data().rows(), mat.data().cols() };
+}
+
+template<class E>
+inline constexpr std::pair<size_t, size_t> std::experimental::la::detail::expression_size(matrix_expression<E> const& expr) noexcept
+{
+    return expr.self().size();
+}
+
+template<class Storage, class E, class Op>
+inline constexpr void std::experimental::la::detail::evaluate_expression(Storage& out, matrix_expression<E> const& expr, Op op) noexcept
+{
+    auto const& e = expr.self();
+    auto const size = e.size();
+    assert(size.first == out.rows() && size.second == out.cols());
+    auto* o = out.begin();
+    for (auto i = size_t(0); i < size.first * size.second; ++i)
+    {
+        o[i] = op(o[i], e[i]);
+    }
+}
+
+////////////////////////////////////////////////////////
+// matrix_binary_expression implementation
+////////////////////////////////////////////////////////
+template<class Op, class Lhs, class Rhs>
+template<class L, class R>
+inline constexpr std::experimental::la::matrix_binary_expression<Op, Lhs, Rhs>::matrix_binary_expression(L&& lhs, R&& rhs) noexcept
+    : _Lhs(std::forward<L>(lhs))
+    , _Rhs(std::forward<R>(rhs))
+{
+    assert(detail::expression_size(_Lhs) == detail::expression_size(_Rhs));
+}
+
+template<class Op, class Lhs, class Rhs>
+inline constexpr std::pair<size_t, size_t> std::experimental::la::matrix_binary_expression<Op, Lhs, Rhs>::size() const noexcept
+{
+    return detail::expression_size(_Lhs);
+}
+
+template<class Op, class Lhs, class Rhs>
+inline constexpr typename std::experimental::la::matrix_binary_expression<Op, Lhs, Rhs>::scalar_t std::experimental::la::matrix_binary_expression<Op, Lhs, Rhs>::operator[](size_t i) const noexcept
+{
+    return Op{}(detail::expression_element(_Lhs, i), detail::expression_element(_Rhs, i));
+}
+
+////////////////////////////////////////////////////////
+// matrix_scalar_expression implementation
+////////////////////////////////////////////////////////
+template<class Op, class Lhs, class Scalar>
+template<class L>
+inline constexpr std::experimental::la::matrix_scalar_expression<Op, Lhs, Scalar>::matrix_scalar_expression(L&& lhs, Scalar const& rhs) noexcept
+    : _Lhs(std::forward<L>(lhs))
+    , _Rhs(rhs)
+{}
+
+template<class Op, class Lhs, class Scalar>
+inline constexpr std::pair<size_t, size_t> std::experimental::la::matrix_scalar_expression<Op, Lhs, Scalar>::size() const noexcept
+{
+    return detail::expression_size(_Lhs);
+}
+
+template<class Op, class Lhs, class Scalar>
+inline constexpr typename std::experimental::la::matrix_scalar_expression<Op, Lhs, Scalar>::scalar_t std::experimental::la::matrix_scalar_expression<Op, Lhs, Scalar>::operator[](size_t i) const noexcept
+{
+    return Op{}(detail::expression_element(_Lhs, i), _Rhs);
+}
+
+////////////////////////////////////////////////////////
+// expression equality implementation
+////////////////////////////////////////////////////////
+template<class Lhs, class Rhs, class>
+inline constexpr bool std::experimental::la::operator==(Lhs const& lhs, Rhs const& rhs) noexcept
+{
+    auto const size = detail::expression_size(lhs);
+    if (size != detail::expression_size(rhs)) return false;
+    for (auto i = size_t(0); i < size.first * size.second; ++i)
+    {
+        if (!(detail::expression_element(lhs, i) == detail::expression_element(rhs, i))) return false;
+    }
+    return true;
+}
+
+template<class Lhs, class Rhs, class>
+inline constexpr bool std::experimental::la::operator!=(Lhs const& lhs, Rhs const& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+#endif
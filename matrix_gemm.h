@@ -0,0 +1,529 @@
+#if !defined MATRIX_GEMM_26_10_18_09_12_04
+#define MATRIX_GEMM_26_10_18_09_12_04
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "matrix_allocator.h"
+#include "matrix_instrument.h"
+#include "matrix_simd.h"
+#include "matrix_thread_pool.h"
+
+/*
+General matrix multiply engine, C = alpha * A * B + beta * C.
+
+Operands are described by a pointer plus a row stride and a column stride, so the
+same engine serves row-major storage, transposed operands and sub-blocks without copying.
+
+The blocked path follows the usual layered scheme:
+    jc loop: nc columns of B, sized so the packed B panel stays in L3
+    pc loop: kc deep slice of A and B, packed B panel (kc x nc)
+    ic loop: mc rows of A, packed A block (mc x kc) stays in L2
+    jr/ir loops: mr x nr micro-tile of C accumulated in registers from packed micro-panels in L1
+
+For float and double the micro-kernel, and with it mr and nr, is picked at run time from
+the simd_level of matrix_simd.h: each vector instruction set has a kernel written against
+its ops<Scalar> with a tile sized to its register file. Every other scalar, and every
+scalar on targets without a vector kernel, takes the portable kernel and gemm_blocking.
+
+A and B may hold a narrower Operand type than C, such as half or bfloat16. They are
+widened to the type of C as they are packed, so the micro-kernel and its accumulators
+always run at the precision of C.
+
+The parallel overload cuts C into tiles of whole micro-tiles and runs the sequential
+engine on each; every thread packs into its own thread-local workspace.
+*/
+
+namespace std::experimental::la::detail {
+    ////////////////////////////////////////////////////////
+    // gemm_blocking
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct gemm_blocking
+    {
+        static constexpr size_t mr = 4;             // Micro-tile rows
+        static constexpr size_t nr = 4;             // Micro-tile columns
+        static constexpr size_t kc = 256;           // Packed panel depth (L1)
+        static constexpr size_t mc = 64;            // Packed A block rows (L2)
+        static constexpr size_t nc = 2048;          // Packed B panel columns (L3)
+        static constexpr size_t direct_size = 16;   // Below direct_size^3 multiply-adds packing does not pay
+    };
+
+    // The float and double tiles are those of the portable kernel, sized for the 32 registers
+    // of 128 bits on AArch64; x86 targets replace mr and nr through gemm_dispatch below.
+    template<>
+    struct gemm_blocking<float>
+    {
+        static constexpr size_t mr = 4;
+        static constexpr size_t nr = 16;
+        static constexpr size_t kc = 256;
+        static constexpr size_t mc = 96;
+        static constexpr size_t nc = 4096;
+        static constexpr size_t direct_size = 24;
+    };
+
+    template<>
+    struct gemm_blocking<double>
+    {
+        static constexpr size_t mr = 4;
+        static constexpr size_t nr = 8;
+        static constexpr size_t kc = 256;
+        static constexpr size_t mc = 72;
+        static constexpr size_t nc = 4096;
+        static constexpr size_t direct_size = 24;
+    };
+
+    ////////////////////////////////////////////////////////
+    // gemm_kernels
+    ////////////////////////////////////////////////////////
+    // A micro-kernel with the mr x nr tile it computes, which is also the shape A and B are packed to.
+    // mc and nc of gemm_blocking are multiples of every tile below, so only the edge blocks are ragged.
+    template<class Scalar>
+    struct gemm_kernels
+    {
+        size_t mr;
+        size_t nr;
+        void (*kernel)(size_t k, Scalar alpha, Scalar const* a, Scalar const* b,
+            Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, size_t m, size_t n) noexcept;
+    };
+
+    template<class Scalar>
+    gemm_kernels<Scalar> const& gemm_kernels_for(simd_level level) noexcept;
+
+    template<class Scalar>
+    gemm_kernels<Scalar> const& gemm_dispatch() noexcept;
+
+    ////////////////////////////////////////////////////////
+    // gemm_workspace
+    ////////////////////////////////////////////////////////
+    // Packing buffers are cache-line aligned so every micro-panel load is aligned
+    template<class Scalar>
+    struct gemm_workspace
+    {
+        using buffer_t = std::vector<Scalar, aligned_allocator<Scalar>>;
+
+        Scalar* a_panel(size_t size);
+        Scalar* b_panel(size_t size);
+        Scalar* c_panel(size_t size);               // Rows of C set aside by an in-place product
+
+        buffer_t _A;
+        buffer_t _B;
+        buffer_t _C;
+    };
+
+    template<class Scalar>
+    gemm_workspace<Scalar>& thread_gemm_workspace();
+
+    ////////////////////////////////////////////////////////
+    // gemm kernels
+    ////////////////////////////////////////////////////////
+    template<class Scalar, class Operand>
+    constexpr void gemm_direct(size_t m, size_t n, size_t k, Scalar alpha,
+        Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+        Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+        Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc) noexcept;
+
+    template<class Scalar, class Operand>
+    void gemm_blocked(size_t m, size_t n, size_t k, Scalar alpha,
+        Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+        Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+        Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc);
+
+    template<class Scalar, class Operand>
+    void gemm(size_t m, size_t n, size_t k, Scalar alpha,
+        Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+        Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+        Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc);
+
+    template<class Scalar, class Operand>
+    void gemm(thread_pool* pool, size_t m, size_t n, size_t k, Scalar alpha,
+        Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+        Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+        Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc);
+}
+
+////////////////////////////////////////////////////////
+// gemm_workspace implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline Scalar* std::experimental::la::detail::gemm_workspace<Scalar>::a_panel(size_t size)
+{
+    if (size > _A.size())
+    {
+        _A = buffer_t(size);
+        _LA_RECORD_ALLOCATION(size * sizeof(Scalar));
+    }
+    return _A.data();
+}
+
+template<class Scalar>
+inline Scalar* std::experimental::la::detail::gemm_workspace<Scalar>::b_panel(size_t size)
+{
+    if (size > _B.size())
+    {
+        _B = buffer_t(size);
+        _LA_RECORD_ALLOCATION(size * sizeof(Scalar));
+    }
+    return _B.data();
+}
+
+template<class Scalar>
+inline Scalar* std::experimental::la::detail::gemm_workspace<Scalar>::c_panel(size_t size)
+{
+    if (size > _C.size())
+    {
+        _C = buffer_t(size);
+        _LA_RECORD_ALLOCATION(size * sizeof(Scalar));
+    }
+    return _C.data();
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::gemm_workspace<Scalar>& std::experimental::la::detail::thread_gemm_workspace()
+{
+    // Packing buffers only grow, so steady-state multiplies do not allocate
+    thread_local gemm_workspace<Scalar> ws;
+    return ws;
+}
+
+////////////////////////////////////////////////////////
+// gemm implementation
+////////////////////////////////////////////////////////
+namespace std::experimental::la::detail {
+    // Packs an m x k block of A into micro-panels of mr rows, each stored column by column.
+    // Rows past the edge of the block are zero-filled so the micro-kernel never branches.
+    // Narrower operands are widened to Scalar here, once per packed element.
+    template<class Scalar, class Operand>
+    inline void pack_a(size_t mr, size_t m, size_t k, Operand const* a, ptrdiff_t rsa, ptrdiff_t csa, Scalar* out) noexcept
+    {
+        for (auto i = size_t(0); i < m; i += mr)
+        {
+            auto const rows = std::min(mr, m - i);
+            auto const* panel = a + ptrdiff_t(i) * rsa;
+            for (auto p = size_t(0); p < k; ++p)
+            {
+                auto const* in = panel + ptrdiff_t(p) * csa;
+                auto r = size_t(0);
+                for (; r < rows; ++r) *out++ = Scalar(in[ptrdiff_t(r) * rsa]);
+                for (; r < mr; ++r) *out++ = Scalar(0);
+            }
+        }
+    }
+
+    // Packs a k x n panel of B into micro-panels of nr columns, each stored row by row.
+    template<class Scalar, class Operand>
+    inline void pack_b(size_t nr, size_t k, size_t n, Operand const* b, ptrdiff_t rsb, ptrdiff_t csb, Scalar* out) noexcept
+    {
+        for (auto j = size_t(0); j < n; j += nr)
+        {
+            auto const cols = std::min(nr, n - j);
+            auto const* panel = b + ptrdiff_t(j) * csb;
+            for (auto p = size_t(0); p < k; ++p)
+            {
+                auto const* in = panel + ptrdiff_t(p) * rsb;
+                auto c = size_t(0);
+                for (; c < cols; ++c) *out++ = Scalar(in[ptrdiff_t(c) * csb]);
+                for (; c < nr; ++c) *out++ = Scalar(0);
+            }
+        }
+    }
+
+    // Computes an MR x NR tile from packed micro-panels. The fixed trip counts let the
+    // compiler unroll and vectorise the rank-1 updates for whatever the target offers.
+    template<class Scalar, size_t MR, size_t NR>
+    inline void micro_kernel(size_t k, Scalar alpha, Scalar const* a, Scalar const* b,
+        Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, size_t m, size_t n) noexcept
+    {
+        Scalar ab[MR * NR] = {};
+        for (auto p = size_t(0); p < k; ++p, a += MR, b += NR)
+        {
+            for (auto i = size_t(0); i < MR; ++i)
+            {
+                auto const ai = a[i];
+                for (auto j = size_t(0); j < NR; ++j)
+                {
+                    ab[i * NR + j] += ai * b[j];
+                }
+            }
+        }
+        for (auto i = size_t(0); i < m; ++i)
+        {
+            auto* out = c + ptrdiff_t(i) * rsc;
+            for (auto j = size_t(0); j < n; ++j)
+            {
+                auto& el = out[ptrdiff_t(j) * csc];
+                el = beta == Scalar(0) ? alpha * ab[i * NR + j] : alpha * ab[i * NR + j] + beta * el;
+            }
+        }
+    }
+
+    template<class Scalar>
+    inline constexpr void scale(size_t m, size_t n, Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc) noexcept
+    {
+        if (beta == Scalar(1)) return;
+        for (auto i = size_t(0); i < m; ++i)
+        {
+            for (auto j = size_t(0); j < n; ++j)
+            {
+                auto& el = c[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc];
+                el = beta == Scalar(0) ? Scalar(0) : beta * el;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////
+// Instruction set micro-kernels
+////////////////////////////////////////////////////////
+// Each reopens an instruction set namespace of matrix_simd.h, so the shared kernel in
+// matrix_gemm_kernels.inl finds that set's ops<Scalar> beside its gemm_tile<Scalar>.
+// A tile keeps mr * nr / width accumulators, a row of B in nr / width vectors and one broadcast of A live.
+#if defined _LA_SIMD_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+namespace std::experimental::la::detail::simd_sse2 {
+    // 12 of the 16 xmm registers accumulate
+    template<class Scalar>
+    struct gemm_tile
+    {
+        static constexpr size_t mr = 6;
+        static constexpr size_t nr = 2 * ops<Scalar>::width;
+    };
+#include "matrix_gemm_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+namespace std::experimental::la::detail::simd_avx2 {
+    // 12 of the 16 ymm registers accumulate
+    template<class Scalar>
+    struct gemm_tile
+    {
+        static constexpr size_t mr = 6;
+        static constexpr size_t nr = 2 * ops<Scalar>::width;
+    };
+#include "matrix_gemm_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+namespace std::experimental::la::detail::simd_avx512 {
+    // 24 of the 32 zmm registers accumulate
+    template<class Scalar>
+    struct gemm_tile
+    {
+        static constexpr size_t mr = 12;
+        static constexpr size_t nr = 2 * ops<Scalar>::width;
+    };
+#include "matrix_gemm_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+////////////////////////////////////////////////////////
+// gemm dispatch implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::detail::gemm_kernels<Scalar> const& std::experimental::la::detail::gemm_kernels_for(simd_level level) noexcept
+{
+    using blk = gemm_blocking<Scalar>;
+    static constexpr gemm_kernels<Scalar> portable_kernels = { blk::mr, blk::nr, &micro_kernel<Scalar, blk::mr, blk::nr> };
+#if defined _LA_SIMD_X86
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        using sse2 = simd_sse2::gemm_tile<Scalar>;
+        using avx2 = simd_avx2::gemm_tile<Scalar>;
+        using avx512 = simd_avx512::gemm_tile<Scalar>;
+        static constexpr gemm_kernels<Scalar> sse2_kernels = { sse2::mr, sse2::nr,
+            &simd_sse2::gemm_micro_kernel<Scalar, sse2::mr, sse2::nr> };
+        static constexpr gemm_kernels<Scalar> avx2_kernels = { avx2::mr, avx2::nr,
+            &simd_avx2::gemm_micro_kernel<Scalar, avx2::mr, avx2::nr> };
+        static constexpr gemm_kernels<Scalar> avx512_kernels = { avx512::mr, avx512::nr,
+            &simd_avx512::gemm_micro_kernel<Scalar, avx512::mr, avx512::nr> };
+        switch (level)
+        {
+        case simd_level::avx512: return avx512_kernels;
+        case simd_level::avx2: return avx2_kernels;
+        case simd_level::sse2: return sse2_kernels;
+        default: break;
+        }
+    }
+#endif
+    return portable_kernels;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::gemm_kernels<Scalar> const& std::experimental::la::detail::gemm_dispatch() noexcept
+{
+    static auto const& kernels = gemm_kernels_for<Scalar>(active_simd_level());
+    return kernels;
+}
+
+template<class Scalar, class Operand>
+inline constexpr void std::experimental::la::detail::gemm_direct(size_t m, size_t n, size_t k, Scalar alpha,
+    Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc) noexcept
+{
+    scale(m, n, beta, c, rsc, csc);
+    if (rsc == 1 && csc != 1)
+    {
+        // j-p-i order for a column-major C: the innermost loop streams a column of A and a column of C
+        for (auto j = size_t(0); j < n; ++j)
+        {
+            auto* out = c + ptrdiff_t(j) * csc;
+            for (auto p = size_t(0); p < k; ++p)
+            {
+                auto const bpj = alpha * Scalar(b[ptrdiff_t(p) * rsb + ptrdiff_t(j) * csb]);
+                auto const* in = a + ptrdiff_t(p) * csa;
+                for (auto i = size_t(0); i < m; ++i)
+                {
+                    out[ptrdiff_t(i) * rsc] += Scalar(in[ptrdiff_t(i) * rsa]) * bpj;
+                }
+            }
+        }
+        return;
+    }
+    // i-p-j order: the innermost loop streams a row of B and a row of C
+    for (auto i = size_t(0); i < m; ++i)
+    {
+        auto* out = c + ptrdiff_t(i) * rsc;
+        for (auto p = size_t(0); p < k; ++p)
+        {
+            auto const aip = alpha * Scalar(a[ptrdiff_t(i) * rsa + ptrdiff_t(p) * csa]);
+            auto const* in = b + ptrdiff_t(p) * rsb;
+            for (auto j = size_t(0); j < n; ++j)
+            {
+                out[ptrdiff_t(j) * csc] += aip * Scalar(in[ptrdiff_t(j) * csb]);
+            }
+        }
+    }
+}
+
+template<class Scalar, class Operand>
+inline void std::experimental::la::detail::gemm_blocked(size_t m, size_t n, size_t k, Scalar alpha,
+    Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    using blk = gemm_blocking<Scalar>;
+    if (m == 0 || n == 0) return;
+    if (k == 0 || alpha == Scalar(0))
+    {
+        scale(m, n, beta, c, rsc, csc);
+        return;
+    }
+
+    auto const& kern = gemm_dispatch<Scalar>();
+    auto const mr = kern.mr;
+    auto const nr = kern.nr;
+    auto& ws = thread_gemm_workspace<Scalar>();
+    auto const b_cols = (std::min(n, blk::nc) + nr - 1) / nr * nr;
+    auto const a_rows = (std::min(m, blk::mc) + mr - 1) / mr * mr;
+    auto* bp = ws.b_panel(b_cols * std::min(k, blk::kc));
+    auto* ap = ws.a_panel(a_rows * std::min(k, blk::kc));
+
+    for (auto jc = size_t(0); jc < n; jc += blk::nc)
+    {
+        auto const nc = std::min(blk::nc, n - jc);
+        for (auto pc = size_t(0); pc < k; pc += blk::kc)
+        {
+            auto const kc = std::min(blk::kc, k - pc);
+            // Only the first slice applies beta; later slices accumulate into C
+            auto const beta_pc = pc == 0 ? beta : Scalar(1);
+            pack_b<Scalar>(nr, kc, nc, b + ptrdiff_t(pc) * rsb + ptrdiff_t(jc) * csb, rsb, csb, bp);
+            for (auto ic = size_t(0); ic < m; ic += blk::mc)
+            {
+                auto const mc = std::min(blk::mc, m - ic);
+                pack_a<Scalar>(mr, mc, kc, a + ptrdiff_t(ic) * rsa + ptrdiff_t(pc) * csa, rsa, csa, ap);
+                for (auto jr = size_t(0); jr < nc; jr += nr)
+                {
+                    for (auto ir = size_t(0); ir < mc; ir += mr)
+                    {
+                        kern.kernel(kc, alpha, ap + ir * kc, bp + jr * kc, beta_pc,
+                            c + ptrdiff_t(ic + ir) * rsc + ptrdiff_t(jc + jr) * csc, rsc, csc,
+                            std::min(mr, mc - ir), std::min(nr, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<class Scalar, class Operand>
+inline void std::experimental::la::detail::gemm(size_t m, size_t n, size_t k, Scalar alpha,
+    Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    using blk = gemm_blocking<Scalar>;
+    if (m * n * k <= blk::direct_size * blk::direct_size * blk::direct_size)
+    {
+        gemm_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+    }
+    else
+    {
+        gemm_blocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+    }
+}
+
+template<class Scalar, class Operand>
+inline void std::experimental::la::detail::gemm(thread_pool* pool, size_t m, size_t n, size_t k, Scalar alpha,
+    Operand const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Operand const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    auto const& kern = gemm_dispatch<Scalar>();
+    auto const threads = pool ? pool->concurrency() : size_t(1);
+    if (threads == 1 || m * n * k < parallel_gemm_threshold)
+    {
+        gemm(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+        return;
+    }
+
+    // A few tiles per thread, with the tile grid following the shape of C
+    auto const target = 4 * threads;
+    auto const max_rows = (m + kern.mr - 1) / kern.mr;
+    auto const max_cols = (n + kern.nr - 1) / kern.nr;
+    auto const row_parts = std::clamp(size_t(std::sqrt(double(target) * double(m) / double(n)) + 0.5), size_t(1), max_rows);
+    auto const col_parts = std::clamp((target + row_parts - 1) / row_parts, size_t(1), max_cols);
+    auto const tm = ((m + row_parts - 1) / row_parts + kern.mr - 1) / kern.mr * kern.mr;
+    auto const tn = ((n + col_parts - 1) / col_parts + kern.nr - 1) / kern.nr * kern.nr;
+    auto const cols = (n + tn - 1) / tn;
+    pool->parallel_for((m + tm - 1) / tm * cols, [&](size_t t) {
+        auto const i = t / cols * tm;
+        auto const j = t % cols * tn;
+        gemm(std::min(tm, m - i), std::min(tn, n - j), k, alpha, a + ptrdiff_t(i) * rsa, rsa, csa, b + ptrdiff_t(j) * csb, rsb, csb,
+            beta, c + ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc, rsc, csc);
+    });
+}
+
+#endif
@@ -0,0 +1,67 @@
+// The gemm micro-kernel shared by every vector instruction set in matrix_gemm.h. Included once
+// inside each detail::simd_* namespace, after that namespace's ops<Scalar> and gemm_tile<Scalar>,
+// so deliberately has no include guard. gemm_tile sizes the MR x NR accumulator block, one row
+// of the packed B micro-panel and a broadcast of A to fit that set's vector register file.
+
+// The fold of detail::unroll, repeated here so it is compiled for this instruction set:
+// GCC will not inline a lambda built for a wider target into a helper built for the baseline,
+// and the accumulators only stay in registers once every index is a constant.
+template<class F, size_t... I>
+inline void gemm_unroll_each(F& f, std::index_sequence<I...>) noexcept
+{
+    (f(std::integral_constant<size_t, I>{}), ...);
+}
+
+template<size_t N, class F>
+inline void gemm_unroll(F&& f) noexcept
+{
+    gemm_unroll_each(f, std::make_index_sequence<N>{});
+}
+
+template<class Scalar, size_t MR, size_t NR>
+inline void gemm_micro_kernel(size_t k, Scalar alpha, Scalar const* a, Scalar const* b,
+    Scalar beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, size_t m, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    constexpr auto nv = NR / v::width;
+    static_assert(nv * v::width == NR, "a micro-tile row must be a whole number of vectors");
+
+    typename v::vec ab[MR][nv];
+    gemm_unroll<MR * nv>([&](auto e) { ab[e / nv][e % nv] = v::zero(); });
+    for (auto p = size_t(0); p < k; ++p, a += MR, b += NR)
+    {
+        typename v::vec bp[nv];
+        gemm_unroll<nv>([&](auto j) { bp[j] = v::load(b + j * v::width); });
+        gemm_unroll<MR>([&](auto i) {
+            auto const ai = v::set1(a[i]);
+            gemm_unroll<nv>([&](auto j) { ab[i][j] = v::fmadd(ai, bp[j], ab[i][j]); });
+        });
+    }
+
+    if (m == MR && n == NR && csc == 1)
+    {
+        // Whole tile of a row-major C: scale and store straight from the accumulators
+        auto const va = v::set1(alpha);
+        auto const vb = v::set1(beta);
+        gemm_unroll<MR * nv>([&](auto e) {
+            auto* out = c + ptrdiff_t(e / nv) * rsc + ptrdiff_t(e % nv * v::width);
+            auto res = v::mul(va, ab[e / nv][e % nv]);
+            if (beta != Scalar(0)) res = v::fmadd(vb, v::load(out), res);
+            v::store(out, res);
+        });
+        return;
+    }
+
+    // Edge tiles and strided C go through a spill, which costs little next to the k-deep update
+    Scalar tile[MR * NR];
+    gemm_unroll<MR * nv>([&](auto e) { v::store(tile + e * v::width, ab[e / nv][e % nv]); });
+    for (auto i = size_t(0); i < m; ++i)
+    {
+        auto* out = c + ptrdiff_t(i) * rsc;
+        for (auto j = size_t(0); j < n; ++j)
+        {
+            auto& el = out[ptrdiff_t(j) * csc];
+            el = beta == Scalar(0) ? alpha * tile[i * NR + j] : alpha * tile[i * NR + j] + beta * el;
+        }
+    }
+}
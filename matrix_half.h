@@ -0,0 +1,685 @@
+#if !defined MATRIX_HALF_26_10_18_20_14_37
+#define MATRIX_HALF_26_10_18_20_14_37
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "matrix_allocator.h"
+#include "matrix_gemm.h"
+#include "matrix_instrument.h"
+#include "matrix_simd.h"
+#include "matrix_thread_pool.h"
+
+/*
+Reduced precision scalars: half (IEEE 754 binary16) and bfloat16 (the top half of a float).
+
+Both are two-byte storage types. Each element converts to float implicitly, and a float
+converts back explicitly, rounding to nearest even. Arithmetic on single elements is done
+in float and rounded once. They halve the memory and bandwidth of a float matrix, so they
+suit large operands whose products are bound by memory traffic.
+
+The traits never accumulate in the storage type. Element-wise operations, inner_product,
+modulus and matrix_multiply widen their operands to float (accumulator_t), do every
+operation at that precision, and round each result once, as it is stored:
+    multiply: the gemm engine widens A and B as it packs them and accumulates into a
+        float copy of C, which is narrowed in one pass at the end
+    reductions: float partial sums per chunk, summed in float, rounded on return
+
+Vector conversions use F16C and AVX-512F for half, and integer shifts for bfloat16, and
+are picked with the rest of the kernels in matrix_simd.h. Single conversions use F16C when
+the whole program is built for it, and exact bit manipulation otherwise.
+*/
+
+#if defined _LA_SIMD_X86 && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define _LA_F16C 1
+#endif
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // half
+    ////////////////////////////////////////////////////////
+    // 1 sign, 5 exponent and 10 fraction bits: about 3 decimal digits, up to 65504
+    class half
+    {
+    public:
+        half() = default;
+        explicit half(float f) noexcept;
+        operator float() const noexcept;
+
+        static constexpr half from_bits(uint16_t bits) noexcept;
+        constexpr uint16_t bits() const noexcept;
+
+    private:
+        uint16_t _Bits;
+    };
+
+    ////////////////////////////////////////////////////////
+    // bfloat16
+    ////////////////////////////////////////////////////////
+    // 1 sign, 8 exponent and 7 fraction bits: the range of float with about 2 decimal digits
+    class bfloat16
+    {
+    public:
+        bfloat16() = default;
+        explicit bfloat16(float f) noexcept;
+        operator float() const noexcept;
+
+        static constexpr bfloat16 from_bits(uint16_t bits) noexcept;
+        constexpr uint16_t bits() const noexcept;
+
+    private:
+        uint16_t _Bits;
+    };
+
+    namespace detail {
+        template<class Scalar>
+        inline constexpr bool is_reduced_precision_v = std::is_same_v<Scalar, half> || std::is_same_v<Scalar, bfloat16>;
+
+        // The type the traits accumulate and compute in
+        template<class Scalar>
+        using accumulator_t = std::conditional_t<is_reduced_precision_v<Scalar>, float, Scalar>;
+
+        template<class Scalar>
+        using if_reduced_t = std::enable_if_t<is_reduced_precision_v<Scalar>, Scalar>;
+
+        float half_to_float(uint16_t h) noexcept;
+        uint16_t float_to_half(float f) noexcept;
+        float bfloat16_to_float(uint16_t b) noexcept;
+        uint16_t float_to_bfloat16(float f) noexcept;
+    }
+
+    // Computed in float and rounded once
+    template<class Scalar> detail::if_reduced_t<Scalar> operator+(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar> operator-(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar> operator*(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar> operator/(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar> operator-(Scalar val) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar>& operator+=(Scalar& lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar>& operator-=(Scalar& lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar>& operator*=(Scalar& lhs, Scalar rhs) noexcept;
+    template<class Scalar> detail::if_reduced_t<Scalar>& operator/=(Scalar& lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator==(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator!=(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator<(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator<=(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator>(Scalar lhs, Scalar rhs) noexcept;
+    template<class Scalar> std::enable_if_t<detail::is_reduced_precision_v<Scalar>, bool> operator>=(Scalar lhs, Scalar rhs) noexcept;
+}
+
+namespace std {
+    template<>
+    class numeric_limits<experimental::la::half>
+    {
+        using half = experimental::la::half;
+    public:
+        static constexpr bool is_specialized = true;
+        static constexpr bool is_signed = true;
+        static constexpr bool is_integer = false;
+        static constexpr bool is_exact = false;
+        static constexpr bool has_infinity = true;
+        static constexpr bool has_quiet_NaN = true;
+        static constexpr bool has_signaling_NaN = true;
+        static constexpr bool is_iec559 = true;
+        static constexpr bool is_bounded = true;
+        static constexpr bool is_modulo = false;
+        static constexpr bool traps = false;
+        static constexpr bool tinyness_before = false;
+        static constexpr float_round_style round_style = round_to_nearest;
+        static constexpr int radix = 2;
+        static constexpr int digits = 11;
+        static constexpr int digits10 = 3;
+        static constexpr int max_digits10 = 5;
+        static constexpr int min_exponent = -13;
+        static constexpr int min_exponent10 = -4;
+        static constexpr int max_exponent = 16;
+        static constexpr int max_exponent10 = 4;
+        static constexpr half min() noexcept { return half::from_bits(0x0400); }
+        static constexpr half lowest() noexcept { return half::from_bits(0xfbff); }
+        static constexpr half max() noexcept { return half::from_bits(0x7bff); }
+        static constexpr half epsilon() noexcept { return half::from_bits(0x1400); }
+        static constexpr half round_error() noexcept { return half::from_bits(0x3800); }
+        static constexpr half infinity() noexcept { return half::from_bits(0x7c00); }
+        static constexpr half quiet_NaN() noexcept { return half::from_bits(0x7e00); }
+        static constexpr half signaling_NaN() noexcept { return half::from_bits(0x7d00); }
+        static constexpr half denorm_min() noexcept { return half::from_bits(0x0001); }
+    };
+
+    template<>
+    class numeric_limits<experimental::la::bfloat16>
+    {
+        using bfloat16 = experimental::la::bfloat16;
+    public:
+        static constexpr bool is_specialized = true;
+        static constexpr bool is_signed = true;
+        static constexpr bool is_integer = false;
+        static constexpr bool is_exact = false;
+        static constexpr bool has_infinity = true;
+        static constexpr bool has_quiet_NaN = true;
+        static constexpr bool has_signaling_NaN = true;
+        static constexpr bool is_iec559 = false;
+        static constexpr bool is_bounded = true;
+        static constexpr bool is_modulo = false;
+        static constexpr bool traps = false;
+        static constexpr bool tinyness_before = false;
+        static constexpr float_round_style round_style = round_to_nearest;
+        static constexpr int radix = 2;
+        static constexpr int digits = 8;
+        static constexpr int digits10 = 2;
+        static constexpr int max_digits10 = 4;
+        static constexpr int min_exponent = -125;
+        static constexpr int min_exponent10 = -37;
+        static constexpr int max_exponent = 128;
+        static constexpr int max_exponent10 = 38;
+        static constexpr bfloat16 min() noexcept { return bfloat16::from_bits(0x0080); }
+        static constexpr bfloat16 lowest() noexcept { return bfloat16::from_bits(0xff7f); }
+        static constexpr bfloat16 max() noexcept { return bfloat16::from_bits(0x7f7f); }
+        static constexpr bfloat16 epsilon() noexcept { return bfloat16::from_bits(0x3c00); }
+        static constexpr bfloat16 round_error() noexcept { return bfloat16::from_bits(0x3f00); }
+        static constexpr bfloat16 infinity() noexcept { return bfloat16::from_bits(0x7f80); }
+        static constexpr bfloat16 quiet_NaN() noexcept { return bfloat16::from_bits(0x7fc0); }
+        static constexpr bfloat16 signaling_NaN() noexcept { return bfloat16::from_bits(0x7fa0); }
+        static constexpr bfloat16 denorm_min() noexcept { return bfloat16::from_bits(0x0001); }
+    };
+}
+
+namespace std::experimental::la::detail {
+    ////////////////////////////////////////////////////////
+    // widened_kernels
+    ////////////////////////////////////////////////////////
+    // The simd_kernels of a reduced precision type: loads widen to float, stores round once
+    template<class Scalar>
+    struct widened_kernels
+    {
+        void (*widen)(Scalar const* in, float* out, size_t n) noexcept;
+        void (*narrow)(float const* in, Scalar* out, size_t n) noexcept;
+        void (*add)(Scalar* lhs, Scalar const* rhs, size_t n) noexcept;
+        void (*subtract)(Scalar* lhs, Scalar const* rhs, size_t n) noexcept;
+        void (*scalar_multiply)(Scalar* lhs, float rhs, size_t n) noexcept;
+        void (*divide)(Scalar* lhs, float rhs, size_t n) noexcept;
+        float (*inner_product)(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept;
+        float (*modulus_squared)(Scalar const* mat, size_t n) noexcept;
+    };
+
+    bool detect_f16c() noexcept;
+
+    template<class Scalar>
+    widened_kernels<Scalar> const& widened_kernels_for(simd_level level) noexcept;
+
+    template<class Scalar>
+    widened_kernels<Scalar> const& widened_dispatch() noexcept;
+
+    // C = alpha * A * B + beta * C for reduced precision operands, accumulated in float and rounded once into C
+    template<class Scalar>
+    void widened_gemm(thread_pool* pool, size_t m, size_t n, size_t k, float alpha,
+        Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+        Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+        float beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc);
+}
+
+////////////////////////////////////////////////////////
+// conversion implementation
+////////////////////////////////////////////////////////
+inline float std::experimental::la::detail::half_to_float(uint16_t h) noexcept
+{
+#if defined _LA_F16C
+    return _cvtsh_ss(h);
+#else
+    // Move exponent and fraction into place and rebias; infinities and NaNs take the
+    // float's maximum exponent, NaNs come out quiet as they do from F16C, and subnormals
+    // are renormalised by one float subtraction
+    constexpr auto magic_bits = uint32_t(113) << 23;
+    constexpr auto shifted_exp = uint32_t(0x7c00) << 13;
+    auto bits = uint32_t(h & 0x7fff) << 13;
+    auto const exp = bits & shifted_exp;
+    bits += uint32_t(127 - 15) << 23;
+    auto res = 0.0f;
+    if (exp == shifted_exp)
+    {
+        bits += uint32_t(128 - 16) << 23;
+        if ((h & 0x3ff) != 0) bits |= 0x400000;
+        std::memcpy(&res, &bits, sizeof(res));
+    }
+    else if (exp == 0)
+    {
+        bits += uint32_t(1) << 23;
+        auto magic = 0.0f;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        std::memcpy(&res, &bits, sizeof(res));
+        res -= magic;
+    }
+    else
+    {
+        std::memcpy(&res, &bits, sizeof(res));
+    }
+    return (h & 0x8000) != 0 ? -res : res;
+#endif
+}
+
+inline uint16_t std::experimental::la::detail::float_to_half(float f) noexcept
+{
+#if defined _LA_F16C
+    return uint16_t(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+#else
+    auto bits = uint32_t(0);
+    std::memcpy(&bits, &f, sizeof(bits));
+    auto const sign = uint16_t((bits >> 16) & 0x8000);
+    bits &= 0x7fffffff;
+    auto res = uint16_t(0);
+    if (bits >= uint32_t(127 + 16) << 23)
+    {
+        // Too large for any finite half, infinity, or NaN, which stays quiet
+        res = bits > 0x7f800000 ? uint16_t(0x7e00 | ((bits >> 13) & 0x3ff)) : uint16_t(0x7c00);
+    }
+    else if (bits < uint32_t(127 - 14) << 23)
+    {
+        // Subnormal or zero: adding 0.5 lines the half's last fraction bit up with the
+        // float's, so the hardware add does the round to nearest even
+        constexpr auto magic_bits = uint32_t(126) << 23;
+        auto magic = 0.0f;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        auto val = 0.0f;
+        std::memcpy(&val, &bits, sizeof(val));
+        val += magic;
+        std::memcpy(&bits, &val, sizeof(bits));
+        res = uint16_t(bits - magic_bits);
+    }
+    else
+    {
+        // Normal: rebias, then round the 13 dropped bits to nearest even; a carry out of
+        // the fraction correctly bumps the exponent, up to infinity
+        auto const odd = (bits >> 13) & 1;
+        bits += (uint32_t(15 - 127) << 23) + 0xfff + odd;
+        res = uint16_t(bits >> 13);
+    }
+    return uint16_t(res | sign);
+#endif
+}
+
+inline float std::experimental::la::detail::bfloat16_to_float(uint16_t b) noexcept
+{
+    auto const bits = uint32_t(b) << 16;
+    auto res = 0.0f;
+    std::memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+inline uint16_t std::experimental::la::detail::float_to_bfloat16(float f) noexcept
+{
+    auto bits = uint32_t(0);
+    std::memcpy(&bits, &f, sizeof(bits));
+    // NaNs are truncated with the quiet bit set, since rounding could carry them into infinity
+    if ((bits & 0x7fffffff) > 0x7f800000) return uint16_t((bits >> 16) | 0x40);
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return uint16_t(bits >> 16);
+}
+
+////////////////////////////////////////////////////////
+// half implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::half::half(float f) noexcept
+    : _Bits(detail::float_to_half(f))
+{}
+
+inline std::experimental::la::half::operator float() const noexcept
+{
+    return detail::half_to_float(_Bits);
+}
+
+inline constexpr std::experimental::la::half std::experimental::la::half::from_bits(uint16_t bits) noexcept
+{
+    auto res = half{};
+    res._Bits = bits;
+    return res;
+}
+
+inline constexpr uint16_t std::experimental::la::half::bits() const noexcept
+{
+    return _Bits;
+}
+
+////////////////////////////////////////////////////////
+// bfloat16 implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::bfloat16::bfloat16(float f) noexcept
+    : _Bits(detail::float_to_bfloat16(f))
+{}
+
+inline std::experimental::la::bfloat16::operator float() const noexcept
+{
+    return detail::bfloat16_to_float(_Bits);
+}
+
+inline constexpr std::experimental::la::bfloat16 std::experimental::la::bfloat16::from_bits(uint16_t bits) noexcept
+{
+    auto res = bfloat16{};
+    res._Bits = bits;
+    return res;
+}
+
+inline constexpr uint16_t std::experimental::la::bfloat16::bits() const noexcept
+{
+    return _Bits;
+}
+
+////////////////////////////////////////////////////////
+// reduced precision operators implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar> std::experimental::la::operator+(Scalar lhs, Scalar rhs) noexcept
+{
+    return Scalar(float(lhs) + float(rhs));
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar> std::experimental::la::operator-(Scalar lhs, Scalar rhs) noexcept
+{
+    return Scalar(float(lhs) - float(rhs));
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar> std::experimental::la::operator*(Scalar lhs, Scalar rhs) noexcept
+{
+    return Scalar(float(lhs) * float(rhs));
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar> std::experimental::la::operator/(Scalar lhs, Scalar rhs) noexcept
+{
+    return Scalar(float(lhs) / float(rhs));
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar> std::experimental::la::operator-(Scalar val) noexcept
+{
+    // Both formats keep the sign in the top bit, so negation is exact
+    return Scalar::from_bits(uint16_t(val.bits() ^ 0x8000));
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar>& std::experimental::la::operator+=(Scalar& lhs, Scalar rhs) noexcept
+{
+    return lhs = lhs + rhs;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar>& std::experimental::la::operator-=(Scalar& lhs, Scalar rhs) noexcept
+{
+    return lhs = lhs - rhs;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar>& std::experimental::la::operator*=(Scalar& lhs, Scalar rhs) noexcept
+{
+    return lhs = lhs * rhs;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::if_reduced_t<Scalar>& std::experimental::la::operator/=(Scalar& lhs, Scalar rhs) noexcept
+{
+    return lhs = lhs / rhs;
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator==(Scalar lhs, Scalar rhs) noexcept
+{
+    // Compared as floats, so zeros of either sign are equal and NaNs are unordered
+    return float(lhs) == float(rhs);
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator!=(Scalar lhs, Scalar rhs) noexcept
+{
+    return float(lhs) != float(rhs);
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator<(Scalar lhs, Scalar rhs) noexcept
+{
+    return float(lhs) < float(rhs);
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator<=(Scalar lhs, Scalar rhs) noexcept
+{
+    return float(lhs) <= float(rhs);
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator>(Scalar lhs, Scalar rhs) noexcept
+{
+    return float(lhs) > float(rhs);
+}
+
+template<class Scalar>
+inline std::enable_if_t<std::experimental::la::detail::is_reduced_precision_v<Scalar>, bool> std::experimental::la::operator>=(Scalar lhs, Scalar rhs) noexcept
+{
+    return float(lhs) >= float(rhs);
+}
+
+////////////////////////////////////////////////////////
+// Widening wrappers
+////////////////////////////////////////////////////////
+// Each reopens an instruction set namespace of matrix_simd.h, so the shared loops in
+// matrix_half_kernels.inl find that set's ops<float> beside widen_ops<Scalar>
+namespace std::experimental::la::detail::simd_scalar {
+    template<class Scalar>
+    struct widen_ops
+    {
+        using vec = float;
+        static constexpr size_t width = 1;
+        static vec load(Scalar const* p) noexcept { return float(*p); }
+        static void store(Scalar* p, vec v) noexcept { *p = Scalar(v); }
+    };
+#include "matrix_half_kernels.inl"
+}
+
+#if defined _LA_SIMD_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+namespace std::experimental::la::detail::simd_avx2 {
+    template<class Scalar>
+    struct widen_ops;
+
+    template<>
+    struct widen_ops<half>
+    {
+        using vec = __m256;
+        static constexpr size_t width = 8;
+        static vec load(half const* p) noexcept { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p))); }
+        static void store(half* p, vec v) noexcept
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        }
+    };
+
+    template<>
+    struct widen_ops<bfloat16>
+    {
+        using vec = __m256;
+        static constexpr size_t width = 8;
+        static vec load(bfloat16 const* p) noexcept
+        {
+            auto const el = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(el, 16));
+        }
+        static void store(bfloat16* p, vec v) noexcept
+        {
+            // Round to nearest even as in float_to_bfloat16, with NaNs truncated and kept quiet
+            auto const bits = _mm256_castps_si256(v);
+            auto const odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+            auto const rounded = _mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff)));
+            auto const quiet = _mm256_or_si256(bits, _mm256_set1_epi32(0x400000));
+            auto const nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+            auto const res = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet, nan), 16);
+            // packus works within 128-bit lanes, so gather the two low quarters afterwards
+            auto const packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(res, res), 0xd8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+        }
+    };
+#include "matrix_half_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+namespace std::experimental::la::detail::simd_avx512 {
+    template<class Scalar>
+    struct widen_ops;
+
+    template<>
+    struct widen_ops<half>
+    {
+        using vec = __m512;
+        static constexpr size_t width = 16;
+        // Zero-masked forms with every lane set here and for bfloat16: the unmasked ones pass
+        // an undefined source register that some compilers warn about
+        static vec load(half const* p) noexcept { return _mm512_maskz_cvtph_ps(__mmask16(0xffff), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p))); }
+        static void store(half* p, vec v) noexcept
+        {
+            auto const res = _mm512_maskz_cvtps_ph(__mmask16(0xffff), v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), res);
+        }
+    };
+
+    template<>
+    struct widen_ops<bfloat16>
+    {
+        using vec = __m512;
+        static constexpr size_t width = 16;
+        static vec load(bfloat16 const* p) noexcept
+        {
+            auto const all = __mmask16(0xffff);
+            auto const el = _mm512_maskz_cvtepu16_epi32(all, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)));
+            return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(all, el, 16));
+        }
+        static void store(bfloat16* p, vec v) noexcept
+        {
+            auto const all = __mmask16(0xffff);
+            auto const bits = _mm512_castps_si512(v);
+            auto const odd = _mm512_and_si512(_mm512_maskz_srli_epi32(all, bits, 16), _mm512_set1_epi32(1));
+            auto const rounded = _mm512_add_epi32(bits, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7fff)));
+            auto const quiet = _mm512_or_si512(bits, _mm512_set1_epi32(0x400000));
+            auto const nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+            auto const res = _mm512_maskz_srli_epi32(all, _mm512_mask_blend_epi32(nan, rounded, quiet), 16);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_maskz_cvtepi32_epi16(all, res));
+        }
+    };
+#include "matrix_half_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+////////////////////////////////////////////////////////
+// widened dispatch implementation
+////////////////////////////////////////////////////////
+inline bool std::experimental::la::detail::detect_f16c() noexcept
+{
+#if defined _LA_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 29)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("f16c");
+#endif
+#else
+    return false;
+#endif
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::widened_kernels<Scalar> const& std::experimental::la::detail::widened_kernels_for(simd_level level) noexcept
+{
+    static_assert(is_reduced_precision_v<Scalar>);
+    static constexpr widened_kernels<Scalar> scalar_kernels = { &simd_scalar::widen<Scalar>, &simd_scalar::narrow<Scalar>,
+        &simd_scalar::widened_add<Scalar>, &simd_scalar::widened_subtract<Scalar>, &simd_scalar::widened_scalar_multiply<Scalar>,
+        &simd_scalar::widened_divide<Scalar>, &simd_scalar::widened_inner_product<Scalar>, &simd_scalar::widened_modulus_squared<Scalar> };
+#if defined _LA_SIMD_X86
+    static constexpr widened_kernels<Scalar> avx2_kernels = { &simd_avx2::widen<Scalar>, &simd_avx2::narrow<Scalar>,
+        &simd_avx2::widened_add<Scalar>, &simd_avx2::widened_subtract<Scalar>, &simd_avx2::widened_scalar_multiply<Scalar>,
+        &simd_avx2::widened_divide<Scalar>, &simd_avx2::widened_inner_product<Scalar>, &simd_avx2::widened_modulus_squared<Scalar> };
+    static constexpr widened_kernels<Scalar> avx512_kernels = { &simd_avx512::widen<Scalar>, &simd_avx512::narrow<Scalar>,
+        &simd_avx512::widened_add<Scalar>, &simd_avx512::widened_subtract<Scalar>, &simd_avx512::widened_scalar_multiply<Scalar>,
+        &simd_avx512::widened_divide<Scalar>, &simd_avx512::widened_inner_product<Scalar>, &simd_avx512::widened_modulus_squared<Scalar> };
+    // SSE2 has no half conversions, and bfloat16 gains too little at that width to bother
+    static auto const f16c = std::is_same_v<Scalar, bfloat16> || detect_f16c();
+    switch (level)
+    {
+    case simd_level::avx512: return avx512_kernels;
+    case simd_level::avx2: return f16c ? avx2_kernels : scalar_kernels;
+    default: break;
+    }
+#endif
+    return scalar_kernels;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::widened_kernels<Scalar> const& std::experimental::la::detail::widened_dispatch() noexcept
+{
+    static auto const& kernels = widened_kernels_for<Scalar>(active_simd_level());
+    return kernels;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::widened_gemm(thread_pool* pool, size_t m, size_t n, size_t k, float alpha,
+    Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    float beta, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    // Accumulate in a float copy of C laid out like C, so it narrows in one contiguous pass
+    using acc_t = accumulator_t<Scalar>;
+    auto const column_major = rsc == 1 && csc != 1;
+    auto const rsw = column_major ? ptrdiff_t(1) : ptrdiff_t(n);
+    auto const csw = column_major ? ptrdiff_t(m) : ptrdiff_t(1);
+    auto wide = std::vector<acc_t, aligned_allocator<acc_t>>(m * n);
+    _LA_RECORD_ALLOCATION(m * n * sizeof(acc_t));
+    if (beta != 0.0f)
+    {
+        if (rsc == rsw && csc == csw) widened_dispatch<Scalar>().widen(c, wide.data(), m * n);
+        else
+        {
+            for (auto i = size_t(0); i < m; ++i)
+            {
+                for (auto j = size_t(0); j < n; ++j)
+                {
+                    wide[ptrdiff_t(i) * rsw + ptrdiff_t(j) * csw] = acc_t(c[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc]);
+                }
+            }
+        }
+    }
+    gemm(pool, m, n, k, acc_t(alpha), a, rsa, csa, b, rsb, csb, acc_t(beta), wide.data(), rsw, csw);
+    if (rsc == rsw && csc == csw)
+    {
+        widened_dispatch<Scalar>().narrow(wide.data(), c, m * n);
+        return;
+    }
+    for (auto i = size_t(0); i < m; ++i)
+    {
+        for (auto j = size_t(0); j < n; ++j)
+        {
+            c[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc] = Scalar(wide[ptrdiff_t(i) * rsw + ptrdiff_t(j) * csw]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Loops over half and bfloat16 ranges shared by every instruction set in matrix_half.h.
+// Included once inside each detail::simd_* namespace, after that namespace's widen_ops<Scalar>,
+// so deliberately has no include guard. widen_ops loads a vector of elements as floats and
+// rounds a vector of floats on store; the arithmetic in between is that namespace's ops<float>.
+
+template<class Scalar>
+inline void widen(Scalar const* in, float* out, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) v::store(out + i, w::load(in + i));
+    for (; i < n; ++i) out[i] = float(in[i]);
+}
+
+template<class Scalar>
+inline void narrow(float const* in, Scalar* out, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) w::store(out + i, v::load(in + i));
+    for (; i < n; ++i) out[i] = Scalar(in[i]);
+}
+
+template<class Scalar>
+inline void widened_add(Scalar* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) w::store(lhs + i, v::add(w::load(lhs + i), w::load(rhs + i)));
+    for (; i < n; ++i) lhs[i] = Scalar(float(lhs[i]) + float(rhs[i]));
+}
+
+template<class Scalar>
+inline void widened_subtract(Scalar* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) w::store(lhs + i, v::sub(w::load(lhs + i), w::load(rhs + i)));
+    for (; i < n; ++i) lhs[i] = Scalar(float(lhs[i]) - float(rhs[i]));
+}
+
+template<class Scalar>
+inline void widened_scalar_multiply(Scalar* lhs, float rhs, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto const s = v::set1(rhs);
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) w::store(lhs + i, v::mul(w::load(lhs + i), s));
+    for (; i < n; ++i) lhs[i] = Scalar(float(lhs[i]) * rhs);
+}
+
+template<class Scalar>
+inline void widened_divide(Scalar* lhs, float rhs, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto const s = v::set1(rhs);
+    auto i = size_t(0);
+    for (; i + w::width <= n; i += w::width) w::store(lhs + i, v::div(w::load(lhs + i), s));
+    for (; i < n; ++i) lhs[i] = Scalar(float(lhs[i]) / rhs);
+}
+
+template<class Scalar>
+inline float widened_inner_product(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using w = widen_ops<Scalar>;
+    using v = ops<float>;
+    auto acc0 = v::zero();
+    auto acc1 = v::zero();
+    auto acc2 = v::zero();
+    auto acc3 = v::zero();
+    auto i = size_t(0);
+    for (; i + 4 * w::width <= n; i += 4 * w::width)
+    {
+        acc0 = v::fmadd(w::load(lhs + i), w::load(rhs + i), acc0);
+        acc1 = v::fmadd(w::load(lhs + i + w::width), w::load(rhs + i + w::width), acc1);
+        acc2 = v::fmadd(w::load(lhs + i + 2 * w::width), w::load(rhs + i + 2 * w::width), acc2);
+        acc3 = v::fmadd(w::load(lhs + i + 3 * w::width), w::load(rhs + i + 3 * w::width), acc3);
+    }
+    for (; i + w::width <= n; i += w::width) acc0 = v::fmadd(w::load(lhs + i), w::load(rhs + i), acc0);
+    auto res = v::hsum(v::add(v::add(acc0, acc1), v::add(acc2, acc3)));
+    for (; i < n; ++i) res += float(lhs[i]) * float(rhs[i]);
+    return res;
+}
+
+template<class Scalar>
+inline float widened_modulus_squared(Scalar const* mat, size_t n) noexcept
+{
+    return widened_inner_product(mat, mat, n);
+}
@@ -0,0 +1,332 @@
+#if !defined MATRIX_INSTRUMENT_26_10_18_19_12_40
+#define MATRIX_INSTRUMENT_26_10_18_19_12_40
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#if defined __has_builtin
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define _LA_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined _LA_CONSTANT_EVALUATED && ((defined __GNUC__ && __GNUC__ >= 9) || (defined _MSC_VER && _MSC_VER >= 1925))
+#define _LA_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+/*
+Per-operation instrumentation, compiled in by defining LA_INSTRUMENT.
+
+Every public operation in linear_algebra.h is wrapped in _LA_INSTRUMENT, which records one
+call: the operation name, its wall time, an estimate of the floating-point operations and
+bytes it reads and writes, and the storage and workspace allocations made on the calling
+thread while it was the innermost operation running there. Times include nested operations
+(solve includes its lu); flops, bytes and allocations are the operation's own, so totals
+over all operations count each once. The estimates are the textbook counts, a multiply-add
+being two flops, with every operand read and the result written once. Allocations are
+those of matrix storage and of the library's workspaces, not every call to operator new;
+work a thread pool runs on its workers is timed but its allocations are not attributed.
+
+Without LA_INSTRUMENT the macros expand to the wrapped expression alone, so nothing is
+timed, counted or even computed. The functions below still exist, so code reading the
+counters builds either way, and report nothing.
+
+Each completed call is added to counters kept per thread, and passed to the sink, if one is
+set, on the thread that ran it. Counters of threads that have exited are folded together
+and kept. Calls made during constant evaluation are not recorded; compilers without
+__builtin_is_constant_evaluated cannot evaluate instrumented operations in constant
+expressions at all.
+*/
+
+#if defined LA_INSTRUMENT
+#define _LA_INSTRUMENT(op, flops, bytes, ...) ::std::experimental::la::detail::instrumented(op, double(flops), double(bytes), [&]() -> decltype(auto) { return __VA_ARGS__; })
+#define _LA_RECORD_ALLOCATION(...) ::std::experimental::la::detail::record_allocation(__VA_ARGS__)
+#else
+#define _LA_INSTRUMENT(op, flops, bytes, ...) __VA_ARGS__
+#define _LA_RECORD_ALLOCATION(...) static_cast<void>(0)
+#endif
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // op_counters
+    ////////////////////////////////////////////////////////
+    struct op_counters
+    {
+        char const* op = nullptr;               // Operation name, as in linear_algebra.h
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;               // Wall time, including nested operations
+        double flops = 0.0;                     // Estimated
+        double bytes = 0.0;                     // Estimated bytes read and written
+        uint64_t allocations = 0;               // Storage and workspace allocations while innermost
+        uint64_t allocated_bytes = 0;
+    };
+
+    // Called with each completed call, calls == 1, on the thread that made it; must not throw
+    using instrument_sink = std::function<void(op_counters const&)>;
+
+    enum class counter_scope { this_thread, all_threads };
+
+#if defined LA_INSTRUMENT
+    inline constexpr bool instrumentation_enabled = true;
+#else
+    inline constexpr bool instrumentation_enabled = false;
+#endif
+
+    void set_instrument_sink(instrument_sink sink);                 // An empty sink removes the current one
+    std::vector<op_counters> instrument_counters(counter_scope scope = counter_scope::all_threads);     // Sorted by name
+    void reset_instrument_counters();                               // Every thread's counters
+    void write_instrument_json(std::ostream& os, counter_scope scope = counter_scope::all_threads);
+
+    namespace detail {
+        class counter_table
+        {
+        public:
+            void add(op_counters const& rec) noexcept;
+            void merge_into(std::vector<op_counters>& out) const;
+            void clear() noexcept;
+
+        private:
+            mutable std::mutex _Mutex;          // Only contended while another thread reads or resets
+            std::vector<op_counters> _Ops;
+        };
+
+        struct instrument_registry
+        {
+            std::mutex _Mutex;
+            std::vector<counter_table*> _Live;
+            counter_table _Retired;             // Threads that have exited
+            std::shared_ptr<instrument_sink const> _Sink;
+            std::atomic<bool> _HasSink{ false };
+        };
+
+        instrument_registry& registry();
+        counter_table& this_thread_counters();
+
+        // The innermost operation running on this thread, which allocations are charged to
+        struct op_frame
+        {
+            uint64_t _Allocations;
+            uint64_t _AllocatedBytes;
+            op_frame* _Outer;
+        };
+        op_frame*& current_frame() noexcept;
+        void record_allocation(size_t bytes, size_t count = 1) noexcept;
+        void accumulate(op_counters& into, op_counters const& rec) noexcept;
+
+        class op_scope
+        {
+        public:
+            op_scope(char const* op, double flops, double bytes) noexcept;
+            ~op_scope();
+            op_scope(op_scope const&) = delete;
+            op_scope& operator=(op_scope const&) = delete;
+
+        private:
+            char const* _Op;
+            double _Flops;
+            double _Bytes;
+            op_frame _Frame;
+            std::chrono::steady_clock::time_point _Start;
+        };
+
+        template<class F>
+        decltype(auto) timed_call(char const* op, double flops, double bytes, F& f);
+        template<class F>
+        constexpr decltype(auto) instrumented(char const* op, double flops, double bytes, F&& f);
+    }
+}
+
+////////////////////////////////////////////////////////
+// instrumentation implementation
+////////////////////////////////////////////////////////
+inline void std::experimental::la::set_instrument_sink(instrument_sink sink)
+{
+    auto& reg = detail::registry();
+    auto next = sink ? std::make_shared<instrument_sink const>(std::move(sink)) : nullptr;
+    std::lock_guard lock(reg._Mutex);
+    reg._HasSink.store(next != nullptr, std::memory_order_release);
+    reg._Sink = std::move(next);
+}
+
+inline std::vector<std::experimental::la::op_counters> std::experimental::la::instrument_counters(counter_scope scope)
+{
+    auto res = std::vector<op_counters>();
+    if (scope == counter_scope::this_thread) detail::this_thread_counters().merge_into(res);
+    else
+    {
+        auto& reg = detail::registry();
+        std::lock_guard lock(reg._Mutex);
+        reg._Retired.merge_into(res);
+        for (auto* table : reg._Live) table->merge_into(res);
+    }
+    std::sort(res.begin(), res.end(), [](auto const& l, auto const& r) { return std::strcmp(l.op, r.op) < 0; });
+    return res;
+}
+
+inline void std::experimental::la::reset_instrument_counters()
+{
+    auto& reg = detail::registry();
+    std::lock_guard lock(reg._Mutex);
+    reg._Retired.clear();
+    for (auto* table : reg._Live) table->clear();
+}
+
+inline void std::experimental::la::write_instrument_json(std::ostream& os, counter_scope scope)
+{
+    auto const ops = instrument_counters(scope);
+    os << "{\n  \"instrumented\": " << (instrumentation_enabled ? "true" : "false") << ",\n  \"operations\": [";
+    for (auto i = size_t(0); i < ops.size(); ++i)
+    {
+        auto const& rec = ops[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    { \"operation\": \"" << rec.op << "\", \"calls\": " << rec.calls << ", \"nanoseconds\": " << rec.nanoseconds
+            << ", \"flops\": " << rec.flops << ", \"bytes\": " << rec.bytes
+            << ", \"allocations\": " << rec.allocations << ", \"allocated_bytes\": " << rec.allocated_bytes << " }";
+    }
+    os << (ops.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+inline void std::experimental::la::detail::counter_table::add(op_counters const& rec) noexcept
+{
+    std::lock_guard lock(_Mutex);
+    auto it = std::find_if(_Ops.begin(), _Ops.end(), [&](auto const& o) { return o.op == rec.op || std::strcmp(o.op, rec.op) == 0; });
+    if (it == _Ops.end())
+    {
+        // Out of memory loses the record rather than the operation
+        try { _Ops.push_back(rec); }
+        catch (...) {}
+        return;
+    }
+    accumulate(*it, rec);
+}
+
+inline void std::experimental::la::detail::counter_table::merge_into(std::vector<op_counters>& out) const
+{
+    std::lock_guard lock(_Mutex);
+    for (auto const& rec : _Ops)
+    {
+        auto it = std::find_if(out.begin(), out.end(), [&](auto const& o) { return std::strcmp(o.op, rec.op) == 0; });
+        if (it == out.end()) out.push_back(rec);
+        else accumulate(*it, rec);
+    }
+}
+
+inline void std::experimental::la::detail::counter_table::clear() noexcept
+{
+    std::lock_guard lock(_Mutex);
+    _Ops.clear();
+}
+
+inline std::experimental::la::detail::instrument_registry& std::experimental::la::detail::registry()
+{
+    static instrument_registry reg;
+    return reg;
+}
+
+inline std::experimental::la::detail::counter_table& std::experimental::la::detail::this_thread_counters()
+{
+    // Registered for the life of the thread, then folded into the retired counters.
+    // The registry is constructed first, so outlives every thread's table
+    struct thread_table
+    {
+        thread_table()
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg._Mutex);
+            reg._Live.push_back(&_Table);
+        }
+        ~thread_table()
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg._Mutex);
+            auto remaining = std::vector<op_counters>();
+            try { _Table.merge_into(remaining); }
+            catch (...) {}
+            for (auto const& rec : remaining) reg._Retired.add(rec);
+            reg._Live.erase(std::find(reg._Live.begin(), reg._Live.end(), &_Table));
+        }
+        counter_table _Table;
+    };
+    thread_local thread_table table;
+    return table._Table;
+}
+
+inline std::experimental::la::detail::op_frame*& std::experimental::la::detail::current_frame() noexcept
+{
+    thread_local op_frame* frame = nullptr;
+    return frame;
+}
+
+inline void std::experimental::la::detail::record_allocation(size_t bytes, size_t count) noexcept
+{
+    if (auto* frame = current_frame())
+    {
+        frame->_Allocations += count;
+        frame->_AllocatedBytes += bytes;
+    }
+}
+
+inline void std::experimental::la::detail::accumulate(op_counters& into, op_counters const& rec) noexcept
+{
+    into.calls += rec.calls;
+    into.nanoseconds += rec.nanoseconds;
+    into.flops += rec.flops;
+    into.bytes += rec.bytes;
+    into.allocations += rec.allocations;
+    into.allocated_bytes += rec.allocated_bytes;
+}
+
+inline std::experimental::la::detail::op_scope::op_scope(char const* op, double flops, double bytes) noexcept
+    : _Op(op)
+    , _Flops(flops)
+    , _Bytes(bytes)
+    , _Frame{ 0, 0, current_frame() }
+{
+    current_frame() = &_Frame;
+    _Start = std::chrono::steady_clock::now();
+}
+
+inline std::experimental::la::detail::op_scope::~op_scope()
+{
+    auto const elapsed = std::chrono::steady_clock::now() - _Start;
+    current_frame() = _Frame._Outer;
+    auto const rec = op_counters{ _Op, 1, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+        _Flops, _Bytes, _Frame._Allocations, _Frame._AllocatedBytes };
+    try { this_thread_counters().add(rec); }
+    catch (...) {}
+    auto& reg = registry();
+    if (!reg._HasSink.load(std::memory_order_acquire)) return;
+    auto sink = std::shared_ptr<instrument_sink const>();
+    {
+        std::lock_guard lock(reg._Mutex);
+        sink = reg._Sink;
+    }
+    if (sink) (*sink)(rec);
+}
+
+template<class F>
+inline decltype(auto) std::experimental::la::detail::timed_call(char const* op, double flops, double bytes, F& f)
+{
+    auto const scope = op_scope(op, flops, bytes);
+    return f();
+}
+
+template<class F>
+inline constexpr decltype(auto) std::experimental::la::detail::instrumented(char const* op, double flops, double bytes, F&& f)
+{
+#if defined _LA_CONSTANT_EVALUATED
+    if (_LA_CONSTANT_EVALUATED()) return f();
+#endif
+    return timed_call(op, flops, bytes, f);
+}
+
+#endif
@@ -0,0 +1,776 @@
+#if !defined MATRIX_ITERATIVE_26_10_18_22_41_15
+#define MATRIX_ITERATIVE_26_10_18_22_41_15
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_simd.h"
+#include "matrix_view.h"
+#include "matrix_sparse.h"
+#include "matrix_instrument.h"
+#include "linear_algebra.h"
+
+/*
+Matrix-free iterative solvers for A x = b.
+
+The solvers never look at the elements of A, only at its product with a vector, so the
+operator may be a dense matrix (either layout, or a view), a sparse matrix, a structured
+matrix, or any callable op(x, y) that writes A x into y, both being n x 1 matrix_views.
+Each iteration costs one or two such products plus a handful of length-n vector updates,
+against the n^3 of a factorization, which pays when A is large and sparse or only
+available as a procedure.
+
+    cg_solver           conjugate gradients, for symmetric positive definite A; one
+                        product per iteration and five vectors of workspace
+    bicgstab_solver     BiCGSTAB, for general square A; two products per iteration and
+                        eight vectors
+    gmres_solver        restarted GMRES(m), for general square A; one product per
+                        iteration, m + 5 vectors and an (m + 1) x m Hessenberg matrix,
+                        the residual decreasing monotonically within a cycle
+
+A preconditioner M approximates the inverse of A and is a callable m(r, z) that writes
+z = M r, with the same view arguments as a callable operator. CG applies it on the left,
+BiCGSTAB and GMRES on the right, so the residual reported is that of the original system
+in all three. identity_preconditioner does nothing, jacobi_preconditioner divides by the
+diagonal of A, and ilu0_preconditioner holds the incomplete LU factorization of A that
+keeps the sparsity pattern of A, applied by a forward and a backward substitution.
+
+b and x are n x 1 or 1 x n matrices of any storage; x holds the initial guess on entry
+and the solution on exit. Iteration stops when ||b - A x|| <= tolerance ||b||, after
+max_iterations iterations, or on a breakdown of the recurrences, and iterative_result
+reports which, with the iteration and product counts and the relative residual reached.
+Workspace vectors live in the solver object and only grow, so repeated solves of one size
+through the same solver do not allocate.
+*/
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // iterative_options, iterative_result
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct iterative_options
+    {
+        Scalar tolerance = std::sqrt(std::numeric_limits<Scalar>::epsilon());  // On ||b - A x|| / ||b||
+        size_t max_iterations = 1000;
+        size_t restart = 30;                // GMRES iterations between restarts, m
+    };
+
+    template<class Scalar>
+    struct iterative_result
+    {
+        bool converged = false;
+        size_t iterations = 0;
+        size_t operator_applications = 0;   // Products with A
+        Scalar residual = Scalar(0);        // ||b - A x|| / ||b|| as tracked by the recurrences
+    };
+
+    ////////////////////////////////////////////////////////
+    // iterative_workspace
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct iterative_workspace
+    {
+        Scalar* buffer(size_t size);        // At least size elements; grows only
+        size_t capacity() const noexcept;
+
+        std::vector<Scalar> _Buffer;
+    };
+
+    ////////////////////////////////////////////////////////
+    // Preconditioners
+    ////////////////////////////////////////////////////////
+    struct identity_preconditioner
+    {
+        template<class Scalar>
+        void operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept;
+    };
+
+    template<class Scalar>
+    struct jacobi_preconditioner
+    {
+        jacobi_preconditioner() = default;
+        template<class Rep>
+        explicit jacobi_preconditioner(matrix<Rep> const& a);          // The diagonal of a, which must have no zeros
+        explicit jacobi_preconditioner(std::vector<Scalar> diagonal);
+        void operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept;
+
+        std::vector<Scalar> _InverseDiagonal;
+    };
+
+    template<class Rep>
+    jacobi_preconditioner(matrix<Rep> const&) -> jacobi_preconditioner<typename Rep::scalar_t>;
+
+    template<class Scalar, class Index = std::uint32_t>
+    struct ilu0_preconditioner
+    {
+        ilu0_preconditioner() = default;
+        // Factors a CSR matrix in a copy of its arrays; other matrices are compressed to CSR
+        // first. Every diagonal element must be stored, and the pivots must not vanish.
+        template<class Rep>
+        explicit ilu0_preconditioner(matrix<Rep> const& a);
+        void operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept;
+        csr_matrix<Scalar, Index> const& factors() const noexcept;
+
+        csr_matrix<Scalar, Index> _LU;      // Unit L below the diagonal, U on and above it
+        std::vector<size_t> _Diagonal;      // Position of each diagonal element in _LU
+    };
+
+    template<class Scalar, class Layout, class Index>
+    ilu0_preconditioner(matrix<sparse_traits<sparse_matrix<Scalar, Layout, Index>>> const&) -> ilu0_preconditioner<Scalar, Index>;
+    template<class Rep>
+    ilu0_preconditioner(matrix<Rep> const&) -> ilu0_preconditioner<typename Rep::scalar_t>;
+
+    ////////////////////////////////////////////////////////
+    // Solvers
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct cg_solver
+    {
+        cg_solver() = default;
+        explicit cg_solver(iterative_options<Scalar> options) noexcept;
+        iterative_options<Scalar>& options() noexcept;
+        iterative_options<Scalar> const& options() const noexcept;
+        iterative_workspace<Scalar> const& workspace() const noexcept;
+        template<class Op, class Rep1, class Rep2, class Precond = identity_preconditioner>
+        iterative_result<Scalar> solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m = Precond());
+
+        iterative_options<Scalar> _Options;
+        iterative_workspace<Scalar> _Workspace;
+    };
+
+    template<class Scalar>
+    struct bicgstab_solver
+    {
+        bicgstab_solver() = default;
+        explicit bicgstab_solver(iterative_options<Scalar> options) noexcept;
+        iterative_options<Scalar>& options() noexcept;
+        iterative_options<Scalar> const& options() const noexcept;
+        iterative_workspace<Scalar> const& workspace() const noexcept;
+        template<class Op, class Rep1, class Rep2, class Precond = identity_preconditioner>
+        iterative_result<Scalar> solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m = Precond());
+
+        iterative_options<Scalar> _Options;
+        iterative_workspace<Scalar> _Workspace;
+    };
+
+    template<class Scalar>
+    struct gmres_solver
+    {
+        gmres_solver() = default;
+        explicit gmres_solver(iterative_options<Scalar> options) noexcept;
+        iterative_options<Scalar>& options() noexcept;
+        iterative_options<Scalar> const& options() const noexcept;
+        iterative_workspace<Scalar> const& workspace() const noexcept;
+        template<class Op, class Rep1, class Rep2, class Precond = identity_preconditioner>
+        iterative_result<Scalar> solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m = Precond());
+
+        iterative_options<Scalar> _Options;
+        iterative_workspace<Scalar> _Workspace;
+    };
+
+    namespace detail {
+        template<class Storage, class = void>
+        inline constexpr bool has_elements_v = std::is_base_of_v<matrix_view_t, Storage>;
+        template<class Storage>
+        inline constexpr bool has_elements_v<Storage, std::void_t<decltype(std::declval<Storage const&>().cbegin())>> = true;
+
+        // y = A x for vectors of length n with unit stride
+        template<class Sparse, class Scalar>
+        void apply_operator(matrix<sparse_traits<Sparse>> const& a, Scalar const* x, Scalar* y, size_t n);
+        template<class Rep, class Scalar>
+        void apply_operator(matrix<Rep> const& a, Scalar const* x, Scalar* y, size_t n);
+        template<class Op, class Scalar>
+        void apply_operator(Op const& op, Scalar const* x, Scalar* y, size_t n);
+
+        template<class Precond, class Scalar>
+        void apply_preconditioner(Precond const& m, Scalar const* r, Scalar* z, size_t n);
+
+        template<class Scalar>
+        Scalar krylov_dot(Scalar const* x, Scalar const* y, size_t n) noexcept;
+        template<class Scalar>
+        void krylov_axpby(Scalar alpha, Scalar const* x, Scalar beta, Scalar* y, size_t n) noexcept;     // y = alpha x + beta y
+        template<class Scalar>
+        Scalar krylov_norm(Scalar const* x, size_t n) noexcept;
+
+        // Copies a vector stored as an n x 1 or 1 x n matrix to and from unit stride
+        template<class Rep, class Scalar>
+        void gather_vector(matrix<Rep> const& v, Scalar* out);
+        template<class Rep, class Scalar>
+        void scatter_vector(Scalar const* in, matrix<Rep>& v);
+        template<class Rep>
+        size_t vector_length(matrix<Rep> const& v) noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// iterative_workspace implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline Scalar* std::experimental::la::iterative_workspace<Scalar>::buffer(size_t size)
+{
+    if (size > _Buffer.size())
+    {
+        _Buffer = std::vector<Scalar>(size);
+        _LA_RECORD_ALLOCATION(size * sizeof(Scalar));
+    }
+    return _Buffer.data();
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::iterative_workspace<Scalar>::capacity() const noexcept
+{
+    return _Buffer.size();
+}
+
+////////////////////////////////////////////////////////
+// identity_preconditioner implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline void std::experimental::la::identity_preconditioner::operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept
+{
+    for (auto i = size_t(0); i < z.rows(); ++i) z(i, 0) = r(i, 0);
+}
+
+////////////////////////////////////////////////////////
+// jacobi_preconditioner implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+template<class Rep>
+inline std::experimental::la::jacobi_preconditioner<Scalar>::jacobi_preconditioner(matrix<Rep> const& a)
+    : _InverseDiagonal(std::min(a.data().rows(), a.data().cols()))
+{
+    for (auto i = size_t(0); i < _InverseDiagonal.size(); ++i)
+    {
+        assert(a(i, i) != Scalar(0));
+        _InverseDiagonal[i] = Scalar(1) / a(i, i);
+    }
+}
+
+template<class Scalar>
+inline std::experimental::la::jacobi_preconditioner<Scalar>::jacobi_preconditioner(std::vector<Scalar> diagonal)
+    : _InverseDiagonal(std::move(diagonal))
+{
+    for (auto& el : _InverseDiagonal)
+    {
+        assert(el != Scalar(0));
+        el = Scalar(1) / el;
+    }
+}
+
+template<class Scalar>
+inline void std::experimental::la::jacobi_preconditioner<Scalar>::operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept
+{
+    assert(r.rows() == _InverseDiagonal.size() && z.rows() == _InverseDiagonal.size());
+    for (auto i = size_t(0); i < z.rows(); ++i) z(i, 0) = _InverseDiagonal[i] * r(i, 0);
+}
+
+////////////////////////////////////////////////////////
+// ilu0_preconditioner implementation
+////////////////////////////////////////////////////////
+template<class Scalar, class Index>
+template<class Rep>
+inline std::experimental::la::ilu0_preconditioner<Scalar, Index>::ilu0_preconditioner(matrix<Rep> const& a)
+{
+    assert(a.data().rows() == a.data().cols());
+    if constexpr (std::is_same_v<Rep, sparse_traits<csr_matrix<Scalar, Index>>>) _LU = a.data();
+    else _LU = to_sparse<row_major, Index>(a).data();
+
+    // IKJ elimination restricted to the pattern: row i is reduced by the rows k < i it
+    // holds, updating only positions already in row i, found through marker
+    auto const n = _LU.rows();
+    auto const& offsets = _LU.offsets();
+    auto const& indices = _LU.indices();
+    auto& values = _LU.values();
+    _Diagonal.resize(n);
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        auto const first = indices.begin() + ptrdiff_t(offsets[i]);
+        auto const last = indices.begin() + ptrdiff_t(offsets[i + 1]);
+        auto const diagonal = std::lower_bound(first, last, Index(i));
+        assert(diagonal != last && size_t(*diagonal) == i);
+        _Diagonal[i] = size_t(diagonal - indices.begin());
+    }
+    auto const none = std::numeric_limits<size_t>::max();
+    auto marker = std::vector<size_t>(n, none);
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto p = offsets[i]; p < offsets[i + 1]; ++p) marker[indices[p]] = p;
+        for (auto p = offsets[i]; p < _Diagonal[i]; ++p)
+        {
+            auto const k = size_t(indices[p]);
+            assert(values[_Diagonal[k]] != Scalar(0));
+            auto const l = values[p] /= values[_Diagonal[k]];
+            for (auto q = _Diagonal[k] + 1; q < offsets[k + 1]; ++q)
+            {
+                if (auto const target = marker[indices[q]]; target != none) values[target] -= l * values[q];
+            }
+        }
+        for (auto p = offsets[i]; p < offsets[i + 1]; ++p) marker[indices[p]] = none;
+    }
+}
+
+template<class Scalar, class Index>
+inline void std::experimental::la::ilu0_preconditioner<Scalar, Index>::operator()(matrix_view<Scalar const> r, matrix_view<Scalar> z) const noexcept
+{
+    auto const n = _LU.rows();
+    assert(r.rows() == n && z.rows() == n);
+    auto const& offsets = _LU.offsets();
+    auto const& indices = _LU.indices();
+    auto const& values = _LU.values();
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        auto acc = r(i, 0);
+        for (auto p = offsets[i]; p < _Diagonal[i]; ++p) acc -= values[p] * z(indices[p], 0);
+        z(i, 0) = acc;
+    }
+    for (auto i = n; i-- > 0;)
+    {
+        auto acc = z(i, 0);
+        for (auto p = _Diagonal[i] + 1; p < offsets[i + 1]; ++p) acc -= values[p] * z(indices[p], 0);
+        z(i, 0) = acc / values[_Diagonal[i]];
+    }
+}
+
+template<class Scalar, class Index>
+inline std::experimental::la::csr_matrix<Scalar, Index> const& std::experimental::la::ilu0_preconditioner<Scalar, Index>::factors() const noexcept
+{
+    return _LU;
+}
+
+////////////////////////////////////////////////////////
+// cg_solver implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::cg_solver<Scalar>::cg_solver(iterative_options<Scalar> options) noexcept
+    : _Options(options)
+{}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar>& std::experimental::la::cg_solver<Scalar>::options() noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar> const& std::experimental::la::cg_solver<Scalar>::options() const noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_workspace<Scalar> const& std::experimental::la::cg_solver<Scalar>::workspace() const noexcept
+{
+    return _Workspace;
+}
+
+template<class Scalar>
+template<class Op, class Rep1, class Rep2, class Precond>
+inline std::experimental::la::iterative_result<Scalar> std::experimental::la::cg_solver<Scalar>::solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m)
+{
+    auto const n = detail::vector_length(b);
+    assert(detail::vector_length(x) == n);
+    auto* const xs = _Workspace.buffer(5 * n);
+    auto* const r = xs + n;
+    auto* const z = r + n;
+    auto* const p = z + n;
+    auto* const q = p + n;
+    detail::gather_vector(x, xs);
+    detail::gather_vector(b, r);
+
+    auto res = iterative_result<Scalar>();
+    auto const b_norm = detail::krylov_norm(r, n);
+    if (b_norm == Scalar(0))
+    {
+        std::fill_n(xs, n, Scalar(0));
+        detail::scatter_vector(xs, x);
+        res.converged = true;
+        return res;
+    }
+    detail::apply_operator(a, xs, q, n);
+    ++res.operator_applications;
+    detail::krylov_axpby(Scalar(-1), q, Scalar(1), r, n);
+    res.residual = detail::krylov_norm(r, n) / b_norm;
+    res.converged = res.residual <= _Options.tolerance;
+    if (!res.converged)
+    {
+        detail::apply_preconditioner(m, r, z, n);
+        std::copy_n(z, n, p);
+        auto rz = detail::krylov_dot(r, z, n);
+        while (res.iterations < _Options.max_iterations)
+        {
+            detail::apply_operator(a, p, q, n);
+            ++res.operator_applications;
+            auto const pq = detail::krylov_dot(p, q, n);
+            if (pq == Scalar(0)) break;
+            auto const alpha = rz / pq;
+            detail::krylov_axpby(alpha, p, Scalar(1), xs, n);
+            detail::krylov_axpby(-alpha, q, Scalar(1), r, n);
+            ++res.iterations;
+            res.residual = detail::krylov_norm(r, n) / b_norm;
+            if ((res.converged = res.residual <= _Options.tolerance)) break;
+            detail::apply_preconditioner(m, r, z, n);
+            auto const rz_next = detail::krylov_dot(r, z, n);
+            detail::krylov_axpby(Scalar(1), z, rz_next / rz, p, n);
+            rz = rz_next;
+        }
+    }
+    detail::scatter_vector(xs, x);
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// bicgstab_solver implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::bicgstab_solver<Scalar>::bicgstab_solver(iterative_options<Scalar> options) noexcept
+    : _Options(options)
+{}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar>& std::experimental::la::bicgstab_solver<Scalar>::options() noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar> const& std::experimental::la::bicgstab_solver<Scalar>::options() const noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_workspace<Scalar> const& std::experimental::la::bicgstab_solver<Scalar>::workspace() const noexcept
+{
+    return _Workspace;
+}
+
+template<class Scalar>
+template<class Op, class Rep1, class Rep2, class Precond>
+inline std::experimental::la::iterative_result<Scalar> std::experimental::la::bicgstab_solver<Scalar>::solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m)
+{
+    auto const n = detail::vector_length(b);
+    assert(detail::vector_length(x) == n);
+    auto* const xs = _Workspace.buffer(8 * n);
+    auto* const r = xs + n;             // Also s, the residual halfway through an iteration
+    auto* const r0 = r + n;             // The shadow residual
+    auto* const p = r0 + n;
+    auto* const v = p + n;
+    auto* const p_hat = v + n;
+    auto* const s_hat = p_hat + n;
+    auto* const t = s_hat + n;
+    detail::gather_vector(x, xs);
+    detail::gather_vector(b, r);
+
+    auto res = iterative_result<Scalar>();
+    auto const b_norm = detail::krylov_norm(r, n);
+    if (b_norm == Scalar(0))
+    {
+        std::fill_n(xs, n, Scalar(0));
+        detail::scatter_vector(xs, x);
+        res.converged = true;
+        return res;
+    }
+    detail::apply_operator(a, xs, t, n);
+    ++res.operator_applications;
+    detail::krylov_axpby(Scalar(-1), t, Scalar(1), r, n);
+    res.residual = detail::krylov_norm(r, n) / b_norm;
+    res.converged = res.residual <= _Options.tolerance;
+    std::copy_n(r, n, r0);
+    std::fill_n(p, n, Scalar(0));
+    std::fill_n(v, n, Scalar(0));
+    auto rho = Scalar(1);
+    auto alpha = Scalar(1);
+    auto omega = Scalar(1);
+    while (!res.converged && res.iterations < _Options.max_iterations)
+    {
+        auto const rho_next = detail::krylov_dot(r0, r, n);
+        if (rho_next == Scalar(0)) break;
+        auto const beta = (rho_next / rho) * (alpha / omega);
+        rho = rho_next;
+        detail::krylov_axpby(-omega, v, Scalar(1), p, n);
+        detail::krylov_axpby(Scalar(1), r, beta, p, n);
+        detail::apply_preconditioner(m, p, p_hat, n);
+        detail::apply_operator(a, p_hat, v, n);
+        ++res.operator_applications;
+        auto const r0v = detail::krylov_dot(r0, v, n);
+        if (r0v == Scalar(0)) break;
+        alpha = rho / r0v;
+        detail::krylov_axpby(-alpha, v, Scalar(1), r, n);
+        detail::krylov_axpby(alpha, p_hat, Scalar(1), xs, n);
+        ++res.iterations;
+        res.residual = detail::krylov_norm(r, n) / b_norm;
+        if ((res.converged = res.residual <= _Options.tolerance)) break;
+
+        detail::apply_preconditioner(m, r, s_hat, n);
+        detail::apply_operator(a, s_hat, t, n);
+        ++res.operator_applications;
+        auto const tt = detail::krylov_dot(t, t, n);
+        omega = tt == Scalar(0) ? Scalar(0) : detail::krylov_dot(t, r, n) / tt;
+        detail::krylov_axpby(omega, s_hat, Scalar(1), xs, n);
+        detail::krylov_axpby(-omega, t, Scalar(1), r, n);
+        res.residual = detail::krylov_norm(r, n) / b_norm;
+        res.converged = res.residual <= _Options.tolerance;
+        if (omega == Scalar(0)) break;
+    }
+    detail::scatter_vector(xs, x);
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// gmres_solver implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::gmres_solver<Scalar>::gmres_solver(iterative_options<Scalar> options) noexcept
+    : _Options(options)
+{}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar>& std::experimental::la::gmres_solver<Scalar>::options() noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_options<Scalar> const& std::experimental::la::gmres_solver<Scalar>::options() const noexcept
+{
+    return _Options;
+}
+
+template<class Scalar>
+inline std::experimental::la::iterative_workspace<Scalar> const& std::experimental::la::gmres_solver<Scalar>::workspace() const noexcept
+{
+    return _Workspace;
+}
+
+template<class Scalar>
+template<class Op, class Rep1, class Rep2, class Precond>
+inline std::experimental::la::iterative_result<Scalar> std::experimental::la::gmres_solver<Scalar>::solve(Op const& a, matrix<Rep1> const& b, matrix<Rep2>& x, Precond const& m)
+{
+    auto const n = detail::vector_length(b);
+    assert(detail::vector_length(x) == n);
+    auto const restart = std::max(size_t(1), std::min(_Options.restart, n));
+    // x, b, w and u, the Krylov basis V of restart + 1 vectors, then the Hessenberg matrix
+    // H, column by column, the Givens rotations (c, s) and the rotated right-hand side g
+    auto* const xs = _Workspace.buffer((restart + 5) * n + (restart + 1) * restart + 3 * restart + 1);
+    auto* const bs = xs + n;
+    auto* const w = bs + n;
+    auto* const u = w + n;
+    auto* const basis = u + n;
+    auto* const h = basis + (restart + 1) * n;
+    auto* const c = h + (restart + 1) * restart;
+    auto* const s = c + restart;
+    auto* const g = s + restart;
+    auto const column = [&](size_t k) { return basis + k * n; };
+    auto const hessenberg = [&](size_t i, size_t j) -> Scalar& { return h[j * (restart + 1) + i]; };
+    detail::gather_vector(x, xs);
+    detail::gather_vector(b, bs);
+
+    auto res = iterative_result<Scalar>();
+    auto const b_norm = detail::krylov_norm(bs, n);
+    if (b_norm == Scalar(0))
+    {
+        std::fill_n(xs, n, Scalar(0));
+        detail::scatter_vector(xs, x);
+        res.converged = true;
+        return res;
+    }
+    for (;;)
+    {
+        // Each cycle restarts from the true residual of the current x
+        detail::apply_operator(a, xs, w, n);
+        ++res.operator_applications;
+        detail::krylov_axpby(Scalar(1), bs, Scalar(-1), w, n);
+        auto const beta = detail::krylov_norm(w, n);
+        res.residual = beta / b_norm;
+        if ((res.converged = res.residual <= _Options.tolerance) || res.iterations >= _Options.max_iterations) break;
+
+        detail::krylov_axpby(Scalar(1) / beta, w, Scalar(0), column(0), n);
+        std::fill_n(g, restart + 1, Scalar(0));
+        g[0] = beta;
+        auto k = size_t(0);
+        auto exhausted = false;         // The Krylov space is invariant under A M, so the cycle solves exactly
+        while (k < restart && res.iterations < _Options.max_iterations)
+        {
+            detail::apply_preconditioner(m, column(k), u, n);
+            detail::apply_operator(a, u, w, n);
+            ++res.operator_applications;
+            for (auto i = size_t(0); i <= k; ++i)
+            {
+                hessenberg(i, k) = detail::krylov_dot(w, column(i), n);
+                detail::krylov_axpby(-hessenberg(i, k), column(i), Scalar(1), w, n);
+            }
+            auto const w_norm = detail::krylov_norm(w, n);
+            hessenberg(k + 1, k) = w_norm;
+            exhausted = w_norm == Scalar(0);
+            if (!exhausted) detail::krylov_axpby(Scalar(1) / w_norm, w, Scalar(0), column(k + 1), n);
+
+            for (auto i = size_t(0); i < k; ++i)
+            {
+                auto const hi = hessenberg(i, k);
+                auto const hj = hessenberg(i + 1, k);
+                hessenberg(i, k) = c[i] * hi + s[i] * hj;
+                hessenberg(i + 1, k) = c[i] * hj - s[i] * hi;
+            }
+            auto const d = std::hypot(hessenberg(k, k), hessenberg(k + 1, k));
+            c[k] = d == Scalar(0) ? Scalar(1) : hessenberg(k, k) / d;
+            s[k] = d == Scalar(0) ? Scalar(0) : hessenberg(k + 1, k) / d;
+            hessenberg(k, k) = d;
+            hessenberg(k + 1, k) = Scalar(0);
+            g[k + 1] = -s[k] * g[k];
+            g[k] = c[k] * g[k];
+            ++k;
+            ++res.iterations;
+            res.residual = std::abs(g[k]) / b_norm;
+            if (res.residual <= _Options.tolerance || exhausted) break;
+        }
+
+        // y minimizes ||g - H y|| over the k columns: back substitution in the rotated,
+        // upper triangular H, then x += M V y
+        for (auto i = k; i-- > 0;)
+        {
+            auto acc = g[i];
+            for (auto j = i + 1; j < k; ++j) acc -= hessenberg(i, j) * g[j];
+            g[i] = hessenberg(i, i) == Scalar(0) ? Scalar(0) : acc / hessenberg(i, i);
+        }
+        std::fill_n(w, n, Scalar(0));
+        for (auto i = size_t(0); i < k; ++i) detail::krylov_axpby(g[i], column(i), Scalar(1), w, n);
+        detail::apply_preconditioner(m, w, u, n);
+        detail::krylov_axpby(Scalar(1), u, Scalar(1), xs, n);
+        if (exhausted)
+        {
+            res.converged = res.residual <= _Options.tolerance;
+            break;
+        }
+    }
+    detail::scatter_vector(xs, x);
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// iterative detail implementation
+////////////////////////////////////////////////////////
+template<class Sparse, class Scalar>
+inline void std::experimental::la::detail::apply_operator(matrix<sparse_traits<Sparse>> const& a, Scalar const* x, Scalar* y, size_t n)
+{
+    assert(a.data().rows() == n && a.data().cols() == n);
+    if constexpr (Sparse::row_compressed) spmm_rows(a.data(), x, 1, 1, 1, y, 1, 0, n);
+    else
+    {
+        std::fill_n(y, n, Scalar(0));
+        spmm_columns(a.data(), x, 1, 1, y, 1, 0, 1);
+    }
+}
+
+template<class Rep, class Scalar>
+inline void std::experimental::la::detail::apply_operator(matrix<Rep> const& a, Scalar const* x, Scalar* y, size_t n)
+{
+    assert(a.data().rows() == n && a.data().cols() == n);
+    using storage_t = typename Rep::matrix_t;
+    if constexpr (has_elements_v<storage_t>)
+    {
+        // Row-major rows are inner products with x; column-major columns accumulate into y
+        auto const v = as_view(a.data());
+        if (v.col_stride() == 1)
+        {
+            for (auto i = size_t(0); i < n; ++i) y[i] = krylov_dot(v.data() + ptrdiff_t(i) * v.row_stride(), x, n);
+        }
+        else if (v.row_stride() == 1)
+        {
+            std::fill_n(y, n, Scalar(0));
+            for (auto j = size_t(0); j < n; ++j) krylov_axpby(x[j], v.data() + ptrdiff_t(j) * v.col_stride(), Scalar(1), y, n);
+        }
+        else
+        {
+            for (auto i = size_t(0); i < n; ++i)
+            {
+                auto acc = Scalar(0);
+                for (auto j = size_t(0); j < n; ++j) acc += v(i, j) * x[j];
+                y[i] = acc;
+            }
+        }
+    }
+    else
+    {
+        // Structured and other storages multiply through their Rep into a dense temporary
+        using view_t = matrix_view<Scalar const>;
+        auto const product = Rep::template matrix_multiply<view_traits<view_t>>(a.data(), view_t(x, n, 1, 1, 1));
+        auto const v = as_view(product);
+        for (auto i = size_t(0); i < n; ++i) y[i] = v(i, 0);
+    }
+}
+
+template<class Op, class Scalar>
+inline void std::experimental::la::detail::apply_operator(Op const& op, Scalar const* x, Scalar* y, size_t n)
+{
+    op(matrix_view<Scalar const>(x, n, 1, 1, 1), matrix_view<Scalar>(y, n, 1, 1, 1));
+}
+
+template<class Precond, class Scalar>
+inline void std::experimental::la::detail::apply_preconditioner(Precond const& m, Scalar const* r, Scalar* z, size_t n)
+{
+    if constexpr (std::is_same_v<Precond, identity_preconditioner>) std::copy_n(r, n, z);
+    else m(matrix_view<Scalar const>(r, n, 1, 1, 1), matrix_view<Scalar>(z, n, 1, 1, 1));
+}
+
+template<class Scalar>
+inline Scalar std::experimental::la::detail::krylov_dot(Scalar const* x, Scalar const* y, size_t n) noexcept
+{
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        if (n >= simd_dispatch_size) return simd_dispatch<Scalar>().inner_product(x, y, n);
+    }
+    auto res = Scalar(0);
+    for (auto i = size_t(0); i < n; ++i) res += x[i] * y[i];
+    return res;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::krylov_axpby(Scalar alpha, Scalar const* x, Scalar beta, Scalar* y, size_t n) noexcept
+{
+    if constexpr (is_simd_scalar_v<Scalar>)
+    {
+        if (n >= simd_dispatch_size) return simd_dispatch<Scalar>().axpby(alpha, x, beta, y, n);
+    }
+    for (auto i = size_t(0); i < n; ++i) y[i] = alpha * x[i] + beta * y[i];
+}
+
+template<class Scalar>
+inline Scalar std::experimental::la::detail::krylov_norm(Scalar const* x, size_t n) noexcept
+{
+    return std::sqrt(krylov_dot(x, x, n));
+}
+
+template<class Rep>
+inline size_t std::experimental::la::detail::vector_length(matrix<Rep> const& v) noexcept
+{
+    assert(v.data().rows() == 1 || v.data().cols() == 1);
+    return v.data().rows() * v.data().cols();
+}
+
+template<class Rep, class Scalar>
+inline void std::experimental::la::detail::gather_vector(matrix<Rep> const& v, Scalar* out)
+{
+    auto const view = as_view(v.data());
+    auto const n = vector_length(v);
+    auto const stride = view.rows() == 1 ? view.col_stride() : view.row_stride();
+    for (auto i = size_t(0); i < n; ++i) out[i] = view.data()[ptrdiff_t(i) * stride];
+}
+
+template<class Rep, class Scalar>
+inline void std::experimental::la::detail::scatter_vector(Scalar const* in, matrix<Rep>& v)
+{
+    auto const view = as_view(v.data());
+    auto const n = vector_length(v);
+    auto const stride = view.rows() == 1 ? view.col_stride() : view.row_stride();
+    for (auto i = size_t(0); i < n; ++i) view.data()[ptrdiff_t(i) * stride] = in[i];
+}
+
+#endif
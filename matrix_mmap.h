@@ -0,0 +1,683 @@
+#if !defined MATRIX_MMAP_26_10_18_20_21_36
+#define MATRIX_MMAP_26_10_18_20_21_36
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_half.h"
+#include "linear_algebra.h"
+#include "matrix_out_of_core.h"
+
+#if defined _WIN32
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#if !defined WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Memory-mapped matrix storage and the matrix file format it maps.
+
+A matrix file is a 64-byte matrix_file_header followed, at data_offset, by the elements in
+the storage order the header names. data_offset is a multiple of the alignment recorded in
+the header, 64 bytes unless the writer asked for more, so the elements of a mapped file are
+as aligned as those of an aligned_dynamic_size_matrix. The header records the byte order of
+the writer, and a file from a machine of the other byte order is rejected, not converted.
+
+mmap_matrix maps such a file and uses its elements in place: opening a matrix of any size
+costs a system call, pages are read on first touch, and processes mapping the same file
+share one copy of it in the page cache. matrix<matrix_traits<mmap_matrix<...>>> is
+accepted everywhere a matrix is; results of operations, and copies, live in anonymous
+mappings of their own, or in deleted scratch files once they exceed out_of_core_budget(),
+and products and LU factorisations of such matrices stream through that budget in tiles
+(see matrix_out_of_core.h). Assigning a matrix of the same shape to a file-backed matrix mapped
+read_write writes the elements to the file, as assigning to a dynamic_size_matrix reuses
+its buffer.
+
+Writing to a matrix mapped read_only faults, as a write to any read-only page does; map
+with copy_on_write to change elements privately. Truncating a file while it is mapped is
+undefined, as it is for any mapping.
+*/
+
+namespace std::experimental::la {
+    enum class mmap_mode
+    {
+        read_only,          // Shared with every process mapping the file
+        read_write,         // Shared, and writes reach the file
+        copy_on_write       // Private: written pages are copied and the file never changes
+    };
+
+    struct matrix_file_header
+    {
+        char magic[8];              // "LAMATRIX", not terminated
+        uint32_t byte_order;        // 0x01020304 as the writer stored it
+        uint32_t version;
+        uint32_t scalar;            // matrix_file_scalar_v of the element type
+        uint32_t element_size;
+        uint32_t layout;            // 0 row-major, 1 column-major
+        uint32_t reserved;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t data_offset;       // From the start of the file
+        uint64_t alignment;         // Of data_offset
+    };
+    static_assert(sizeof(matrix_file_header) == 64);
+
+    // Element type code in a matrix file: the kind in the high byte (1 IEEE floating point,
+    // 2 signed integer, 3 unsigned integer, 4 bfloat16) and the size in bytes in the low byte.
+    // Zero for types the format cannot hold; specialise it to store other trivial types.
+    template<class Scalar>
+    inline constexpr uint32_t matrix_file_scalar_v = std::is_arithmetic_v<Scalar>
+        ? (std::is_floating_point_v<Scalar> ? 0x100u : std::is_signed_v<Scalar> ? 0x200u : 0x300u) | uint32_t(sizeof(Scalar))
+        : 0u;
+    template<>
+    inline constexpr uint32_t matrix_file_scalar_v<half> = 0x102u;
+    template<>
+    inline constexpr uint32_t matrix_file_scalar_v<bfloat16> = 0x402u;
+
+    namespace detail {
+        enum class region_kind { anonymous, scratch, file };
+    }
+
+    template<class Scalar, class Layout = row_major>
+    struct mmap_matrix : public mmap_matrix_t
+    {
+        using scalar_t = Scalar;
+        using layout_t = Layout;
+        using matrix_t = mmap_matrix<Scalar, Layout>;
+        template<class Other>
+        using multiply_t = mmap_matrix<Scalar, Layout>;
+        using transpose_t = mmap_matrix<Scalar, Layout>;
+        using submatrix_t = mmap_matrix<Scalar, Layout>;
+        static_assert(std::is_trivially_copyable_v<Scalar>);
+
+        mmap_matrix() = default;
+        explicit mmap_matrix(std::filesystem::path const& path, mmap_mode mode = mmap_mode::read_only);
+        mmap_matrix(std::pair<size_t, size_t>);               // Anonymous or scratch, uninitialised elements
+        mmap_matrix(mmap_matrix const&);                      // Anonymous or scratch copy of the elements
+        mmap_matrix(mmap_matrix&&) noexcept;
+        ~mmap_matrix();
+        mmap_matrix& operator=(mmap_matrix const&);           // Writes in place when the shapes match
+        mmap_matrix& operator=(mmap_matrix&&) noexcept;
+        void swap(mmap_matrix&) noexcept;
+        Scalar operator()(size_t, size_t) const;
+        Scalar& operator()(size_t, size_t);
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+
+        Scalar* begin() noexcept;
+        const Scalar* cbegin() const noexcept;
+        Scalar* end() noexcept;
+        const Scalar* cend() const noexcept;
+
+        bool is_file_backed() const noexcept;
+        mmap_mode mode() const noexcept;
+        void flush() const;                                   // Writes dirty pages of a read_write mapping to the file
+
+        Scalar* _Data = nullptr;
+        size_t _RowCount = 0;
+        size_t _ColCount = 0;
+        void* _Base = nullptr;                                // Start of the mapping: the header of a file
+        size_t _Length = 0;
+        mmap_mode _Mode = mmap_mode::read_write;
+        detail::region_kind _Kind = detail::region_kind::anonymous;
+
+    private:
+        void release() noexcept;
+    };
+
+    // Matrix files
+    // save_matrix writes owning storages in their own order and anything else row-major.
+    // load_matrix reads a file of either order into memory; map_matrix maps one whose order
+    // matches Layout. Errors from the system are std::system_error, and files that are not
+    // matrix files of the requested element type are std::runtime_error.
+    matrix_file_header read_matrix_header(std::filesystem::path const& path);
+
+    template<class Rep>
+    void save_matrix(std::filesystem::path const& path, matrix<Rep> const& mat, size_t alignment = 64);
+
+    template<class Scalar, class Layout = row_major>
+    matrix<matrix_traits<dynamic_size_matrix<Scalar, std::allocator<Scalar>, Layout>>> load_matrix(std::filesystem::path const& path);
+
+    template<class Scalar, class Layout = row_major>
+    matrix<matrix_traits<mmap_matrix<Scalar, Layout>>> map_matrix(std::filesystem::path const& path, mmap_mode mode = mmap_mode::read_only);
+
+    // A new file of zero elements, mapped read_write, for results too large to build in memory
+    template<class Scalar, class Layout = row_major>
+    matrix<matrix_traits<mmap_matrix<Scalar, Layout>>> create_matrix_file(std::filesystem::path const& path, size_t rows, size_t cols, size_t alignment = 64);
+
+    namespace detail {
+        struct mapped_region
+        {
+            void* base = nullptr;
+            size_t length = 0;
+            region_kind kind = region_kind::anonymous;
+        };
+
+        std::FILE* open_file(std::filesystem::path const& path, bool write) noexcept;
+        mapped_region map_file(std::filesystem::path const& path, mmap_mode mode);
+        mapped_region map_anonymous(size_t length);
+        mapped_region map_scratch(size_t length);              // A file in out_of_core_directory(), deleted once unmapped
+        void unmap(mapped_region const& region) noexcept;
+        void flush_region(mapped_region const& region);
+        [[noreturn]] void throw_system_error(char const* what, std::filesystem::path const& path);
+
+        inline constexpr char matrix_file_magic[8] = { 'L', 'A', 'M', 'A', 'T', 'R', 'I', 'X' };
+        inline constexpr uint32_t matrix_file_byte_order = 0x01020304u;
+        inline constexpr uint32_t matrix_file_version = 1;
+
+        template<class Scalar, class Layout>
+        matrix_file_header make_file_header(size_t rows, size_t cols, size_t alignment) noexcept;
+
+        // Throws unless header describes a complete file of Scalar elements in a file of file_size bytes
+        template<class Scalar>
+        void check_file_header(matrix_file_header const& header, size_t file_size, std::filesystem::path const& path);
+    }
+}
+
+////////////////////////////////////////////////////////
+// mapping implementation
+////////////////////////////////////////////////////////
+inline void std::experimental::la::detail::throw_system_error(char const* what, std::filesystem::path const& path)
+{
+#if defined _WIN32
+    auto const code = std::error_code(int(::GetLastError()), std::system_category());
+#else
+    auto const code = std::error_code(errno, std::generic_category());
+#endif
+    throw std::system_error(code, std::string(what) + " " + path.string());
+}
+
+inline std::FILE* std::experimental::la::detail::open_file(std::filesystem::path const& path, bool write) noexcept
+{
+#if defined _WIN32
+    return ::_wfopen(path.c_str(), write ? L"wb" : L"rb");
+#else
+    return std::fopen(path.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+inline std::experimental::la::detail::mapped_region std::experimental::la::detail::map_file(std::filesystem::path const& path, mmap_mode mode)
+{
+    auto region = mapped_region{ nullptr, 0, region_kind::file };
+#if defined _WIN32
+    auto const write = mode == mmap_mode::read_write;
+    auto file = ::CreateFileW(path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw_system_error("cannot open", path);
+    auto size = LARGE_INTEGER{};
+    if (!::GetFileSizeEx(file, &size))
+    {
+        ::CloseHandle(file);
+        throw_system_error("cannot size", path);
+    }
+    region.length = size_t(size.QuadPart);
+    if (region.length == 0)
+    {
+        ::CloseHandle(file);
+        throw std::runtime_error("empty matrix file " + path.string());
+    }
+    auto const protect = mode == mmap_mode::read_only ? PAGE_READONLY : mode == mmap_mode::read_write ? PAGE_READWRITE : PAGE_WRITECOPY;
+    auto mapping = ::CreateFileMappingW(file, nullptr, protect, 0, 0, nullptr);
+    ::CloseHandle(file);
+    if (!mapping) throw_system_error("cannot map", path);
+    auto const access = mode == mmap_mode::read_only ? FILE_MAP_READ : mode == mmap_mode::read_write ? FILE_MAP_WRITE : FILE_MAP_COPY;
+    region.base = ::MapViewOfFile(mapping, access, 0, 0, 0);
+    ::CloseHandle(mapping);         // The view keeps the mapping alive
+    if (!region.base) throw_system_error("cannot map", path);
+#else
+    auto const fd = ::open(path.c_str(), mode == mmap_mode::read_write ? O_RDWR : O_RDONLY);
+    if (fd < 0) throw_system_error("cannot open", path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw_system_error("cannot size", path);
+    }
+    region.length = size_t(st.st_size);
+    if (region.length == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("empty matrix file " + path.string());
+    }
+    auto const prot = mode == mmap_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    auto const flags = mode == mmap_mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+    auto* base = ::mmap(nullptr, region.length, prot, flags, fd, 0);
+    ::close(fd);                    // The mapping keeps the file open
+    if (base == MAP_FAILED) throw_system_error("cannot map", path);
+    region.base = base;
+#endif
+    return region;
+}
+
+inline std::experimental::la::detail::mapped_region std::experimental::la::detail::map_anonymous(size_t length)
+{
+    auto region = mapped_region{ nullptr, length, region_kind::anonymous };
+    if (length == 0) return region;
+#if defined _WIN32
+    region.base = ::VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!region.base) throw std::bad_alloc();
+#else
+    auto* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) throw std::bad_alloc();
+    region.base = base;
+#endif
+    return region;
+}
+
+inline std::experimental::la::detail::mapped_region std::experimental::la::detail::map_scratch(size_t length)
+{
+    auto region = mapped_region{ nullptr, length, region_kind::scratch };
+    if (length == 0) return region;
+    auto const dir = out_of_core_directory();
+#if defined _WIN32
+    wchar_t name[MAX_PATH];
+    if (!::GetTempFileNameW(dir.c_str(), L"la", 0, name)) throw_system_error("cannot create scratch file in", dir);
+    auto file = ::CreateFileW(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw_system_error("cannot create scratch file in", dir);
+    auto size = ULARGE_INTEGER{};
+    size.QuadPart = length;
+    auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+    ::CloseHandle(file);
+    if (!mapping) throw_system_error("cannot map scratch file in", dir);
+    region.base = ::MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    ::CloseHandle(mapping);         // The file goes when the view does
+    if (!region.base) throw_system_error("cannot map scratch file in", dir);
+#else
+    auto name = (dir / "lin_alg_XXXXXX").string();
+    auto const fd = ::mkstemp(name.data());
+    if (fd < 0) throw_system_error("cannot create scratch file in", dir);
+    ::unlink(name.c_str());         // The mapping keeps the file until it is unmapped
+    if (::ftruncate(fd, off_t(length)) != 0)
+    {
+        ::close(fd);
+        throw_system_error("cannot size scratch file in", dir);
+    }
+    auto* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) throw_system_error("cannot map scratch file in", dir);
+    region.base = base;
+#endif
+    return region;
+}
+
+inline void std::experimental::la::detail::unmap(mapped_region const& region) noexcept
+{
+    if (!region.base) return;
+#if defined _WIN32
+    if (region.kind == region_kind::anonymous) ::VirtualFree(region.base, 0, MEM_RELEASE);
+    else ::UnmapViewOfFile(region.base);
+#else
+    ::munmap(region.base, region.length);
+#endif
+}
+
+inline void std::experimental::la::detail::flush_region(mapped_region const& region)
+{
+    if (!region.base || region.kind != region_kind::file) return;
+#if defined _WIN32
+    if (!::FlushViewOfFile(region.base, 0)) throw_system_error("cannot flush", std::filesystem::path());
+#else
+    if (::msync(region.base, region.length, MS_SYNC) != 0) throw_system_error("cannot flush", std::filesystem::path());
+#endif
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::matrix_file_header std::experimental::la::detail::make_file_header(size_t rows, size_t cols, size_t alignment) noexcept
+{
+    static_assert(matrix_file_scalar_v<Scalar> != 0, "matrix files hold arithmetic elements; specialise matrix_file_scalar_v for others");
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    alignment = std::max(alignment, alignof(Scalar));
+    auto header = matrix_file_header{};
+    std::memcpy(header.magic, matrix_file_magic, sizeof(header.magic));
+    header.byte_order = matrix_file_byte_order;
+    header.version = matrix_file_version;
+    header.scalar = matrix_file_scalar_v<Scalar>;
+    header.element_size = uint32_t(sizeof(Scalar));
+    header.layout = std::is_same_v<Layout, column_major> ? 1u : 0u;
+    header.rows = rows;
+    header.cols = cols;
+    header.data_offset = (sizeof(matrix_file_header) + alignment - 1) / alignment * alignment;
+    header.alignment = alignment;
+    return header;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::check_file_header(matrix_file_header const& header, size_t file_size, std::filesystem::path const& path)
+{
+    auto fail = [&](char const* what) { throw std::runtime_error(std::string(what) + " " + path.string()); };
+    if (file_size < sizeof(matrix_file_header) || std::memcmp(header.magic, matrix_file_magic, sizeof(header.magic)) != 0) fail("not a matrix file:");
+    if (header.byte_order != matrix_file_byte_order) fail("matrix file of the other byte order:");
+    if (header.version != matrix_file_version) fail("unsupported matrix file version:");
+    if (header.scalar != matrix_file_scalar_v<Scalar> || header.element_size != sizeof(Scalar)) fail("matrix file element type differs:");
+    if (header.layout > 1 || header.data_offset < sizeof(matrix_file_header) || header.data_offset % alignof(Scalar) != 0) fail("corrupt matrix file header:");
+    if (header.cols != 0 && header.rows > (std::numeric_limits<uint64_t>::max() / sizeof(Scalar)) / header.cols) fail("corrupt matrix file header:");
+    if (file_size - std::min<uint64_t>(file_size, header.data_offset) < header.rows * header.cols * sizeof(Scalar)) fail("truncated matrix file:");
+}
+
+////////////////////////////////////////////////////////
+// mmap_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>::mmap_matrix(std::filesystem::path const& path, mmap_mode mode)
+{
+    auto const region = detail::map_file(path, mode);
+    _Base = region.base;
+    _Length = region.length;
+    _Mode = mode;
+    _Kind = detail::region_kind::file;
+    auto header = matrix_file_header{};
+    std::memcpy(&header, _Base, std::min(sizeof(header), _Length));
+    try
+    {
+        detail::check_file_header<Scalar>(header, _Length, path);
+        if (header.layout != (std::is_same_v<Layout, column_major> ? 1u : 0u))
+        {
+            throw std::runtime_error("matrix file storage order differs: " + path.string());
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    _RowCount = size_t(header.rows);
+    _ColCount = size_t(header.cols);
+    _Data = reinterpret_cast<Scalar*>(static_cast<char*>(_Base) + header.data_offset);
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>::mmap_matrix(std::pair<size_t, size_t> size)
+    : _RowCount(size.first)
+    , _ColCount(size.second)
+{
+    auto const bytes = _RowCount * _ColCount * sizeof(Scalar);
+    auto const region = detail::exceeds_out_of_core_budget<Scalar>(_RowCount * _ColCount) ? detail::map_scratch(bytes) : detail::map_anonymous(bytes);
+    _Kind = region.kind;
+    _Base = region.base;
+    _Length = region.length;
+    _Data = static_cast<Scalar*>(_Base);
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>::mmap_matrix(mmap_matrix const& rhs)
+    : mmap_matrix(std::pair(rhs._RowCount, rhs._ColCount))
+{
+    if (rhs._Data) std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>::mmap_matrix(mmap_matrix&& rhs) noexcept
+{
+    swap(rhs);
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>::~mmap_matrix()
+{
+    release();
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>& std::experimental::la::mmap_matrix<Scalar, Layout>::operator=(mmap_matrix const& rhs)
+{
+    if (this != &rhs)
+    {
+        // Reuse the mapping, and so write through to a file, when the shape matches. A file's
+        // header records its shape, so only anonymous and scratch mappings take another shape
+        // with the same element count.
+        auto const same_shape = _RowCount == rhs._RowCount && _ColCount == rhs._ColCount;
+        auto const same_count = _RowCount * _ColCount == rhs._RowCount * rhs._ColCount;
+        if (!_Data || _Mode == mmap_mode::read_only || !(same_shape || (same_count && _Kind != detail::region_kind::file)))
+        {
+            auto copy = mmap_matrix(rhs);
+            swap(copy);
+            return *this;
+        }
+        _RowCount = rhs._RowCount;
+        _ColCount = rhs._ColCount;
+        std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+    }
+    return *this;
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_matrix<Scalar, Layout>& std::experimental::la::mmap_matrix<Scalar, Layout>::operator=(mmap_matrix&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        release();
+        swap(rhs);
+    }
+    return *this;
+}
+
+template<class Scalar, class Layout>
+inline void std::experimental::la::mmap_matrix<Scalar, Layout>::swap(mmap_matrix& rhs) noexcept
+{
+    using std::swap;
+    swap(_Data, rhs._Data);
+    swap(_RowCount, rhs._RowCount);
+    swap(_ColCount, rhs._ColCount);
+    swap(_Base, rhs._Base);
+    swap(_Length, rhs._Length);
+    swap(_Mode, rhs._Mode);
+    swap(_Kind, rhs._Kind);
+}
+
+template<class Scalar, class Layout>
+inline void std::experimental::la::mmap_matrix<Scalar, Layout>::release() noexcept
+{
+    detail::unmap(detail::mapped_region{ _Base, _Length, _Kind });
+    _Data = nullptr;
+    _RowCount = 0;
+    _ColCount = 0;
+    _Base = nullptr;
+    _Length = 0;
+    _Mode = mmap_mode::read_write;
+    _Kind = detail::region_kind::anonymous;
+}
+
+template<class Scalar, class Layout>
+inline Scalar std::experimental::la::mmap_matrix<Scalar, Layout>::operator()(size_t i, size_t j) const
+{
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
+}
+
+template<class Scalar, class Layout>
+inline Scalar& std::experimental::la::mmap_matrix<Scalar, Layout>::operator()(size_t i, size_t j)
+{
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
+}
+
+template<class Scalar, class Layout>
+inline size_t std::experimental::la::mmap_matrix<Scalar, Layout>::rows() const noexcept
+{
+    return _RowCount;
+}
+
+template<class Scalar, class Layout>
+inline size_t std::experimental::la::mmap_matrix<Scalar, Layout>::cols() const noexcept
+{
+    return _ColCount;
+}
+
+template<class Scalar, class Layout>
+inline Scalar* std::experimental::la::mmap_matrix<Scalar, Layout>::begin() noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, class Layout>
+inline const Scalar* std::experimental::la::mmap_matrix<Scalar, Layout>::cbegin() const noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, class Layout>
+inline Scalar* std::experimental::la::mmap_matrix<Scalar, Layout>::end() noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+template<class Scalar, class Layout>
+inline const Scalar* std::experimental::la::mmap_matrix<Scalar, Layout>::cend() const noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+template<class Scalar, class Layout>
+inline bool std::experimental::la::mmap_matrix<Scalar, Layout>::is_file_backed() const noexcept
+{
+    return _Kind == detail::region_kind::file;
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::mmap_mode std::experimental::la::mmap_matrix<Scalar, Layout>::mode() const noexcept
+{
+    return _Mode;
+}
+
+template<class Scalar, class Layout>
+inline void std::experimental::la::mmap_matrix<Scalar, Layout>::flush() const
+{
+    if (_Mode == mmap_mode::read_write) detail::flush_region(detail::mapped_region{ _Base, _Length, _Kind });
+}
+
+////////////////////////////////////////////////////////
+// matrix file implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::matrix_file_header std::experimental::la::read_matrix_header(std::filesystem::path const& path)
+{
+    auto header = matrix_file_header{};
+    auto* file = detail::open_file(path, false);
+    if (!file) detail::throw_system_error("cannot open", path);
+    auto const read = std::fread(&header, 1, sizeof(header), file);
+    std::fclose(file);
+    if (read != sizeof(header) || std::memcmp(header.magic, detail::matrix_file_magic, sizeof(header.magic)) != 0)
+    {
+        throw std::runtime_error("not a matrix file: " + path.string());
+    }
+    return header;
+}
+
+template<class Rep>
+inline void std::experimental::la::save_matrix(std::filesystem::path const& path, matrix<Rep> const& mat, size_t alignment)
+{
+    using storage_t = typename Rep::matrix_t;
+    using scalar_t = typename Rep::scalar_t;
+    // Owning storages are written in their own order with one call, anything else element by element
+    constexpr auto owning = std::is_base_of_v<fixed_size_matrix_t, storage_t> || std::is_base_of_v<dynamic_size_matrix_t, storage_t>
+        || std::is_base_of_v<mmap_matrix_t, storage_t>;
+    using layout_t = std::conditional_t<owning, typename detail::storage_layout<storage_t>::type, row_major>;
+    auto const rows = mat.data().rows();
+    auto const cols = mat.data().cols();
+    auto const header = detail::make_file_header<scalar_t, layout_t>(rows, cols, alignment);
+
+    auto* file = detail::open_file(path, true);
+    if (!file) detail::throw_system_error("cannot create", path);
+    auto ok = true;
+    auto write = [&](void const* data, size_t bytes) { ok = ok && (bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes); };
+    write(&header, sizeof(header));
+    char const padding[64] = {};
+    for (auto pad = size_t(header.data_offset) - sizeof(header); pad != 0; pad -= std::min(pad, sizeof(padding)))
+    {
+        write(padding, std::min(pad, sizeof(padding)));
+    }
+    if constexpr (owning) write(mat.data().cbegin(), rows * cols * sizeof(scalar_t));
+    else
+    {
+        for (auto i = size_t(0); i < rows && ok; ++i)
+        {
+            for (auto j = size_t(0); j < cols; ++j)
+            {
+                auto const el = scalar_t(mat(i, j));
+                write(&el, sizeof(el));
+            }
+        }
+    }
+    if (std::fclose(file) != 0 || !ok) detail::throw_system_error("cannot write", path);
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::matrix<std::experimental::la::matrix_traits<std::experimental::la::dynamic_size_matrix<Scalar, std::allocator<Scalar>, Layout>>>
+    std::experimental::la::load_matrix(std::filesystem::path const& path)
+{
+    // Mapping rather than reading keeps the file out of a second buffer while it is copied
+    auto const region = detail::map_file(path, mmap_mode::read_only);
+    try
+    {
+        auto header = matrix_file_header{};
+        std::memcpy(&header, region.base, std::min(sizeof(header), region.length));
+        detail::check_file_header<Scalar>(header, region.length, path);
+        auto const rows = size_t(header.rows);
+        auto const cols = size_t(header.cols);
+        auto res = matrix<matrix_traits<dynamic_size_matrix<Scalar, std::allocator<Scalar>, Layout>>>(std::pair(rows, cols));
+        auto const* src = reinterpret_cast<Scalar const*>(static_cast<char const*>(region.base) + header.data_offset);
+        if (header.layout == (std::is_same_v<Layout, column_major> ? 1u : 0u)) std::copy(src, src + rows * cols, res.data().begin());
+        else
+        {
+            for (auto i = size_t(0); i < rows; ++i)
+            {
+                for (auto j = size_t(0); j < cols; ++j)
+                {
+                    res(i, j) = src[header.layout == 1u ? column_major::index(i, j, rows, cols) : row_major::index(i, j, rows, cols)];
+                }
+            }
+        }
+        detail::unmap(region);
+        return res;
+    }
+    catch (...)
+    {
+        detail::unmap(region);
+        throw;
+    }
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::matrix<std::experimental::la::matrix_traits<std::experimental::la::mmap_matrix<Scalar, Layout>>>
+    std::experimental::la::map_matrix(std::filesystem::path const& path, mmap_mode mode)
+{
+    return matrix<matrix_traits<mmap_matrix<Scalar, Layout>>>(mmap_matrix<Scalar, Layout>(path, mode));
+}
+
+template<class Scalar, class Layout>
+inline std::experimental::la::matrix<std::experimental::la::matrix_traits<std::experimental::la::mmap_matrix<Scalar, Layout>>>
+    std::experimental::la::create_matrix_file(std::filesystem::path const& path, size_t rows, size_t cols, size_t alignment)
+{
+    auto const header = detail::make_file_header<Scalar, Layout>(rows, cols, alignment);
+    {
+        auto* file = detail::open_file(path, true);
+        if (!file) detail::throw_system_error("cannot create", path);
+        auto const written = std::fwrite(&header, 1, sizeof(header), file);
+        if (std::fclose(file) != 0 || written != sizeof(header)) detail::throw_system_error("cannot write", path);
+    }
+    // Extending the file leaves the elements zero, and on most file systems unallocated until written
+    std::filesystem::resize_file(path, header.data_offset + rows * cols * sizeof(Scalar));
+    return map_matrix<Scalar, Layout>(path, mmap_mode::read_write);
+}
+
+#endif //MATRIX_MMAP_26_10_18_20_21_36
@@ -0,0 +1,341 @@
+#if !defined MATRIX_OUT_OF_CORE_26_10_18_21_02_47
+#define MATRIX_OUT_OF_CORE_26_10_18_21_02_47
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_gemm.h"
+#include "matrix_instrument.h"
+#include "matrix_thread_pool.h"
+
+/*
+Out-of-core kernels for operands that do not fit in memory.
+
+Matrices whose storage is an mmap_matrix may be larger than memory. Their products and LU
+factorisations switch to the kernels here once the operands exceed out_of_core_budget()
+bytes, and results of that size are backed by scratch files in out_of_core_directory()
+rather than by anonymous memory, so callers change the storage type and nothing else.
+
+The kernels never touch the mapped elements from the compute loops. They copy tiles into
+buffers whose total stays within the budget and run the in-memory engines on those. Tile
+transfers run on their own thread with two buffers each: while one tile is being
+multiplied or factored, the next is being read from the mapping and the previous result
+is being written back, so page faults and write-back overlap the arithmetic.
+
+GEMM walks C in square tiles, accumulating A(i, p) B(p, j) over p. Six tiles are held:
+A, B and C, each double buffered.
+
+LU is left-looking by column panels of the packed buffer. Each panel is loaded, has the
+L blocks of all earlier panels applied to it (streamed with double buffering), and is
+then factored with partial pivoting. Its row interchanges are applied to the columns on
+either side of it in the mapping before it is written back. Four panels are held: the
+panel, two L blocks and the one being written. The result is the packed LU and LAPACK
+pivots that lu_factorize would produce, up to rounding.
+*/
+
+namespace std::experimental::la {
+    // Out-of-core settings, shared by all threads. The budget bounds the tile buffers of one
+    // operation and is the size above which mmap_matrix results go to scratch files.
+    size_t out_of_core_budget() noexcept;
+    void set_out_of_core_budget(size_t bytes) noexcept;
+    std::filesystem::path out_of_core_directory();                   // Defaults to the system temporary directory
+    void set_out_of_core_directory(std::filesystem::path const& dir);
+
+    namespace detail {
+        template<class Storage>
+        inline constexpr bool is_out_of_core_v = std::is_base_of_v<mmap_matrix_t, std::remove_const_t<Storage>>;
+
+        // Whether an operation touching this many elements should stream its operands
+        template<class Scalar>
+        bool exceeds_out_of_core_budget(size_t elements) noexcept;
+
+        // C = A B with C overwritten, all three given by pointer and strides
+        template<class Scalar>
+        void out_of_core_gemm(size_t m, size_t n, size_t k, Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+            Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, thread_pool* pool = nullptr);
+
+        // lu_factorize for an n x n row-major buffer that is mapped rather than resident
+        template<class Scalar>
+        void out_of_core_lu_factorize(Scalar* a, size_t n, size_t* pivot, bool& odd_permutation, thread_pool* pool = nullptr);
+
+        // Dense row-major tile to and from a strided matrix
+        template<class Scalar>
+        void read_tile(Scalar const* src, ptrdiff_t rs, ptrdiff_t cs, size_t rows, size_t cols, Scalar* dst) noexcept;
+
+        template<class Scalar>
+        void write_tile(Scalar const* src, size_t rows, size_t cols, Scalar* dst, ptrdiff_t rs, ptrdiff_t cs) noexcept;
+
+        struct out_of_core_settings
+        {
+            std::atomic<size_t> _Budget{ size_t(1) << 30 };
+            std::mutex _Mutex;
+            std::filesystem::path _Directory;
+        };
+        out_of_core_settings& out_of_core_state() noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// settings implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::detail::out_of_core_settings& std::experimental::la::detail::out_of_core_state() noexcept
+{
+    static out_of_core_settings settings;
+    return settings;
+}
+
+inline size_t std::experimental::la::out_of_core_budget() noexcept
+{
+    return detail::out_of_core_state()._Budget.load(std::memory_order_relaxed);
+}
+
+inline void std::experimental::la::set_out_of_core_budget(size_t bytes) noexcept
+{
+    detail::out_of_core_state()._Budget.store(bytes, std::memory_order_relaxed);
+}
+
+inline std::filesystem::path std::experimental::la::out_of_core_directory()
+{
+    auto& state = detail::out_of_core_state();
+    auto const lock = std::lock_guard(state._Mutex);
+    return state._Directory.empty() ? std::filesystem::temp_directory_path() : state._Directory;
+}
+
+inline void std::experimental::la::set_out_of_core_directory(std::filesystem::path const& dir)
+{
+    auto& state = detail::out_of_core_state();
+    auto const lock = std::lock_guard(state._Mutex);
+    state._Directory = dir;
+}
+
+template<class Scalar>
+inline bool std::experimental::la::detail::exceeds_out_of_core_budget(size_t elements) noexcept
+{
+    return elements > out_of_core_budget() / sizeof(Scalar);
+}
+
+////////////////////////////////////////////////////////
+// tile transfer implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline void std::experimental::la::detail::read_tile(Scalar const* src, ptrdiff_t rs, ptrdiff_t cs, size_t rows, size_t cols, Scalar* dst) noexcept
+{
+    if (cs == 1)
+    {
+        for (auto i = size_t(0); i < rows; ++i) std::copy(src + ptrdiff_t(i) * rs, src + ptrdiff_t(i) * rs + ptrdiff_t(cols), dst + i * cols);
+        return;
+    }
+    // Walk the source in its own order so each page is faulted in once
+    for (auto j = size_t(0); j < cols; ++j)
+    {
+        for (auto i = size_t(0); i < rows; ++i) dst[i * cols + j] = src[ptrdiff_t(i) * rs + ptrdiff_t(j) * cs];
+    }
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::write_tile(Scalar const* src, size_t rows, size_t cols, Scalar* dst, ptrdiff_t rs, ptrdiff_t cs) noexcept
+{
+    if (cs == 1)
+    {
+        for (auto i = size_t(0); i < rows; ++i) std::copy(src + i * cols, src + i * cols + cols, dst + ptrdiff_t(i) * rs);
+        return;
+    }
+    for (auto j = size_t(0); j < cols; ++j)
+    {
+        for (auto i = size_t(0); i < rows; ++i) dst[ptrdiff_t(i) * rs + ptrdiff_t(j) * cs] = src[i * cols + j];
+    }
+}
+
+////////////////////////////////////////////////////////
+// out-of-core gemm implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline void std::experimental::la::detail::out_of_core_gemm(size_t m, size_t n, size_t k, Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, thread_pool* pool)
+{
+    if (m == 0 || n == 0) return;
+    if (k == 0)
+    {
+        for (auto i = size_t(0); i < m; ++i)
+        {
+            for (auto j = size_t(0); j < n; ++j) c[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc] = Scalar(0);
+        }
+        return;
+    }
+
+    // Six square tiles within the budget, in whole micro-tiles where the budget allows
+    auto const& kern = gemm_dispatch<Scalar>();
+    auto const step = std::max(kern.mr, kern.nr);
+    auto tile = size_t(std::sqrt(double(out_of_core_budget() / sizeof(Scalar)) / 6.0));
+    tile = std::max(tile >= step ? tile / step * step : tile, size_t(1));
+    auto const tiles_m = (m + tile - 1) / tile;
+    auto const tiles_n = (n + tile - 1) / tile;
+    auto const tiles_k = (k + tile - 1) / tile;
+
+    std::vector<Scalar> a_tile[2], b_tile[2], c_tile[2];
+    for (auto s = 0; s < 2; ++s)
+    {
+        a_tile[s].resize(tile * tile);
+        b_tile[s].resize(tile * tile);
+        c_tile[s].resize(tile * tile);
+    }
+    _LA_RECORD_ALLOCATION(6 * tile * tile * sizeof(Scalar), 6);
+
+    // Step s multiplies A(i, p) B(p, j), for p fastest, then j, then i
+    auto const steps = tiles_m * tiles_n * tiles_k;
+    auto const coords = [&](size_t s) {
+        auto const p = s % tiles_k;
+        auto const j = s / tiles_k % tiles_n;
+        auto const i = s / tiles_k / tiles_n;
+        return std::array<size_t, 3>{ i * tile, j * tile, p * tile };
+    };
+    auto const load = [&](size_t s) {
+        auto const [i, j, p] = coords(s);
+        auto const tm = std::min(tile, m - i);
+        auto const tn = std::min(tile, n - j);
+        auto const tk = std::min(tile, k - p);
+        read_tile(a + ptrdiff_t(i) * rsa + ptrdiff_t(p) * csa, rsa, csa, tm, tk, a_tile[s % 2].data());
+        read_tile(b + ptrdiff_t(p) * rsb + ptrdiff_t(j) * csb, rsb, csb, tk, tn, b_tile[s % 2].data());
+    };
+
+    auto loading = std::async(std::launch::async, load, size_t(0));
+    auto writing = std::future<void>();
+    auto out = 0;
+    for (auto s = size_t(0); s < steps; ++s)
+    {
+        loading.get();
+        if (s + 1 < steps) loading = std::async(std::launch::async, load, s + 1);
+
+        auto const [i, j, p] = coords(s);
+        auto const tm = std::min(tile, m - i);
+        auto const tn = std::min(tile, n - j);
+        auto const tk = std::min(tile, k - p);
+        gemm(pool, tm, tn, tk, Scalar(1), a_tile[s % 2].data(), ptrdiff_t(tk), ptrdiff_t(1), b_tile[s % 2].data(), ptrdiff_t(tn), ptrdiff_t(1),
+            p == 0 ? Scalar(0) : Scalar(1), c_tile[out].data(), ptrdiff_t(tn), ptrdiff_t(1));
+        if (p + tile >= k)
+        {
+            // One write in flight: the other buffer's is finished before this one starts
+            auto* dst = c + ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc;
+            if (writing.valid()) writing.get();
+            writing = std::async(std::launch::async, [&, dst, tm, tn, buffer = c_tile[out].data()] { write_tile(buffer, tm, tn, dst, rsc, csc); });
+            out ^= 1;
+        }
+    }
+    if (writing.valid()) writing.get();
+}
+
+////////////////////////////////////////////////////////
+// out-of-core lu implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline void std::experimental::la::detail::out_of_core_lu_factorize(Scalar* a, size_t n, size_t* pivot, bool& odd_permutation, thread_pool* pool)
+{
+    using std::abs;
+    if (n == 0) return;
+    // Four n-row panels within the budget
+    auto width = std::min(out_of_core_budget() / sizeof(Scalar) / (4 * n), n);
+    width = std::max(width >= 8 ? width / 8 * 8 : width, size_t(1));
+    auto const lda = ptrdiff_t(n);
+
+    std::vector<Scalar> panel(n * width), spare(n * width), l_block[2] = { std::vector<Scalar>(n * width), std::vector<Scalar>(n * width) };
+    _LA_RECORD_ALLOCATION(4 * n * width * sizeof(Scalar), 4);
+    auto writing = std::future<void>();
+    for (auto j0 = size_t(0); j0 < n; j0 += width)
+    {
+        auto const w = std::min(width, n - j0);
+        auto const j1 = j0 + w;
+        auto const ldp = ptrdiff_t(w);
+        read_tile(a + j0, lda, ptrdiff_t(1), n, w, panel.data());
+        if (writing.valid()) writing.get();       // The previous panel must be in place before its L block is read
+
+        // Apply the L blocks of the earlier panels, reading block q + 1 while block q is applied
+        auto const blocks = j0 / width;
+        auto const load = [&](size_t q) {
+            auto const q0 = q * width;
+            read_tile(a + q0 * n + q0, lda, ptrdiff_t(1), n - q0, width, l_block[q % 2].data());
+        };
+        auto loading = blocks != 0 ? std::async(std::launch::async, load, size_t(0)) : std::future<void>();
+        for (auto q = size_t(0); q < blocks; ++q)
+        {
+            loading.get();
+            if (q + 1 < blocks) loading = std::async(std::launch::async, load, q + 1);
+            auto const q0 = q * width;
+            auto const q1 = q0 + width;
+            auto const* l = l_block[q % 2].data();           // Rows q0 to n of columns q0 to q1
+
+            // U(q, panel) = L(q, q)^-1 A(q, panel), unit lower triangular
+            for (auto r = size_t(1); r < width; ++r)
+            {
+                auto* row = panel.data() + (q0 + r) * w;
+                for (auto t = size_t(0); t < r; ++t)
+                {
+                    auto const f = l[r * width + t];
+                    auto const* src = panel.data() + (q0 + t) * w;
+                    for (auto c = size_t(0); c < w; ++c) row[c] -= f * src[c];
+                }
+            }
+            // A(below, panel) -= L(below, q) U(q, panel)
+            gemm(pool, n - q1, w, width, Scalar(-1), l + width * width, ptrdiff_t(width), ptrdiff_t(1), panel.data() + q0 * w, ldp, ptrdiff_t(1),
+                Scalar(1), panel.data() + q1 * w, ldp, ptrdiff_t(1));
+        }
+
+        // Factor the panel from row j0 down, as lu_factorize factors its panels
+        for (auto jj = size_t(0); jj < w; ++jj)
+        {
+            auto const j = j0 + jj;
+            auto p = j;
+            auto max = abs(panel[j * w + jj]);
+            for (auto i = j + 1; i < n; ++i)
+            {
+                if (abs(panel[i * w + jj]) > max)
+                {
+                    max = abs(panel[i * w + jj]);
+                    p = i;
+                }
+            }
+            pivot[j] = p;
+            if (p != j)
+            {
+                std::swap_ranges(panel.data() + j * w, panel.data() + j * w + w, panel.data() + p * w);
+                odd_permutation = !odd_permutation;
+            }
+            auto const diag = panel[j * w + jj];
+            if (diag == Scalar(0)) continue;
+            parallel_chunks(pool, n - j - 1, parallel_element_threshold / std::max(w - jj, size_t(1)), [&](size_t r0, size_t r1) {
+                auto const* u = panel.data() + j * w;
+                for (auto i = j + 1 + r0; i < j + 1 + r1; ++i)
+                {
+                    auto* row = panel.data() + i * w;
+                    auto const f = row[jj] /= diag;
+                    for (auto c = jj + 1; c < w; ++c) row[c] -= f * u[c];
+                }
+            });
+        }
+
+        // The interchanges move whole rows, so apply them to the columns on either side
+        for (auto j = j0; j < j1; ++j)
+        {
+            if (pivot[j] == j) continue;
+            auto* rj = a + j * n;
+            auto* rp = a + pivot[j] * n;
+            std::swap_ranges(rj, rj + j0, rp);
+            std::swap_ranges(rj + j1, rj + n, rp + j1);
+        }
+
+        // Write the panel back while the next one is read
+        std::swap(panel, spare);
+        writing = std::async(std::launch::async, [&, j0, w, buffer = spare.data()] { write_tile(buffer, n, w, a + j0, lda, ptrdiff_t(1)); });
+    }
+    if (writing.valid()) writing.get();
+}
+
+#endif //MATRIX_OUT_OF_CORE_26_10_18_21_02_47
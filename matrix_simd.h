@@ -0,0 +1,366 @@
+#if !defined MATRIX_SIMD_26_10_18_11_40_27
+#define MATRIX_SIMD_26_10_18_11_40_27
+
+#include <cstddef>
+#include <type_traits>
+
+/*
+Explicit SIMD kernels for the element-wise and reduction traits.
+
+Each instruction set gets its own namespace holding an ops<Scalar> wrapper around the
+intrinsics, and the loops themselves live in matrix_simd_kernels.inl, which is included
+once per namespace inside a region compiled for that instruction set. The widest set
+supported by the processor and the operating system is chosen once, on first use,
+so a single binary runs at full width on every x86 machine.
+
+Reductions keep four independent accumulators so the loop is bound by load throughput
+rather than by the latency of the add.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define _LA_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+namespace std::experimental::la::detail {
+    ////////////////////////////////////////////////////////
+    // simd_kernels
+    ////////////////////////////////////////////////////////
+    enum class simd_level { scalar, sse2, avx2, avx512 };
+
+    template<class Scalar>
+    struct simd_kernels
+    {
+        void (*add)(Scalar* lhs, Scalar const* rhs, size_t n) noexcept;
+        void (*subtract)(Scalar* lhs, Scalar const* rhs, size_t n) noexcept;
+        void (*scalar_multiply)(Scalar* lhs, Scalar rhs, size_t n) noexcept;
+        void (*divide)(Scalar* lhs, Scalar rhs, size_t n) noexcept;
+        Scalar (*inner_product)(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept;
+        Scalar (*modulus_squared)(Scalar const* mat, size_t n) noexcept;
+        bool (*equal)(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept;
+        void (*axpby)(Scalar alpha, Scalar const* x, Scalar beta, Scalar* y, size_t n) noexcept;
+    };
+
+    template<class Scalar>
+    inline constexpr bool is_simd_scalar_v = std::is_same_v<Scalar, float> || std::is_same_v<Scalar, double>;
+
+    // Below this many elements the cost of the indirect call outweighs the wider loop
+    inline constexpr size_t simd_dispatch_size = 32;
+
+    // Matrices interleaved per block of a matrix_batch: one cache line of each element,
+    // which is a whole number of registers at every width above
+    template<class Scalar>
+    inline constexpr size_t batch_lanes = sizeof(Scalar) < 64 ? 64 / sizeof(Scalar) : 1;
+
+    simd_level detect_simd_level() noexcept;
+    simd_level active_simd_level() noexcept;
+
+    template<class Scalar>
+    simd_kernels<Scalar> const& simd_kernels_for(simd_level level) noexcept;
+
+    template<class Scalar>
+    simd_kernels<Scalar> const& simd_dispatch() noexcept;
+}
+
+////////////////////////////////////////////////////////
+// Instruction set wrappers
+////////////////////////////////////////////////////////
+namespace std::experimental::la::detail::simd_scalar {
+    template<class Scalar>
+    struct ops
+    {
+        using vec = Scalar;
+        static constexpr size_t width = 1;
+        static vec load(Scalar const* p) noexcept { return *p; }
+        static void store(Scalar* p, vec v) noexcept { *p = v; }
+        static vec set1(Scalar s) noexcept { return s; }
+        static vec zero() noexcept { return Scalar(0); }
+        static vec add(vec a, vec b) noexcept { return a + b; }
+        static vec sub(vec a, vec b) noexcept { return a - b; }
+        static vec mul(vec a, vec b) noexcept { return a * b; }
+        static vec div(vec a, vec b) noexcept { return a / b; }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return a * b + c; }
+        static Scalar hsum(vec v) noexcept { return v; }
+        static bool any_not_equal(vec a, vec b) noexcept { return !(a == b); }
+    };
+#include "matrix_simd_kernels.inl"
+}
+
+#if defined _LA_SIMD_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+namespace std::experimental::la::detail::simd_sse2 {
+    template<class Scalar>
+    struct ops;
+
+    template<>
+    struct ops<float>
+    {
+        using vec = __m128;
+        static constexpr size_t width = 4;
+        static vec load(float const* p) noexcept { return _mm_loadu_ps(p); }
+        static void store(float* p, vec v) noexcept { _mm_storeu_ps(p, v); }
+        static vec set1(float s) noexcept { return _mm_set1_ps(s); }
+        static vec zero() noexcept { return _mm_setzero_ps(); }
+        static vec add(vec a, vec b) noexcept { return _mm_add_ps(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm_sub_ps(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm_mul_ps(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm_div_ps(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static float hsum(vec v) noexcept
+        {
+            auto shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+            auto sums = _mm_add_ps(v, shuf);
+            shuf = _mm_movehl_ps(shuf, sums);
+            return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+        }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm_movemask_ps(_mm_cmpneq_ps(a, b)) != 0; }
+    };
+
+    template<>
+    struct ops<double>
+    {
+        using vec = __m128d;
+        static constexpr size_t width = 2;
+        static vec load(double const* p) noexcept { return _mm_loadu_pd(p); }
+        static void store(double* p, vec v) noexcept { _mm_storeu_pd(p, v); }
+        static vec set1(double s) noexcept { return _mm_set1_pd(s); }
+        static vec zero() noexcept { return _mm_setzero_pd(); }
+        static vec add(vec a, vec b) noexcept { return _mm_add_pd(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm_sub_pd(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm_mul_pd(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm_div_pd(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+        static double hsum(vec v) noexcept { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm_movemask_pd(_mm_cmpneq_pd(a, b)) != 0; }
+    };
+#include "matrix_simd_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+namespace std::experimental::la::detail::simd_avx2 {
+    template<class Scalar>
+    struct ops;
+
+    template<>
+    struct ops<float>
+    {
+        using vec = __m256;
+        static constexpr size_t width = 8;
+        static vec load(float const* p) noexcept { return _mm256_loadu_ps(p); }
+        static void store(float* p, vec v) noexcept { _mm256_storeu_ps(p, v); }
+        static vec set1(float s) noexcept { return _mm256_set1_ps(s); }
+        static vec zero() noexcept { return _mm256_setzero_ps(); }
+        static vec add(vec a, vec b) noexcept { return _mm256_add_ps(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm256_sub_ps(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm256_mul_ps(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm256_div_ps(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+        static float hsum(vec v) noexcept
+        {
+            auto v4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            auto shuf = _mm_shuffle_ps(v4, v4, _MM_SHUFFLE(2, 3, 0, 1));
+            auto sums = _mm_add_ps(v4, shuf);
+            shuf = _mm_movehl_ps(shuf, sums);
+            return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+        }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_NEQ_UQ)) != 0; }
+    };
+
+    template<>
+    struct ops<double>
+    {
+        using vec = __m256d;
+        static constexpr size_t width = 4;
+        static vec load(double const* p) noexcept { return _mm256_loadu_pd(p); }
+        static void store(double* p, vec v) noexcept { _mm256_storeu_pd(p, v); }
+        static vec set1(double s) noexcept { return _mm256_set1_pd(s); }
+        static vec zero() noexcept { return _mm256_setzero_pd(); }
+        static vec add(vec a, vec b) noexcept { return _mm256_add_pd(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm256_sub_pd(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm256_mul_pd(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm256_div_pd(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+        static double hsum(vec v) noexcept
+        {
+            auto v2 = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(v2, _mm_unpackhi_pd(v2, v2)));
+        }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ)) != 0; }
+    };
+#include "matrix_simd_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+namespace std::experimental::la::detail::simd_avx512 {
+    template<class Scalar>
+    struct ops;
+
+    template<>
+    struct ops<float>
+    {
+        using vec = __m512;
+        static constexpr size_t width = 16;
+        static vec load(float const* p) noexcept { return _mm512_loadu_ps(p); }
+        static void store(float* p, vec v) noexcept { _mm512_storeu_ps(p, v); }
+        static vec set1(float s) noexcept { return _mm512_set1_ps(s); }
+        static vec zero() noexcept { return _mm512_setzero_ps(); }
+        static vec add(vec a, vec b) noexcept { return _mm512_add_ps(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm512_sub_ps(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm512_mul_ps(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm512_div_ps(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+        static float hsum(vec v) noexcept
+        {
+            // Once per reduction, so a spill is cheaper than the extract sequence
+            float lanes[width];
+            _mm512_storeu_ps(lanes, v);
+            auto res = 0.0f;
+            for (auto el : lanes) res += el;
+            return res;
+        }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ) != 0; }
+    };
+
+    template<>
+    struct ops<double>
+    {
+        using vec = __m512d;
+        static constexpr size_t width = 8;
+        static vec load(double const* p) noexcept { return _mm512_loadu_pd(p); }
+        static void store(double* p, vec v) noexcept { _mm512_storeu_pd(p, v); }
+        static vec set1(double s) noexcept { return _mm512_set1_pd(s); }
+        static vec zero() noexcept { return _mm512_setzero_pd(); }
+        static vec add(vec a, vec b) noexcept { return _mm512_add_pd(a, b); }
+        static vec sub(vec a, vec b) noexcept { return _mm512_sub_pd(a, b); }
+        static vec mul(vec a, vec b) noexcept { return _mm512_mul_pd(a, b); }
+        static vec div(vec a, vec b) noexcept { return _mm512_div_pd(a, b); }
+        static vec fmadd(vec a, vec b, vec c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+        static double hsum(vec v) noexcept
+        {
+            double lanes[width];
+            _mm512_storeu_pd(lanes, v);
+            auto res = 0.0;
+            for (auto el : lanes) res += el;
+            return res;
+        }
+        static bool any_not_equal(vec a, vec b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ) != 0; }
+    };
+#include "matrix_simd_kernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+////////////////////////////////////////////////////////
+// simd dispatch implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::detail::simd_level std::experimental::la::detail::detect_simd_level() noexcept
+{
+#if defined _LA_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    auto const max_leaf = info[0];
+    __cpuid(info, 1);
+    auto const sse2 = (info[3] & (1 << 26)) != 0;
+    auto const fma = (info[2] & (1 << 12)) != 0;
+    auto const osxsave = (info[2] & (1 << 27)) != 0;
+    // The operating system must save the wider registers on context switch
+    auto const xcr0 = osxsave ? _xgetbv(0) : 0;
+    auto const ymm_state = (xcr0 & 0x06) == 0x06;
+    auto const zmm_state = (xcr0 & 0xE6) == 0xE6;
+    auto avx2 = false;
+    auto avx512f = false;
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512f = (info[1] & (1 << 16)) != 0;
+    }
+    if (avx512f && zmm_state) return simd_level::avx512;
+    if (avx2 && fma && ymm_state) return simd_level::avx2;
+    if (sse2) return simd_level::sse2;
+#else
+    // libgcc and compiler-rt also check that the OS saves the extended register state
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return simd_level::avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return simd_level::avx2;
+    if (__builtin_cpu_supports("sse2")) return simd_level::sse2;
+#endif
+#endif
+    return simd_level::scalar;
+}
+
+inline std::experimental::la::detail::simd_level std::experimental::la::detail::active_simd_level() noexcept
+{
+    static auto const level = detect_simd_level();
+    return level;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::simd_kernels<Scalar> const& std::experimental::la::detail::simd_kernels_for(simd_level level) noexcept
+{
+    static_assert(is_simd_scalar_v<Scalar>);
+    static constexpr simd_kernels<Scalar> scalar_kernels = { &simd_scalar::add<Scalar>, &simd_scalar::subtract<Scalar>,
+        &simd_scalar::scalar_multiply<Scalar>, &simd_scalar::divide<Scalar>, &simd_scalar::inner_product<Scalar>,
+        &simd_scalar::modulus_squared<Scalar>, &simd_scalar::equal<Scalar>, &simd_scalar::axpby<Scalar> };
+#if defined _LA_SIMD_X86
+    static constexpr simd_kernels<Scalar> sse2_kernels = { &simd_sse2::add<Scalar>, &simd_sse2::subtract<Scalar>,
+        &simd_sse2::scalar_multiply<Scalar>, &simd_sse2::divide<Scalar>, &simd_sse2::inner_product<Scalar>,
+        &simd_sse2::modulus_squared<Scalar>, &simd_sse2::equal<Scalar>, &simd_sse2::axpby<Scalar> };
+    static constexpr simd_kernels<Scalar> avx2_kernels = { &simd_avx2::add<Scalar>, &simd_avx2::subtract<Scalar>,
+        &simd_avx2::scalar_multiply<Scalar>, &simd_avx2::divide<Scalar>, &simd_avx2::inner_product<Scalar>,
+        &simd_avx2::modulus_squared<Scalar>, &simd_avx2::equal<Scalar>, &simd_avx2::axpby<Scalar> };
+    static constexpr simd_kernels<Scalar> avx512_kernels = { &simd_avx512::add<Scalar>, &simd_avx512::subtract<Scalar>,
+        &simd_avx512::scalar_multiply<Scalar>, &simd_avx512::divide<Scalar>, &simd_avx512::inner_product<Scalar>,
+        &simd_avx512::modulus_squared<Scalar>, &simd_avx512::equal<Scalar>, &simd_avx512::axpby<Scalar> };
+    switch (level)
+    {
+    case simd_level::avx512: return avx512_kernels;
+    case simd_level::avx2: return avx2_kernels;
+    case simd_level::sse2: return sse2_kernels;
+    default: break;
+    }
+#endif
+    return scalar_kernels;
+}
+
+template<class Scalar>
+inline std::experimental::la::detail::simd_kernels<Scalar> const& std::experimental::la::detail::simd_dispatch() noexcept
+{
+    static auto const& kernels = simd_kernels_for<Scalar>(active_simd_level());
+    return kernels;
+}
+
+#endif
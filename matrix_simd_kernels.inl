@@ -0,0 +1,258 @@
+// Loops shared by every instruction set in matrix_simd.h.
+// Included once inside each detail::simd_* namespace, after that namespace's ops<Scalar>,
+// so deliberately has no include guard.
+
+template<class Scalar>
+inline void add(Scalar* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width) v::store(lhs + i, v::add(v::load(lhs + i), v::load(rhs + i)));
+    for (; i < n; ++i) lhs[i] = lhs[i] + rhs[i];
+}
+
+template<class Scalar>
+inline void subtract(Scalar* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width) v::store(lhs + i, v::sub(v::load(lhs + i), v::load(rhs + i)));
+    for (; i < n; ++i) lhs[i] = lhs[i] - rhs[i];
+}
+
+template<class Scalar>
+inline void scalar_multiply(Scalar* lhs, Scalar rhs, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    auto const s = v::set1(rhs);
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width) v::store(lhs + i, v::mul(v::load(lhs + i), s));
+    for (; i < n; ++i) lhs[i] = lhs[i] * rhs;
+}
+
+template<class Scalar>
+inline void divide(Scalar* lhs, Scalar rhs, size_t n) noexcept
+{
+    // A true division rather than a multiply by the reciprocal, to match the scalar trait bit for bit
+    using v = ops<Scalar>;
+    auto const s = v::set1(rhs);
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width) v::store(lhs + i, v::div(v::load(lhs + i), s));
+    for (; i < n; ++i) lhs[i] = lhs[i] / rhs;
+}
+
+template<class Scalar>
+inline void axpby(Scalar alpha, Scalar const* x, Scalar beta, Scalar* y, size_t n) noexcept
+{
+    // Separate multiplies and add rather than fmadd, to match the scalar trait bit for bit
+    using v = ops<Scalar>;
+    auto const a = v::set1(alpha);
+    auto const b = v::set1(beta);
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width) v::store(y + i, v::add(v::mul(a, v::load(x + i)), v::mul(b, v::load(y + i))));
+    for (; i < n; ++i) y[i] = alpha * x[i] + beta * y[i];
+}
+
+template<class Scalar>
+inline Scalar inner_product(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    auto acc0 = v::zero();
+    auto acc1 = v::zero();
+    auto acc2 = v::zero();
+    auto acc3 = v::zero();
+    auto i = size_t(0);
+    for (; i + 4 * v::width <= n; i += 4 * v::width)
+    {
+        acc0 = v::fmadd(v::load(lhs + i), v::load(rhs + i), acc0);
+        acc1 = v::fmadd(v::load(lhs + i + v::width), v::load(rhs + i + v::width), acc1);
+        acc2 = v::fmadd(v::load(lhs + i + 2 * v::width), v::load(rhs + i + 2 * v::width), acc2);
+        acc3 = v::fmadd(v::load(lhs + i + 3 * v::width), v::load(rhs + i + 3 * v::width), acc3);
+    }
+    for (; i + v::width <= n; i += v::width) acc0 = v::fmadd(v::load(lhs + i), v::load(rhs + i), acc0);
+    auto res = v::hsum(v::add(v::add(acc0, acc1), v::add(acc2, acc3)));
+    for (; i < n; ++i) res += lhs[i] * rhs[i];
+    return res;
+}
+
+template<class Scalar>
+inline Scalar modulus_squared(Scalar const* mat, size_t n) noexcept
+{
+    return inner_product(mat, mat, n);
+}
+
+template<class Scalar>
+inline bool equal(Scalar const* lhs, Scalar const* rhs, size_t n) noexcept
+{
+    using v = ops<Scalar>;
+    auto i = size_t(0);
+    for (; i + v::width <= n; i += v::width)
+    {
+        if (v::any_not_equal(v::load(lhs + i), v::load(rhs + i))) return false;
+    }
+    for (; i < n; ++i)
+    {
+        if (!(lhs[i] == rhs[i])) return false;
+    }
+    return true;
+}
+
+// Batched small-matrix kernels for matrix_batch.
+// A block holds batch_lanes<Scalar> matrices with element e of every matrix stored together
+// at e * lanes, so each load fills a register with the same element of width matrices and
+// the arithmetic of one matrix is done for all of them at once.
+
+template<class Scalar, size_t R, size_t K, size_t C>
+inline void batch_multiply(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept
+{
+    using v = ops<Scalar>;
+    constexpr auto lanes = batch_lanes<Scalar>;
+    for (auto b = size_t(0); b < blocks; ++b, lhs += R * K * lanes, rhs += K * C * lanes, res += R * C * lanes)
+    {
+        for (auto l = size_t(0); l + v::width <= lanes; l += v::width)
+        {
+            for (auto i = size_t(0); i < R; ++i)
+            {
+                for (auto j = size_t(0); j < C; ++j)
+                {
+                    auto acc = v::mul(v::load(lhs + i * K * lanes + l), v::load(rhs + j * lanes + l));
+                    for (auto p = size_t(1); p < K; ++p) acc = v::fmadd(v::load(lhs + (i * K + p) * lanes + l), v::load(rhs + (p * C + j) * lanes + l), acc);
+                    v::store(res + (i * C + j) * lanes + l, acc);
+                }
+            }
+        }
+    }
+}
+
+// lhs is a single row-major matrix applied to every matrix of the batch
+template<class Scalar, size_t R, size_t K, size_t C>
+inline void batch_multiply_shared(Scalar const* lhs, Scalar const* rhs, Scalar* res, size_t blocks) noexcept
+{
+    using v = ops<Scalar>;
+    constexpr auto lanes = batch_lanes<Scalar>;
+    for (auto b = size_t(0); b < blocks; ++b, rhs += K * C * lanes, res += R * C * lanes)
+    {
+        for (auto l = size_t(0); l + v::width <= lanes; l += v::width)
+        {
+            for (auto i = size_t(0); i < R; ++i)
+            {
+                for (auto j = size_t(0); j < C; ++j)
+                {
+                    auto acc = v::mul(v::set1(lhs[i * K]), v::load(rhs + j * lanes + l));
+                    for (auto p = size_t(1); p < K; ++p) acc = v::fmadd(v::set1(lhs[i * K + p]), v::load(rhs + (p * C + j) * lanes + l), acc);
+                    v::store(res + (i * C + j) * lanes + l, acc);
+                }
+            }
+        }
+    }
+}
+
+// a * b - c * d
+template<class V>
+inline typename V::vec batch_cross(typename V::vec a, typename V::vec b, typename V::vec c, typename V::vec d) noexcept
+{
+    return V::sub(V::mul(a, b), V::mul(c, d));
+}
+
+// Writes the classical adjoint of the N x N matrix m to adj and returns the determinant.
+// Closed forms up to 4 x 4; the 4 x 4 case expands by the 2 x 2 minors of its top and bottom row pairs.
+template<class V, size_t N>
+inline typename V::vec batch_adjoint(typename V::vec const* m, typename V::vec* adj) noexcept
+{
+    static_assert(N >= 1 && N <= 4);
+    if constexpr (N == 1)
+    {
+        adj[0] = V::set1(1);
+        return m[0];
+    }
+    else if constexpr (N == 2)
+    {
+        adj[0] = m[3];
+        adj[1] = V::sub(V::zero(), m[1]);
+        adj[2] = V::sub(V::zero(), m[2]);
+        adj[3] = m[0];
+        return batch_cross<V>(m[0], m[3], m[1], m[2]);
+    }
+    else if constexpr (N == 3)
+    {
+        adj[0] = batch_cross<V>(m[4], m[8], m[5], m[7]);
+        adj[1] = batch_cross<V>(m[2], m[7], m[1], m[8]);
+        adj[2] = batch_cross<V>(m[1], m[5], m[2], m[4]);
+        adj[3] = batch_cross<V>(m[5], m[6], m[3], m[8]);
+        adj[4] = batch_cross<V>(m[0], m[8], m[2], m[6]);
+        adj[5] = batch_cross<V>(m[2], m[3], m[0], m[5]);
+        adj[6] = batch_cross<V>(m[3], m[7], m[4], m[6]);
+        adj[7] = batch_cross<V>(m[1], m[6], m[0], m[7]);
+        adj[8] = batch_cross<V>(m[0], m[4], m[1], m[3]);
+        return V::fmadd(m[2], adj[6], V::fmadd(m[1], adj[3], V::mul(m[0], adj[0])));
+    }
+    else
+    {
+        auto const s0 = batch_cross<V>(m[0], m[5], m[4], m[1]);
+        auto const s1 = batch_cross<V>(m[0], m[6], m[4], m[2]);
+        auto const s2 = batch_cross<V>(m[0], m[7], m[4], m[3]);
+        auto const s3 = batch_cross<V>(m[1], m[6], m[5], m[2]);
+        auto const s4 = batch_cross<V>(m[1], m[7], m[5], m[3]);
+        auto const s5 = batch_cross<V>(m[2], m[7], m[6], m[3]);
+        auto const c0 = batch_cross<V>(m[8], m[13], m[12], m[9]);
+        auto const c1 = batch_cross<V>(m[8], m[14], m[12], m[10]);
+        auto const c2 = batch_cross<V>(m[8], m[15], m[12], m[11]);
+        auto const c3 = batch_cross<V>(m[9], m[14], m[13], m[10]);
+        auto const c4 = batch_cross<V>(m[9], m[15], m[13], m[11]);
+        auto const c5 = batch_cross<V>(m[10], m[15], m[14], m[11]);
+        adj[0] = V::add(batch_cross<V>(m[5], c5, m[6], c4), V::mul(m[7], c3));
+        adj[1] = V::sub(batch_cross<V>(m[2], c4, m[1], c5), V::mul(m[3], c3));
+        adj[2] = V::add(batch_cross<V>(m[13], s5, m[14], s4), V::mul(m[15], s3));
+        adj[3] = V::sub(batch_cross<V>(m[10], s4, m[9], s5), V::mul(m[11], s3));
+        adj[4] = V::sub(batch_cross<V>(m[6], c2, m[4], c5), V::mul(m[7], c1));
+        adj[5] = V::add(batch_cross<V>(m[0], c5, m[2], c2), V::mul(m[3], c1));
+        adj[6] = V::sub(batch_cross<V>(m[14], s2, m[12], s5), V::mul(m[15], s1));
+        adj[7] = V::add(batch_cross<V>(m[8], s5, m[10], s2), V::mul(m[11], s1));
+        adj[8] = V::add(batch_cross<V>(m[4], c4, m[5], c2), V::mul(m[7], c0));
+        adj[9] = V::sub(batch_cross<V>(m[1], c2, m[0], c4), V::mul(m[3], c0));
+        adj[10] = V::add(batch_cross<V>(m[12], s4, m[13], s2), V::mul(m[15], s0));
+        adj[11] = V::sub(batch_cross<V>(m[9], s2, m[8], s4), V::mul(m[11], s0));
+        adj[12] = V::sub(batch_cross<V>(m[5], c1, m[4], c3), V::mul(m[6], c0));
+        adj[13] = V::add(batch_cross<V>(m[0], c3, m[1], c1), V::mul(m[2], c0));
+        adj[14] = V::sub(batch_cross<V>(m[13], s1, m[12], s3), V::mul(m[14], s0));
+        adj[15] = V::add(batch_cross<V>(m[8], s3, m[9], s1), V::mul(m[10], s0));
+        return V::add(V::add(V::sub(V::mul(s0, c5), V::mul(s1, c4)), V::add(V::mul(s2, c3), V::mul(s3, c2))), V::sub(V::mul(s5, c0), V::mul(s4, c1)));
+    }
+}
+
+// One determinant per matrix, written to det[block * lanes + lane]
+template<class Scalar, size_t N>
+inline void batch_determinant(Scalar const* mat, Scalar* det, size_t blocks) noexcept
+{
+    using v = ops<Scalar>;
+    constexpr auto lanes = batch_lanes<Scalar>;
+    for (auto b = size_t(0); b < blocks; ++b, mat += N * N * lanes, det += lanes)
+    {
+        for (auto l = size_t(0); l + v::width <= lanes; l += v::width)
+        {
+            typename v::vec m[N * N];
+            typename v::vec adj[N * N];
+            for (auto e = size_t(0); e < N * N; ++e) m[e] = v::load(mat + e * lanes + l);
+            v::store(det + l, batch_adjoint<v, N>(m, adj));
+        }
+    }
+}
+
+// A singular matrix has no inverse; its slot is left holding non-finite values
+template<class Scalar, size_t N>
+inline void batch_inverse(Scalar const* mat, Scalar* res, size_t blocks) noexcept
+{
+    using v = ops<Scalar>;
+    constexpr auto lanes = batch_lanes<Scalar>;
+    for (auto b = size_t(0); b < blocks; ++b, mat += N * N * lanes, res += N * N * lanes)
+    {
+        for (auto l = size_t(0); l + v::width <= lanes; l += v::width)
+        {
+            typename v::vec m[N * N];
+            typename v::vec adj[N * N];
+            for (auto e = size_t(0); e < N * N; ++e) m[e] = v::load(mat + e * lanes + l);
+            auto const det = batch_adjoint<v, N>(m, adj);
+            for (auto e = size_t(0); e < N * N; ++e) v::store(res + e * lanes + l, v::div(adj[e], det));
+        }
+    }
+}
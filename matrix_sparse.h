@@ -0,0 +1,747 @@
+#if !defined MATRIX_SPARSE_26_10_18_19_34_27
+#define MATRIX_SPARSE_26_10_18_19_34_27
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_thread_pool.h"
+#include "linear_algebra.h"
+
+/*
+Compressed sparse storage.
+
+sparse_matrix keeps only the nonzero elements. They are grouped by row (CSR, with the
+row_major layout) or by column (CSC, with column_major): offsets() has one entry per
+row or column plus one, and the nonzeros of row or column k are values()[offsets()[k]]
+up to values()[offsets()[k + 1]], at the positions given by indices(), which are
+ascending within each row or column. For a problem with m rows and z nonzeros CSR takes
+z values, z indices and m + 1 offsets, against m times n values stored dense.
+
+sparse_traits is the Rep for sparse matrices. A sparse matrix multiplies a dense matrix
+or vector (view, either layout) into a dense result, adds and subtracts another sparse
+matrix of the same type into a sparse result, and transposes for free: the transpose of
+a CSR matrix is the CSC matrix with the same arrays. Sparse matrices do not take part
+in the element-wise expressions of matrix_expression.h; +, - and the scalar operators
+here compute their results directly.
+
+sparse_builder gathers (row, column, value) triplets in any order, summing duplicates,
+and compresses them into either layout.
+*/
+
+namespace std::experimental::la {
+    struct sparse_matrix_t {};
+
+    ////////////////////////////////////////////////////////
+    // sparse_matrix
+    ////////////////////////////////////////////////////////
+    // Index is the type of the stored positions, and bounds the number of rows or columns
+    template<class Scalar, class Layout = row_major, class Index = std::uint32_t>
+    struct sparse_matrix : public sparse_matrix_t
+    {
+        using scalar_t = Scalar;
+        using layout_t = Layout;
+        using index_t = Index;
+        using matrix_t = sparse_matrix<Scalar, Layout, Index>;
+        using transpose_t = sparse_matrix<Scalar, std::conditional_t<std::is_same_v<Layout, row_major>, column_major, row_major>, Index>;
+
+        constexpr static bool row_compressed = std::is_same_v<Layout, row_major>;
+
+        sparse_matrix() = default;
+        explicit sparse_matrix(std::pair<size_t, size_t> size);        // All zero
+        // Adopts compressed arrays, laid out as described above
+        sparse_matrix(std::pair<size_t, size_t> size, std::vector<size_t> offsets, std::vector<Index> indices, std::vector<Scalar> values);
+        // Accessors
+        Scalar operator()(size_t i, size_t j) const;                   // Zero where nothing is stored
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+        size_t nonzeros() const noexcept;
+        size_t outer_size() const noexcept;                            // Rows for CSR, columns for CSC
+        size_t inner_size() const noexcept;
+        std::vector<size_t> const& offsets() const noexcept;
+        std::vector<Index> const& indices() const noexcept;
+        std::vector<Scalar> const& values() const noexcept;
+        std::vector<Scalar>& values() noexcept;                        // Values may change in place; the pattern may not
+
+        size_t _RowCount = 0;
+        size_t _ColCount = 0;
+        std::vector<size_t> _Offsets = std::vector<size_t>(1);
+        std::vector<Index> _Indices;
+        std::vector<Scalar> _Values;
+    };
+
+    template<class Scalar, class Index = std::uint32_t>
+    using csr_matrix = sparse_matrix<Scalar, row_major, Index>;
+
+    template<class Scalar, class Index = std::uint32_t>
+    using csc_matrix = sparse_matrix<Scalar, column_major, Index>;
+
+    ////////////////////////////////////////////////////////
+    // sparse_builder
+    ////////////////////////////////////////////////////////
+    // Coordinate (COO) form: triplets in any order, duplicates summed when built
+    template<class Scalar>
+    struct sparse_builder
+    {
+        sparse_builder(size_t rows, size_t cols);
+        void reserve(size_t count);
+        void add(size_t i, size_t j, Scalar value);
+        size_t size() const noexcept;                                  // Triplets added so far
+        template<class Layout = row_major, class Index = std::uint32_t>
+        sparse_matrix<Scalar, Layout, Index> build() const;
+
+        size_t _RowCount;
+        size_t _ColCount;
+        std::vector<size_t> _Rows;
+        std::vector<size_t> _Cols;
+        std::vector<Scalar> _Values;
+    };
+
+    ////////////////////////////////////////////////////////
+    // sparse_traits
+    ////////////////////////////////////////////////////////
+    template<class Sparse>
+    struct sparse_traits
+    {
+        using scalar_t = typename Sparse::scalar_t;
+        using matrix_t = Sparse;
+        using dense_rep_t = matrix_traits<dynamic_size_matrix<scalar_t>>;
+        using transpose_t = sparse_traits<typename Sparse::transpose_t>;
+        template<class Traits2>
+        using multiply_t = dense_rep_t;
+
+        static bool equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;        // Same shape, pattern and values
+        static bool not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static void scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        template <class Traits2> static typename dense_rep_t::matrix_t matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs);
+        static void divide(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        static void add(matrix_t& lhs, matrix_t const& rhs);
+        static void subtract(matrix_t& lhs, matrix_t const& rhs);
+        static typename transpose_t::matrix_t transpose(matrix_t const& mat);
+        static scalar_t inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static scalar_t modulus(matrix_t const& mat) noexcept;
+        static scalar_t modulus_squared(matrix_t const& mat) noexcept;
+        static bool is_identity(matrix_t const& mat) noexcept;
+        // lhs + alpha rhs, merging the two patterns
+        static matrix_t combine(thread_pool* pool, matrix_t const& lhs, matrix_t const& rhs, scalar_t alpha);
+
+        // Parallel overloads: rows of a CSR product, or columns of the right-hand side for CSC,
+        // and the rows or columns of a sum, are shared among the threads
+        template <class Traits2> static typename dense_rep_t::matrix_t matrix_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs);
+        static void add(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs);
+        static void subtract(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs);
+    };
+
+    // Sums and scalar products of sparse matrices
+    template<class Sparse>
+    matrix<sparse_traits<Sparse>> operator+(matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs);
+
+    template<class Sparse>
+    matrix<sparse_traits<Sparse>> operator-(matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs);
+
+    template<class Sparse>
+    matrix<sparse_traits<Sparse>> operator*(matrix<sparse_traits<Sparse>> lhs, typename Sparse::scalar_t const& rhs);
+
+    template<class Sparse>
+    matrix<sparse_traits<Sparse>> operator*(typename Sparse::scalar_t const& lhs, matrix<sparse_traits<Sparse>> rhs);
+
+    template<class Sparse>
+    matrix<sparse_traits<Sparse>> operator/(matrix<sparse_traits<Sparse>> lhs, typename Sparse::scalar_t const& rhs);
+
+    template<class Exec, class Sparse, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<sparse_traits<Sparse>> add(Exec&& exec, matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs);
+
+    template<class Exec, class Sparse, class = std::enable_if_t<detail::is_execution_v<Exec>>>
+    matrix<sparse_traits<Sparse>> subtract(Exec&& exec, matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs);
+
+    // Conversions
+    // to_sparse keeps the nonzero elements of a dense matrix, or changes the layout of a sparse one
+    template<class Layout = row_major, class Index = std::uint32_t, class Rep>
+    matrix<sparse_traits<sparse_matrix<typename Rep::scalar_t, Layout, Index>>> to_sparse(matrix<Rep> const& mat);
+
+    template<class Layout, class Index = std::uint32_t, class Sparse>
+    matrix<sparse_traits<sparse_matrix<typename Sparse::scalar_t, Layout, Index>>> to_sparse(matrix<sparse_traits<Sparse>> const& mat);
+
+    template<class Sparse>
+    matrix<typename sparse_traits<Sparse>::dense_rep_t> to_dense(matrix<sparse_traits<Sparse>> const& mat);
+
+    namespace detail {
+        template<class Rep>
+        inline constexpr bool is_sparse_rep_v = false;
+
+        template<class Sparse>
+        inline constexpr bool is_sparse_rep_v<sparse_traits<Sparse>> = true;
+
+        // C[r0:r1, :] = A[r0:r1, :] B for CSR A; rows are independent
+        template<class Sparse, class Scalar>
+        void spmm_rows(Sparse const& a, Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, size_t nrhs, Scalar* c, ptrdiff_t rsc, size_t r0, size_t r1) noexcept;
+
+        // C[:, c0:c1] = A B[:, c0:c1] for CSC A, scattering each column of A into C
+        template<class Sparse, class Scalar>
+        void spmm_columns(Sparse const& a, Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, Scalar* c, ptrdiff_t rsc, size_t c0, size_t c1) noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// sparse_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar, class Layout, class Index>
+inline std::experimental::la::sparse_matrix<Scalar, Layout, Index>::sparse_matrix(std::pair<size_t, size_t> size)
+    : _RowCount(size.first)
+    , _ColCount(size.second)
+    , _Offsets(outer_size() + 1)
+{}
+
+template<class Scalar, class Layout, class Index>
+inline std::experimental::la::sparse_matrix<Scalar, Layout, Index>::sparse_matrix(std::pair<size_t, size_t> size, std::vector<size_t> offsets, std::vector<Index> indices, std::vector<Scalar> values)
+    : _RowCount(size.first)
+    , _ColCount(size.second)
+    , _Offsets(std::move(offsets))
+    , _Indices(std::move(indices))
+    , _Values(std::move(values))
+{
+    assert(_Offsets.size() == outer_size() + 1 && _Offsets.front() == 0);
+    assert(_Offsets.back() == _Indices.size() && _Indices.size() == _Values.size());
+    assert(inner_size() <= size_t(std::numeric_limits<Index>::max()));
+}
+
+template<class Scalar, class Layout, class Index>
+inline Scalar std::experimental::la::sparse_matrix<Scalar, Layout, Index>::operator()(size_t i, size_t j) const
+{
+    assert(i < _RowCount && j < _ColCount);
+    auto const outer = row_compressed ? i : j;
+    auto const inner = Index(row_compressed ? j : i);
+    auto const first = _Indices.begin() + ptrdiff_t(_Offsets[outer]);
+    auto const last = _Indices.begin() + ptrdiff_t(_Offsets[outer + 1]);
+    auto const it = std::lower_bound(first, last, inner);
+    return it != last && *it == inner ? _Values[size_t(it - _Indices.begin())] : Scalar(0);
+}
+
+template<class Scalar, class Layout, class Index>
+inline size_t std::experimental::la::sparse_matrix<Scalar, Layout, Index>::rows() const noexcept
+{
+    return _RowCount;
+}
+
+template<class Scalar, class Layout, class Index>
+inline size_t std::experimental::la::sparse_matrix<Scalar, Layout, Index>::cols() const noexcept
+{
+    return _ColCount;
+}
+
+template<class Scalar, class Layout, class Index>
+inline size_t std::experimental::la::sparse_matrix<Scalar, Layout, Index>::nonzeros() const noexcept
+{
+    return _Values.size();
+}
+
+template<class Scalar, class Layout, class Index>
+inline size_t std::experimental::la::sparse_matrix<Scalar, Layout, Index>::outer_size() const noexcept
+{
+    return row_compressed ? _RowCount : _ColCount;
+}
+
+template<class Scalar, class Layout, class Index>
+inline size_t std::experimental::la::sparse_matrix<Scalar, Layout, Index>::inner_size() const noexcept
+{
+    return row_compressed ? _ColCount : _RowCount;
+}
+
+template<class Scalar, class Layout, class Index>
+inline std::vector<size_t> const& std::experimental::la::sparse_matrix<Scalar, Layout, Index>::offsets() const noexcept
+{
+    return _Offsets;
+}
+
+template<class Scalar, class Layout, class Index>
+inline std::vector<Index> const& std::experimental::la::sparse_matrix<Scalar, Layout, Index>::indices() const noexcept
+{
+    return _Indices;
+}
+
+template<class Scalar, class Layout, class Index>
+inline std::vector<Scalar> const& std::experimental::la::sparse_matrix<Scalar, Layout, Index>::values() const noexcept
+{
+    return _Values;
+}
+
+template<class Scalar, class Layout, class Index>
+inline std::vector<Scalar>& std::experimental::la::sparse_matrix<Scalar, Layout, Index>::values() noexcept
+{
+    return _Values;
+}
+
+////////////////////////////////////////////////////////
+// sparse_builder implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::sparse_builder<Scalar>::sparse_builder(size_t rows, size_t cols)
+    : _RowCount(rows)
+    , _ColCount(cols)
+{}
+
+template<class Scalar>
+inline void std::experimental::la::sparse_builder<Scalar>::reserve(size_t count)
+{
+    _Rows.reserve(count);
+    _Cols.reserve(count);
+    _Values.reserve(count);
+}
+
+template<class Scalar>
+inline void std::experimental::la::sparse_builder<Scalar>::add(size_t i, size_t j, Scalar value)
+{
+    assert(i < _RowCount && j < _ColCount);
+    _Rows.push_back(i);
+    _Cols.push_back(j);
+    _Values.push_back(value);
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::sparse_builder<Scalar>::size() const noexcept
+{
+    return _Values.size();
+}
+
+template<class Scalar>
+template<class Layout, class Index>
+inline std::experimental::la::sparse_matrix<Scalar, Layout, Index> std::experimental::la::sparse_builder<Scalar>::build() const
+{
+    constexpr auto row_compressed = sparse_matrix<Scalar, Layout, Index>::row_compressed;
+    auto const& outer = row_compressed ? _Rows : _Cols;
+    auto const& inner = row_compressed ? _Cols : _Rows;
+    auto const outer_size = row_compressed ? _RowCount : _ColCount;
+
+    // Counting sort by row or column, then sort each one by position and sum duplicates
+    auto offsets = std::vector<size_t>(outer_size + 1);
+    for (auto o : outer) ++offsets[o + 1];
+    for (auto k = size_t(0); k < outer_size; ++k) offsets[k + 1] += offsets[k];
+    auto next = std::vector<size_t>(offsets.begin(), offsets.end() - 1);
+    auto entries = std::vector<std::pair<Index, Scalar>>(_Values.size());
+    for (auto t = size_t(0); t < _Values.size(); ++t) entries[next[outer[t]]++] = { Index(inner[t]), _Values[t] };
+
+    auto indices = std::vector<Index>();
+    auto values = std::vector<Scalar>();
+    indices.reserve(entries.size());
+    values.reserve(entries.size());
+    auto const by_index = [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; };
+    for (auto k = size_t(0); k < outer_size; ++k)
+    {
+        auto const first = entries.begin() + ptrdiff_t(offsets[k]);
+        auto const last = entries.begin() + ptrdiff_t(offsets[k + 1]);
+        std::stable_sort(first, last, by_index);
+        offsets[k] = indices.size();
+        for (auto it = first; it != last; ++it)
+        {
+            if (indices.size() > offsets[k] && indices.back() == it->first) values.back() += it->second;
+            else
+            {
+                indices.push_back(it->first);
+                values.push_back(it->second);
+            }
+        }
+    }
+    offsets[outer_size] = indices.size();
+    return sparse_matrix<Scalar, Layout, Index>(std::pair(_RowCount, _ColCount), std::move(offsets), std::move(indices), std::move(values));
+}
+
+////////////////////////////////////////////////////////
+// sparse_traits implementation
+////////////////////////////////////////////////////////
+template<class Sparse>
+inline bool std::experimental::la::sparse_traits<Sparse>::equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols() && lhs.offsets() == rhs.offsets() && lhs.indices() == rhs.indices() && lhs.values() == rhs.values();
+}
+
+template<class Sparse>
+inline bool std::experimental::la::sparse_traits<Sparse>::not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return !equal(lhs, rhs);
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto& el : lhs.values()) el *= rhs;
+}
+
+template<class Sparse>
+template<class Traits2>
+inline typename std::experimental::la::sparse_traits<Sparse>::dense_rep_t::matrix_t std::experimental::la::sparse_traits<Sparse>::matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs)
+{
+    return matrix_multiply<Traits2>(nullptr, lhs, rhs);
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::divide(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto& el : lhs.values()) el /= rhs;
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::add(matrix_t& lhs, matrix_t const& rhs)
+{
+    lhs = combine(nullptr, lhs, rhs, scalar_t(1));
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::subtract(matrix_t& lhs, matrix_t const& rhs)
+{
+    lhs = combine(nullptr, lhs, rhs, scalar_t(-1));
+}
+
+template<class Sparse>
+inline typename std::experimental::la::sparse_traits<Sparse>::transpose_t::matrix_t std::experimental::la::sparse_traits<Sparse>::transpose(matrix_t const& mat)
+{
+    // Row i of a CSR matrix is column i of its transpose, so the arrays carry over unchanged
+    return typename transpose_t::matrix_t(std::pair(mat.cols(), mat.rows()), mat.offsets(), mat.indices(), mat.values());
+}
+
+template<class Sparse>
+inline typename std::experimental::la::sparse_traits<Sparse>::scalar_t std::experimental::la::sparse_traits<Sparse>::inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    // A vector keeps its nonzeros in ascending order of position in either layout, along
+    // its one row or column or one to a row or column, so the product is a merge
+    assert(lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols() && (lhs.rows() == 1 || lhs.cols() == 1));
+    auto const position = [](matrix_t const& vec, size_t n, size_t& k) {
+        if (vec.outer_size() == 1) return size_t(vec.indices()[n]);
+        while (vec.offsets()[k + 1] <= n) ++k;
+        return k;
+    };
+    auto res = scalar_t(0);
+    auto l = size_t(0);
+    auto r = size_t(0);
+    auto kl = size_t(0);
+    auto kr = size_t(0);
+    while (l < lhs.nonzeros() && r < rhs.nonzeros())
+    {
+        auto const pl = position(lhs, l, kl);
+        auto const pr = position(rhs, r, kr);
+        if (pl < pr) ++l;
+        else if (pr < pl) ++r;
+        else res += lhs.values()[l++] * rhs.values()[r++];
+    }
+    return res;
+}
+
+template<class Sparse>
+inline typename std::experimental::la::sparse_traits<Sparse>::scalar_t std::experimental::la::sparse_traits<Sparse>::modulus(matrix_t const& mat) noexcept
+{
+    return std::sqrt(modulus_squared(mat));
+}
+
+template<class Sparse>
+inline typename std::experimental::la::sparse_traits<Sparse>::scalar_t std::experimental::la::sparse_traits<Sparse>::modulus_squared(matrix_t const& mat) noexcept
+{
+    auto res = scalar_t(0);
+    for (auto const& el : mat.values()) res += el * el;
+    return res;
+}
+
+template<class Sparse>
+inline bool std::experimental::la::sparse_traits<Sparse>::is_identity(matrix_t const& mat) noexcept
+{
+    if (mat.rows() != mat.cols()) return false;
+    for (auto k = size_t(0); k < mat.outer_size(); ++k)
+    {
+        auto diagonal = false;
+        for (auto n = mat.offsets()[k]; n < mat.offsets()[k + 1]; ++n)
+        {
+            auto const on_diagonal = size_t(mat.indices()[n]) == k;
+            if (mat.values()[n] != (on_diagonal ? scalar_t(1) : scalar_t(0))) return false;
+            diagonal |= on_diagonal;
+        }
+        if (!diagonal) return false;
+    }
+    return true;
+}
+
+template<class Sparse>
+inline typename std::experimental::la::sparse_traits<Sparse>::matrix_t std::experimental::la::sparse_traits<Sparse>::combine(thread_pool* pool, matrix_t const& lhs, matrix_t const& rhs, scalar_t alpha)
+{
+    using index_t = typename Sparse::index_t;
+    assert(lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols());
+    auto const outer_size = lhs.outer_size();
+    auto const& lo = lhs.offsets();
+    auto const& ro = rhs.offsets();
+    auto const& li = lhs.indices();
+    auto const& ri = rhs.indices();
+    auto const min_chunk = std::max(size_t(1), detail::parallel_element_threshold * outer_size / std::max(size_t(1), lhs.nonzeros() + rhs.nonzeros()));
+
+    // Two passes over each row or column: size the merged pattern, then fill it
+    auto offsets = std::vector<size_t>(outer_size + 1);
+    detail::parallel_chunks(pool, outer_size, min_chunk, [&](size_t k0, size_t k1) {
+        for (auto k = k0; k < k1; ++k)
+        {
+            auto l = lo[k];
+            auto r = ro[k];
+            auto count = size_t(0);
+            while (l < lo[k + 1] && r < ro[k + 1])
+            {
+                auto const il = li[l];
+                auto const ir = ri[r];
+                l += il <= ir;
+                r += ir <= il;
+                ++count;
+            }
+            offsets[k + 1] = count + (lo[k + 1] - l) + (ro[k + 1] - r);
+        }
+    });
+    for (auto k = size_t(0); k < outer_size; ++k) offsets[k + 1] += offsets[k];
+
+    auto indices = std::vector<index_t>(offsets.back());
+    auto values = std::vector<scalar_t>(offsets.back());
+    auto const& lv = lhs.values();
+    auto const& rv = rhs.values();
+    detail::parallel_chunks(pool, outer_size, min_chunk, [&](size_t k0, size_t k1) {
+        for (auto k = k0; k < k1; ++k)
+        {
+            auto l = lo[k];
+            auto r = ro[k];
+            auto out = offsets[k];
+            while (l < lo[k + 1] || r < ro[k + 1])
+            {
+                if (r == ro[k + 1] || (l < lo[k + 1] && li[l] < ri[r]))
+                {
+                    indices[out] = li[l];
+                    values[out++] = lv[l++];
+                }
+                else if (l == lo[k + 1] || ri[r] < li[l])
+                {
+                    indices[out] = ri[r];
+                    values[out++] = alpha * rv[r++];
+                }
+                else
+                {
+                    indices[out] = li[l];
+                    values[out++] = lv[l++] + alpha * rv[r++];
+                }
+            }
+        }
+    });
+    return matrix_t(std::pair(lhs.rows(), lhs.cols()), std::move(offsets), std::move(indices), std::move(values));
+}
+
+template<class Sparse>
+template<class Traits2>
+inline typename std::experimental::la::sparse_traits<Sparse>::dense_rep_t::matrix_t std::experimental::la::sparse_traits<Sparse>::matrix_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs)
+{
+    static_assert(!detail::is_sparse_rep_v<Traits2>, "the right-hand side of a sparse product must be dense");
+    assert(lhs.cols() == rhs.rows());
+    auto const b = detail::as_view(rhs);
+    auto const nrhs = b.cols();
+    auto res = typename dense_rep_t::matrix_t(std::pair(lhs.rows(), nrhs));
+    std::fill(res.begin(), res.end(), scalar_t(0));
+    auto* c = res.begin();
+    auto const rsc = ptrdiff_t(nrhs);
+    if (!pool || lhs.nonzeros() * nrhs < detail::parallel_element_threshold) pool = nullptr;
+    if constexpr (Sparse::row_compressed)
+    {
+        auto const per_row = std::max(size_t(1), lhs.nonzeros() * nrhs / std::max(size_t(1), lhs.rows()));
+        detail::parallel_chunks(pool, lhs.rows(), std::max(size_t(1), detail::parallel_element_threshold / per_row), [&](size_t r0, size_t r1) {
+            detail::spmm_rows(lhs, b.data(), b.row_stride(), b.col_stride(), nrhs, c, rsc, r0, r1);
+        });
+    }
+    else
+    {
+        // Columns of A scatter into every row of C, so only the right-hand sides are split
+        detail::parallel_chunks(pool, nrhs, 1, [&](size_t c0, size_t c1) {
+            detail::spmm_columns(lhs, b.data(), b.row_stride(), b.col_stride(), c, rsc, c0, c1);
+        });
+    }
+    return res;
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::add(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs)
+{
+    lhs = combine(pool, lhs, rhs, scalar_t(1));
+}
+
+template<class Sparse>
+inline void std::experimental::la::sparse_traits<Sparse>::subtract(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs)
+{
+    lhs = combine(pool, lhs, rhs, scalar_t(-1));
+}
+
+////////////////////////////////////////////////////////
+// Sparse operations implementation
+////////////////////////////////////////////////////////
+template<class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::operator+(matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs)
+{
+    return matrix<sparse_traits<Sparse>>(sparse_traits<Sparse>::combine(nullptr, lhs.data(), rhs.data(), typename Sparse::scalar_t(1)));
+}
+
+template<class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::operator-(matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs)
+{
+    return matrix<sparse_traits<Sparse>>(sparse_traits<Sparse>::combine(nullptr, lhs.data(), rhs.data(), typename Sparse::scalar_t(-1)));
+}
+
+template<class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::operator*(matrix<sparse_traits<Sparse>> lhs, typename Sparse::scalar_t const& rhs)
+{
+    lhs *= rhs;
+    return lhs;
+}
+
+template<class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::operator*(typename Sparse::scalar_t const& lhs, matrix<sparse_traits<Sparse>> rhs)
+{
+    rhs *= lhs;
+    return rhs;
+}
+
+template<class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::operator/(matrix<sparse_traits<Sparse>> lhs, typename Sparse::scalar_t const& rhs)
+{
+    lhs /= rhs;
+    return lhs;
+}
+
+template<class Exec, class Sparse, class>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::add(Exec&& exec, matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs)
+{
+    return matrix<sparse_traits<Sparse>>(sparse_traits<Sparse>::combine(detail::execution_pool(exec), lhs.data(), rhs.data(), typename Sparse::scalar_t(1)));
+}
+
+template<class Exec, class Sparse, class>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<Sparse>> std::experimental::la::subtract(Exec&& exec, matrix<sparse_traits<Sparse>> const& lhs, matrix<sparse_traits<Sparse>> const& rhs)
+{
+    return matrix<sparse_traits<Sparse>>(sparse_traits<Sparse>::combine(detail::execution_pool(exec), lhs.data(), rhs.data(), typename Sparse::scalar_t(-1)));
+}
+
+template<class Layout, class Index, class Rep>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<std::experimental::la::sparse_matrix<typename Rep::scalar_t, Layout, Index>>> std::experimental::la::to_sparse(matrix<Rep> const& mat)
+{
+    using scalar_t = typename Rep::scalar_t;
+    using result_t = sparse_matrix<scalar_t, Layout, Index>;
+    auto const rows = mat.data().rows();
+    auto const cols = mat.data().cols();
+    auto const outer_size = result_t::row_compressed ? rows : cols;
+    auto const inner_size = result_t::row_compressed ? cols : rows;
+    auto offsets = std::vector<size_t>(outer_size + 1);
+    auto indices = std::vector<Index>();
+    auto values = std::vector<scalar_t>();
+    for (auto k = size_t(0); k < outer_size; ++k)
+    {
+        for (auto n = size_t(0); n < inner_size; ++n)
+        {
+            auto const el = result_t::row_compressed ? mat(k, n) : mat(n, k);
+            if (el == scalar_t(0)) continue;
+            indices.push_back(Index(n));
+            values.push_back(el);
+        }
+        offsets[k + 1] = indices.size();
+    }
+    return matrix<sparse_traits<result_t>>(result_t(std::pair(rows, cols), std::move(offsets), std::move(indices), std::move(values)));
+}
+
+template<class Layout, class Index, class Sparse>
+inline std::experimental::la::matrix<std::experimental::la::sparse_traits<std::experimental::la::sparse_matrix<typename Sparse::scalar_t, Layout, Index>>> std::experimental::la::to_sparse(matrix<sparse_traits<Sparse>> const& mat)
+{
+    using result_t = sparse_matrix<typename Sparse::scalar_t, Layout, Index>;
+    auto const& src = mat.data();
+    if constexpr (result_t::row_compressed == Sparse::row_compressed)
+    {
+        auto indices = std::vector<Index>(src.indices().begin(), src.indices().end());
+        return matrix<sparse_traits<result_t>>(result_t(std::pair(src.rows(), src.cols()), src.offsets(), std::move(indices), src.values()));
+    }
+    else
+    {
+        // Changing layout is a transpose of the arrays: a counting sort by the inner index,
+        // which visits each row or column in order and so keeps the result sorted
+        auto offsets = std::vector<size_t>(src.inner_size() + 1);
+        for (auto i : src.indices()) ++offsets[size_t(i) + 1];
+        for (auto k = size_t(0); k < src.inner_size(); ++k) offsets[k + 1] += offsets[k];
+        auto next = std::vector<size_t>(offsets.begin(), offsets.end() - 1);
+        auto indices = std::vector<Index>(src.nonzeros());
+        auto values = std::vector<typename Sparse::scalar_t>(src.nonzeros());
+        for (auto k = size_t(0); k < src.outer_size(); ++k)
+        {
+            for (auto n = src.offsets()[k]; n < src.offsets()[k + 1]; ++n)
+            {
+                auto const out = next[size_t(src.indices()[n])]++;
+                indices[out] = Index(k);
+                values[out] = src.values()[n];
+            }
+        }
+        return matrix<sparse_traits<result_t>>(result_t(std::pair(src.rows(), src.cols()), std::move(offsets), std::move(indices), std::move(values)));
+    }
+}
+
+template<class Sparse>
+inline std::experimental::la::matrix<typename std::experimental::la::sparse_traits<Sparse>::dense_rep_t> std::experimental::la::to_dense(matrix<sparse_traits<Sparse>> const& mat)
+{
+    auto const& src = mat.data();
+    auto res = matrix<typename sparse_traits<Sparse>::dense_rep_t>(std::pair(src.rows(), src.cols()));
+    std::fill(res.data().begin(), res.data().end(), typename Sparse::scalar_t(0));
+    for (auto k = size_t(0); k < src.outer_size(); ++k)
+    {
+        for (auto n = src.offsets()[k]; n < src.offsets()[k + 1]; ++n)
+        {
+            auto const inner = size_t(src.indices()[n]);
+            if constexpr (Sparse::row_compressed) res(k, inner) = src.values()[n];
+            else res(inner, k) = src.values()[n];
+        }
+    }
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// sparse kernels implementation
+////////////////////////////////////////////////////////
+template<class Sparse, class Scalar>
+inline void std::experimental::la::detail::spmm_rows(Sparse const& a, Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, size_t nrhs, Scalar* c, ptrdiff_t rsc, size_t r0, size_t r1) noexcept
+{
+    auto const* offsets = a.offsets().data();
+    auto const* indices = a.indices().data();
+    auto const* values = a.values().data();
+    for (auto i = r0; i < r1; ++i)
+    {
+        auto* out = c + ptrdiff_t(i) * rsc;
+        if (nrhs == 1)
+        {
+            // A dot product per row; the accumulator stays in a register
+            auto sum = Scalar(0);
+            for (auto n = offsets[i]; n < offsets[i + 1]; ++n) sum += values[n] * b[ptrdiff_t(indices[n]) * rsb];
+            out[0] = sum;
+            continue;
+        }
+        for (auto n = offsets[i]; n < offsets[i + 1]; ++n)
+        {
+            auto const v = values[n];
+            auto const* in = b + ptrdiff_t(indices[n]) * rsb;
+            for (auto j = size_t(0); j < nrhs; ++j) out[j] += v * in[ptrdiff_t(j) * csb];
+        }
+    }
+}
+
+template<class Sparse, class Scalar>
+inline void std::experimental::la::detail::spmm_columns(Sparse const& a, Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb, Scalar* c, ptrdiff_t rsc, size_t c0, size_t c1) noexcept
+{
+    auto const* offsets = a.offsets().data();
+    auto const* indices = a.indices().data();
+    auto const* values = a.values().data();
+    for (auto k = size_t(0); k < a.cols(); ++k)
+    {
+        auto const* in = b + ptrdiff_t(k) * rsb;
+        for (auto n = offsets[k]; n < offsets[k + 1]; ++n)
+        {
+            auto const v = values[n];
+            auto* out = c + ptrdiff_t(indices[n]) * rsc;
+            for (auto j = c0; j < c1; ++j) out[j] += v * in[ptrdiff_t(j) * csb];
+        }
+    }
+}
+
+#endif
@@ -2,32 +2,69 @@
 #define MATRIX_STORAGE_2018_08_24_12_32_44
 
 #include <initializer_list>
+#include <iterator>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cassert>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#include "matrix_allocator.h"
+#include "matrix_instrument.h"
+
+#if defined __cpp_lib_memory_resource
+#define _LA_MEMORY_RESOURCE 1
+#endif
 
 namespace std::experimental::la {
     struct fixed_size_matrix_t{};
     struct dynamic_size_matrix_t{};
+    struct matrix_view_t{};
+    struct mmap_matrix_t{};
     template<class T>
     using is_fixed_size = typename enable_if<std::is_base_of<fixed_size_matrix_t, T>::value>::type;
     template<class T>
     using is_dynamic_size = typename enable_if<std::is_base_of<dynamic_size_matrix_t, T>::value>::type;
+    template<class T>
+    using is_matrix_view = typename enable_if<std::is_base_of<matrix_view_t, T>::value>::type;
     
-    template<class Scalar, size_t RowCount, size_t ColCount>
+    // Element order of an owning storage. Row-major keeps each row contiguous, as C arrays
+    // and image buffers do; column-major keeps each column contiguous, as Fortran and
+    // LAPACK do, so such data can be adopted and handed back without a transposing copy.
+    // Initializer lists and begin()/end() run in storage order.
+    struct row_major
+    {
+        static constexpr size_t index(size_t i, size_t j, size_t rows, size_t cols) noexcept;
+    };
+    struct column_major
+    {
+        static constexpr size_t index(size_t i, size_t j, size_t rows, size_t cols) noexcept;
+    };
+    
+    template<class Scalar, size_t RowCount, size_t ColCount, class Layout = row_major>
     struct fixed_size_matrix : public fixed_size_matrix_t
     {
         using scalar_t = Scalar;
-        using matrix_t = fixed_size_matrix<Scalar, RowCount, ColCount>;
+        using layout_t = Layout;
+        using matrix_t = fixed_size_matrix<Scalar, RowCount, ColCount, Layout>;
         template<class Other>
-        using multiply_t = fixed_size_matrix<Scalar, RowCount, Other::col>;
-        using transpose_t = fixed_size_matrix<Scalar, ColCount, RowCount>;
-        using submatrix_t = fixed_size_matrix<Scalar, RowCount - 1, ColCount - 1>;
+        using multiply_t = fixed_size_matrix<Scalar, RowCount, Other::col, Layout>;
+        using transpose_t = fixed_size_matrix<Scalar, ColCount, RowCount, Layout>;
+        using submatrix_t = fixed_size_matrix<Scalar, RowCount - 1, ColCount - 1, Layout>;
         
         constexpr static size_t row = RowCount;
         constexpr static size_t col = ColCount;
         
         constexpr fixed_size_matrix() = default;
         constexpr fixed_size_matrix(std::initializer_list<Scalar>) noexcept;            // Pass by value or rref?
+        constexpr fixed_size_matrix(std::pair<size_t, size_t>) noexcept;                 // Uniform construction with dynamic_size_matrix
         constexpr Scalar operator()(size_t, size_t) const;
         constexpr Scalar& operator()(size_t, size_t);
+        constexpr size_t rows() const noexcept;
+        constexpr size_t cols() const noexcept;
         
         constexpr Scalar* begin() noexcept;
         constexpr const Scalar* cbegin() const noexcept;
@@ -37,74 +74,303 @@ namespace std::experimental::la {
         Scalar _Data[RowCount * ColCount];
     };
     
-    template<class Scalar, class Alloc = std::allocator<Scalar>>
+    // Allocator-aware: storage is obtained through allocator_traits<Alloc>, and the allocator
+    // is propagated on copy, move and swap as the standard containers do. Results of matrix
+    // operations are allocated with the allocator of their left operand.
+    //
+    // Resizable: like std::vector, the buffer may hold more elements than the shape uses.
+    // reserve() sets aside room up front; resize(), reshape() and the append functions
+    // reuse the buffer while the new shape fits its capacity and otherwise grow it
+    // geometrically, so a matrix built up one row (or column) at a time reallocates
+    // O(log n) times. Appending along the contiguous dimension, rows for row_major and
+    // columns for column_major, copies only the new elements; appending across it has to
+    // move the existing elements apart, although still within the same buffer.
+    template<class Scalar, class Alloc = std::allocator<Scalar>, class Layout = row_major>
     struct dynamic_size_matrix : public dynamic_size_matrix_t
     {
         using scalar_t = Scalar;
-        using matrix_t = dynamic_size_matrix<Scalar, Alloc>;
+        using layout_t = Layout;
+        using matrix_t = dynamic_size_matrix<Scalar, Alloc, Layout>;
         template<class Other>
-        using multiply_t = dynamic_size_matrix<Scalar, Alloc>;
-        using transpose_t = dynamic_size_matrix<Scalar, Alloc>;
-        using submatrix_t = dynamic_size_matrix<Scalar, Alloc>;
+        using multiply_t = dynamic_size_matrix<Scalar, Alloc, Layout>;
+        using transpose_t = dynamic_size_matrix<Scalar, Alloc, Layout>;
+        using submatrix_t = dynamic_size_matrix<Scalar, Alloc, Layout>;
+        using allocator_type = Alloc;
+        using alloc_traits = std::allocator_traits<Alloc>;
+        static_assert(std::is_same_v<typename alloc_traits::value_type, Scalar>);
+        static_assert(std::is_same_v<typename alloc_traits::pointer, Scalar*>);
         
         constexpr dynamic_size_matrix() = default;
+        constexpr explicit dynamic_size_matrix(Alloc const&) noexcept;
         constexpr dynamic_size_matrix(dynamic_size_matrix const&);
-        constexpr dynamic_size_matrix(std::pair<size_t, size_t>);
+        constexpr dynamic_size_matrix(dynamic_size_matrix const&, Alloc const&);
+        constexpr dynamic_size_matrix(dynamic_size_matrix&&) noexcept;
+        constexpr dynamic_size_matrix(dynamic_size_matrix&&, Alloc const&);
+        constexpr dynamic_size_matrix(std::pair<size_t, size_t>, Alloc const& = Alloc());
+        ~dynamic_size_matrix();
+        constexpr dynamic_size_matrix& operator=(dynamic_size_matrix const&);
+        constexpr dynamic_size_matrix& operator=(dynamic_size_matrix&&) noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value);
+        constexpr void swap(dynamic_size_matrix&) noexcept;
+        constexpr allocator_type get_allocator() const noexcept;
         constexpr Scalar operator()(size_t, size_t) const;
         constexpr Scalar& operator()(size_t, size_t);
+        constexpr size_t rows() const noexcept;
+        constexpr size_t cols() const noexcept;
+        
+        // Resizing
+        constexpr size_t capacity() const noexcept;                 // Elements the buffer holds
+        constexpr void reserve(size_t);                             // Never shrinks
+        constexpr void shrink_to_fit();
+        constexpr void resize(size_t rows, size_t cols);            // Keeps element (i, j) where both shapes have it; new elements are value-initialised
+        constexpr void reshape(size_t rows, size_t cols);           // Keeps the elements in storage order; new elements are unspecified
+        constexpr void append_row(std::initializer_list<Scalar>);   // cols() values, or any number for a matrix with no rows
+        template<class FwdIt>
+        constexpr void append_row(FwdIt first, FwdIt last);
+        constexpr void append_col(std::initializer_list<Scalar>);   // rows() values, or any number for a matrix with no columns
+        template<class FwdIt>
+        constexpr void append_col(FwdIt first, FwdIt last);
+        
+        constexpr Scalar* begin() noexcept;
+        constexpr const Scalar* cbegin() const noexcept;
+        constexpr Scalar* end() noexcept;
+        constexpr const Scalar* cend() const noexcept;
         
+        Alloc _Alloc = Alloc();
+        size_t _RowCount = 0;
+        size_t _ColCount = 0;
+        size_t _Capacity = 0;               // Elements allocated at _Data, at least _RowCount * _ColCount
+        Scalar* _Data = nullptr;
+        
+    private:
+        constexpr Scalar* allocate(size_t);
+        constexpr void deallocate() noexcept;
+        constexpr void reallocate(size_t);
+        constexpr void relayout(Scalar* to, size_t rows, size_t cols);
+    };
+
+    // A dynamic_size_matrix that keeps up to InlineCapacity elements in the object itself
+    // and only goes to the allocator for larger shapes, so small runtime-sized matrices
+    // never touch the heap. The elements are inline exactly when they fit, so a matrix
+    // shrinking to fit gives its heap buffer back. Moving an inline matrix copies its
+    // elements and cannot steal them, so begin() is not preserved as it is for heap storage.
+    template<class Scalar, size_t InlineCapacity = 64, class Alloc = std::allocator<Scalar>, class Layout = row_major>
+    struct small_dynamic_matrix : public dynamic_size_matrix_t
+    {
+        static_assert(InlineCapacity > 0);
+
+        using scalar_t = Scalar;
+        using layout_t = Layout;
+        using matrix_t = small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>;
+        template<class Other>
+        using multiply_t = small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>;
+        using transpose_t = small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>;
+        using submatrix_t = small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>;
+        using allocator_type = Alloc;
+        using alloc_traits = std::allocator_traits<Alloc>;
+        static_assert(std::is_same_v<typename alloc_traits::value_type, Scalar>);
+        static_assert(std::is_same_v<typename alloc_traits::pointer, Scalar*>);
+
+        static constexpr size_t inline_capacity = InlineCapacity;
+
+        constexpr small_dynamic_matrix() = default;
+        constexpr explicit small_dynamic_matrix(Alloc const&) noexcept;
+        constexpr small_dynamic_matrix(small_dynamic_matrix const&);
+        constexpr small_dynamic_matrix(small_dynamic_matrix const&, Alloc const&);
+        constexpr small_dynamic_matrix(small_dynamic_matrix&&) noexcept(std::is_nothrow_move_assignable_v<Scalar>);
+        constexpr small_dynamic_matrix(small_dynamic_matrix&&, Alloc const&);
+        constexpr small_dynamic_matrix(std::pair<size_t, size_t>, Alloc const& = Alloc());
+        ~small_dynamic_matrix();
+        constexpr small_dynamic_matrix& operator=(small_dynamic_matrix const&);
+        constexpr small_dynamic_matrix& operator=(small_dynamic_matrix&&) noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value);
+        constexpr void swap(small_dynamic_matrix&) noexcept;
+        constexpr allocator_type get_allocator() const noexcept;
+        constexpr Scalar operator()(size_t, size_t) const;
+        constexpr Scalar& operator()(size_t, size_t);
+        constexpr size_t rows() const noexcept;
+        constexpr size_t cols() const noexcept;
+        constexpr bool is_inline() const noexcept;
+
         constexpr Scalar* begin() noexcept;
         constexpr const Scalar* cbegin() const noexcept;
         constexpr Scalar* end() noexcept;
         constexpr const Scalar* cend() const noexcept;
+
+        Alloc _Alloc = Alloc();
+        size_t _RowCount = 0;
+        size_t _ColCount = 0;
+        Scalar* _Data = _Inline;            // _Inline, or a heap buffer when there are more than InlineCapacity elements
+        Scalar _Inline[InlineCapacity];
+
+    private:
+        constexpr Scalar* allocate(size_t);
+        constexpr void deallocate() noexcept;
+        constexpr void take(small_dynamic_matrix& rhs) noexcept(std::is_nothrow_move_assignable_v<Scalar>);
+    };
+
+    // Non-owning window onto the elements of another storage, in the manner of mdspan:
+    // element (i, j) is at data + i * row_stride + j * col_stride. Copies are shallow and
+    // the viewed elements must outlive the view. Scalar is const for a read-only view.
+    template<class Scalar>
+    struct matrix_view : public matrix_view_t
+    {
+        using scalar_t = std::remove_const_t<Scalar>;
+        using element_t = Scalar;
+        using matrix_t = matrix_view<Scalar>;
+        using owning_t = dynamic_size_matrix<scalar_t>;          // Results that need storage of their own
+        template<class Other>
+        using multiply_t = owning_t;
+        using transpose_t = matrix_view<Scalar>;
+        using submatrix_t = owning_t;
+        
+        constexpr matrix_view() = default;
+        constexpr matrix_view(Scalar* data, size_t rows, size_t cols, ptrdiff_t row_stride, ptrdiff_t col_stride) noexcept;
+        template<class Other, class = std::enable_if_t<std::is_const_v<Scalar> && std::is_same_v<Other const, Scalar>>>
+        constexpr matrix_view(matrix_view<Other> const&) noexcept;        // Read-only from mutable
+        constexpr Scalar& operator()(size_t, size_t) const;
+        constexpr size_t rows() const noexcept;
+        constexpr size_t cols() const noexcept;
+        constexpr ptrdiff_t row_stride() const noexcept;
+        constexpr ptrdiff_t col_stride() const noexcept;
+        constexpr Scalar* data() const noexcept;
+        constexpr bool is_contiguous() const noexcept;                    // Rows packed end to end, as in an owning storage
         
+        constexpr matrix_view transposed() const noexcept;
+        constexpr matrix_view block(size_t i, size_t j, size_t rows, size_t cols) const noexcept;
+        
+        Scalar* _Data = nullptr;
         size_t _RowCount = 0;
         size_t _ColCount = 0;
-        std::unique_ptr<Scalar[]> _Data = nullptr;
+        ptrdiff_t _RowStride = 0;
+        ptrdiff_t _ColStride = 0;
     };
+
+    namespace detail {
+        template<class Storage, class = void>
+        inline constexpr bool is_allocator_aware_v = false;
+
+        template<class Storage>
+        inline constexpr bool is_allocator_aware_v<Storage, std::void_t<typename Storage::allocator_type>> = true;
+
+        // New storage of the given shape, using the allocator of like when they share an allocator type
+        template<class Result, class Like>
+        constexpr Result make_storage(Like const& like, std::pair<size_t, size_t> size);
+
+        // Copy that keeps the allocator of the source, for working copies made inside operations
+        template<class Storage>
+        constexpr Storage copy_storage(Storage const& src);
+
+        // Layout of a storage; storages that do not name one are row-major
+        template<class Storage, class = void>
+        struct storage_layout
+        {
+            using type = row_major;
+        };
+
+        template<class Storage>
+        struct storage_layout<Storage, std::void_t<typename Storage::layout_t>>
+        {
+            using type = typename Storage::layout_t;
+        };
+
+        template<class Storage>
+        inline constexpr bool is_column_major_v = std::is_same_v<typename storage_layout<std::remove_const_t<Storage>>::type, column_major>;
+
+        // Any storage as a view: owning storages are viewed whole, views are returned as they are
+        // A const storage gives a read-only view
+        template<class Storage>
+        constexpr auto as_view(Storage& s) noexcept;
+    }
+
+    template<class Scalar, size_t Alignment = 64>
+    using aligned_dynamic_size_matrix = dynamic_size_matrix<Scalar, aligned_allocator<Scalar, Alignment>>;
+
+#if defined _LA_MEMORY_RESOURCE
+    namespace pmr {
+        template<class Scalar>
+        using dynamic_size_matrix = la::dynamic_size_matrix<Scalar, std::pmr::polymorphic_allocator<Scalar>>;
+        template<class Scalar, size_t InlineCapacity = 64>
+        using small_dynamic_matrix = la::small_dynamic_matrix<Scalar, InlineCapacity, std::pmr::polymorphic_allocator<Scalar>>;
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////
+// layout implementation
+////////////////////////////////////////////////////////
+inline constexpr size_t std::experimental::la::row_major::index(size_t i, size_t j, size_t, size_t cols) noexcept
+{
+    return i * cols + j;
+}
+
+inline constexpr size_t std::experimental::la::column_major::index(size_t i, size_t j, size_t rows, size_t) noexcept
+{
+    return j * rows + i;
 }
 
 ////////////////////////////////////////////////////////
 // fixed_size_matrix implementation
 ////////////////////////////////////////////////////////
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::fixed_size_matrix(std::initializer_list<Scalar> il) noexcept
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::fixed_size_matrix(std::initializer_list<Scalar> il) noexcept
+    : _Data{}
+{
+    // A plain loop rather than std::copy, so construction is a constant expression in C++17
+    assert(il.size() <= RowCount * ColCount);
+    auto out = size_t(0);
+    for (auto const& el : il) _Data[out++] = el;
+}
+
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::fixed_size_matrix([[maybe_unused]] std::pair<size_t, size_t> size) noexcept
+    : _Data{}
+{
+    assert(size.first == RowCount && size.second == ColCount);
+}
+
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr Scalar std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::operator()(size_t i, size_t j) const
 {
-    std::copy(il.begin(), il.end(), _Data);
+    return _Data[Layout::index(i, j, RowCount, ColCount)];
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr Scalar std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::operator()(size_t i, size_t j) const
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr Scalar& std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::operator()(size_t i, size_t j)
 {
-    return _Data[i * RowCount + j];
+    return _Data[Layout::index(i, j, RowCount, ColCount)];
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr Scalar& std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::operator()(size_t i, size_t j)
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr size_t std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::rows() const noexcept
 {
-    return _Data[i * RowCount + j];
+    return RowCount;
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::begin() noexcept
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr size_t std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::cols() const noexcept
+{
+    return ColCount;
+}
+
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::begin() noexcept
 {
     return _Data;
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr const Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::cbegin() const noexcept
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr const Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::cbegin() const noexcept
 {
     return _Data;
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::end() noexcept
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::end() noexcept
 {
     return _Data + RowCount * ColCount;
 }
 
-template<class Scalar, size_t RowCount, size_t ColCount>
-inline constexpr const Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount>::cend() const noexcept
+template<class Scalar, size_t RowCount, size_t ColCount, class Layout>
+inline constexpr const Scalar* std::experimental::la::fixed_size_matrix<Scalar, RowCount, ColCount, Layout>::cend() const noexcept
 {
     return _Data + RowCount * ColCount;
 }
@@ -112,60 +378,670 @@ inline constexpr const Scalar* std::experimental::la::fixed_size_matrix<Scalar,
 ////////////////////////////////////////////////////////
 // dynamic_size_matrix implementation
 ////////////////////////////////////////////////////////
-template<class Scalar, class Alloc>
-inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::dynamic_size_matrix(dynamic_size_matrix const& rhs)
-    : _RowCount(rhs._RowCount)
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(Alloc const& alloc) noexcept
+    : _Alloc(alloc)
+{}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(dynamic_size_matrix const& rhs)
+    : dynamic_size_matrix(rhs, alloc_traits::select_on_container_copy_construction(rhs._Alloc))
+{}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(dynamic_size_matrix const& rhs, Alloc const& alloc)
+    : _Alloc(alloc)
+    , _RowCount(rhs._RowCount)
     , _ColCount(rhs._ColCount)
-    , _Data(new Scalar[_RowCount * _ColCount])
+    , _Capacity(_RowCount * _ColCount)
+    , _Data(allocate(_Capacity))
 {
     if (rhs._Data)
     {
-        std::copy(rhs._Data.get(), rhs._Data.get() + _RowCount * _ColCount, _Data.get());
+        std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
     }
 }
 
-template<class Scalar, class Alloc>
-inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::dynamic_size_matrix(std::pair<size_t, size_t> size)
-    : _RowCount(size.first)
-    , _ColCount(size.first)
-    , _Data(new Scalar[_RowCount * _ColCount])
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(dynamic_size_matrix&& rhs) noexcept
+    : _Alloc(std::move(rhs._Alloc))
+    , _RowCount(std::exchange(rhs._RowCount, 0))
+    , _ColCount(std::exchange(rhs._ColCount, 0))
+    , _Capacity(std::exchange(rhs._Capacity, 0))
+    , _Data(std::exchange(rhs._Data, nullptr))
+{}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(dynamic_size_matrix&& rhs, Alloc const& alloc)
+    : _Alloc(alloc)
 {
+    if (alloc_traits::is_always_equal::value || _Alloc == rhs._Alloc)
+    {
+        _RowCount = std::exchange(rhs._RowCount, 0);
+        _ColCount = std::exchange(rhs._ColCount, 0);
+        _Capacity = std::exchange(rhs._Capacity, 0);
+        _Data = std::exchange(rhs._Data, nullptr);
+    }
+    else
+    {
+        // Memory from another resource cannot be adopted, so the elements are copied
+        _Data = allocate(rhs._RowCount * rhs._ColCount);
+        _Capacity = rhs._RowCount * rhs._ColCount;
+        _RowCount = rhs._RowCount;
+        _ColCount = rhs._ColCount;
+        if (rhs._Data) std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+    }
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::dynamic_size_matrix(std::pair<size_t, size_t> size, Alloc const& alloc)
+    : _Alloc(alloc)
+    , _RowCount(size.first)
+    , _ColCount(size.second)
+    , _Capacity(_RowCount * _ColCount)
+    , _Data(allocate(_Capacity))
+{
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::~dynamic_size_matrix()
+{
+    deallocate();
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>& std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::operator=(dynamic_size_matrix const& rhs)
+{
+    if (this != &rhs)
+    {
+        if constexpr (alloc_traits::propagate_on_container_copy_assignment::value)
+        {
+            if (!alloc_traits::is_always_equal::value && _Alloc != rhs._Alloc) deallocate();
+            _Alloc = rhs._Alloc;
+        }
+        // Reuse the existing buffer when the elements fit
+        if (_Capacity < rhs._RowCount * rhs._ColCount)
+        {
+            deallocate();
+            _Data = allocate(rhs._RowCount * rhs._ColCount);
+            _Capacity = rhs._RowCount * rhs._ColCount;
+        }
+        _RowCount = rhs._RowCount;
+        _ColCount = rhs._ColCount;
+        if (rhs._Data)
+        {
+            std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+        }
+    }
+    return *this;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>& std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::operator=(dynamic_size_matrix&& rhs)
+    noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value)
+{
+    if (this != &rhs)
+    {
+        if constexpr (!alloc_traits::propagate_on_container_move_assignment::value && !alloc_traits::is_always_equal::value)
+        {
+            // Without propagation, memory owned by a different allocator has to be copied
+            if (_Alloc != rhs._Alloc) return *this = static_cast<dynamic_size_matrix const&>(rhs);
+        }
+        deallocate();
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value) _Alloc = std::move(rhs._Alloc);
+        _RowCount = std::exchange(rhs._RowCount, 0);
+        _ColCount = std::exchange(rhs._ColCount, 0);
+        _Capacity = std::exchange(rhs._Capacity, 0);
+        _Data = std::exchange(rhs._Data, nullptr);
+    }
+    return *this;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::swap(dynamic_size_matrix& rhs) noexcept
+{
+    using std::swap;
+    if constexpr (alloc_traits::propagate_on_container_swap::value) swap(_Alloc, rhs._Alloc);
+    else assert(alloc_traits::is_always_equal::value || _Alloc == rhs._Alloc);
+    swap(_RowCount, rhs._RowCount);
+    swap(_ColCount, rhs._ColCount);
+    swap(_Capacity, rhs._Capacity);
+    swap(_Data, rhs._Data);
 }
 
-template<class Scalar, class Alloc>
-inline constexpr Scalar std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::operator()(size_t i, size_t j) const
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Alloc std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::get_allocator() const noexcept
 {
-    return _Data.get()[i * _RowCount + j];
+    return _Alloc;
 }
 
-template<class Scalar, class Alloc>
-inline constexpr Scalar& std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::operator()(size_t i, size_t j)
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::allocate(size_t n)
 {
-    return _Data.get()[i * _RowCount + j];
+    if (n == 0) return nullptr;
+    auto* p = alloc_traits::allocate(_Alloc, n);
+    _LA_RECORD_ALLOCATION(n * sizeof(Scalar));
+    // Arithmetic elements are left uninitialised, as new Scalar[] did
+    if constexpr (!std::is_trivially_default_constructible_v<Scalar>)
+    {
+        for (auto i = size_t(0); i < n; ++i) alloc_traits::construct(_Alloc, p + i);
+    }
+    return p;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::deallocate() noexcept
+{
+    if (!_Data) return;
+    if constexpr (!std::is_trivially_destructible_v<Scalar>)
+    {
+        for (auto i = size_t(0); i < _Capacity; ++i) alloc_traits::destroy(_Alloc, _Data + i);
+    }
+    alloc_traits::deallocate(_Alloc, _Data, _Capacity);
+    _Data = nullptr;
+    _Capacity = 0;
 }
 
-template<class Scalar, class Alloc>
-inline constexpr Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::begin() noexcept
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::reallocate(size_t n)
 {
-    return _Data.get();
+    // Moves the elements, in storage order, to a buffer of exactly n
+    assert(n >= _RowCount * _ColCount);
+    auto* to = allocate(n);
+    if (_Data) std::move(_Data, _Data + _RowCount * _ColCount, to);
+    deallocate();
+    _Data = to;
+    _Capacity = n;
 }
 
-template<class Scalar, class Alloc>
-inline constexpr const Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::cbegin() const noexcept
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::relayout(Scalar* to, size_t rows, size_t cols)
 {
-    return _Data.get();
+    // Moves each element to its place in a rows by cols matrix at to, which may be _Data
+    // itself, and value-initialises the elements the old shape did not have. Each row
+    // (each column, for column_major) stays contiguous, so whole runs move at once
+    constexpr auto column = std::is_same_v<Layout, column_major>;
+    auto const lines = column ? cols : rows;
+    auto const stride = column ? rows : cols;
+    auto const old_lines = column ? _ColCount : _RowCount;
+    auto const old_stride = column ? _RowCount : _ColCount;
+    auto const kept_lines = std::min(lines, old_lines);
+    auto const kept = std::min(stride, old_stride);
+    if (to != _Data)
+    {
+        for (auto k = size_t(0); k < kept_lines; ++k) std::move(_Data + k * old_stride, _Data + k * old_stride + kept, to + k * stride);
+    }
+    else if (stride > old_stride)
+    {
+        // Lines spread out, so the last moves first
+        for (auto k = kept_lines; k-- > 0;) std::move_backward(_Data + k * old_stride, _Data + k * old_stride + kept, to + k * stride + kept);
+    }
+    else if (stride < old_stride)
+    {
+        for (auto k = size_t(1); k < kept_lines; ++k) std::move(_Data + k * old_stride, _Data + k * old_stride + kept, to + k * stride);
+    }
+    for (auto k = size_t(0); k < lines; ++k)
+    {
+        auto const from = k < kept_lines ? kept : size_t(0);
+        std::fill(to + k * stride + from, to + (k + 1) * stride, Scalar());
+    }
 }
 
-template<class Scalar, class Alloc>
-inline constexpr Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::end() noexcept
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Scalar std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::operator()(size_t i, size_t j) const
 {
-    return _Data.get() + _RowCount * _ColCount;
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
 }
 
-template<class Scalar, class Alloc>
-inline constexpr const Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc>::cend() const noexcept
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Scalar& std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::operator()(size_t i, size_t j)
 {
-    return _Data.get() + _RowCount * _ColCount;
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr size_t std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::rows() const noexcept
+{
+    return _RowCount;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr size_t std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::cols() const noexcept
+{
+    return _ColCount;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr size_t std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::capacity() const noexcept
+{
+    return _Capacity;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::reserve(size_t n)
+{
+    if (n > _Capacity) reallocate(n);
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::shrink_to_fit()
+{
+    if (_Capacity == _RowCount * _ColCount) return;
+    if (_RowCount * _ColCount == 0) deallocate();
+    else reallocate(_RowCount * _ColCount);
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::resize(size_t rows, size_t cols)
+{
+    if (rows == _RowCount && cols == _ColCount) return;
+    auto const n = rows * cols;
+    if (n <= _Capacity) relayout(_Data, rows, cols);
+    else
+    {
+        // Geometric growth keeps a run of appends amortised O(1) per element
+        auto const capacity = std::max(n, 2 * _Capacity);
+        auto* to = allocate(capacity);
+        relayout(to, rows, cols);
+        deallocate();
+        _Data = to;
+        _Capacity = capacity;
+    }
+    _RowCount = rows;
+    _ColCount = cols;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::reshape(size_t rows, size_t cols)
+{
+    if (rows * cols > _Capacity) reallocate(std::max(rows * cols, 2 * _Capacity));
+    _RowCount = rows;
+    _ColCount = cols;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::append_row(std::initializer_list<Scalar> il)
+{
+    append_row(il.begin(), il.end());
+}
+
+template<class Scalar, class Alloc, class Layout>
+template<class FwdIt>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::append_row(FwdIt first, FwdIt last)
+{
+    auto const n = size_t(std::distance(first, last));
+    assert(_RowCount == 0 || n == _ColCount);
+    auto const i = _RowCount;
+    resize(_RowCount + 1, _RowCount == 0 ? n : _ColCount);
+    for (auto j = size_t(0); j < _ColCount; ++j, ++first) (*this)(i, j) = *first;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::append_col(std::initializer_list<Scalar> il)
+{
+    append_col(il.begin(), il.end());
+}
+
+template<class Scalar, class Alloc, class Layout>
+template<class FwdIt>
+inline constexpr void std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::append_col(FwdIt first, FwdIt last)
+{
+    auto const n = size_t(std::distance(first, last));
+    assert(_ColCount == 0 || n == _RowCount);
+    auto const j = _ColCount;
+    resize(_ColCount == 0 ? n : _RowCount, _ColCount + 1);
+    for (auto i = size_t(0); i < _RowCount; ++i, ++first) (*this)(i, j) = *first;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::begin() noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr const Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::cbegin() const noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::end() noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+template<class Scalar, class Alloc, class Layout>
+inline constexpr const Scalar* std::experimental::la::dynamic_size_matrix<Scalar, Alloc, Layout>::cend() const noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+////////////////////////////////////////////////////////
+// small_dynamic_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(Alloc const& alloc) noexcept
+    : _Alloc(alloc)
+{}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(small_dynamic_matrix const& rhs)
+    : small_dynamic_matrix(rhs, alloc_traits::select_on_container_copy_construction(rhs._Alloc))
+{}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(small_dynamic_matrix const& rhs, Alloc const& alloc)
+    : _Alloc(alloc)
+    , _RowCount(rhs._RowCount)
+    , _ColCount(rhs._ColCount)
+    , _Data(allocate(_RowCount * _ColCount))
+{
+    std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(small_dynamic_matrix&& rhs) noexcept(std::is_nothrow_move_assignable_v<Scalar>)
+    : _Alloc(std::move(rhs._Alloc))
+{
+    take(rhs);
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(small_dynamic_matrix&& rhs, Alloc const& alloc)
+    : _Alloc(alloc)
+{
+    if (alloc_traits::is_always_equal::value || _Alloc == rhs._Alloc || rhs.is_inline()) take(rhs);
+    else
+    {
+        // Memory from another resource cannot be adopted, so the elements are copied
+        _Data = allocate(rhs._RowCount * rhs._ColCount);
+        _RowCount = rhs._RowCount;
+        _ColCount = rhs._ColCount;
+        std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+    }
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::small_dynamic_matrix(std::pair<size_t, size_t> size, Alloc const& alloc)
+    : _Alloc(alloc)
+    , _RowCount(size.first)
+    , _ColCount(size.second)
+    , _Data(allocate(_RowCount * _ColCount))
+{
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::~small_dynamic_matrix()
+{
+    deallocate();
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>& std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::operator=(small_dynamic_matrix const& rhs)
+{
+    if (this != &rhs)
+    {
+        if constexpr (alloc_traits::propagate_on_container_copy_assignment::value)
+        {
+            if (!alloc_traits::is_always_equal::value && _Alloc != rhs._Alloc) deallocate();
+            _Alloc = rhs._Alloc;
+        }
+        // Reuse a heap buffer when the element count matches, and the inline one when the
+        // elements fit; a buffer just released for a different allocator is inline again
+        auto const n = rhs._RowCount * rhs._ColCount;
+        if (is_inline() ? n > InlineCapacity : _RowCount * _ColCount != n)
+        {
+            deallocate();
+            _Data = allocate(n);
+        }
+        _RowCount = rhs._RowCount;
+        _ColCount = rhs._ColCount;
+        std::copy(rhs._Data, rhs._Data + _RowCount * _ColCount, _Data);
+    }
+    return *this;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>& std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::operator=(small_dynamic_matrix&& rhs)
+    noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value)
+{
+    if (this != &rhs)
+    {
+        if constexpr (!alloc_traits::propagate_on_container_move_assignment::value && !alloc_traits::is_always_equal::value)
+        {
+            // Without propagation, memory owned by a different allocator has to be copied
+            if (_Alloc != rhs._Alloc && !rhs.is_inline()) return *this = static_cast<small_dynamic_matrix const&>(rhs);
+        }
+        deallocate();
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value) _Alloc = std::move(rhs._Alloc);
+        take(rhs);
+    }
+    return *this;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr void std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::swap(small_dynamic_matrix& rhs) noexcept
+{
+    using std::swap;
+    if constexpr (alloc_traits::propagate_on_container_swap::value) swap(_Alloc, rhs._Alloc);
+    else assert(alloc_traits::is_always_equal::value || _Alloc == rhs._Alloc);
+    if (is_inline() || rhs.is_inline())
+    {
+        // Inline elements cannot change hands, so they go through a temporary
+        auto tmp = small_dynamic_matrix(_Alloc);
+        tmp.take(*this);
+        take(rhs);
+        rhs.take(tmp);
+        return;
+    }
+    swap(_RowCount, rhs._RowCount);
+    swap(_ColCount, rhs._ColCount);
+    swap(_Data, rhs._Data);
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Alloc std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::get_allocator() const noexcept
+{
+    return _Alloc;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::allocate(size_t n)
+{
+    if (n <= InlineCapacity) return _Inline;
+    auto* p = alloc_traits::allocate(_Alloc, n);
+    _LA_RECORD_ALLOCATION(n * sizeof(Scalar));
+    if constexpr (!std::is_trivially_default_constructible_v<Scalar>)
+    {
+        for (auto i = size_t(0); i < n; ++i) alloc_traits::construct(_Alloc, p + i);
+    }
+    return p;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr void std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::deallocate() noexcept
+{
+    if (is_inline()) return;
+    auto const n = _RowCount * _ColCount;
+    if constexpr (!std::is_trivially_destructible_v<Scalar>)
+    {
+        for (auto i = size_t(0); i < n; ++i) alloc_traits::destroy(_Alloc, _Data + i);
+    }
+    alloc_traits::deallocate(_Alloc, _Data, n);
+    _Data = _Inline;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr void std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::take(small_dynamic_matrix& rhs) noexcept(std::is_nothrow_move_assignable_v<Scalar>)
+{
+    // Expects this to be inline; leaves rhs empty, as a moved-from dynamic_size_matrix is
+    auto const n = rhs._RowCount * rhs._ColCount;
+    if (rhs.is_inline()) std::move(rhs._Inline, rhs._Inline + n, _Inline);
+    else _Data = std::exchange(rhs._Data, rhs._Inline);
+    _RowCount = std::exchange(rhs._RowCount, 0);
+    _ColCount = std::exchange(rhs._ColCount, 0);
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Scalar std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::operator()(size_t i, size_t j) const
+{
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Scalar& std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::operator()(size_t i, size_t j)
+{
+    return _Data[Layout::index(i, j, _RowCount, _ColCount)];
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr size_t std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::rows() const noexcept
+{
+    return _RowCount;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr size_t std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::cols() const noexcept
+{
+    return _ColCount;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr bool std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::is_inline() const noexcept
+{
+    return _Data == _Inline;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::begin() noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr const Scalar* std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::cbegin() const noexcept
+{
+    return _Data;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr Scalar* std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::end() noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+template<class Scalar, size_t InlineCapacity, class Alloc, class Layout>
+inline constexpr const Scalar* std::experimental::la::small_dynamic_matrix<Scalar, InlineCapacity, Alloc, Layout>::cend() const noexcept
+{
+    return _Data + _RowCount * _ColCount;
+}
+
+////////////////////////////////////////////////////////
+// matrix_view implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline constexpr std::experimental::la::matrix_view<Scalar>::matrix_view(Scalar* data, size_t rows, size_t cols, ptrdiff_t row_stride, ptrdiff_t col_stride) noexcept
+    : _Data(data)
+    , _RowCount(rows)
+    , _ColCount(cols)
+    , _RowStride(row_stride)
+    , _ColStride(col_stride)
+{}
+
+template<class Scalar>
+template<class Other, class>
+inline constexpr std::experimental::la::matrix_view<Scalar>::matrix_view(matrix_view<Other> const& rhs) noexcept
+    : matrix_view(rhs._Data, rhs._RowCount, rhs._ColCount, rhs._RowStride, rhs._ColStride)
+{}
+
+template<class Scalar>
+inline constexpr Scalar& std::experimental::la::matrix_view<Scalar>::operator()(size_t i, size_t j) const
+{
+    return _Data[ptrdiff_t(i) * _RowStride + ptrdiff_t(j) * _ColStride];
+}
+
+template<class Scalar>
+inline constexpr size_t std::experimental::la::matrix_view<Scalar>::rows() const noexcept
+{
+    return _RowCount;
+}
+
+template<class Scalar>
+inline constexpr size_t std::experimental::la::matrix_view<Scalar>::cols() const noexcept
+{
+    return _ColCount;
+}
+
+template<class Scalar>
+inline constexpr ptrdiff_t std::experimental::la::matrix_view<Scalar>::row_stride() const noexcept
+{
+    return _RowStride;
+}
+
+template<class Scalar>
+inline constexpr ptrdiff_t std::experimental::la::matrix_view<Scalar>::col_stride() const noexcept
+{
+    return _ColStride;
+}
+
+template<class Scalar>
+inline constexpr Scalar* std::experimental::la::matrix_view<Scalar>::data() const noexcept
+{
+    return _Data;
+}
+
+template<class Scalar>
+inline constexpr bool std::experimental::la::matrix_view<Scalar>::is_contiguous() const noexcept
+{
+    return (_ColStride == 1 || _ColCount <= 1) && (_RowStride == ptrdiff_t(_ColCount) || _RowCount <= 1);
+}
+
+template<class Scalar>
+inline constexpr std::experimental::la::matrix_view<Scalar> std::experimental::la::matrix_view<Scalar>::transposed() const noexcept
+{
+    return matrix_view(_Data, _ColCount, _RowCount, _ColStride, _RowStride);
+}
+
+template<class Scalar>
+inline constexpr std::experimental::la::matrix_view<Scalar> std::experimental::la::matrix_view<Scalar>::block(size_t i, size_t j, size_t rows, size_t cols) const noexcept
+{
+    assert(i + rows <= _RowCount && j + cols <= _ColCount);
+    return matrix_view(_Data + ptrdiff_t(i) * _RowStride + ptrdiff_t(j) * _ColStride, rows, cols, _RowStride, _ColStride);
+}
+
+////////////////////////////////////////////////////////
+// make_storage implementation
+////////////////////////////////////////////////////////
+template<class Result, class Like>
+inline constexpr Result std::experimental::la::detail::make_storage([[maybe_unused]] Like const& like, std::pair<size_t, size_t> size)
+{
+    if constexpr (is_allocator_aware_v<Result> && is_allocator_aware_v<Like>)
+    {
+        if constexpr (std::is_same_v<typename Result::allocator_type, typename Like::allocator_type>) return Result(size, like.get_allocator());
+        else return Result(size);
+    }
+    else return Result(size);
+}
+
+template<class Storage>
+inline constexpr Storage std::experimental::la::detail::copy_storage(Storage const& src)
+{
+    if constexpr (is_allocator_aware_v<Storage>) return Storage(src, src.get_allocator());
+    else return src;
+}
+
+template<class Storage>
+inline constexpr auto std::experimental::la::detail::as_view(Storage& s) noexcept
+{
+    if constexpr (std::is_base_of_v<matrix_view_t, std::remove_const_t<Storage>>) return s;
+    else
+    {
+        using element_t = std::conditional_t<std::is_const_v<Storage>, typename Storage::scalar_t const, typename Storage::scalar_t>;
+        auto* data = const_cast<element_t*>(s.cbegin());
+        if constexpr (is_column_major_v<Storage>) return matrix_view<element_t>(data, s.rows(), s.cols(), 1, ptrdiff_t(s.rows()));
+        else return matrix_view<element_t>(data, s.rows(), s.cols(), ptrdiff_t(s.cols()), 1);
+    }
 }
 
 #endif //MATRIX_STORAGE_2018_08_24_12_32_44
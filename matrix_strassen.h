@@ -0,0 +1,251 @@
+#if !defined MATRIX_STRASSEN_26_10_18_23_17_40
+#define MATRIX_STRASSEN_26_10_18_23_17_40
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "matrix_allocator.h"
+#include "matrix_gemm.h"
+#include "matrix_instrument.h"
+#include "matrix_thread_pool.h"
+
+/*
+Strassen-Winograd multiplication for large dense products.
+
+Each level of the recursion splits A, B and C into quadrants and forms C from 7 half-size
+products and 15 quadrant additions, against the 8 products of the conventional method, so
+a product of order n costs about n^log2(7) = n^2.81 multiply-adds. The recursion stops
+once a dimension is at most strassen_cutoff(), where the blocked engine of matrix_gemm.h
+takes over; at the default cutoff of 512 a product of order 8192 runs 4 levels, doing
+(7/8)^4 = 0.59 of the conventional arithmetic. Odd dimensions are peeled: the even part
+goes through the recursion and the last row, column or rank-1 term through gemm.
+
+The quadrant sums and products are scheduled as in Boyer, Dumas, Pernet and Zhou, 2009,
+with two temporaries per level, one of m/2 x max(k/2, n/2) elements and one of k/2 x n/2,
+and the quadrants of C holding the remaining intermediate products. The temporaries of
+all levels are carved from one buffer allocated at the top, about two thirds of the size
+of C for square operands, so the recursion itself does not allocate.
+
+Accuracy. The bound is normwise rather than componentwise. With unit roundoff u, l levels
+of recursion and the conventional product on blocks of order n0 = n / 2^l,
+
+    max |C - fl(C)| <= [(n0^2 + 6 n0) 18^l - 6n] u max |A| max |B| + O(u^2)
+
+(Higham, Accuracy and Stability of Numerical Algorithms, 2nd ed., section 23.2), against
+n u |A| |B| elementwise for the conventional product. Each level multiplies the constant by
+about 4.5. Elements of C that are much smaller than the largest products of A and B may
+lose all their relative accuracy, so badly scaled operands should be equilibrated first.
+
+Products use the recursion when called through strassen_multiply, or through operator*
+and multiply once every dimension reaches strassen_threshold(). The threshold defaults to
+the largest size_t, which turns the heuristic off; callers who accept the error bound
+above opt in with set_strassen_threshold. Both settings are shared by all threads.
+*/
+
+namespace std::experimental::la {
+    // Order at or below which the recursion hands over to the blocked engine
+    size_t strassen_cutoff() noexcept;
+    void set_strassen_cutoff(size_t n) noexcept;
+    // Smallest dimension at which operator* and multiply switch to the recursion
+    size_t strassen_threshold() noexcept;
+    void set_strassen_threshold(size_t n) noexcept;
+
+    namespace detail {
+        struct strassen_settings
+        {
+            std::atomic<size_t> _Cutoff{ 512 };
+            std::atomic<size_t> _Threshold{ std::numeric_limits<size_t>::max() };
+        };
+        strassen_settings& strassen_state() noexcept;
+
+        // Whether strassen_threshold() selects the recursion for an m x k by k x n product
+        bool prefers_strassen(size_t m, size_t n, size_t k) noexcept;
+
+        // Elements of workspace the recursion needs for an m x k by k x n product
+        size_t strassen_workspace_size(size_t m, size_t n, size_t k, size_t cutoff) noexcept;
+
+        // C = A B with C overwritten, all three given by pointer and strides
+        template<class Scalar>
+        void strassen_gemm(thread_pool* pool, size_t m, size_t n, size_t k,
+            Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+            Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+            Scalar* c, ptrdiff_t rsc, ptrdiff_t csc);
+
+        template<class Scalar>
+        void strassen_recurse(thread_pool* pool, size_t cutoff, size_t m, size_t n, size_t k,
+            Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+            Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+            Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, Scalar* workspace);
+
+        // Z = X + sign * Y over rows x cols; Z may be X or Y
+        template<class Scalar>
+        void strassen_combine(thread_pool* pool, size_t rows, size_t cols,
+            Scalar const* x, ptrdiff_t rsx, ptrdiff_t csx, Scalar sign,
+            Scalar const* y, ptrdiff_t rsy, ptrdiff_t csy,
+            Scalar* z, ptrdiff_t rsz, ptrdiff_t csz);
+    }
+}
+
+////////////////////////////////////////////////////////
+// settings implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::detail::strassen_settings& std::experimental::la::detail::strassen_state() noexcept
+{
+    static strassen_settings settings;
+    return settings;
+}
+
+inline size_t std::experimental::la::strassen_cutoff() noexcept
+{
+    return detail::strassen_state()._Cutoff.load(std::memory_order_relaxed);
+}
+
+inline void std::experimental::la::set_strassen_cutoff(size_t n) noexcept
+{
+    // Below order 2 the quadrants would be empty
+    detail::strassen_state()._Cutoff.store(std::max(n, size_t(1)), std::memory_order_relaxed);
+}
+
+inline size_t std::experimental::la::strassen_threshold() noexcept
+{
+    return detail::strassen_state()._Threshold.load(std::memory_order_relaxed);
+}
+
+inline void std::experimental::la::set_strassen_threshold(size_t n) noexcept
+{
+    detail::strassen_state()._Threshold.store(n, std::memory_order_relaxed);
+}
+
+inline bool std::experimental::la::detail::prefers_strassen(size_t m, size_t n, size_t k) noexcept
+{
+    auto const smallest = std::min({ m, n, k });
+    return smallest >= strassen_threshold() && smallest > strassen_cutoff();
+}
+
+////////////////////////////////////////////////////////
+// strassen implementation
+////////////////////////////////////////////////////////
+inline size_t std::experimental::la::detail::strassen_workspace_size(size_t m, size_t n, size_t k, size_t cutoff) noexcept
+{
+    auto size = size_t(0);
+    while (std::min({ m, n, k }) > cutoff)
+    {
+        m /= 2;
+        n /= 2;
+        k /= 2;
+        size += m * std::max(k, n) + k * n;
+    }
+    return size;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::strassen_gemm(thread_pool* pool, size_t m, size_t n, size_t k,
+    Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    auto const cutoff = strassen_cutoff();
+    auto const size = strassen_workspace_size(m, n, k, cutoff);
+    auto workspace = std::vector<Scalar, aligned_allocator<Scalar>>(size);
+    if (size > 0) _LA_RECORD_ALLOCATION(size * sizeof(Scalar));
+    strassen_recurse(pool, cutoff, m, n, k, a, rsa, csa, b, rsb, csb, c, rsc, csc, workspace.data());
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::strassen_recurse(thread_pool* pool, size_t cutoff, size_t m, size_t n, size_t k,
+    Scalar const* a, ptrdiff_t rsa, ptrdiff_t csa,
+    Scalar const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    Scalar* c, ptrdiff_t rsc, ptrdiff_t csc, Scalar* workspace)
+{
+    if (std::min({ m, n, k }) <= cutoff)
+    {
+        gemm(pool, m, n, k, Scalar(1), a, rsa, csa, b, rsb, csb, Scalar(0), c, rsc, csc);
+        return;
+    }
+    auto const hm = m / 2;
+    auto const hn = n / 2;
+    auto const hk = k / 2;
+    auto const one = Scalar(1);
+    auto const minus = Scalar(-1);
+    // X holds the sums of quadrants of A and then P1, Y the sums of quadrants of B
+    auto const rsx = ptrdiff_t(std::max(hk, hn));
+    auto const rsy = ptrdiff_t(hn);
+    auto* const x = workspace;
+    auto* const y = x + hm * size_t(rsx);
+    auto* const deeper = y + hk * hn;
+    auto const* const a11 = a;
+    auto const* const a12 = a + ptrdiff_t(hk) * csa;
+    auto const* const a21 = a + ptrdiff_t(hm) * rsa;
+    auto const* const a22 = a21 + ptrdiff_t(hk) * csa;
+    auto const* const b11 = b;
+    auto const* const b12 = b + ptrdiff_t(hn) * csb;
+    auto const* const b21 = b + ptrdiff_t(hk) * rsb;
+    auto const* const b22 = b21 + ptrdiff_t(hn) * csb;
+    auto* const c11 = c;
+    auto* const c12 = c + ptrdiff_t(hn) * csc;
+    auto* const c21 = c + ptrdiff_t(hm) * rsc;
+    auto* const c22 = c21 + ptrdiff_t(hn) * csc;
+    auto const multiply = [&](Scalar const* l, ptrdiff_t rsl, ptrdiff_t csl, Scalar const* r, ptrdiff_t rsr, ptrdiff_t csr, Scalar* out, ptrdiff_t rso, ptrdiff_t cso) {
+        strassen_recurse(pool, cutoff, hm, hn, hk, l, rsl, csl, r, rsr, csr, out, rso, cso, deeper);
+    };
+
+    strassen_combine(pool, hm, hk, a11, rsa, csa, minus, a21, rsa, csa, x, rsx, 1);        // S3 = A11 - A21
+    strassen_combine(pool, hk, hn, b22, rsb, csb, minus, b12, rsb, csb, y, rsy, 1);        // T3 = B22 - B12
+    multiply(x, rsx, 1, y, rsy, 1, c21, rsc, csc);                                          // P7 = S3 T3
+    strassen_combine(pool, hm, hk, a21, rsa, csa, one, a22, rsa, csa, x, rsx, 1);          // S1 = A21 + A22
+    strassen_combine(pool, hk, hn, b12, rsb, csb, minus, b11, rsb, csb, y, rsy, 1);        // T1 = B12 - B11
+    multiply(x, rsx, 1, y, rsy, 1, c22, rsc, csc);                                          // P5 = S1 T1
+    strassen_combine(pool, hm, hk, x, rsx, 1, minus, a11, rsa, csa, x, rsx, 1);            // S2 = S1 - A11
+    strassen_combine(pool, hk, hn, b22, rsb, csb, minus, y, rsy, 1, y, rsy, 1);            // T2 = B22 - T1
+    multiply(x, rsx, 1, y, rsy, 1, c12, rsc, csc);                                          // P6 = S2 T2
+    strassen_combine(pool, hm, hk, a12, rsa, csa, minus, x, rsx, 1, x, rsx, 1);            // S4 = A12 - S2
+    multiply(x, rsx, 1, b22, rsb, csb, c11, rsc, csc);                                      // P3 = S4 B22
+    multiply(a11, rsa, csa, b11, rsb, csb, x, rsx, 1);                                      // P1 = A11 B11
+    strassen_combine(pool, hm, hn, x, rsx, 1, one, c12, rsc, csc, c12, rsc, csc);          // U2 = P1 + P6
+    strassen_combine(pool, hm, hn, c12, rsc, csc, one, c21, rsc, csc, c21, rsc, csc);      // U3 = U2 + P7
+    strassen_combine(pool, hm, hn, c12, rsc, csc, one, c22, rsc, csc, c12, rsc, csc);      // U4 = U2 + P5
+    strassen_combine(pool, hm, hn, c21, rsc, csc, one, c22, rsc, csc, c22, rsc, csc);      // C22 = U7 = U3 + P5
+    strassen_combine(pool, hm, hn, c12, rsc, csc, one, c11, rsc, csc, c12, rsc, csc);      // C12 = U5 = U4 + P3
+    strassen_combine(pool, hk, hn, y, rsy, 1, minus, b21, rsb, csb, y, rsy, 1);            // T4 = T2 - B21
+    multiply(a22, rsa, csa, y, rsy, 1, c11, rsc, csc);                                      // P4 = A22 T4
+    strassen_combine(pool, hm, hn, c21, rsc, csc, minus, c11, rsc, csc, c21, rsc, csc);    // C21 = U6 = U3 - P4
+    multiply(a12, rsa, csa, b21, rsb, csb, c11, rsc, csc);                                  // P2 = A12 B21
+    strassen_combine(pool, hm, hn, x, rsx, 1, one, c11, rsc, csc, c11, rsc, csc);          // C11 = U1 = P1 + P2
+
+    // Peel the odd row, column and rank-1 term left outside the even part
+    auto const em = 2 * hm;
+    auto const en = 2 * hn;
+    auto const ek = 2 * hk;
+    if (ek < k) gemm(pool, em, en, size_t(1), one, a + ptrdiff_t(ek) * csa, rsa, csa, b + ptrdiff_t(ek) * rsb, rsb, csb, one, c, rsc, csc);
+    if (en < n) gemm(pool, em, size_t(1), k, one, a, rsa, csa, b + ptrdiff_t(en) * csb, rsb, csb, Scalar(0), c + ptrdiff_t(en) * csc, rsc, csc);
+    if (em < m) gemm(pool, size_t(1), n, k, one, a + ptrdiff_t(em) * rsa, rsa, csa, b, rsb, csb, Scalar(0), c + ptrdiff_t(em) * rsc, rsc, csc);
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::strassen_combine(thread_pool* pool, size_t rows, size_t cols,
+    Scalar const* x, ptrdiff_t rsx, ptrdiff_t csx, Scalar sign,
+    Scalar const* y, ptrdiff_t rsy, ptrdiff_t csy,
+    Scalar* z, ptrdiff_t rsz, ptrdiff_t csz)
+{
+    parallel_chunks(pool, rows, std::max(size_t(1), parallel_element_threshold / std::max(cols, size_t(1))), [&](size_t r0, size_t r1) {
+        for (auto i = r0; i < r1; ++i)
+        {
+            auto const* xi = x + ptrdiff_t(i) * rsx;
+            auto const* yi = y + ptrdiff_t(i) * rsy;
+            auto* zi = z + ptrdiff_t(i) * rsz;
+            if (csx == 1 && csy == 1 && csz == 1)
+            {
+                // Unit strides, the usual case, vectorise
+                for (auto j = size_t(0); j < cols; ++j) zi[j] = xi[j] + sign * yi[j];
+            }
+            else
+            {
+                for (auto j = size_t(0); j < cols; ++j) zi[ptrdiff_t(j) * csz] = xi[ptrdiff_t(j) * csx] + sign * yi[ptrdiff_t(j) * csy];
+            }
+        }
+    });
+}
+
+#endif
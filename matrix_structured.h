@@ -0,0 +1,1106 @@
+#if !defined MATRIX_STRUCTURED_26_10_18_21_52_06
+#define MATRIX_STRUCTURED_26_10_18_21_52_06
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_decomposition.h"
+#include "matrix_instrument.h"
+#include "linear_algebra.h"
+
+/*
+Structured storage for square matrices whose pattern of zeros is known in advance.
+
+symmetric_matrix keeps one triangle, n(n + 1)/2 elements packed row by row from the lower
+triangle, and writing element (i, j) writes (j, i) with it. triangular_matrix keeps the
+lower or upper triangle in the same space: the lower one row by row and the upper one
+column by column, so a triangular matrix and its transpose share one packed array.
+diagonal_matrix keeps n elements. banded_matrix keeps the l diagonals below the main one
+and the u above it, l + u + 1 slots to a row, where slot s of row i is column i - l + s;
+slots that fall outside the matrix, in the first and last rows, are held at zero.
+Elements outside the stored part read as zero through a const matrix; the non-const
+operator() returns a reference to a stored element, so only those may be used with it.
+
+structured_traits is the Rep for all four. A structured matrix multiplies a dense matrix
+or vector (view, either layout) into a dense result visiting only the stored elements, so
+a banded product costs n(l + u + 1) multiply-adds per right-hand side. solve() and
+determinant() use the structure:
+
+    diagonal        division, O(n)
+    triangular      substitution, O(n^2); the determinant is the diagonal product, O(n)
+    banded          LU with partial pivoting inside the band, O(n l (l + u)), the factor
+                    needing l more diagonals above the main one for the row interchanges
+    symmetric       Cholesky, n^3/3 flops against 2n^3/3 for LU, on the packed triangle
+                    for small n and on a dense copy beyond packed_cholesky_limit, falling
+                    back to a dense LU when the matrix is not positive definite
+
+Transposes keep the structure, and sums, differences and scalar products are computed on
+the stored elements. Like sparse matrices, structured matrices do not take part in the
+element-wise expressions of matrix_expression.h. to_symmetric, to_triangular, to_diagonal
+and to_banded copy the relevant part of a dense matrix, and to_dense expands any of them.
+*/
+
+namespace std::experimental::la {
+    struct structured_matrix_t {};
+
+    // Which triangle a triangular_matrix keeps
+    struct lower_triangle {};
+    struct upper_triangle {};
+
+    ////////////////////////////////////////////////////////
+    // symmetric_matrix
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct symmetric_matrix : public structured_matrix_t
+    {
+        using scalar_t = Scalar;
+        using matrix_t = symmetric_matrix<Scalar>;
+        using transpose_t = symmetric_matrix<Scalar>;
+
+        symmetric_matrix() = default;
+        explicit symmetric_matrix(std::pair<size_t, size_t> size);     // All zero
+        symmetric_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values);     // Adopts a packed lower triangle
+        // Accessors
+        Scalar operator()(size_t i, size_t j) const;
+        Scalar& operator()(size_t i, size_t j);                        // The same element as (j, i)
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+        size_t lower_bandwidth() const noexcept;                       // Diagonals below the main one that may be nonzero
+        size_t upper_bandwidth() const noexcept;
+        size_t position(size_t i, size_t j) const noexcept;            // Of element (i, j) in values()
+        std::vector<Scalar> const& values() const noexcept;
+        std::vector<Scalar>& values() noexcept;
+
+        size_t _Size = 0;
+        std::vector<Scalar> _Values;
+    };
+
+    ////////////////////////////////////////////////////////
+    // triangular_matrix
+    ////////////////////////////////////////////////////////
+    template<class Scalar, class Triangle = lower_triangle>
+    struct triangular_matrix : public structured_matrix_t
+    {
+        using scalar_t = Scalar;
+        using triangle_t = Triangle;
+        using matrix_t = triangular_matrix<Scalar, Triangle>;
+        using transpose_t = triangular_matrix<Scalar, std::conditional_t<std::is_same_v<Triangle, lower_triangle>, upper_triangle, lower_triangle>>;
+
+        constexpr static bool lower = std::is_same_v<Triangle, lower_triangle>;
+
+        triangular_matrix() = default;
+        explicit triangular_matrix(std::pair<size_t, size_t> size);    // All zero
+        triangular_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values);    // Adopts a packed triangle, laid out as described above
+        // Accessors
+        Scalar operator()(size_t i, size_t j) const;                   // Zero outside the triangle
+        Scalar& operator()(size_t i, size_t j);
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+        size_t lower_bandwidth() const noexcept;
+        size_t upper_bandwidth() const noexcept;
+        size_t position(size_t i, size_t j) const noexcept;            // Of element (i, j), which must be in the triangle
+        std::vector<Scalar> const& values() const noexcept;
+        std::vector<Scalar>& values() noexcept;
+
+        size_t _Size = 0;
+        std::vector<Scalar> _Values;
+    };
+
+    template<class Scalar>
+    using lower_triangular_matrix = triangular_matrix<Scalar, lower_triangle>;
+
+    template<class Scalar>
+    using upper_triangular_matrix = triangular_matrix<Scalar, upper_triangle>;
+
+    ////////////////////////////////////////////////////////
+    // diagonal_matrix
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct diagonal_matrix : public structured_matrix_t
+    {
+        using scalar_t = Scalar;
+        using matrix_t = diagonal_matrix<Scalar>;
+        using transpose_t = diagonal_matrix<Scalar>;
+
+        diagonal_matrix() = default;
+        explicit diagonal_matrix(std::pair<size_t, size_t> size);      // All zero
+        diagonal_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values);
+        // Accessors
+        Scalar operator()(size_t i, size_t j) const;                   // Zero off the diagonal
+        Scalar& operator()(size_t i, size_t j);
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+        size_t lower_bandwidth() const noexcept;
+        size_t upper_bandwidth() const noexcept;
+        size_t position(size_t i, size_t j) const noexcept;
+        std::vector<Scalar> const& values() const noexcept;
+        std::vector<Scalar>& values() noexcept;
+
+        size_t _Size = 0;
+        std::vector<Scalar> _Values;
+    };
+
+    ////////////////////////////////////////////////////////
+    // banded_matrix
+    ////////////////////////////////////////////////////////
+    template<class Scalar>
+    struct banded_matrix : public structured_matrix_t
+    {
+        using scalar_t = Scalar;
+        using matrix_t = banded_matrix<Scalar>;
+        using transpose_t = banded_matrix<Scalar>;
+
+        banded_matrix() = default;
+        banded_matrix(std::pair<size_t, size_t> size, size_t lower, size_t upper);     // All zero
+        banded_matrix(std::pair<size_t, size_t> size, size_t lower, size_t upper, std::vector<Scalar> values);     // Adopts rows of lower + upper + 1 slots
+        // Accessors
+        Scalar operator()(size_t i, size_t j) const;                   // Zero outside the band
+        Scalar& operator()(size_t i, size_t j);
+        size_t rows() const noexcept;
+        size_t cols() const noexcept;
+        size_t lower_bandwidth() const noexcept;
+        size_t upper_bandwidth() const noexcept;
+        size_t width() const noexcept;                                 // Slots per row
+        size_t position(size_t i, size_t j) const noexcept;            // Of element (i, j), which must be in the band
+        std::vector<Scalar> const& values() const noexcept;
+        std::vector<Scalar>& values() noexcept;
+
+        size_t _Size = 0;
+        size_t _Lower = 0;
+        size_t _Upper = 0;
+        std::vector<Scalar> _Values;
+    };
+
+    ////////////////////////////////////////////////////////
+    // structured_traits
+    ////////////////////////////////////////////////////////
+    template<class Structured>
+    struct structured_traits
+    {
+        using scalar_t = typename Structured::scalar_t;
+        using matrix_t = Structured;
+        using dense_rep_t = matrix_traits<dynamic_size_matrix<scalar_t>>;
+        using transpose_t = structured_traits<typename Structured::transpose_t>;
+        template<class Traits2>
+        using multiply_t = dense_rep_t;
+
+        static bool equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;        // Same shape and stored values
+        static bool not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static void scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        template <class Traits2> static typename dense_rep_t::matrix_t matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs);
+        static void divide(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        static void add(matrix_t& lhs, matrix_t const& rhs) noexcept;                // Same shape, and bandwidths for banded matrices
+        static void subtract(matrix_t& lhs, matrix_t const& rhs) noexcept;
+        static typename transpose_t::matrix_t transpose(matrix_t const& mat);
+        static bool is_identity(matrix_t const& mat) noexcept;
+        static bool is_invertible(matrix_t const& mat);
+        static scalar_t determinant(matrix_t const& mat);
+        // Overwrites b, a dense n x nrhs storage or view, with the solution X of mat X = b
+        template <class Other> static void solve_in_place(matrix_t const& mat, Other& b);
+        static typename dense_rep_t::matrix_t to_dense(matrix_t const& mat);
+    };
+
+    // Sums and scalar products of structured matrices
+    template<class Structured>
+    matrix<structured_traits<Structured>> operator+(matrix<structured_traits<Structured>> lhs, matrix<structured_traits<Structured>> const& rhs);
+
+    template<class Structured>
+    matrix<structured_traits<Structured>> operator-(matrix<structured_traits<Structured>> lhs, matrix<structured_traits<Structured>> const& rhs);
+
+    template<class Structured>
+    matrix<structured_traits<Structured>> operator*(matrix<structured_traits<Structured>> lhs, typename Structured::scalar_t const& rhs);
+
+    template<class Structured>
+    matrix<structured_traits<Structured>> operator*(typename Structured::scalar_t const& lhs, matrix<structured_traits<Structured>> rhs);
+
+    template<class Structured>
+    matrix<structured_traits<Structured>> operator/(matrix<structured_traits<Structured>> lhs, typename Structured::scalar_t const& rhs);
+
+    // Linear systems, solved through the structure rather than a dense LU
+    template<class Structured, class B, class = std::enable_if_t<detail::is_matrix_operand_v<B>>>
+    matrix<detail::operand_rep_t<B>> solve(matrix<structured_traits<Structured>> const& a, B&& b);
+
+    // Conversions
+    // Each reads only the part of the square matrix it keeps: to_symmetric the lower triangle
+    template<class Rep>
+    matrix<structured_traits<symmetric_matrix<typename Rep::scalar_t>>> to_symmetric(matrix<Rep> const& mat);
+
+    template<class Triangle = lower_triangle, class Rep>
+    matrix<structured_traits<triangular_matrix<typename Rep::scalar_t, Triangle>>> to_triangular(matrix<Rep> const& mat);
+
+    template<class Rep>
+    matrix<structured_traits<diagonal_matrix<typename Rep::scalar_t>>> to_diagonal(matrix<Rep> const& mat);
+
+    template<class Rep>
+    matrix<structured_traits<banded_matrix<typename Rep::scalar_t>>> to_banded(matrix<Rep> const& mat, size_t lower, size_t upper);
+
+    template<class Structured>
+    matrix<typename structured_traits<Structured>::dense_rep_t> to_dense(matrix<structured_traits<Structured>> const& mat);
+
+    namespace detail {
+        template<class Rep>
+        inline constexpr bool is_structured_rep_v = false;
+
+        template<class Structured>
+        inline constexpr bool is_structured_rep_v<structured_traits<Structured>> = true;
+
+        template<class Structured>
+        inline constexpr bool is_symmetric_storage_v = false;
+
+        template<class Scalar>
+        inline constexpr bool is_symmetric_storage_v<symmetric_matrix<Scalar>> = true;
+
+        template<class Structured>
+        inline constexpr bool is_triangular_storage_v = false;
+
+        template<class Scalar, class Triangle>
+        inline constexpr bool is_triangular_storage_v<triangular_matrix<Scalar, Triangle>> = true;
+
+        template<class Structured>
+        inline constexpr bool is_diagonal_storage_v = false;
+
+        template<class Scalar>
+        inline constexpr bool is_diagonal_storage_v<diagonal_matrix<Scalar>> = true;
+
+        template<class Structured>
+        inline constexpr bool is_banded_storage_v = false;
+
+        template<class Scalar>
+        inline constexpr bool is_banded_storage_v<banded_matrix<Scalar>> = true;
+
+        // Offset of row or column k of a packed triangle
+        constexpr size_t packed_offset(size_t k) noexcept;
+
+        // Beyond this order the rows a packed Cholesky step reads no longer stay in cache, and
+        // the blocked dense factorisation of an unpacked copy is faster despite the copy
+        inline constexpr size_t packed_cholesky_limit = 4 * lu_block_size;
+
+        // The kernels below solve in place for X, n x nrhs with strides rsx and csx.
+        // l is a lower triangle packed row by row, u an upper one packed column by column
+        template<class Scalar>
+        void packed_lower_solve(Scalar const* l, size_t n, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept;
+        template<class Scalar>
+        void packed_upper_solve(Scalar const* u, size_t n, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept;
+
+        // A = LL* over a packed lower triangle, which L overwrites; false if A is not positive definite
+        template<class Scalar>
+        bool packed_cholesky_factorize(Scalar* l, size_t n) noexcept;
+
+        // PA = LU inside a band of kl diagonals below the main one and ku above. ab has n rows
+        // of 2kl + ku + 1 slots, slot s of row i being column i - kl + s, and holds A in the
+        // first kl + ku + 1; U, with kl + ku diagonals above the main one, overwrites the
+        // slots from the diagonal on, and the multipliers of each elimination those before it.
+        // Row interchanges are kept as in lu_decomposition; false if A is singular
+        template<class Scalar>
+        bool band_lu_factorize(Scalar* ab, size_t n, size_t kl, size_t ku, size_t* pivot, bool& odd_permutation) noexcept;
+        template<class Scalar>
+        void band_lu_solve(Scalar const* ab, size_t n, size_t kl, size_t ku, size_t const* pivot, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// symmetric_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::symmetric_matrix<Scalar>::symmetric_matrix(std::pair<size_t, size_t> size)
+    : _Size(size.first)
+    , _Values(detail::packed_offset(size.first))
+{
+    assert(size.first == size.second);
+}
+
+template<class Scalar>
+inline std::experimental::la::symmetric_matrix<Scalar>::symmetric_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values)
+    : _Size(size.first)
+    , _Values(std::move(values))
+{
+    assert(size.first == size.second && _Values.size() == detail::packed_offset(_Size));
+}
+
+template<class Scalar>
+inline Scalar std::experimental::la::symmetric_matrix<Scalar>::operator()(size_t i, size_t j) const
+{
+    return _Values[position(i, j)];
+}
+
+template<class Scalar>
+inline Scalar& std::experimental::la::symmetric_matrix<Scalar>::operator()(size_t i, size_t j)
+{
+    return _Values[position(i, j)];
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::symmetric_matrix<Scalar>::rows() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::symmetric_matrix<Scalar>::cols() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::symmetric_matrix<Scalar>::lower_bandwidth() const noexcept
+{
+    return _Size == 0 ? 0 : _Size - 1;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::symmetric_matrix<Scalar>::upper_bandwidth() const noexcept
+{
+    return lower_bandwidth();
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::symmetric_matrix<Scalar>::position(size_t i, size_t j) const noexcept
+{
+    assert(i < _Size && j < _Size);
+    return i >= j ? detail::packed_offset(i) + j : detail::packed_offset(j) + i;
+}
+
+template<class Scalar>
+inline std::vector<Scalar> const& std::experimental::la::symmetric_matrix<Scalar>::values() const noexcept
+{
+    return _Values;
+}
+
+template<class Scalar>
+inline std::vector<Scalar>& std::experimental::la::symmetric_matrix<Scalar>::values() noexcept
+{
+    return _Values;
+}
+
+////////////////////////////////////////////////////////
+// triangular_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar, class Triangle>
+inline std::experimental::la::triangular_matrix<Scalar, Triangle>::triangular_matrix(std::pair<size_t, size_t> size)
+    : _Size(size.first)
+    , _Values(detail::packed_offset(size.first))
+{
+    assert(size.first == size.second);
+}
+
+template<class Scalar, class Triangle>
+inline std::experimental::la::triangular_matrix<Scalar, Triangle>::triangular_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values)
+    : _Size(size.first)
+    , _Values(std::move(values))
+{
+    assert(size.first == size.second && _Values.size() == detail::packed_offset(_Size));
+}
+
+template<class Scalar, class Triangle>
+inline Scalar std::experimental::la::triangular_matrix<Scalar, Triangle>::operator()(size_t i, size_t j) const
+{
+    assert(i < _Size && j < _Size);
+    return (lower ? j <= i : i <= j) ? _Values[position(i, j)] : Scalar(0);
+}
+
+template<class Scalar, class Triangle>
+inline Scalar& std::experimental::la::triangular_matrix<Scalar, Triangle>::operator()(size_t i, size_t j)
+{
+    return _Values[position(i, j)];
+}
+
+template<class Scalar, class Triangle>
+inline size_t std::experimental::la::triangular_matrix<Scalar, Triangle>::rows() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar, class Triangle>
+inline size_t std::experimental::la::triangular_matrix<Scalar, Triangle>::cols() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar, class Triangle>
+inline size_t std::experimental::la::triangular_matrix<Scalar, Triangle>::lower_bandwidth() const noexcept
+{
+    return lower && _Size != 0 ? _Size - 1 : 0;
+}
+
+template<class Scalar, class Triangle>
+inline size_t std::experimental::la::triangular_matrix<Scalar, Triangle>::upper_bandwidth() const noexcept
+{
+    return !lower && _Size != 0 ? _Size - 1 : 0;
+}
+
+template<class Scalar, class Triangle>
+inline size_t std::experimental::la::triangular_matrix<Scalar, Triangle>::position(size_t i, size_t j) const noexcept
+{
+    // Row i of the lower triangle and column j of the upper one are packed end to end
+    assert(i < _Size && j < _Size && (lower ? j <= i : i <= j));
+    return lower ? detail::packed_offset(i) + j : detail::packed_offset(j) + i;
+}
+
+template<class Scalar, class Triangle>
+inline std::vector<Scalar> const& std::experimental::la::triangular_matrix<Scalar, Triangle>::values() const noexcept
+{
+    return _Values;
+}
+
+template<class Scalar, class Triangle>
+inline std::vector<Scalar>& std::experimental::la::triangular_matrix<Scalar, Triangle>::values() noexcept
+{
+    return _Values;
+}
+
+////////////////////////////////////////////////////////
+// diagonal_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::diagonal_matrix<Scalar>::diagonal_matrix(std::pair<size_t, size_t> size)
+    : _Size(size.first)
+    , _Values(size.first)
+{
+    assert(size.first == size.second);
+}
+
+template<class Scalar>
+inline std::experimental::la::diagonal_matrix<Scalar>::diagonal_matrix(std::pair<size_t, size_t> size, std::vector<Scalar> values)
+    : _Size(size.first)
+    , _Values(std::move(values))
+{
+    assert(size.first == size.second && _Values.size() == _Size);
+}
+
+template<class Scalar>
+inline Scalar std::experimental::la::diagonal_matrix<Scalar>::operator()(size_t i, size_t j) const
+{
+    assert(i < _Size && j < _Size);
+    return i == j ? _Values[i] : Scalar(0);
+}
+
+template<class Scalar>
+inline Scalar& std::experimental::la::diagonal_matrix<Scalar>::operator()(size_t i, size_t j)
+{
+    return _Values[position(i, j)];
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::diagonal_matrix<Scalar>::rows() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::diagonal_matrix<Scalar>::cols() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::diagonal_matrix<Scalar>::lower_bandwidth() const noexcept
+{
+    return 0;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::diagonal_matrix<Scalar>::upper_bandwidth() const noexcept
+{
+    return 0;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::diagonal_matrix<Scalar>::position([[maybe_unused]] size_t i, size_t j) const noexcept
+{
+    assert(i < _Size && i == j);
+    return j;
+}
+
+template<class Scalar>
+inline std::vector<Scalar> const& std::experimental::la::diagonal_matrix<Scalar>::values() const noexcept
+{
+    return _Values;
+}
+
+template<class Scalar>
+inline std::vector<Scalar>& std::experimental::la::diagonal_matrix<Scalar>::values() noexcept
+{
+    return _Values;
+}
+
+////////////////////////////////////////////////////////
+// banded_matrix implementation
+////////////////////////////////////////////////////////
+template<class Scalar>
+inline std::experimental::la::banded_matrix<Scalar>::banded_matrix(std::pair<size_t, size_t> size, size_t lower, size_t upper)
+    : _Size(size.first)
+    , _Lower(lower)
+    , _Upper(upper)
+    , _Values(size.first * (lower + upper + 1))
+{
+    assert(size.first == size.second);
+}
+
+template<class Scalar>
+inline std::experimental::la::banded_matrix<Scalar>::banded_matrix(std::pair<size_t, size_t> size, size_t lower, size_t upper, std::vector<Scalar> values)
+    : _Size(size.first)
+    , _Lower(lower)
+    , _Upper(upper)
+    , _Values(std::move(values))
+{
+    assert(size.first == size.second && _Values.size() == _Size * width());
+}
+
+template<class Scalar>
+inline Scalar std::experimental::la::banded_matrix<Scalar>::operator()(size_t i, size_t j) const
+{
+    assert(i < _Size && j < _Size);
+    return j + _Lower >= i && j <= i + _Upper ? _Values[position(i, j)] : Scalar(0);
+}
+
+template<class Scalar>
+inline Scalar& std::experimental::la::banded_matrix<Scalar>::operator()(size_t i, size_t j)
+{
+    return _Values[position(i, j)];
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::rows() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::cols() const noexcept
+{
+    return _Size;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::lower_bandwidth() const noexcept
+{
+    return _Lower;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::upper_bandwidth() const noexcept
+{
+    return _Upper;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::width() const noexcept
+{
+    return _Lower + _Upper + 1;
+}
+
+template<class Scalar>
+inline size_t std::experimental::la::banded_matrix<Scalar>::position(size_t i, size_t j) const noexcept
+{
+    assert(i < _Size && j < _Size && j + _Lower >= i && j <= i + _Upper);
+    return i * width() + (j + _Lower - i);
+}
+
+template<class Scalar>
+inline std::vector<Scalar> const& std::experimental::la::banded_matrix<Scalar>::values() const noexcept
+{
+    return _Values;
+}
+
+template<class Scalar>
+inline std::vector<Scalar>& std::experimental::la::banded_matrix<Scalar>::values() noexcept
+{
+    return _Values;
+}
+
+////////////////////////////////////////////////////////
+// structured_traits implementation
+////////////////////////////////////////////////////////
+template<class Structured>
+inline bool std::experimental::la::structured_traits<Structured>::equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return lhs.rows() == rhs.rows() && lhs.lower_bandwidth() == rhs.lower_bandwidth() && lhs.upper_bandwidth() == rhs.upper_bandwidth() && lhs.values() == rhs.values();
+}
+
+template<class Structured>
+inline bool std::experimental::la::structured_traits<Structured>::not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return !equal(lhs, rhs);
+}
+
+template<class Structured>
+inline void std::experimental::la::structured_traits<Structured>::scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto& el : lhs.values()) el *= rhs;
+}
+
+template<class Structured>
+template<class Traits2>
+inline typename std::experimental::la::structured_traits<Structured>::dense_rep_t::matrix_t std::experimental::la::structured_traits<Structured>::matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs)
+{
+    static_assert(!detail::is_structured_rep_v<Traits2>, "the right-hand side of a structured product must be dense");
+    assert(lhs.cols() == rhs.rows());
+    auto const b = detail::as_view(rhs);
+    auto const n = lhs.rows();
+    auto const nrhs = b.cols();
+    auto res = typename dense_rep_t::matrix_t(std::pair(n, nrhs));
+    std::fill(res.begin(), res.end(), scalar_t(0));
+    auto const* v = lhs.values().data();
+    auto const rsb = b.row_stride();
+    auto const csb = b.col_stride();
+    // Every stored element a(i, j) adds a times row j of B to row i of C
+    auto const update = [&, c = res.begin()](scalar_t a, size_t i, size_t j) {
+        auto* out = c + i * nrhs;
+        auto const* in = b.data() + ptrdiff_t(j) * rsb;
+        for (auto k = size_t(0); k < nrhs; ++k) out[k] += a * in[ptrdiff_t(k) * csb];
+    };
+    if constexpr (detail::is_symmetric_storage_v<Structured>)
+    {
+        // Each element of the stored triangle stands for itself and its mirror
+        for (auto i = size_t(0); i < n; ++i)
+        {
+            auto const* row = v + detail::packed_offset(i);
+            for (auto j = size_t(0); j < i; ++j)
+            {
+                update(row[j], i, j);
+                update(row[j], j, i);
+            }
+            update(row[i], i, i);
+        }
+    }
+    else if constexpr (detail::is_triangular_storage_v<Structured>)
+    {
+        // Lower rows and upper columns are packed, so either way one line of A is read at a time
+        for (auto k = size_t(0); k < n; ++k)
+        {
+            auto const* line = v + detail::packed_offset(k);
+            for (auto l = size_t(0); l <= k; ++l)
+            {
+                if constexpr (Structured::lower) update(line[l], k, l);
+                else update(line[l], l, k);
+            }
+        }
+    }
+    else if constexpr (detail::is_diagonal_storage_v<Structured>)
+    {
+        for (auto i = size_t(0); i < n; ++i) update(v[i], i, i);
+    }
+    else
+    {
+        auto const kl = lhs.lower_bandwidth();
+        auto const ku = lhs.upper_bandwidth();
+        for (auto i = size_t(0); i < n; ++i)
+        {
+            auto const* row = v + i * lhs.width();
+            for (auto j = i > kl ? i - kl : size_t(0); j < std::min(n, i + ku + 1); ++j) update(row[j + kl - i], i, j);
+        }
+    }
+    return res;
+}
+
+template<class Structured>
+inline void std::experimental::la::structured_traits<Structured>::divide(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto& el : lhs.values()) el /= rhs;
+}
+
+template<class Structured>
+inline void std::experimental::la::structured_traits<Structured>::add(matrix_t& lhs, matrix_t const& rhs) noexcept
+{
+    assert(lhs.rows() == rhs.rows() && lhs.lower_bandwidth() == rhs.lower_bandwidth() && lhs.upper_bandwidth() == rhs.upper_bandwidth());
+    std::transform(lhs.values().begin(), lhs.values().end(), rhs.values().begin(), lhs.values().begin(), std::plus<>());
+}
+
+template<class Structured>
+inline void std::experimental::la::structured_traits<Structured>::subtract(matrix_t& lhs, matrix_t const& rhs) noexcept
+{
+    assert(lhs.rows() == rhs.rows() && lhs.lower_bandwidth() == rhs.lower_bandwidth() && lhs.upper_bandwidth() == rhs.upper_bandwidth());
+    std::transform(lhs.values().begin(), lhs.values().end(), rhs.values().begin(), lhs.values().begin(), std::minus<>());
+}
+
+template<class Structured>
+inline typename std::experimental::la::structured_traits<Structured>::transpose_t::matrix_t std::experimental::la::structured_traits<Structured>::transpose(matrix_t const& mat)
+{
+    using result_t = typename transpose_t::matrix_t;
+    auto const size = std::pair(mat.rows(), mat.cols());
+    if constexpr (detail::is_banded_storage_v<Structured>)
+    {
+        // The band is mirrored: l diagonals below become l above
+        auto res = result_t(size, mat.upper_bandwidth(), mat.lower_bandwidth());
+        auto const n = mat.rows();
+        for (auto i = size_t(0); i < n; ++i)
+        {
+            for (auto j = i > mat.lower_bandwidth() ? i - mat.lower_bandwidth() : size_t(0); j < std::min(n, i + mat.upper_bandwidth() + 1); ++j) res(j, i) = mat(i, j);
+        }
+        return res;
+    }
+    // A symmetric or diagonal matrix is its own transpose, and the packed lower triangle
+    // is the packed upper triangle of the transpose
+    else return result_t(size, mat.values());
+}
+
+template<class Structured>
+inline bool std::experimental::la::structured_traits<Structured>::is_identity(matrix_t const& mat) noexcept
+{
+    auto const n = mat.rows();
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto j = i > mat.lower_bandwidth() ? i - mat.lower_bandwidth() : size_t(0); j < std::min(n, i + mat.upper_bandwidth() + 1); ++j)
+        {
+            if (mat(i, j) != (i == j ? scalar_t(1) : scalar_t(0))) return false;
+        }
+    }
+    return true;
+}
+
+template<class Structured>
+inline bool std::experimental::la::structured_traits<Structured>::is_invertible(matrix_t const& mat)
+{
+    return determinant(mat) != scalar_t(0);
+}
+
+template<class Structured>
+inline typename std::experimental::la::structured_traits<Structured>::scalar_t std::experimental::la::structured_traits<Structured>::determinant(matrix_t const& mat)
+{
+    auto const n = mat.rows();
+    auto res = scalar_t(1);
+    if constexpr (detail::is_symmetric_storage_v<Structured>)
+    {
+        if (n > detail::packed_cholesky_limit)
+        {
+            auto const chol = cholesky_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat));
+            if (chol.is_positive_definite()) return chol.determinant();
+            return lu_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat)).determinant();
+        }
+        auto l = mat.values();
+        _LA_RECORD_ALLOCATION(l.size() * sizeof(scalar_t));
+        if (!detail::packed_cholesky_factorize(l.data(), n)) return lu_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat)).determinant();
+        for (auto i = size_t(0); i < n; ++i) res *= l[detail::packed_offset(i) + i];
+        return res * res;
+    }
+    else if constexpr (detail::is_banded_storage_v<Structured>)
+    {
+        auto const kl = mat.lower_bandwidth();
+        auto const ku = mat.upper_bandwidth();
+        auto const width = 2 * kl + ku + 1;
+        auto ab = std::vector<scalar_t>(n * width);
+        auto pivot = std::vector<size_t>(n);
+        _LA_RECORD_ALLOCATION(ab.size() * sizeof(scalar_t) + n * sizeof(size_t), 2);
+        for (auto i = size_t(0); i < n; ++i) std::copy_n(mat.values().data() + i * mat.width(), mat.width(), ab.data() + i * width);
+        auto odd_permutation = false;
+        if (!detail::band_lu_factorize(ab.data(), n, kl, ku, pivot.data(), odd_permutation)) return scalar_t(0);
+        for (auto i = size_t(0); i < n; ++i) res *= ab[i * width + kl];
+        return odd_permutation ? -res : res;
+    }
+    else
+    {
+        // Triangular and diagonal: the product of the diagonal
+        for (auto i = size_t(0); i < n; ++i) res *= mat.values()[mat.position(i, i)];
+        return res;
+    }
+}
+
+template<class Structured>
+template<class Other>
+inline void std::experimental::la::structured_traits<Structured>::solve_in_place(matrix_t const& mat, Other& b)
+{
+    auto const n = mat.rows();
+    auto const xv = detail::as_view(b);
+    assert(xv.rows() == n);
+    auto* x = xv.data();
+    auto const nrhs = xv.cols();
+    auto const rsx = xv.row_stride();
+    auto const csx = xv.col_stride();
+    auto const* v = mat.values().data();
+    if constexpr (detail::is_symmetric_storage_v<Structured>)
+    {
+        // LL*X = B: the packed lower triangle L, read column by column, is the packed upper triangle L*
+        if (n > detail::packed_cholesky_limit)
+        {
+            auto const chol = cholesky_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat));
+            if (chol.is_positive_definite()) return chol.solve_in_place(b);
+            return lu_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat)).solve_in_place(b);
+        }
+        auto l = mat.values();
+        _LA_RECORD_ALLOCATION(l.size() * sizeof(scalar_t));
+        if (!detail::packed_cholesky_factorize(l.data(), n)) return lu_decomposition<typename dense_rep_t::matrix_t>(to_dense(mat)).solve_in_place(b);
+        detail::packed_lower_solve(l.data(), n, x, nrhs, rsx, csx);
+        detail::packed_upper_solve(l.data(), n, x, nrhs, rsx, csx);
+    }
+    else if constexpr (detail::is_triangular_storage_v<Structured>)
+    {
+        if constexpr (Structured::lower) detail::packed_lower_solve(v, n, x, nrhs, rsx, csx);
+        else detail::packed_upper_solve(v, n, x, nrhs, rsx, csx);
+    }
+    else if constexpr (detail::is_diagonal_storage_v<Structured>)
+    {
+        for (auto i = size_t(0); i < n; ++i)
+        {
+            auto* row = x + ptrdiff_t(i) * rsx;
+            for (auto k = size_t(0); k < nrhs; ++k) row[ptrdiff_t(k) * csx] /= v[i];
+        }
+    }
+    else
+    {
+        auto const kl = mat.lower_bandwidth();
+        auto const ku = mat.upper_bandwidth();
+        auto const width = 2 * kl + ku + 1;
+        auto ab = std::vector<scalar_t>(n * width);
+        auto pivot = std::vector<size_t>(n);
+        _LA_RECORD_ALLOCATION(ab.size() * sizeof(scalar_t) + n * sizeof(size_t), 2);
+        for (auto i = size_t(0); i < n; ++i) std::copy_n(v + i * mat.width(), mat.width(), ab.data() + i * width);
+        auto odd_permutation = false;
+        detail::band_lu_factorize(ab.data(), n, kl, ku, pivot.data(), odd_permutation);
+        detail::band_lu_solve(ab.data(), n, kl, ku, pivot.data(), x, nrhs, rsx, csx);
+    }
+}
+
+template<class Structured>
+inline typename std::experimental::la::structured_traits<Structured>::dense_rep_t::matrix_t std::experimental::la::structured_traits<Structured>::to_dense(matrix_t const& mat)
+{
+    auto const n = mat.rows();
+    auto res = typename dense_rep_t::matrix_t(std::pair(n, n));
+    std::fill(res.begin(), res.end(), scalar_t(0));
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto j = i > mat.lower_bandwidth() ? i - mat.lower_bandwidth() : size_t(0); j < std::min(n, i + mat.upper_bandwidth() + 1); ++j) res(i, j) = mat(i, j);
+    }
+    return res;
+}
+
+////////////////////////////////////////////////////////
+// Structured operations implementation
+////////////////////////////////////////////////////////
+template<class Structured>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<Structured>> std::experimental::la::operator+(matrix<structured_traits<Structured>> lhs, matrix<structured_traits<Structured>> const& rhs)
+{
+    lhs += rhs;
+    return lhs;
+}
+
+template<class Structured>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<Structured>> std::experimental::la::operator-(matrix<structured_traits<Structured>> lhs, matrix<structured_traits<Structured>> const& rhs)
+{
+    lhs -= rhs;
+    return lhs;
+}
+
+template<class Structured>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<Structured>> std::experimental::la::operator*(matrix<structured_traits<Structured>> lhs, typename Structured::scalar_t const& rhs)
+{
+    lhs *= rhs;
+    return lhs;
+}
+
+template<class Structured>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<Structured>> std::experimental::la::operator*(typename Structured::scalar_t const& lhs, matrix<structured_traits<Structured>> rhs)
+{
+    rhs *= lhs;
+    return rhs;
+}
+
+template<class Structured>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<Structured>> std::experimental::la::operator/(matrix<structured_traits<Structured>> lhs, typename Structured::scalar_t const& rhs)
+{
+    lhs /= rhs;
+    return lhs;
+}
+
+template<class Structured, class B, class>
+inline std::experimental::la::matrix<std::experimental::la::detail::operand_rep_t<B>> std::experimental::la::solve(matrix<structured_traits<Structured>> const& a, B&& b)
+{
+    return _LA_INSTRUMENT("solve", 2 * double(a.data().values().size()) * double(detail::expression_size(b).second),
+        double(a.data().values().size()) * sizeof(typename Structured::scalar_t) + 2 * detail::operand_bytes(b), [&] {
+        auto x = detail::working_copy(std::forward<B>(b));
+        structured_traits<Structured>::solve_in_place(a.data(), x.data());
+        return x;
+    }());
+}
+
+template<class Rep>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<std::experimental::la::symmetric_matrix<typename Rep::scalar_t>>> std::experimental::la::to_symmetric(matrix<Rep> const& mat)
+{
+    auto const n = mat.data().rows();
+    auto res = symmetric_matrix<typename Rep::scalar_t>(std::pair(n, mat.data().cols()));
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto j = size_t(0); j <= i; ++j) res(i, j) = mat(i, j);
+    }
+    return matrix<structured_traits<symmetric_matrix<typename Rep::scalar_t>>>(std::move(res));
+}
+
+template<class Triangle, class Rep>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<std::experimental::la::triangular_matrix<typename Rep::scalar_t, Triangle>>> std::experimental::la::to_triangular(matrix<Rep> const& mat)
+{
+    using result_t = triangular_matrix<typename Rep::scalar_t, Triangle>;
+    auto const n = mat.data().rows();
+    auto res = result_t(std::pair(n, mat.data().cols()));
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto j = result_t::lower ? size_t(0) : i; j < (result_t::lower ? i + 1 : n); ++j) res(i, j) = mat(i, j);
+    }
+    return matrix<structured_traits<result_t>>(std::move(res));
+}
+
+template<class Rep>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<std::experimental::la::diagonal_matrix<typename Rep::scalar_t>>> std::experimental::la::to_diagonal(matrix<Rep> const& mat)
+{
+    auto const n = mat.data().rows();
+    auto res = diagonal_matrix<typename Rep::scalar_t>(std::pair(n, mat.data().cols()));
+    for (auto i = size_t(0); i < n; ++i) res(i, i) = mat(i, i);
+    return matrix<structured_traits<diagonal_matrix<typename Rep::scalar_t>>>(std::move(res));
+}
+
+template<class Rep>
+inline std::experimental::la::matrix<std::experimental::la::structured_traits<std::experimental::la::banded_matrix<typename Rep::scalar_t>>> std::experimental::la::to_banded(matrix<Rep> const& mat, size_t lower, size_t upper)
+{
+    auto const n = mat.data().rows();
+    auto res = banded_matrix<typename Rep::scalar_t>(std::pair(n, mat.data().cols()), lower, upper);
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        for (auto j = i > lower ? i - lower : size_t(0); j < std::min(n, i + upper + 1); ++j) res(i, j) = mat(i, j);
+    }
+    return matrix<structured_traits<banded_matrix<typename Rep::scalar_t>>>(std::move(res));
+}
+
+template<class Structured>
+inline std::experimental::la::matrix<typename std::experimental::la::structured_traits<Structured>::dense_rep_t> std::experimental::la::to_dense(matrix<structured_traits<Structured>> const& mat)
+{
+    return matrix<typename structured_traits<Structured>::dense_rep_t>(structured_traits<Structured>::to_dense(mat.data()));
+}
+
+////////////////////////////////////////////////////////
+// structured kernels implementation
+////////////////////////////////////////////////////////
+inline constexpr size_t std::experimental::la::detail::packed_offset(size_t k) noexcept
+{
+    return k * (k + 1) / 2;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::packed_lower_solve(Scalar const* l, size_t n, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept
+{
+    // Forward substitution a row of L at a time, subtracting each earlier row of X from row i
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        auto const* row = l + packed_offset(i);
+        auto* xi = x + ptrdiff_t(i) * rsx;
+        for (auto j = size_t(0); j < i; ++j)
+        {
+            auto const m = row[j];
+            auto const* xj = x + ptrdiff_t(j) * rsx;
+            for (auto k = size_t(0); k < nrhs; ++k) xi[ptrdiff_t(k) * csx] -= m * xj[ptrdiff_t(k) * csx];
+        }
+        for (auto k = size_t(0); k < nrhs; ++k) xi[ptrdiff_t(k) * csx] /= row[i];
+    }
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::packed_upper_solve(Scalar const* u, size_t n, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept
+{
+    // Back substitution a column of U at a time: once row j of X is known, column j is
+    // eliminated from every row above it
+    for (auto j = n; j-- > 0;)
+    {
+        auto const* col = u + packed_offset(j);
+        auto* xj = x + ptrdiff_t(j) * rsx;
+        for (auto k = size_t(0); k < nrhs; ++k) xj[ptrdiff_t(k) * csx] /= col[j];
+        for (auto i = size_t(0); i < j; ++i)
+        {
+            auto const m = col[i];
+            auto* xi = x + ptrdiff_t(i) * rsx;
+            for (auto k = size_t(0); k < nrhs; ++k) xi[ptrdiff_t(k) * csx] -= m * xj[ptrdiff_t(k) * csx];
+        }
+    }
+}
+
+template<class Scalar>
+inline bool std::experimental::la::detail::packed_cholesky_factorize(Scalar* l, size_t n) noexcept
+{
+    // Row by row, so each element is a dot product of two packed rows already computed
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        auto* li = l + packed_offset(i);
+        for (auto j = size_t(0); j <= i; ++j)
+        {
+            auto const* lj = l + packed_offset(j);
+            auto sum = li[j];
+            for (auto k = size_t(0); k < j; ++k) sum -= li[k] * lj[k];
+            if (j < i) li[j] = sum / lj[j];
+            else if (!(sum > Scalar(0))) return false;
+            else li[i] = std::sqrt(sum);
+        }
+    }
+    return true;
+}
+
+template<class Scalar>
+inline bool std::experimental::la::detail::band_lu_factorize(Scalar* ab, size_t n, size_t kl, size_t ku, size_t* pivot, bool& odd_permutation) noexcept
+{
+    using std::abs;
+    auto const width = 2 * kl + ku + 1;
+    // Element (i, j) of the working band; j - i lies in [-kl, kl + ku]
+    auto const at = [&](size_t i, size_t j) -> Scalar& { return ab[i * width + (j + kl - i)]; };
+    auto nonsingular = true;
+    odd_permutation = false;
+    for (auto k = size_t(0); k < n; ++k)
+    {
+        // Only the kl rows below can reach column k, and a row taken from there brings its
+        // elements out to column k + kl + ku, the widest U gets
+        auto const last_row = std::min(n, k + kl + 1);
+        auto const last_col = std::min(n, k + kl + ku + 1);
+        auto p = k;
+        for (auto i = k + 1; i < last_row; ++i)
+        {
+            if (abs(at(i, k)) > abs(at(p, k))) p = i;
+        }
+        pivot[k] = p;
+        if (at(p, k) == Scalar(0))
+        {
+            nonsingular = false;
+            continue;
+        }
+        if (p != k)
+        {
+            for (auto j = k; j < last_col; ++j) std::swap(at(k, j), at(p, j));
+            odd_permutation = !odd_permutation;
+        }
+        auto const d = at(k, k);
+        for (auto i = k + 1; i < last_row; ++i)
+        {
+            auto const m = at(i, k) / d;
+            at(i, k) = m;
+            if (m == Scalar(0)) continue;
+            for (auto j = k + 1; j < last_col; ++j) at(i, j) -= m * at(k, j);
+        }
+    }
+    return nonsingular;
+}
+
+template<class Scalar>
+inline void std::experimental::la::detail::band_lu_solve(Scalar const* ab, size_t n, size_t kl, size_t ku, size_t const* pivot, Scalar* x, size_t nrhs, ptrdiff_t rsx, ptrdiff_t csx) noexcept
+{
+    auto const width = 2 * kl + ku + 1;
+    auto const at = [&](size_t i, size_t j) { return ab[i * width + (j + kl - i)]; };
+    auto const subtract_row = [&](Scalar m, size_t from, size_t to) {
+        auto const* in = x + ptrdiff_t(from) * rsx;
+        auto* out = x + ptrdiff_t(to) * rsx;
+        for (auto c = size_t(0); c < nrhs; ++c) out[ptrdiff_t(c) * csx] -= m * in[ptrdiff_t(c) * csx];
+    };
+    // LY = PB, applying each interchange and elimination in the order they were made
+    for (auto k = size_t(0); k < n; ++k)
+    {
+        if (pivot[k] != k) swap_rows(x, nrhs, rsx, csx, k, pivot[k]);
+        for (auto i = k + 1; i < std::min(n, k + kl + 1); ++i) subtract_row(at(i, k), k, i);
+    }
+    // UX = Y
+    for (auto k = n; k-- > 0;)
+    {
+        for (auto j = k + 1; j < std::min(n, k + kl + ku + 1); ++j) subtract_row(at(k, j), j, k);
+        auto* row = x + ptrdiff_t(k) * rsx;
+        for (auto c = size_t(0); c < nrhs; ++c) row[ptrdiff_t(c) * csx] /= at(k, k);
+    }
+}
+
+#endif
@@ -0,0 +1,264 @@
+#if !defined MATRIX_THREAD_POOL_26_10_18_16_40_27
+#define MATRIX_THREAD_POOL_26_10_18_16_40_27
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __has_include(<execution>)
+#include <execution>
+#endif
+
+#if defined __cpp_lib_execution
+#define _LA_EXECUTION_POLICY 1
+#endif
+
+/*
+Work-stealing thread pool behind the parallel overloads.
+
+parallel_for splits a loop into tasks dealt round-robin onto the workers' queues. A worker
+takes from the back of its own queue and, when that is empty, steals from the front of
+the others. The calling thread runs tasks as well until its loop is finished, so a
+parallel_for issued from inside a task cannot deadlock the pool.
+
+Operations reach a pool through an execution argument: a thread_pool, or a standard
+execution policy, where std::execution::par and par_unseq use default_thread_pool() and
+seq and unseq run on the calling thread.
+*/
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // thread_pool
+    ////////////////////////////////////////////////////////
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(size_t concurrency = std::thread::hardware_concurrency());
+        ~thread_pool();
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        size_t concurrency() const noexcept;                    // Worker threads plus the calling thread
+        template<class F> void parallel_for(size_t count, F&& f);     // f(i) for every i in [0, count); f must not throw
+
+    private:
+        struct job
+        {
+            void (*_Run)(void*, size_t) noexcept;
+            void* _Body;
+            std::atomic<size_t> _Remaining;
+        };
+        struct task
+        {
+            job* _Job;
+            size_t _Index;
+        };
+        struct queue
+        {
+            std::mutex _Mutex;
+            std::deque<task> _Tasks;
+        };
+
+        static size_t& worker_index() noexcept;
+        bool try_run_one() noexcept;
+        void worker_loop(size_t index) noexcept;
+
+        std::vector<std::unique_ptr<queue>> _Queues;
+        std::vector<std::thread> _Workers;
+        std::atomic<ptrdiff_t> _Pending{ 0 };          // Queued tasks; briefly negative while a push races a steal
+        std::mutex _Mutex;
+        std::condition_variable _Wake;
+        std::condition_variable _Done;
+        bool _Stop = false;
+    };
+
+    thread_pool& default_thread_pool();
+
+    namespace detail {
+        // Below these sizes work stays on the calling thread
+        inline constexpr size_t parallel_element_threshold = size_t(1) << 15;   // Elements, for element-wise operations and reductions
+        inline constexpr size_t parallel_gemm_threshold = size_t(1) << 21;      // Multiply-adds, for gemm
+
+        // Splits [0, n) into chunks of at least min_chunk and calls f(begin, end) for each,
+        // on the pool when there is one and the range is big enough
+        template<class F>
+        void parallel_chunks(thread_pool* pool, size_t n, size_t min_chunk, F&& f);
+
+        template<class P>
+        inline constexpr bool is_execution_v = std::is_same_v<std::decay_t<P>, thread_pool>
+#if defined _LA_EXECUTION_POLICY
+            || std::is_execution_policy_v<std::decay_t<P>>
+#endif
+            ;
+
+        // The pool an execution argument runs on; null means sequential
+        thread_pool* execution_pool(thread_pool& pool) noexcept;
+        template<class P, class = std::enable_if_t<!std::is_same_v<std::decay_t<P>, thread_pool>>>
+        thread_pool* execution_pool(P const&) noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// thread_pool implementation
+////////////////////////////////////////////////////////
+inline std::experimental::la::thread_pool::thread_pool(size_t concurrency)
+{
+    auto const workers = std::max(concurrency, size_t(1)) - 1;
+    _Queues.reserve(workers);
+    for (auto i = size_t(0); i < workers; ++i) _Queues.push_back(std::make_unique<queue>());
+    _Workers.reserve(workers);
+    for (auto i = size_t(0); i < workers; ++i) _Workers.emplace_back([this, i] { worker_loop(i); });
+}
+
+inline std::experimental::la::thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard lock(_Mutex);
+        _Stop = true;
+    }
+    _Wake.notify_all();
+    for (auto& worker : _Workers) worker.join();
+}
+
+inline size_t std::experimental::la::thread_pool::concurrency() const noexcept
+{
+    return _Workers.size() + 1;
+}
+
+template<class F>
+inline void std::experimental::la::thread_pool::parallel_for(size_t count, F&& f)
+{
+    if (count == 0) return;
+    if (count == 1 || _Workers.empty())
+    {
+        for (auto i = size_t(0); i < count; ++i) f(i);
+        return;
+    }
+
+    using body_t = std::remove_reference_t<F>;
+    auto j = job{ [](void* body, size_t i) noexcept { (*static_cast<body_t*>(body))(i); }, const_cast<void*>(static_cast<void const*>(std::addressof(f))), {} };
+    j._Remaining.store(count, std::memory_order_relaxed);
+    auto const queues = _Queues.size();
+    for (auto q = size_t(0); q < queues; ++q)
+    {
+        std::lock_guard lock(_Queues[q]->_Mutex);
+        for (auto i = q; i < count; i += queues) _Queues[q]->_Tasks.push_back({ &j, i });
+    }
+    {
+        std::lock_guard lock(_Mutex);
+        _Pending.fetch_add(ptrdiff_t(count));
+    }
+    _Wake.notify_all();
+
+    // Help until every task of this loop has run
+    while (j._Remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (try_run_one()) continue;
+        std::unique_lock lock(_Mutex);
+        _Done.wait(lock, [&] { return j._Remaining.load(std::memory_order_acquire) == 0; });
+    }
+}
+
+inline size_t& std::experimental::la::thread_pool::worker_index() noexcept
+{
+    thread_local size_t index = size_t(-1);
+    return index;
+}
+
+inline bool std::experimental::la::thread_pool::try_run_one() noexcept
+{
+    auto const queues = _Queues.size();
+    auto const home = worker_index() < queues ? worker_index() : size_t(0);
+    auto t = task{ nullptr, 0 };
+    for (auto q = size_t(0); q < queues && !t._Job; ++q)
+    {
+        auto& target = *_Queues[(home + q) % queues];
+        std::lock_guard lock(target._Mutex);
+        if (target._Tasks.empty()) continue;
+        // Own queue from the back, for locality; others from the front, taking their oldest work
+        if (q == 0 && worker_index() == home)
+        {
+            t = target._Tasks.back();
+            target._Tasks.pop_back();
+        }
+        else
+        {
+            t = target._Tasks.front();
+            target._Tasks.pop_front();
+        }
+    }
+    if (!t._Job) return false;
+    _Pending.fetch_sub(1);
+    t._Job->_Run(t._Job->_Body, t._Index);
+    if (t._Job->_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        // The job may be destroyed as soon as its owner sees zero, so it is not touched again
+        std::lock_guard lock(_Mutex);
+        _Done.notify_all();
+    }
+    return true;
+}
+
+inline void std::experimental::la::thread_pool::worker_loop(size_t index) noexcept
+{
+    worker_index() = index;
+    for (;;)
+    {
+        if (try_run_one()) continue;
+        std::unique_lock lock(_Mutex);
+        _Wake.wait(lock, [&] { return _Stop || _Pending.load() > 0; });
+        if (_Stop && _Pending.load() <= 0) return;
+    }
+}
+
+inline std::experimental::la::thread_pool& std::experimental::la::default_thread_pool()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+////////////////////////////////////////////////////////
+// execution helpers implementation
+////////////////////////////////////////////////////////
+template<class F>
+inline void std::experimental::la::detail::parallel_chunks(thread_pool* pool, size_t n, size_t min_chunk, F&& f)
+{
+    if (!pool || pool->concurrency() == 1 || n < 2 * min_chunk)
+    {
+        f(size_t(0), n);
+        return;
+    }
+    // A few chunks per thread so stealing can even out uneven progress
+    auto const chunks = std::min((n + min_chunk - 1) / min_chunk, 4 * pool->concurrency());
+    auto const chunk = (n + chunks - 1) / chunks;
+    pool->parallel_for((n + chunk - 1) / chunk, [&](size_t i) {
+        f(i * chunk, std::min(n, (i + 1) * chunk));
+    });
+}
+
+inline std::experimental::la::thread_pool* std::experimental::la::detail::execution_pool(thread_pool& pool) noexcept
+{
+    return &pool;
+}
+
+template<class P, class>
+inline std::experimental::la::thread_pool* std::experimental::la::detail::execution_pool(P const&) noexcept
+{
+#if defined _LA_EXECUTION_POLICY
+    using policy_t = std::decay_t<P>;
+    if constexpr (std::is_same_v<policy_t, std::execution::parallel_policy> || std::is_same_v<policy_t, std::execution::parallel_unsequenced_policy>)
+    {
+        return &default_thread_pool();
+    }
+#endif
+    return nullptr;
+}
+
+#endif
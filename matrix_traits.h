@@ -5,6 +5,19 @@
 #include <algorithm>
 #include <functional>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include "matrix_storage.h"
+#include "matrix_gemm.h"
+#include "matrix_strassen.h"
+#include "matrix_half.h"
+#include "matrix_simd.h"
+#include "matrix_unrolled.h"
+#include "matrix_decomposition.h"
+#include "matrix_thread_pool.h"
 
 /*
 TO DO:
@@ -17,6 +30,24 @@ TO DO:
 */
 
 namespace std::experimental::la {
+    namespace detail {
+        // Transposes recurse down to tiles this wide, whose rows and columns stay in L1 together
+        inline constexpr size_t transpose_tile = 16;
+
+        template<class Storage, class = void>
+        inline constexpr bool is_reshapeable_v = false;
+
+        template<class Storage>
+        inline constexpr bool is_reshapeable_v<Storage, std::void_t<decltype(std::declval<Storage&>().reshape(size_t(), size_t()))>> = true;
+
+        // Products that may take the Strassen-Winograd path: resident, runtime-sized and in
+        // float or double, so the recursion's extra additions round at full precision
+        template<class Storage, class Rhs>
+        inline constexpr bool is_strassen_candidate_v = std::is_floating_point_v<typename Storage::scalar_t>
+            && !std::is_base_of_v<fixed_size_matrix_t, Storage> && !std::is_base_of_v<fixed_size_matrix_t, Rhs>
+            && !is_out_of_core_v<Storage> && !is_out_of_core_v<Rhs>;
+    }
+
     ////////////////////////////////////////////////////////
     // matrix_traits
     ////////////////////////////////////////////////////////
@@ -30,74 +61,192 @@ namespace std::experimental::la {
         template<class Traits2>
         using multiply_t = matrix_traits<typename Storage::template multiply_t<typename Traits2::matrix_t>>;
         
+        // Products and factorisations of out-of-core storages report failing scratch files
+        // and worker threads as std::system_error
         static constexpr bool equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
         static constexpr bool not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
         static constexpr void scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept;
-        template <class Traits2> static constexpr typename multiply_t<Traits2>::matrix_t matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept;
+        template <class Traits2> static constexpr typename multiply_t<Traits2>::matrix_t matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept(!detail::is_out_of_core_v<Storage> && !detail::is_out_of_core_v<typename Traits2::matrix_t>);
         static constexpr void divide(matrix_t& lhs, scalar_t const& rhs) noexcept;
         static constexpr void add(matrix_t& lhs, matrix_t const& rhs) noexcept;
         static constexpr void subtract(matrix_t& lhs, matrix_t const& rhs) noexcept;
         static constexpr auto submatrix(matrix_t const& mat, size_t m, size_t n) noexcept;
         static constexpr typename transpose_t::matrix_t transpose(matrix_t const& mat) noexcept;
+        static constexpr void transpose_inplace(matrix_t& mat);
         static constexpr scalar_t inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept;
         static constexpr scalar_t modulus(matrix_t const& mat) noexcept;
         static constexpr scalar_t modulus_squared(matrix_t const& mat) noexcept;
         static constexpr matrix_t unit(matrix_t const& mat) noexcept;
         static constexpr bool is_identity(matrix_t const& mat) noexcept;
-        static constexpr bool is_invertible(matrix_t const& mat) noexcept;
+        static constexpr bool is_invertible(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>);
         static constexpr matrix_t identity() noexcept;
-        static constexpr scalar_t determinant(matrix_t const& mat) noexcept;
-        static constexpr typename transpose_t::matrix_t classical_adjoint(matrix_t const& mat) noexcept;
+        static constexpr scalar_t determinant(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>);
+        static constexpr typename transpose_t::matrix_t classical_adjoint(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>);
         static constexpr matrix_t inverse(matrix_t const& mat);
+        
+        // In-place updates, writing into an existing matrix; c must not overlap a or b
+        template <class Traits2> static constexpr void gemm(scalar_t alpha, matrix_t const& a, typename Traits2::matrix_t const& b, scalar_t beta, typename multiply_t<Traits2>::matrix_t& c);
+        static constexpr void axpby(scalar_t alpha, matrix_t const& x, scalar_t beta, matrix_t& y) noexcept;
+        template <class Traits2, class Traits3> static constexpr void rank_1_update(scalar_t alpha, typename Traits2::matrix_t const& x, typename Traits3::matrix_t const& y, matrix_t& a);
+        template <class Traits2> static constexpr void rank_k_update(scalar_t alpha, matrix_t const& a, scalar_t beta, typename Traits2::matrix_t& c);
+        static constexpr void multiply_assign(matrix_t& lhs, matrix_t const& rhs);
+        
+        // Parallel overloads, run on pool; a null pool or small operands run sequentially
+        template <class Traits2> static typename multiply_t<Traits2>::matrix_t matrix_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs);
+        static void scalar_multiply(thread_pool* pool, matrix_t& lhs, scalar_t const& rhs);
+        static void divide(thread_pool* pool, matrix_t& lhs, scalar_t const& rhs);
+        static void add(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs);
+        static void subtract(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs);
+        static typename transpose_t::matrix_t transpose(thread_pool* pool, matrix_t const& mat);
+        static scalar_t inner_product(thread_pool* pool, matrix_t const& lhs, matrix_t const& rhs);
+        static scalar_t modulus(thread_pool* pool, matrix_t const& mat);
+        static scalar_t modulus_squared(thread_pool* pool, matrix_t const& mat);
+        static scalar_t determinant(thread_pool* pool, matrix_t const& mat);
+        static matrix_t inverse(thread_pool* pool, matrix_t const& mat);
+        template <class Traits2> static void gemm(thread_pool* pool, scalar_t alpha, matrix_t const& a, typename Traits2::matrix_t const& b, scalar_t beta, typename multiply_t<Traits2>::matrix_t& c);
+        
+        // Strassen-Winograd product whatever strassen_threshold() says; see matrix_strassen.h.
+        // Other storages, and products with a dimension within strassen_cutoff(), multiply as usual.
+        template <class Traits2> static typename multiply_t<Traits2>::matrix_t strassen_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs);
+        
+    private:
+        static constexpr void assert_vector(matrix_t const& mat) noexcept;
+        // Element-wise kernels over raw ranges, shared by the sequential and parallel overloads
+        static constexpr void scalar_multiply_range(scalar_t* lhs, scalar_t rhs, size_t n) noexcept;
+        static constexpr void divide_range(scalar_t* lhs, scalar_t rhs, size_t n) noexcept;
+        static constexpr void add_range(scalar_t* lhs, scalar_t const* rhs, size_t n) noexcept;
+        static constexpr void subtract_range(scalar_t* lhs, scalar_t const* rhs, size_t n) noexcept;
+        static constexpr void axpby_range(scalar_t alpha, scalar_t const* x, scalar_t beta, scalar_t* y, size_t n) noexcept;
+        // C = alpha * A * B + beta * C through the operands' strides, shared by the in-place updates
+        static constexpr void gemm_update(thread_pool* pool, size_t m, size_t n, size_t k, scalar_t alpha,
+            scalar_t const* a, ptrdiff_t rsa, ptrdiff_t csa, scalar_t const* b, ptrdiff_t rsb, ptrdiff_t csb,
+            scalar_t beta, scalar_t* c, ptrdiff_t rsc, ptrdiff_t csc);
+        // Reductions return the accumulator, so half and bfloat16 results are rounded once by the caller
+        static constexpr detail::accumulator_t<scalar_t> inner_product_range(scalar_t const* lhs, scalar_t const* rhs, size_t n) noexcept;
+        static constexpr detail::accumulator_t<scalar_t> modulus_squared_range(scalar_t const* mat, size_t n) noexcept;
+        static detail::accumulator_t<scalar_t> modulus_squared_range(thread_pool* pool, scalar_t const* mat, size_t n);
+        static constexpr void transpose_rows(scalar_t const* in, scalar_t* out, size_t rows, size_t cols, size_t r0, size_t r1) noexcept;
+        static constexpr void transpose_block(scalar_t const* in, scalar_t* out, size_t rows, size_t cols, size_t r0, size_t r1, size_t c0, size_t c1) noexcept;
+        static constexpr void transpose_square(scalar_t* mat, size_t n) noexcept;
+        static void transpose_cycles(scalar_t* mat, size_t rows, size_t cols);
+        // The element buffer as a row-major array: rows by cols, or cols by rows for column-major storage
+        static constexpr std::pair<size_t, size_t> buffer_shape(matrix_t const& mat) noexcept;
     };
 }
 
 ////////////////////////////////////////////////////////
 // matrix_traits implementation
 ////////////////////////////////////////////////////////
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::assert_vector([[maybe_unused]] matrix_t const& mat) noexcept
+{
+    if constexpr (std::is_base_of_v<fixed_size_matrix_t, Storage>)
+    {
+        static_assert(Storage::row == 1 || Storage::col == 1);
+        static_assert(Storage::row != Storage::col);
+    }
+    else
+    {
+        assert(mat.rows() == 1 || mat.cols() == 1);
+    }
+}
+
 template<class Storage>
 inline constexpr bool std::experimental::la::matrix_traits<Storage>::equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
 {
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_equal(lhs, rhs);
+    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) return false;     // Dynamic storages may differ in shape
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        auto const n = size_t(lhs.cend() - lhs.cbegin());
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().equal(lhs.cbegin(), rhs.cbegin(), n);
+    }
     return std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin());
 }
 
 template<class Storage>
 inline constexpr bool std::experimental::la::matrix_traits<Storage>::not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
 {
-    return !std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin());
+    return !equal(lhs, rhs);
 }
 
 template<class Storage>
 inline constexpr void std::experimental::la::matrix_traits<Storage>::scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept
 {
-    std::transform(lhs.begin(), lhs.end(), lhs.begin(), [&](const auto& el) {return el * rhs; });
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_scalar_multiply(lhs, rhs);
+    scalar_multiply_range(lhs.begin(), rhs, size_t(lhs.end() - lhs.begin()));
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::scalar_multiply_range(scalar_t* lhs, scalar_t rhs, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().scalar_multiply(lhs, rhs, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::widened_dispatch<scalar_t>().scalar_multiply(lhs, float(rhs), n);
+    }
+    std::transform(lhs, lhs + n, lhs, [&](const auto& el) {return el * rhs; });
 }
 
 template<class Storage>
 template<class Traits2>
-inline constexpr typename std::experimental::la::matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t std::experimental::la::matrix_traits<Storage>::matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept
+inline constexpr typename std::experimental::la::matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t std::experimental::la::matrix_traits<Storage>::matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept(!detail::is_out_of_core_v<Storage> && !detail::is_out_of_core_v<typename Traits2::matrix_t>)
 {
-    auto res = typename matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t{};
-    auto out = res.begin();
-    auto l_in = lhs.cbegin();
-    auto r_in = rhs.cbegin();
-    for (auto i = 0U; i < Storage::row; ++i)
+    using result_t = typename matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t;
+    using rhs_t = typename Traits2::matrix_t;
+    assert(lhs.cols() == rhs.rows());
+    if constexpr (detail::is_unrolled_v<Storage> && detail::is_unrolled_v<rhs_t> && !detail::is_reduced_precision_v<scalar_t>) return detail::unrolled_multiply<result_t>(lhs, rhs);
+    auto res = detail::make_storage<result_t>(lhs, std::pair(lhs.rows(), rhs.cols()));
+    auto const m = lhs.rows();
+    auto const n = rhs.cols();
+    auto const k = lhs.cols();
+    auto const one = scalar_t(1);
+    auto const zero = scalar_t(0);
+    // Every operand goes to the kernels through its strides, so any mix of layouts, and a
+    // view on the right, is multiplied where it lies rather than converted first
+    auto const a = detail::as_view(lhs);
+    auto const b = detail::as_view(rhs);
+    auto const c = detail::as_view(res);
+    if constexpr (detail::is_out_of_core_v<Storage> || detail::is_out_of_core_v<rhs_t>)
+    {
+        // Operands larger than the budget are streamed through it in tiles
+        if (detail::exceeds_out_of_core_budget<scalar_t>(m * k + k * n + m * n))
+        {
+            detail::out_of_core_gemm(m, n, k, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), c.data(), c.row_stride(), c.col_stride());
+            return res;
+        }
+    }
+    // Small fixed sizes never reach the blocked engine, so it is not instantiated for them
+    constexpr auto direct_only = [] {
+        if constexpr (std::is_base_of_v<fixed_size_matrix_t, Storage> && std::is_base_of_v<fixed_size_matrix_t, rhs_t>)
+        {
+            constexpr auto direct = detail::gemm_blocking<scalar_t>::direct_size;
+            return Storage::row * Storage::col * rhs_t::col <= direct * direct * direct;
+        }
+        else return false;
+    }();
+    if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        detail::widened_gemm(nullptr, m, n, k, 1.0f, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), 0.0f, c.data(), c.row_stride(), c.col_stride());
+    }
+    else if constexpr (direct_only)
     {
-        for (auto j = 0U; j < Traits2::matrix_t::col; ++j)
+        detail::gemm_direct(m, n, k, one, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), zero, c.data(), c.row_stride(), c.col_stride());
+    }
+    else
+    {
+        if constexpr (detail::is_strassen_candidate_v<Storage, rhs_t>)
         {
-            auto dp = typename Storage::scalar_t(0);
-            for (auto k = 0U; k < Traits2::matrix_t::col; ++k)
+            if (detail::prefers_strassen(m, n, k))
             {
-                dp += *l_in++ * *r_in;
-                r_in += Traits2::matrix_t::col;
+                detail::strassen_gemm<scalar_t>(nullptr, m, n, k, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), c.data(), c.row_stride(), c.col_stride());
+                return res;
             }
-            *out++ = dp;
-            l_in -= Traits2::matrix_t::col;
-            r_in -= Traits2::matrix_t::col * Traits2::matrix_t::col;
-            ++r_in;
         }
-        l_in += Traits2::matrix_t::col;
-        r_in -= Traits2::matrix_t::col;
+        detail::gemm(m, n, k, one, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), zero, c.data(), c.row_stride(), c.col_stride());
     }
     return res;
 }
@@ -105,51 +254,123 @@ inline constexpr typename std::experimental::la::matrix_traits<Storage>::templat
 template<class Storage>
 inline constexpr void std::experimental::la::matrix_traits<Storage>::divide(matrix_t& lhs, scalar_t const& rhs) noexcept
 {
-    std::transform(lhs.begin(), lhs.end(), lhs.begin(), [&](const auto& el) {return el / rhs; });
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_divide(lhs, rhs);
+    divide_range(lhs.begin(), rhs, size_t(lhs.end() - lhs.begin()));
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::divide_range(scalar_t* lhs, scalar_t rhs, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().divide(lhs, rhs, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::widened_dispatch<scalar_t>().divide(lhs, float(rhs), n);
+    }
+    std::transform(lhs, lhs + n, lhs, [&](const auto& el) {return el / rhs; });
 }
 
 template<class Storage>
 inline constexpr void std::experimental::la::matrix_traits<Storage>::add(matrix_t& lhs, matrix_t const& rhs) noexcept
 {
-    std::transform(lhs.begin(), lhs.end(), rhs.cbegin(), lhs.begin(), [&](const auto& lel, const auto& rel) {return lel + rel; });
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_add(lhs, rhs);
+    add_range(lhs.begin(), rhs.cbegin(), size_t(lhs.end() - lhs.begin()));
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::add_range(scalar_t* lhs, scalar_t const* rhs, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().add(lhs, rhs, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::widened_dispatch<scalar_t>().add(lhs, rhs, n);
+    }
+    std::transform(lhs, lhs + n, rhs, lhs, [&](const auto& lel, const auto& rel) {return lel + rel; });
 }
 
 template<class Storage>
 inline constexpr void std::experimental::la::matrix_traits<Storage>::subtract(matrix_t& lhs, matrix_t const& rhs) noexcept
 {
-    std::transform(lhs.begin(), lhs.end(), rhs.cbegin(), lhs.begin(), [&](const auto& lel, const auto& rel) {return lel - rel; });
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_subtract(lhs, rhs);
+    subtract_range(lhs.begin(), rhs.cbegin(), size_t(lhs.end() - lhs.begin()));
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::subtract_range(scalar_t* lhs, scalar_t const* rhs, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().subtract(lhs, rhs, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::widened_dispatch<scalar_t>().subtract(lhs, rhs, n);
+    }
+    std::transform(lhs, lhs + n, rhs, lhs, [&](const auto& lel, const auto& rel) {return lel - rel; });
 }
 
 template<class Storage>
 inline constexpr typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept
 {
-    static_assert(Storage::row == 1 || Storage::col == 1);
-    static_assert(Storage::row != Storage::col);
-    return typename Storage::scalar_t(std::inner_product(lhs.cbegin(), lhs.cend(), rhs.cbegin(), typename Storage::scalar_t(0)));
+    assert_vector(lhs);
+    if constexpr (detail::is_unrolled_v<Storage> && !detail::is_reduced_precision_v<scalar_t>) return detail::unrolled_inner_product(lhs, rhs);
+    return scalar_t(inner_product_range(lhs.cbegin(), rhs.cbegin(), size_t(lhs.cend() - lhs.cbegin())));
+}
+
+template<class Storage>
+inline constexpr std::experimental::la::detail::accumulator_t<typename Storage::scalar_t> std::experimental::la::matrix_traits<Storage>::inner_product_range(scalar_t const* lhs, scalar_t const* rhs, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().inner_product(lhs, rhs, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        return detail::widened_dispatch<scalar_t>().inner_product(lhs, rhs, n);
+    }
+    return typename Storage::scalar_t(std::inner_product(lhs, lhs + n, rhs, typename Storage::scalar_t(0)));
 }
 
 template<class Storage>
 inline constexpr typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::modulus(matrix_t const& mat) noexcept
 {
-    static_assert(Storage::row == 1 || Storage::col == 1);
-    static_assert(Storage::row != Storage::col);
-    return typename Storage::scalar_t(std::sqrt(modulus_squared(mat)));
+    assert_vector(mat);
+    if constexpr (detail::is_unrolled_v<Storage> && !detail::is_reduced_precision_v<scalar_t>) return scalar_t(std::sqrt(detail::unrolled_modulus_squared(mat)));
+    return scalar_t(std::sqrt(modulus_squared_range(mat.cbegin(), size_t(mat.cend() - mat.cbegin()))));
 }
 
 template<class Storage>
 inline constexpr typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::modulus_squared(matrix_t const& mat) noexcept
 {
-    static_assert(Storage::row == 1 || Storage::col == 1);
-    static_assert(Storage::row != Storage::col);
-    return std::accumulate(mat.cbegin(), mat.cend(), typename Storage::scalar_t(0), [&](typename Storage::scalar_t tot, const auto& el) {return tot + (el * el); });
+    assert_vector(mat);
+    if constexpr (detail::is_unrolled_v<Storage> && !detail::is_reduced_precision_v<scalar_t>) return detail::unrolled_modulus_squared(mat);
+    return scalar_t(modulus_squared_range(mat.cbegin(), size_t(mat.cend() - mat.cbegin())));
+}
+
+template<class Storage>
+inline constexpr std::experimental::la::detail::accumulator_t<typename Storage::scalar_t> std::experimental::la::matrix_traits<Storage>::modulus_squared_range(scalar_t const* mat, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().modulus_squared(mat, n);
+    }
+    else if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        return detail::widened_dispatch<scalar_t>().modulus_squared(mat, n);
+    }
+    return std::accumulate(mat, mat + n, typename Storage::scalar_t(0), [&](typename Storage::scalar_t tot, const auto& el) {return tot + (el * el); });
 }
 
 template<class Storage>
 inline constexpr typename std::experimental::la::matrix_traits<Storage>::matrix_t std::experimental::la::matrix_traits<Storage>::unit(matrix_t const& mat) noexcept
 {
-    static_assert(Storage::row == 1 || Storage::col == 1);
-    static_assert(Storage::row != Storage::col);
-    auto res(mat);
+    assert_vector(mat);
+    auto res = detail::copy_storage(mat);
     auto mod = modulus(mat);
     std::transform(mat.cbegin(), mat.cend(), res.begin(), [&](const auto& el) { return el / mod; });
     return res;
@@ -158,35 +379,32 @@ inline constexpr typename std::experimental::la::matrix_traits<Storage>::matrix_
 template<class Storage>
 inline constexpr bool std::experimental::la::matrix_traits<Storage>::is_identity(matrix_t const& mat) noexcept
 {
-    static_assert(Storage::row == Storage::col);
+    if constexpr (std::is_base_of_v<fixed_size_matrix_t, Storage>) static_assert(Storage::row == Storage::col);
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_is_identity(mat);
+    auto const n = mat.rows();
+    if (n != mat.cols()) return false;
     auto l_in = mat.cbegin();
-    auto x = Storage::row + 1;
-    for (auto y = 0; y != Storage::row * Storage::row; ++y, ++l_in)
+    for (auto i = size_t(0); i < n; ++i)
     {
-        if (x == (Storage::row + 1) && *l_in != typename Storage::scalar_t(1))
-        {
-            return false;
-        }
-        else if (x != Storage::row + 1)
+        for (auto j = size_t(0); j < n; ++j, ++l_in)
         {
-            if (*l_in != typename Storage::scalar_t(0)) return false;
+            if (*l_in != (i == j ? scalar_t(1) : scalar_t(0))) return false;
         }
-        if (--x == 0) x = Storage::row + 1;
-            }
+    }
     return true;
 }
 
 template<class Storage>
-inline constexpr bool std::experimental::la::matrix_traits<Storage>::is_invertible(matrix_t const& mat) noexcept
+inline constexpr bool std::experimental::la::matrix_traits<Storage>::is_invertible(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>)
 {
-    // TODO
-    return true;
+    return lu_decomposition<Storage>(mat).is_invertible();
 }
 
 template<class Storage>
 inline constexpr typename std::experimental::la::matrix_traits<Storage>::matrix_t std::experimental::la::matrix_traits<Storage>::identity() noexcept
 {
     static_assert(Storage::row == Storage::col);
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_identity<Storage>();
     auto res = matrix_t{};
     auto out = res.begin();
     auto x = Storage::row + 1;
@@ -206,66 +424,133 @@ inline constexpr typename std::experimental::la::matrix_traits<Storage>::matrix_
 }
 
 template<class Storage>
-inline constexpr typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::determinant(matrix_t const& mat) noexcept
+inline constexpr typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::determinant(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>)
 {
-    static_assert(Storage::row == Storage::col);
-    if constexpr (Storage::row == 1) return mat._Data[0];
-    else if constexpr (Storage::row == 2) return (mat._Data[0] * mat._Data[3]) - (mat._Data[1] * mat._Data[2]);
-    else if constexpr (Storage::row > 2)
+    // Closed forms up to 4x4, LU factorisation beyond
+    if constexpr (detail::is_unrolled_v<Storage>)
     {
-        auto det = scalar_t(0);
-        auto sign = scalar_t(1);
-        for (auto f = 0; f < Storage::row; ++f)
-        {
-            auto sub = submatrix(mat, 0, f);
-            auto cofactor = sign * mat._Data[f] * submatrix_t::determinant(sub);
-            det += cofactor;
-            sign = -sign;
-        }
-        return det;
+        return detail::unrolled_determinant(mat);
+    }
+    else
+    {
+        return lu_decomposition<Storage>(mat).determinant();
     }
 }
 
 template<class Storage>
-inline constexpr typename std::experimental::la::matrix_traits<Storage>::transpose_t::matrix_t std::experimental::la::matrix_traits<Storage>::classical_adjoint(matrix_t const& mat) noexcept
+inline constexpr typename std::experimental::la::matrix_traits<Storage>::transpose_t::matrix_t std::experimental::la::matrix_traits<Storage>::classical_adjoint(matrix_t const& mat) noexcept(!detail::is_out_of_core_v<Storage>)
 {
-    static_assert(Storage::row == Storage::col);
-    auto res = matrix_t{};
-    for (auto i = 0; i < Storage::row; ++i)
+    auto const n = mat.rows();
+    assert(n == mat.cols());
+    auto res = detail::make_storage<matrix_t>(mat, std::pair(n, n));
+    if constexpr (detail::is_unrolled_v<Storage>)
     {
-        auto sign = i % 2 == 0 ? scalar_t(1) : scalar_t(-1);
-        for (auto j = 0; j < Storage::row; ++j)
+        // Closed form from the 2x2 minors
+        detail::unrolled_adjoint(mat, res);
+    }
+    else
+    {
+        auto lu = lu_decomposition<Storage>(mat);
+        auto const rank = lu.rank();
+        if (rank == n)
+        {
+            // adj(A) = det(A) A^-1
+            res = lu.inverse();
+            scalar_multiply(res, lu.determinant());
+        }
+        else if (rank + 1 == n)
+        {
+            // Rank n-1: adj(A) = g x y* with Ax = 0 and y*A = 0, read off the factors in O(n^2).
+            // In buffer terms PA = LU, so adj(A) = adj(U) L^-1 det(P) P, and with k the zero pivot
+            // adj(U) = x y* prod(u_ii, i != k) for the null vectors of U with x_k = y_k = 1.
+            // adj(A*) = adj(A)*, so the same buffer arithmetic serves column-major storage.
+            using std::abs;
+            auto const* lu_data = lu.packed().cbegin();
+            auto const at = [&](size_t i, size_t j) { return lu_data[i * n + j]; };
+            auto k = size_t(0);
+            for (auto i = size_t(1); i < n; ++i)
+            {
+                if (abs(at(i, i)) < abs(at(k, k))) k = i;
+            }
+            auto g = scalar_t(1);
+            for (auto i = size_t(0); i < n; ++i)
+            {
+                if (i != k) g *= at(i, i);
+                if (lu.pivots()[i] != i) g = -g;
+            }
+            
+            // Ux = 0 by back substitution above the zero pivot
+            auto x = std::vector<scalar_t>(n, scalar_t(0));
+            x[k] = scalar_t(1);
+            for (auto i = k; i-- > 0;)
+            {
+                auto sum = scalar_t(0);
+                for (auto j = i + 1; j <= k; ++j) sum += at(i, j) * x[j];
+                x[i] = -sum / at(i, i);
+            }
+            
+            // y*U = 0 by forward substitution below it, then w = P* L*^-1 y
+            auto w = std::vector<scalar_t>(n, scalar_t(0));
+            w[k] = scalar_t(1);
+            for (auto j = k + 1; j < n; ++j)
+            {
+                auto sum = scalar_t(0);
+                for (auto i = k; i < j; ++i) sum += w[i] * at(i, j);
+                w[j] = -sum / at(j, j);
+            }
+            for (auto i = n; i-- > 0;)
+            {
+                for (auto j = i + 1; j < n; ++j) w[i] -= at(j, i) * w[j];
+            }
+            for (auto i = n; i-- > 0;)
+            {
+                if (lu.pivots()[i] != i) std::swap(w[i], w[lu.pivots()[i]]);
+            }
+            
+            auto* out = res.begin();
+            for (auto i = size_t(0); i < n; ++i)
+            {
+                auto const gx = g * x[i];
+                for (auto j = size_t(0); j < n; ++j) out[i * n + j] = gx * w[j];
+            }
+        }
+        else
         {
-            auto sub = submatrix(mat, i, j);
-            auto det = submatrix_t::determinant(sub);
-            res._Data[i * Storage::row + j] = sign * det;
-            sign = -sign;
+            std::fill(res.begin(), res.end(), scalar_t(0));
         }
     }
-    return transpose(res);
+    return res;
 }
 
 template<class Storage>
 inline constexpr typename std::experimental::la::matrix_traits<Storage>::matrix_t std::experimental::la::matrix_traits<Storage>::inverse(matrix_t const& mat)
 {
-    auto adj = classical_adjoint(mat);
-    auto det = determinant(mat);
-    std::transform(adj._Data, adj._Data + (Storage::row * Storage::row), adj._Data, [&](const auto& el) { return el / det; });
-    return adj;
+    if constexpr (detail::is_unrolled_v<Storage>)
+    {
+        return detail::unrolled_inverse(mat);
+    }
+    else
+    {
+        return lu_decomposition<Storage>(mat).inverse();
+    }
 }
 
 template<class Storage>
 inline constexpr auto std::experimental::la::matrix_traits<Storage>::submatrix(matrix_t const& mat, size_t i, size_t j) noexcept
 {
-    static_assert(Storage::row > 1 && Storage::col > 1);
+    if constexpr (std::is_base_of_v<fixed_size_matrix_t, Storage>) static_assert(Storage::row > 1 && Storage::col > 1);
+    assert(mat.rows() > 1 && mat.cols() > 1);
+    // Walk the buffer in storage order; the result has the same layout, so it fills in order too
+    auto const shape = buffer_shape(mat);
+    auto const skip = detail::is_column_major_v<Storage> ? std::pair(j, i) : std::pair(i, j);
     auto l_in = mat.cbegin();
-    auto res = typename submatrix_t::matrix_t{};
+    auto res = detail::make_storage<typename submatrix_t::matrix_t>(mat, std::pair(mat.rows() - 1, mat.cols() - 1));
     auto r_out = res.begin();
-    for (auto r = 0U; r < Storage::row; ++r)
+    for (auto r = size_t(0); r < shape.first; ++r)
     {
-        for (auto c = 0U; c < Storage::col; ++c)
+        for (auto c = size_t(0); c < shape.second; ++c)
         {
-            if (r != i && c != j)
+            if (r != skip.first && c != skip.second)
             {
                 *r_out++ = *l_in;
             }
@@ -278,17 +563,420 @@ inline constexpr auto std::experimental::la::matrix_traits<Storage>::submatrix(m
 template<class Storage>
 inline constexpr typename std::experimental::la::matrix_traits<Storage>::transpose_t::matrix_t std::experimental::la::matrix_traits<Storage>::transpose(typename std::experimental::la::matrix_traits<Storage>::matrix_t const& mat) noexcept
 {
-    auto res = typename transpose_t::matrix_t{};
-    for (auto i = 0; i < Storage::row; ++i)
+    if constexpr (detail::is_unrolled_v<Storage>) return detail::unrolled_transpose<typename transpose_t::matrix_t>(mat);
+    // Transposing the buffer transposes the matrix in either layout
+    auto const shape = buffer_shape(mat);
+    auto res = detail::make_storage<typename transpose_t::matrix_t>(mat, std::pair(mat.cols(), mat.rows()));
+    transpose_rows(mat.cbegin(), res.begin(), shape.first, shape.second, 0, shape.first);
+    return res;
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::transpose_inplace(matrix_t& mat)
+{
+    static_assert(std::is_same_v<typename Storage::transpose_t, matrix_t>, "only a storage that is its own transpose can be transposed in place");
+    auto const shape = buffer_shape(mat);
+    if (shape.first == shape.second) transpose_square(mat.begin(), shape.first);
+    else if constexpr (detail::is_reshapeable_v<matrix_t>)
+    {
+        transpose_cycles(mat.begin(), shape.first, shape.second);
+        mat.reshape(mat.cols(), mat.rows());
+    }
+    else assert(shape.first == shape.second && "a rectangular matrix is only transposed in place by a storage with reshape()");
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::transpose_rows(scalar_t const* in, scalar_t* out, size_t rows, size_t cols, size_t r0, size_t r1) noexcept
+{
+    transpose_block(in, out, rows, cols, r0, r1, 0, cols);
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::transpose_block(scalar_t const* in, scalar_t* out, size_t rows, size_t cols, size_t r0, size_t r1, size_t c0, size_t c1) noexcept
+{
+    // Cache-oblivious: halving the longer side until a tile fits means that at every level
+    // of the memory hierarchy some level of the recursion reads and writes whole lines,
+    // rather than touching one element of every destination line for each source row
+    if (r1 - r0 > detail::transpose_tile || c1 - c0 > detail::transpose_tile)
+    {
+        if (r1 - r0 >= c1 - c0)
+        {
+            auto const mid = r0 + (r1 - r0) / 2;
+            transpose_block(in, out, rows, cols, r0, mid, c0, c1);
+            transpose_block(in, out, rows, cols, mid, r1, c0, c1);
+        }
+        else
+        {
+            auto const mid = c0 + (c1 - c0) / 2;
+            transpose_block(in, out, rows, cols, r0, r1, c0, mid);
+            transpose_block(in, out, rows, cols, r0, r1, mid, c1);
+        }
+        return;
+    }
+    for (auto i = r0; i < r1; ++i)
     {
-        for (auto j = 0; j < Storage::col; ++j)
+        for (auto j = c0; j < c1; ++j)
         {
-            res._Data[i + j * Storage::row] = mat._Data[i * Storage::col + j];
+            out[i + j * rows] = in[i * cols + j];
         }
     }
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::transpose_square(scalar_t* mat, size_t n) noexcept
+{
+    // Each tile above the diagonal is swapped with its mirror below it, and the
+    // diagonal tiles with themselves, so both tiles of a pair are in cache together
+    for (auto i0 = size_t(0); i0 < n; i0 += detail::transpose_tile)
+    {
+        auto const i1 = std::min(i0 + detail::transpose_tile, n);
+        for (auto j0 = i0; j0 < n; j0 += detail::transpose_tile)
+        {
+            auto const j1 = std::min(j0 + detail::transpose_tile, n);
+            for (auto i = i0; i < i1; ++i)
+            {
+                for (auto j = std::max(j0, i + 1); j < j1; ++j)
+                {
+                    auto const t = mat[i * n + j];
+                    mat[i * n + j] = mat[j * n + i];
+                    mat[j * n + i] = t;
+                }
+            }
+        }
+    }
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_traits<Storage>::transpose_cycles(scalar_t* mat, size_t rows, size_t cols)
+{
+    // Element (i, j) of the rows by cols buffer moves to (j, i) of the cols by rows one.
+    // That permutation is followed one cycle at a time, carrying a single element, with
+    // a bit per element, 1/64 of a double matrix, marking those already in place
+    auto const n = rows * cols;
+    if (rows == 1 || cols == 1) return;
+    auto moved = std::vector<bool>(n);
+    _LA_RECORD_ALLOCATION((n + 7) / 8);
+    for (auto start = size_t(1); start + 1 < n; ++start)
+    {
+        if (moved[start]) continue;
+        auto k = start;
+        auto carried = mat[k];
+        do
+        {
+            auto const next = (k % cols) * rows + k / cols;
+            auto const displaced = mat[next];
+            mat[next] = carried;
+            carried = displaced;
+            moved[next] = true;
+            k = next;
+        } while (k != start);
+    }
+}
+
+template<class Storage>
+template<class Traits2>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::gemm(scalar_t alpha, matrix_t const& a, typename Traits2::matrix_t const& b, scalar_t beta, typename multiply_t<Traits2>::matrix_t& c)
+{
+    assert(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols());
+    assert(static_cast<void const*>(c.cbegin()) != a.cbegin() && static_cast<void const*>(c.cbegin()) != b.cbegin());
+    auto const av = detail::as_view(a);
+    auto const bv = detail::as_view(b);
+    auto const cv = detail::as_view(c);
+    gemm_update(nullptr, a.rows(), b.cols(), a.cols(), alpha, av.data(), av.row_stride(), av.col_stride(), bv.data(), bv.row_stride(), bv.col_stride(),
+        beta, cv.data(), cv.row_stride(), cv.col_stride());
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::axpby(scalar_t alpha, matrix_t const& x, scalar_t beta, matrix_t& y) noexcept
+{
+    assert(x.rows() == y.rows() && x.cols() == y.cols());
+    axpby_range(alpha, x.cbegin(), beta, y.begin(), size_t(y.end() - y.begin()));
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::axpby_range(scalar_t alpha, scalar_t const* x, scalar_t beta, scalar_t* y, size_t n) noexcept
+{
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().axpby(alpha, x, beta, y, n);
+    }
+    using acc_t = detail::accumulator_t<scalar_t>;
+    for (auto i = size_t(0); i < n; ++i)
+    {
+        y[i] = scalar_t(acc_t(alpha) * acc_t(x[i]) + acc_t(beta) * acc_t(y[i]));
+    }
+}
+
+template<class Storage>
+template<class Traits2, class Traits3>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::rank_1_update(scalar_t alpha, typename Traits2::matrix_t const& x, typename Traits3::matrix_t const& y, matrix_t& a)
+{
+    // x is an m by 1 operand and y a 1 by n one, whatever the orientation of the vectors
+    assert(size_t(x.cend() - x.cbegin()) == a.rows() && size_t(y.cend() - y.cbegin()) == a.cols());
+    auto const av = detail::as_view(a);
+    gemm_update(nullptr, a.rows(), a.cols(), 1, alpha, x.cbegin(), 1, 1, y.cbegin(), 1, 1, scalar_t(1), av.data(), av.row_stride(), av.col_stride());
+}
+
+template<class Storage>
+template<class Traits2>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::rank_k_update(scalar_t alpha, matrix_t const& a, scalar_t beta, typename Traits2::matrix_t& c)
+{
+    // a is passed twice, the second time with its strides exchanged to read it transposed.
+    // Both triangles of c are computed, so c need not be symmetric beforehand
+    assert(c.rows() == a.rows() && c.cols() == a.rows());
+    assert(static_cast<void const*>(c.cbegin()) != a.cbegin());
+    auto const av = detail::as_view(a);
+    auto const cv = detail::as_view(c);
+    gemm_update(nullptr, a.rows(), a.rows(), a.cols(), alpha, av.data(), av.row_stride(), av.col_stride(), av.data(), av.col_stride(), av.row_stride(),
+        beta, cv.data(), cv.row_stride(), cv.col_stride());
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::multiply_assign(matrix_t& lhs, matrix_t const& rhs)
+{
+    assert(lhs.cols() == rhs.rows() && rhs.rows() == rhs.cols());
+    // Fixed sizes live on the stack, so the product is simply made and assigned
+    if constexpr (std::is_base_of_v<fixed_size_matrix_t, Storage>) lhs = matrix_multiply<matrix_traits>(lhs, rhs);
+    else
+    {
+        if (&lhs == &rhs)
+        {
+            lhs = matrix_multiply<matrix_traits>(lhs, rhs);
+            return;
+        }
+        // Row i of the product needs only row i of lhs, so lhs is overwritten a panel of
+        // rows at a time from a copy of that panel kept in the thread's gemm workspace
+        auto const m = lhs.rows();
+        auto const n = lhs.cols();
+        auto const panel = std::min(m, size_t(4) * detail::gemm_blocking<detail::accumulator_t<scalar_t>>::mc);
+        auto* saved = detail::thread_gemm_workspace<scalar_t>().c_panel(panel * n);
+        auto const c = detail::as_view(lhs);
+        auto const b = detail::as_view(rhs);
+        for (auto i0 = size_t(0); i0 < m; i0 += panel)
+        {
+            auto const count = std::min(panel, m - i0);
+            for (auto i = size_t(0); i < count; ++i)
+            {
+                for (auto j = size_t(0); j < n; ++j) saved[i * n + j] = c(i0 + i, j);
+            }
+            gemm_update(nullptr, count, n, n, scalar_t(1), saved, ptrdiff_t(n), 1, b.data(), b.row_stride(), b.col_stride(),
+                scalar_t(0), c.data() + ptrdiff_t(i0) * c.row_stride(), c.row_stride(), c.col_stride());
+        }
+    }
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::matrix_traits<Storage>::gemm_update(thread_pool* pool, size_t m, size_t n, size_t k, scalar_t alpha,
+    scalar_t const* a, ptrdiff_t rsa, ptrdiff_t csa, scalar_t const* b, ptrdiff_t rsb, ptrdiff_t csb,
+    scalar_t beta, scalar_t* c, ptrdiff_t rsc, ptrdiff_t csc)
+{
+    constexpr auto direct = detail::gemm_blocking<detail::accumulator_t<scalar_t>>::direct_size;
+    if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        detail::widened_gemm(pool, m, n, k, float(alpha), a, rsa, csa, b, rsb, csb, float(beta), c, rsc, csc);
+    }
+    else if (m * n * k <= direct * direct * direct)
+    {
+        // The only path taken in constant evaluation
+        detail::gemm_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+    }
+    else
+    {
+        detail::gemm(pool, m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc);
+    }
+}
+
+template<class Storage>
+inline constexpr std::pair<size_t, size_t> std::experimental::la::matrix_traits<Storage>::buffer_shape(matrix_t const& mat) noexcept
+{
+    if constexpr (detail::is_column_major_v<Storage>) return { mat.cols(), mat.rows() };
+    else return { mat.rows(), mat.cols() };
+}
+
+////////////////////////////////////////////////////////
+// matrix_traits parallel implementation
+////////////////////////////////////////////////////////
+template<class Storage>
+template<class Traits2>
+inline typename std::experimental::la::matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t std::experimental::la::matrix_traits<Storage>::matrix_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs)
+{
+    using result_t = typename matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t;
+    assert(lhs.cols() == rhs.rows());
+    auto const m = lhs.rows();
+    auto const n = rhs.cols();
+    auto const k = lhs.cols();
+    if (!pool || m * n * k < detail::parallel_gemm_threshold) return matrix_multiply<Traits2>(lhs, rhs);
+    auto res = detail::make_storage<result_t>(lhs, std::pair(m, n));
+    auto const a = detail::as_view(lhs);
+    auto const b = detail::as_view(rhs);
+    auto const c = detail::as_view(res);
+    if constexpr (detail::is_out_of_core_v<Storage> || detail::is_out_of_core_v<typename Traits2::matrix_t>)
+    {
+        if (detail::exceeds_out_of_core_budget<scalar_t>(m * k + k * n + m * n))
+        {
+            detail::out_of_core_gemm(m, n, k, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), c.data(), c.row_stride(), c.col_stride(), pool);
+            return res;
+        }
+    }
+    if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        detail::widened_gemm(pool, m, n, k, 1.0f, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), 0.0f, c.data(), c.row_stride(), c.col_stride());
+    }
+    else
+    {
+        if constexpr (detail::is_strassen_candidate_v<Storage, typename Traits2::matrix_t>)
+        {
+            if (detail::prefers_strassen(m, n, k))
+            {
+                detail::strassen_gemm<scalar_t>(pool, m, n, k, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), c.data(), c.row_stride(), c.col_stride());
+                return res;
+            }
+        }
+        detail::gemm(pool, m, n, k, scalar_t(1), a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), scalar_t(0), c.data(), c.row_stride(), c.col_stride());
+    }
     return res;
 }
 
+template<class Storage>
+template<class Traits2>
+inline typename std::experimental::la::matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t std::experimental::la::matrix_traits<Storage>::strassen_multiply(thread_pool* pool, matrix_t const& lhs, typename Traits2::matrix_t const& rhs)
+{
+    using result_t = typename matrix_traits<Storage>::template multiply_t<Traits2>::matrix_t;
+    assert(lhs.cols() == rhs.rows());
+    auto const m = lhs.rows();
+    auto const n = rhs.cols();
+    auto const k = lhs.cols();
+    if constexpr (detail::is_strassen_candidate_v<Storage, typename Traits2::matrix_t>)
+    {
+        if (std::min({ m, n, k }) > strassen_cutoff())
+        {
+            auto res = detail::make_storage<result_t>(lhs, std::pair(m, n));
+            auto const a = detail::as_view(lhs);
+            auto const b = detail::as_view(rhs);
+            auto const c = detail::as_view(res);
+            detail::strassen_gemm<scalar_t>(pool, m, n, k, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), c.data(), c.row_stride(), c.col_stride());
+            return res;
+        }
+    }
+    return matrix_multiply<Traits2>(pool, lhs, rhs);
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_traits<Storage>::scalar_multiply(thread_pool* pool, matrix_t& lhs, scalar_t const& rhs)
+{
+    auto* l = lhs.begin();
+    detail::parallel_chunks(pool, size_t(lhs.end() - l), detail::parallel_element_threshold, [&](size_t b, size_t e) { scalar_multiply_range(l + b, rhs, e - b); });
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_traits<Storage>::divide(thread_pool* pool, matrix_t& lhs, scalar_t const& rhs)
+{
+    auto* l = lhs.begin();
+    detail::parallel_chunks(pool, size_t(lhs.end() - l), detail::parallel_element_threshold, [&](size_t b, size_t e) { divide_range(l + b, rhs, e - b); });
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_traits<Storage>::add(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs)
+{
+    auto* l = lhs.begin();
+    auto const* r = rhs.cbegin();
+    detail::parallel_chunks(pool, size_t(lhs.end() - l), detail::parallel_element_threshold, [&](size_t b, size_t e) { add_range(l + b, r + b, e - b); });
+}
+
+template<class Storage>
+inline void std::experimental::la::matrix_traits<Storage>::subtract(thread_pool* pool, matrix_t& lhs, matrix_t const& rhs)
+{
+    auto* l = lhs.begin();
+    auto const* r = rhs.cbegin();
+    detail::parallel_chunks(pool, size_t(lhs.end() - l), detail::parallel_element_threshold, [&](size_t b, size_t e) { subtract_range(l + b, r + b, e - b); });
+}
+
+template<class Storage>
+template<class Traits2>
+inline void std::experimental::la::matrix_traits<Storage>::gemm(thread_pool* pool, scalar_t alpha, matrix_t const& a, typename Traits2::matrix_t const& b, scalar_t beta, typename multiply_t<Traits2>::matrix_t& c)
+{
+    assert(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols());
+    assert(static_cast<void const*>(c.cbegin()) != a.cbegin() && static_cast<void const*>(c.cbegin()) != b.cbegin());
+    auto const av = detail::as_view(a);
+    auto const bv = detail::as_view(b);
+    auto const cv = detail::as_view(c);
+    gemm_update(pool, a.rows(), b.cols(), a.cols(), alpha, av.data(), av.row_stride(), av.col_stride(), bv.data(), bv.row_stride(), bv.col_stride(),
+        beta, cv.data(), cv.row_stride(), cv.col_stride());
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_traits<Storage>::transpose_t::matrix_t std::experimental::la::matrix_traits<Storage>::transpose(thread_pool* pool, matrix_t const& mat)
+{
+    auto const [rows, cols] = buffer_shape(mat);
+    auto res = detail::make_storage<typename transpose_t::matrix_t>(mat, std::pair(mat.cols(), mat.rows()));
+    auto const* in = mat.cbegin();
+    auto* out = res.begin();
+    detail::parallel_chunks(pool, rows, std::max(size_t(1), detail::parallel_element_threshold / std::max(cols, size_t(1))),
+        [&](size_t r0, size_t r1) { transpose_rows(in, out, rows, cols, r0, r1); });
+    return res;
+}
+
+template<class Storage>
+inline typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::inner_product(thread_pool* pool, matrix_t const& lhs, matrix_t const& rhs)
+{
+    assert_vector(lhs);
+    auto const* l = lhs.cbegin();
+    auto const* r = rhs.cbegin();
+    auto const n = size_t(lhs.cend() - l);
+    if (!pool || n < 2 * detail::parallel_element_threshold) return scalar_t(inner_product_range(l, r, n));
+    // Partial sums per chunk, added in chunk order
+    using acc_t = detail::accumulator_t<scalar_t>;
+    auto const chunks = std::min(n / detail::parallel_element_threshold, 4 * pool->concurrency());
+    auto partial = std::vector<acc_t>(chunks);
+    pool->parallel_for(chunks, [&](size_t i) {
+        auto const b = n * i / chunks;
+        partial[i] = inner_product_range(l + b, r + b, n * (i + 1) / chunks - b);
+    });
+    return scalar_t(std::accumulate(partial.cbegin(), partial.cend(), acc_t(0)));
+}
+
+template<class Storage>
+inline typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::modulus(thread_pool* pool, matrix_t const& mat)
+{
+    assert_vector(mat);
+    return scalar_t(std::sqrt(modulus_squared_range(pool, mat.cbegin(), size_t(mat.cend() - mat.cbegin()))));
+}
+
+template<class Storage>
+inline typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::modulus_squared(thread_pool* pool, matrix_t const& mat)
+{
+    assert_vector(mat);
+    return scalar_t(modulus_squared_range(pool, mat.cbegin(), size_t(mat.cend() - mat.cbegin())));
+}
+
+template<class Storage>
+inline std::experimental::la::detail::accumulator_t<typename Storage::scalar_t> std::experimental::la::matrix_traits<Storage>::modulus_squared_range(thread_pool* pool, scalar_t const* mat, size_t n)
+{
+    if (!pool || n < 2 * detail::parallel_element_threshold) return modulus_squared_range(mat, n);
+    using acc_t = detail::accumulator_t<scalar_t>;
+    auto const chunks = std::min(n / detail::parallel_element_threshold, 4 * pool->concurrency());
+    auto partial = std::vector<acc_t>(chunks);
+    pool->parallel_for(chunks, [&](size_t i) {
+        auto const b = n * i / chunks;
+        partial[i] = modulus_squared_range(mat + b, n * (i + 1) / chunks - b);
+    });
+    return std::accumulate(partial.cbegin(), partial.cend(), acc_t(0));
+}
+
+template<class Storage>
+inline typename Storage::scalar_t std::experimental::la::matrix_traits<Storage>::determinant(thread_pool* pool, matrix_t const& mat)
+{
+    if (!pool || mat.rows() <= detail::lu_block_size) return determinant(mat);
+    return lu_decomposition<Storage>(mat, pool).determinant();
+}
+
+template<class Storage>
+inline typename std::experimental::la::matrix_traits<Storage>::matrix_t std::experimental::la::matrix_traits<Storage>::inverse(thread_pool* pool, matrix_t const& mat)
+{
+    if (!pool || mat.rows() <= detail::lu_block_size) return inverse(mat);
+    return lu_decomposition<Storage>(mat, pool).inverse(pool);
+}
+
 #endif
 
 /*
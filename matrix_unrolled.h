@@ -0,0 +1,366 @@
+#if !defined MATRIX_UNROLLED_26_10_18_19_58_40
+#define MATRIX_UNROLLED_26_10_18_19_58_40
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "matrix_storage.h"
+
+/*
+Fully unrolled kernels for small fixed size matrices.
+
+For a fixed_size_matrix of up to sixteen elements every loop bound is a compile time
+constant, so matrix_traits hands it to the kernels here rather than to the general loops
+and the SIMD dispatch. Each kernel is a fold over a std::index_sequence and expands to
+straight-line code with no loop counter and no branch. The determinant, the classical
+adjoint and the inverse are closed forms over the 2 x 2 minors of the matrix rather than
+cofactor expansions through submatrix temporaries.
+
+Everything here is constexpr and uses no standard algorithm, so small fixed matrices can
+be multiplied, transposed, inverted and compared in constant expressions under C++17.
+*/
+
+namespace std::experimental::la::detail {
+    // Fixed storages with at most this many elements take the unrolled kernels
+    inline constexpr size_t unrolled_max_elements = 16;
+
+    template<class Storage, class = void>
+    inline constexpr bool is_unrolled_v = false;
+
+    template<class Storage>
+    inline constexpr bool is_unrolled_v<Storage, std::enable_if_t<std::is_base_of_v<fixed_size_matrix_t, Storage>>> = Storage::row * Storage::col <= unrolled_max_elements;
+
+    // f(std::integral_constant<size_t, I>{}) for each I in [0, N), as a fold
+    template<size_t N, class F>
+    constexpr void unroll(F&& f) noexcept;
+
+    // The sum, and the conjunction without short-circuit, of f(I) for each I in [0, N)
+    template<size_t N, class F>
+    constexpr auto unroll_sum(F&& f) noexcept;
+
+    template<size_t N, class F>
+    constexpr bool unroll_all(F&& f) noexcept;
+
+    // The expansions behind them
+    template<class F, size_t... I>
+    constexpr void unroll_each(F& f, std::index_sequence<I...>) noexcept;
+
+    template<class F, size_t... I>
+    constexpr auto unroll_fold_sum(F& f, std::index_sequence<I...>) noexcept;
+
+    template<class F, size_t... I>
+    constexpr bool unroll_fold_all(F& f, std::index_sequence<I...>) noexcept;
+
+    // Element-wise
+    template<class Storage>
+    constexpr bool unrolled_equal(Storage const& lhs, Storage const& rhs) noexcept;
+
+    template<class Storage>
+    constexpr void unrolled_scalar_multiply(Storage& lhs, typename Storage::scalar_t rhs) noexcept;
+
+    template<class Storage>
+    constexpr void unrolled_divide(Storage& lhs, typename Storage::scalar_t rhs) noexcept;
+
+    template<class Storage>
+    constexpr void unrolled_add(Storage& lhs, Storage const& rhs) noexcept;
+
+    template<class Storage>
+    constexpr void unrolled_subtract(Storage& lhs, Storage const& rhs) noexcept;
+
+    // Vectors
+    template<class Storage>
+    constexpr typename Storage::scalar_t unrolled_inner_product(Storage const& lhs, Storage const& rhs) noexcept;
+
+    template<class Storage>
+    constexpr typename Storage::scalar_t unrolled_modulus_squared(Storage const& mat) noexcept;
+
+    // Matrices, in any mix of layouts
+    template<class Result, class Lhs, class Rhs>
+    constexpr Result unrolled_multiply(Lhs const& lhs, Rhs const& rhs) noexcept;
+
+    template<class Result, class Storage>
+    constexpr Result unrolled_transpose(Storage const& mat) noexcept;
+
+    template<class Storage>
+    constexpr bool unrolled_is_identity(Storage const& mat) noexcept;
+
+    template<class Storage>
+    constexpr Storage unrolled_identity() noexcept;
+
+    // Square matrices up to 4 x 4
+    template<class Storage>
+    constexpr typename Storage::scalar_t unrolled_determinant(Storage const& mat) noexcept;
+
+    // Writes the classical adjoint to adj and returns the determinant
+    template<class Storage>
+    constexpr typename Storage::scalar_t unrolled_adjoint(Storage const& mat, Storage& adj) noexcept;
+
+    template<class Storage>
+    constexpr Storage unrolled_inverse(Storage const& mat) noexcept;
+
+    template<class Scalar>
+    constexpr Scalar unrolled_cross(Scalar a, Scalar b, Scalar c, Scalar d) noexcept;         // ab - cd
+
+    template<class Storage, size_t... E>
+    constexpr void unrolled_row_major(Storage const& mat, typename Storage::scalar_t* m, std::index_sequence<E...>) noexcept;
+}
+
+////////////////////////////////////////////////////////
+// unroll implementation
+////////////////////////////////////////////////////////
+template<class F, size_t... I>
+inline constexpr void std::experimental::la::detail::unroll_each(F& f, std::index_sequence<I...>) noexcept
+{
+    (f(std::integral_constant<size_t, I>{}), ...);
+}
+
+template<class F, size_t... I>
+inline constexpr auto std::experimental::la::detail::unroll_fold_sum(F& f, std::index_sequence<I...>) noexcept
+{
+    return (... + f(std::integral_constant<size_t, I>{}));
+}
+
+template<class F, size_t... I>
+inline constexpr bool std::experimental::la::detail::unroll_fold_all(F& f, std::index_sequence<I...>) noexcept
+{
+    return (... & bool(f(std::integral_constant<size_t, I>{})));
+}
+
+template<size_t N, class F>
+inline constexpr void std::experimental::la::detail::unroll(F&& f) noexcept
+{
+    unroll_each(f, std::make_index_sequence<N>{});
+}
+
+template<size_t N, class F>
+inline constexpr auto std::experimental::la::detail::unroll_sum(F&& f) noexcept
+{
+    static_assert(N > 0);
+    return unroll_fold_sum(f, std::make_index_sequence<N>{});
+}
+
+template<size_t N, class F>
+inline constexpr bool std::experimental::la::detail::unroll_all(F&& f) noexcept
+{
+    static_assert(N > 0);
+    return unroll_fold_all(f, std::make_index_sequence<N>{});
+}
+
+////////////////////////////////////////////////////////
+// unrolled kernels implementation
+////////////////////////////////////////////////////////
+template<class Storage>
+inline constexpr bool std::experimental::la::detail::unrolled_equal(Storage const& lhs, Storage const& rhs) noexcept
+{
+    return unroll_all<Storage::row * Storage::col>([&](auto e) { return lhs._Data[e] == rhs._Data[e]; });
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::detail::unrolled_scalar_multiply(Storage& lhs, typename Storage::scalar_t rhs) noexcept
+{
+    unroll<Storage::row * Storage::col>([&](auto e) { lhs._Data[e] *= rhs; });
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::detail::unrolled_divide(Storage& lhs, typename Storage::scalar_t rhs) noexcept
+{
+    unroll<Storage::row * Storage::col>([&](auto e) { lhs._Data[e] /= rhs; });
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::detail::unrolled_add(Storage& lhs, Storage const& rhs) noexcept
+{
+    unroll<Storage::row * Storage::col>([&](auto e) { lhs._Data[e] += rhs._Data[e]; });
+}
+
+template<class Storage>
+inline constexpr void std::experimental::la::detail::unrolled_subtract(Storage& lhs, Storage const& rhs) noexcept
+{
+    unroll<Storage::row * Storage::col>([&](auto e) { lhs._Data[e] -= rhs._Data[e]; });
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::detail::unrolled_inner_product(Storage const& lhs, Storage const& rhs) noexcept
+{
+    return unroll_sum<Storage::row * Storage::col>([&](auto e) { return lhs._Data[e] * rhs._Data[e]; });
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::detail::unrolled_modulus_squared(Storage const& mat) noexcept
+{
+    return unroll_sum<Storage::row * Storage::col>([&](auto e) { return mat._Data[e] * mat._Data[e]; });
+}
+
+template<class Result, class Lhs, class Rhs>
+inline constexpr Result std::experimental::la::detail::unrolled_multiply(Lhs const& lhs, Rhs const& rhs) noexcept
+{
+    static_assert(Lhs::col == Rhs::row);
+    constexpr auto m = Lhs::row;
+    constexpr auto k = Lhs::col;
+    constexpr auto n = Rhs::col;
+    auto res = Result{ std::pair(m, n) };
+    unroll<m * n>([&](auto e) {
+        constexpr auto i = decltype(e)::value / n;
+        constexpr auto j = decltype(e)::value % n;
+        res._Data[Result::layout_t::index(i, j, m, n)] = unroll_sum<k>([&](auto p) {
+            return lhs._Data[Lhs::layout_t::index(i, p, m, k)] * rhs._Data[Rhs::layout_t::index(p, j, k, n)];
+        });
+    });
+    return res;
+}
+
+template<class Result, class Storage>
+inline constexpr Result std::experimental::la::detail::unrolled_transpose(Storage const& mat) noexcept
+{
+    constexpr auto rows = Storage::row;
+    constexpr auto cols = Storage::col;
+    auto res = Result{ std::pair(cols, rows) };
+    unroll<rows * cols>([&](auto e) {
+        constexpr auto i = decltype(e)::value / cols;
+        constexpr auto j = decltype(e)::value % cols;
+        res._Data[Result::layout_t::index(j, i, cols, rows)] = mat._Data[Storage::layout_t::index(i, j, rows, cols)];
+    });
+    return res;
+}
+
+template<class Storage>
+inline constexpr bool std::experimental::la::detail::unrolled_is_identity(Storage const& mat) noexcept
+{
+    // Element e is on the diagonal at the same places in either layout
+    constexpr auto n = Storage::row;
+    static_assert(n == Storage::col);
+    return unroll_all<n * n>([&](auto e) {
+        return mat._Data[e] == typename Storage::scalar_t(e / n == e % n ? 1 : 0);
+    });
+}
+
+template<class Storage>
+inline constexpr Storage std::experimental::la::detail::unrolled_identity() noexcept
+{
+    constexpr auto n = Storage::row;
+    static_assert(n == Storage::col);
+    auto res = Storage{ std::pair(n, n) };
+    unroll<n>([&](auto i) { res._Data[i * (n + 1)] = typename Storage::scalar_t(1); });
+    return res;
+}
+
+template<class Scalar>
+inline constexpr Scalar std::experimental::la::detail::unrolled_cross(Scalar a, Scalar b, Scalar c, Scalar d) noexcept
+{
+    return a * b - c * d;
+}
+
+template<class Storage, size_t... E>
+inline constexpr void std::experimental::la::detail::unrolled_row_major(Storage const& mat, typename Storage::scalar_t* m, std::index_sequence<E...>) noexcept
+{
+    ((m[E] = mat._Data[Storage::layout_t::index(E / Storage::col, E % Storage::col, Storage::row, Storage::col)]), ...);
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::detail::unrolled_determinant(Storage const& mat) noexcept
+{
+    // det(A*) = det(A), so the layout does not matter
+    using scalar_t = typename Storage::scalar_t;
+    constexpr auto n = Storage::row;
+    static_assert(n == Storage::col && n >= 1 && n <= 4);
+    auto const* a = mat._Data;
+    if constexpr (n == 1) return a[0];
+    else if constexpr (n == 2) return (a[0] * a[3]) - (a[1] * a[2]);
+    else if constexpr (n == 3) return a[0] * (a[4] * a[8] - a[5] * a[7]) - a[1] * (a[3] * a[8] - a[5] * a[6]) + a[2] * (a[3] * a[7] - a[4] * a[6]);
+    else
+    {
+        // Laplace expansion by the 2 x 2 minors of the first two and last two rows
+        scalar_t const s[] = {
+            unrolled_cross(a[0], a[5], a[4], a[1]), unrolled_cross(a[0], a[6], a[4], a[2]), unrolled_cross(a[0], a[7], a[4], a[3]),
+            unrolled_cross(a[1], a[6], a[5], a[2]), unrolled_cross(a[1], a[7], a[5], a[3]), unrolled_cross(a[2], a[7], a[6], a[3]) };
+        scalar_t const c[] = {
+            unrolled_cross(a[8], a[13], a[12], a[9]), unrolled_cross(a[8], a[14], a[12], a[10]), unrolled_cross(a[8], a[15], a[12], a[11]),
+            unrolled_cross(a[9], a[14], a[13], a[10]), unrolled_cross(a[9], a[15], a[13], a[11]), unrolled_cross(a[10], a[15], a[14], a[11]) };
+        return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+    }
+}
+
+template<class Storage>
+inline constexpr typename Storage::scalar_t std::experimental::la::detail::unrolled_adjoint(Storage const& mat, Storage& adj) noexcept
+{
+    // Computed on a row-major copy, which the compiler elides for row-major storage
+    using scalar_t = typename Storage::scalar_t;
+    constexpr auto n = Storage::row;
+    static_assert(n == Storage::col && n >= 1 && n <= 4);
+    scalar_t m[n * n]{};
+    scalar_t r[n * n]{};
+    unrolled_row_major(mat, m, std::make_index_sequence<n * n>{});
+    auto det = scalar_t(0);
+    if constexpr (n == 1)
+    {
+        r[0] = scalar_t(1);
+        det = m[0];
+    }
+    else if constexpr (n == 2)
+    {
+        r[0] = m[3];
+        r[1] = -m[1];
+        r[2] = -m[2];
+        r[3] = m[0];
+        det = unrolled_cross(m[0], m[3], m[1], m[2]);
+    }
+    else if constexpr (n == 3)
+    {
+        r[0] = unrolled_cross(m[4], m[8], m[5], m[7]);
+        r[1] = unrolled_cross(m[2], m[7], m[1], m[8]);
+        r[2] = unrolled_cross(m[1], m[5], m[2], m[4]);
+        r[3] = unrolled_cross(m[5], m[6], m[3], m[8]);
+        r[4] = unrolled_cross(m[0], m[8], m[2], m[6]);
+        r[5] = unrolled_cross(m[2], m[3], m[0], m[5]);
+        r[6] = unrolled_cross(m[3], m[7], m[4], m[6]);
+        r[7] = unrolled_cross(m[1], m[6], m[0], m[7]);
+        r[8] = unrolled_cross(m[0], m[4], m[1], m[3]);
+        det = m[0] * r[0] + m[1] * r[3] + m[2] * r[6];
+    }
+    else
+    {
+        auto const s0 = unrolled_cross(m[0], m[5], m[4], m[1]);
+        auto const s1 = unrolled_cross(m[0], m[6], m[4], m[2]);
+        auto const s2 = unrolled_cross(m[0], m[7], m[4], m[3]);
+        auto const s3 = unrolled_cross(m[1], m[6], m[5], m[2]);
+        auto const s4 = unrolled_cross(m[1], m[7], m[5], m[3]);
+        auto const s5 = unrolled_cross(m[2], m[7], m[6], m[3]);
+        auto const c0 = unrolled_cross(m[8], m[13], m[12], m[9]);
+        auto const c1 = unrolled_cross(m[8], m[14], m[12], m[10]);
+        auto const c2 = unrolled_cross(m[8], m[15], m[12], m[11]);
+        auto const c3 = unrolled_cross(m[9], m[14], m[13], m[10]);
+        auto const c4 = unrolled_cross(m[9], m[15], m[13], m[11]);
+        auto const c5 = unrolled_cross(m[10], m[15], m[14], m[11]);
+        r[0] = unrolled_cross(m[5], c5, m[6], c4) + m[7] * c3;
+        r[1] = unrolled_cross(m[2], c4, m[1], c5) - m[3] * c3;
+        r[2] = unrolled_cross(m[13], s5, m[14], s4) + m[15] * s3;
+        r[3] = unrolled_cross(m[10], s4, m[9], s5) - m[11] * s3;
+        r[4] = unrolled_cross(m[6], c2, m[4], c5) - m[7] * c1;
+        r[5] = unrolled_cross(m[0], c5, m[2], c2) + m[3] * c1;
+        r[6] = unrolled_cross(m[14], s2, m[12], s5) - m[15] * s1;
+        r[7] = unrolled_cross(m[8], s5, m[10], s2) + m[11] * s1;
+        r[8] = unrolled_cross(m[4], c4, m[5], c2) + m[7] * c0;
+        r[9] = unrolled_cross(m[1], c2, m[0], c4) - m[3] * c0;
+        r[10] = unrolled_cross(m[12], s4, m[13], s2) + m[15] * s0;
+        r[11] = unrolled_cross(m[9], s2, m[8], s4) - m[11] * s0;
+        r[12] = unrolled_cross(m[5], c1, m[4], c3) - m[6] * c0;
+        r[13] = unrolled_cross(m[0], c3, m[1], c1) + m[2] * c0;
+        r[14] = unrolled_cross(m[13], s1, m[12], s3) - m[14] * s0;
+        r[15] = unrolled_cross(m[8], s3, m[9], s1) + m[10] * s0;
+        det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    }
+    unroll<n * n>([&](auto e) { adj._Data[Storage::layout_t::index(e / n, e % n, n, n)] = r[e]; });
+    return det;
+}
+
+template<class Storage>
+inline constexpr Storage std::experimental::la::detail::unrolled_inverse(Storage const& mat) noexcept
+{
+    // A singular matrix has no inverse; the result holds non-finite values
+    auto res = Storage{ std::pair(Storage::row, Storage::col) };
+    auto const det = unrolled_adjoint(mat, res);
+    unrolled_divide(res, det);
+    return res;
+}
+
+#endif
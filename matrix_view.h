@@ -0,0 +1,438 @@
+#if !defined MATRIX_VIEW_26_10_18_18_52_09
+#define MATRIX_VIEW_26_10_18_18_52_09
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "matrix_storage.h"
+#include "matrix_traits.h"
+#include "matrix_simd.h"
+#include "linear_algebra.h"
+
+/*
+Zero-copy views of matrices.
+
+view_traits is the Rep for matrices whose storage is a matrix_view, so a block, a row,
+a column or a transpose of another matrix is a matrix<view_traits<...>> that refers to
+the original elements rather than a copy of them. Operations that update their left
+operand (*=, /=, +=, -=) write through to the viewed matrix, transpose() of a view is
+another view with its strides exchanged, and a view multiplies, compares and reduces
+without being copied.
+
+Results that need storage of their own (products, submatrices, and the elements of
+expressions such as a + b) are owning dynamic_size_matrix matrices. Assigning one view
+to another rebinds it, as copying a pointer would; assign() copies elements into a view.
+*/
+
+namespace std::experimental::la {
+    ////////////////////////////////////////////////////////
+    // view_traits
+    ////////////////////////////////////////////////////////
+    template<class View>
+    struct view_traits
+    {
+        using scalar_t = typename View::scalar_t;
+        using matrix_t = View;
+        using owning_rep_t = matrix_traits<typename View::owning_t>;
+        using transpose_t = view_traits<View>;
+        using submatrix_t = owning_rep_t;
+        template<class Traits2>
+        using multiply_t = owning_rep_t;
+
+        static constexpr bool equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static constexpr bool not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static constexpr void scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        template <class Traits2> static typename View::owning_t matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept;
+        static constexpr void divide(matrix_t& lhs, scalar_t const& rhs) noexcept;
+        static constexpr void add(matrix_t& lhs, matrix_t const& rhs) noexcept;
+        static constexpr void subtract(matrix_t& lhs, matrix_t const& rhs) noexcept;
+        static constexpr typename View::owning_t submatrix(matrix_t const& mat, size_t m, size_t n) noexcept;
+        static constexpr matrix_t transpose(matrix_t const& mat) noexcept;          // Lazy: the same elements with rows and columns exchanged
+        static constexpr scalar_t inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept;
+        static constexpr scalar_t modulus(matrix_t const& mat) noexcept;
+        static constexpr scalar_t modulus_squared(matrix_t const& mat) noexcept;
+        static constexpr bool is_identity(matrix_t const& mat) noexcept;
+        static constexpr bool is_invertible(matrix_t const& mat) noexcept;
+        static constexpr scalar_t determinant(matrix_t const& mat) noexcept;
+        static constexpr typename View::owning_t copy(matrix_t const& mat);          // The viewed elements in storage of their own
+
+    private:
+        static constexpr typename View::element_t* row(matrix_t const& mat, size_t i) noexcept;
+        static constexpr bool unit_stride(matrix_t const& lhs, matrix_t const& rhs) noexcept;   // Whether rows can go to the SIMD kernels
+        static constexpr ptrdiff_t vector_stride(matrix_t const& vec) noexcept;
+    };
+
+    // View construction
+    // The const overloads give read-only views of owning matrices. A view of a view refers
+    // to the original elements, and all of them are invalidated with the matrix they view.
+    template<class Rep>
+    constexpr auto view(matrix<Rep>& mat) noexcept;
+
+    template<class Rep>
+    constexpr auto view(matrix<Rep> const& mat) noexcept;
+
+    template<class Rep>
+    constexpr auto block_view(matrix<Rep>& mat, size_t i, size_t j, size_t rows, size_t cols) noexcept;
+
+    template<class Rep>
+    constexpr auto block_view(matrix<Rep> const& mat, size_t i, size_t j, size_t rows, size_t cols) noexcept;
+
+    template<class Rep>
+    constexpr auto row_view(matrix<Rep>& mat, size_t i) noexcept;
+
+    template<class Rep>
+    constexpr auto row_view(matrix<Rep> const& mat, size_t i) noexcept;
+
+    template<class Rep>
+    constexpr auto column_view(matrix<Rep>& mat, size_t j) noexcept;
+
+    template<class Rep>
+    constexpr auto column_view(matrix<Rep> const& mat, size_t j) noexcept;
+
+    template<class Rep>
+    constexpr auto transpose_view(matrix<Rep>& mat) noexcept;
+
+    template<class Rep>
+    constexpr auto transpose_view(matrix<Rep> const& mat) noexcept;
+
+    // Copies the elements of src, a matrix, view or expression of the same shape, into the viewed elements
+    template<class View, class Src, class = std::enable_if_t<detail::is_matrix_operand_v<Src>>>
+    constexpr void assign(matrix<view_traits<View>> const& dst, Src const& src) noexcept;
+
+    template<class View>
+    constexpr matrix<typename view_traits<View>::owning_rep_t> materialize(matrix<view_traits<View>> const& mat);
+
+    namespace detail {
+        template<class View>
+        constexpr matrix<view_traits<View>> make_view_matrix(View const& view) noexcept;
+    }
+}
+
+////////////////////////////////////////////////////////
+// view_traits implementation
+////////////////////////////////////////////////////////
+template<class View>
+inline constexpr bool std::experimental::la::view_traits<View>::equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) return false;
+    for (auto i = size_t(0); i < lhs.rows(); ++i)
+    {
+        auto const* l = row(lhs, i);
+        auto const* r = row(rhs, i);
+        if constexpr (detail::is_simd_scalar_v<scalar_t>)
+        {
+            if (unit_stride(lhs, rhs))
+            {
+                if (!detail::simd_dispatch<scalar_t>().equal(l, r, lhs.cols())) return false;
+                continue;
+            }
+        }
+        for (auto j = size_t(0); j < lhs.cols(); ++j)
+        {
+            if (!(l[ptrdiff_t(j) * lhs.col_stride()] == r[ptrdiff_t(j) * rhs.col_stride()])) return false;
+        }
+    }
+    return true;
+}
+
+template<class View>
+inline constexpr bool std::experimental::la::view_traits<View>::not_equal(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return !equal(lhs, rhs);
+}
+
+template<class View>
+inline constexpr void std::experimental::la::view_traits<View>::scalar_multiply(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto i = size_t(0); i < lhs.rows(); ++i)
+    {
+        auto* l = row(lhs, i);
+        if constexpr (detail::is_simd_scalar_v<scalar_t>)
+        {
+            if (unit_stride(lhs, lhs))
+            {
+                detail::simd_dispatch<scalar_t>().scalar_multiply(l, rhs, lhs.cols());
+                continue;
+            }
+        }
+        for (auto j = size_t(0); j < lhs.cols(); ++j) l[ptrdiff_t(j) * lhs.col_stride()] *= rhs;
+    }
+}
+
+template<class View>
+template<class Traits2>
+inline typename View::owning_t std::experimental::la::view_traits<View>::matrix_multiply(matrix_t const& lhs, typename Traits2::matrix_t const& rhs) noexcept
+{
+    // Both operands go to the engine through their strides, so neither is copied
+    assert(lhs.cols() == rhs.rows());
+    auto const b = detail::as_view(rhs);
+    auto res = typename View::owning_t(std::pair(lhs.rows(), b.cols()));
+    if constexpr (detail::is_reduced_precision_v<scalar_t>)
+    {
+        detail::widened_gemm(nullptr, lhs.rows(), b.cols(), lhs.cols(), 1.0f, lhs.data(), lhs.row_stride(), lhs.col_stride(), b.data(), b.row_stride(), b.col_stride(),
+            0.0f, res.begin(), ptrdiff_t(b.cols()), ptrdiff_t(1));
+    }
+    else
+    {
+        detail::gemm(lhs.rows(), b.cols(), lhs.cols(), scalar_t(1), lhs.data(), lhs.row_stride(), lhs.col_stride(), b.data(), b.row_stride(), b.col_stride(),
+            scalar_t(0), res.begin(), ptrdiff_t(b.cols()), ptrdiff_t(1));
+    }
+    return res;
+}
+
+template<class View>
+inline constexpr void std::experimental::la::view_traits<View>::divide(matrix_t& lhs, scalar_t const& rhs) noexcept
+{
+    for (auto i = size_t(0); i < lhs.rows(); ++i)
+    {
+        auto* l = row(lhs, i);
+        if constexpr (detail::is_simd_scalar_v<scalar_t>)
+        {
+            if (unit_stride(lhs, lhs))
+            {
+                detail::simd_dispatch<scalar_t>().divide(l, rhs, lhs.cols());
+                continue;
+            }
+        }
+        for (auto j = size_t(0); j < lhs.cols(); ++j) l[ptrdiff_t(j) * lhs.col_stride()] /= rhs;
+    }
+}
+
+template<class View>
+inline constexpr void std::experimental::la::view_traits<View>::add(matrix_t& lhs, matrix_t const& rhs) noexcept
+{
+    assert(lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols());
+    for (auto i = size_t(0); i < lhs.rows(); ++i)
+    {
+        auto* l = row(lhs, i);
+        auto const* r = row(rhs, i);
+        if constexpr (detail::is_simd_scalar_v<scalar_t>)
+        {
+            if (unit_stride(lhs, rhs))
+            {
+                detail::simd_dispatch<scalar_t>().add(l, r, lhs.cols());
+                continue;
+            }
+        }
+        for (auto j = size_t(0); j < lhs.cols(); ++j) l[ptrdiff_t(j) * lhs.col_stride()] += r[ptrdiff_t(j) * rhs.col_stride()];
+    }
+}
+
+template<class View>
+inline constexpr void std::experimental::la::view_traits<View>::subtract(matrix_t& lhs, matrix_t const& rhs) noexcept
+{
+    assert(lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols());
+    for (auto i = size_t(0); i < lhs.rows(); ++i)
+    {
+        auto* l = row(lhs, i);
+        auto const* r = row(rhs, i);
+        if constexpr (detail::is_simd_scalar_v<scalar_t>)
+        {
+            if (unit_stride(lhs, rhs))
+            {
+                detail::simd_dispatch<scalar_t>().subtract(l, r, lhs.cols());
+                continue;
+            }
+        }
+        for (auto j = size_t(0); j < lhs.cols(); ++j) l[ptrdiff_t(j) * lhs.col_stride()] -= r[ptrdiff_t(j) * rhs.col_stride()];
+    }
+}
+
+template<class View>
+inline constexpr typename View::owning_t std::experimental::la::view_traits<View>::submatrix(matrix_t const& mat, size_t m, size_t n) noexcept
+{
+    // Removing a row and a column is not a strided pattern, so this one is copied
+    auto res = typename View::owning_t(std::pair(mat.rows() - 1, mat.cols() - 1));
+    auto* out = res.begin();
+    for (auto i = size_t(0); i < mat.rows(); ++i)
+    {
+        if (i == m) continue;
+        for (auto j = size_t(0); j < mat.cols(); ++j)
+        {
+            if (j != n) *out++ = mat(i, j);
+        }
+    }
+    return res;
+}
+
+template<class View>
+inline constexpr typename std::experimental::la::view_traits<View>::matrix_t std::experimental::la::view_traits<View>::transpose(matrix_t const& mat) noexcept
+{
+    return mat.transposed();
+}
+
+template<class View>
+inline constexpr typename std::experimental::la::view_traits<View>::scalar_t std::experimental::la::view_traits<View>::inner_product(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    assert(lhs.rows() == 1 || lhs.cols() == 1);
+    assert(lhs.rows() * lhs.cols() == rhs.rows() * rhs.cols());
+    auto const n = lhs.rows() * lhs.cols();
+    auto const ls = vector_stride(lhs);
+    auto const rs = vector_stride(rhs);
+    if constexpr (detail::is_simd_scalar_v<scalar_t>)
+    {
+        if (ls == 1 && rs == 1 && n >= detail::simd_dispatch_size) return detail::simd_dispatch<scalar_t>().inner_product(lhs.data(), rhs.data(), n);
+    }
+    auto res = scalar_t(0);
+    for (auto i = size_t(0); i < n; ++i) res = res + lhs.data()[ptrdiff_t(i) * ls] * rhs.data()[ptrdiff_t(i) * rs];
+    return res;
+}
+
+template<class View>
+inline constexpr typename std::experimental::la::view_traits<View>::scalar_t std::experimental::la::view_traits<View>::modulus(matrix_t const& mat) noexcept
+{
+    return scalar_t(std::sqrt(modulus_squared(mat)));
+}
+
+template<class View>
+inline constexpr typename std::experimental::la::view_traits<View>::scalar_t std::experimental::la::view_traits<View>::modulus_squared(matrix_t const& mat) noexcept
+{
+    return inner_product(mat, mat);
+}
+
+template<class View>
+inline constexpr bool std::experimental::la::view_traits<View>::is_identity(matrix_t const& mat) noexcept
+{
+    if (mat.rows() != mat.cols()) return false;
+    for (auto i = size_t(0); i < mat.rows(); ++i)
+    {
+        for (auto j = size_t(0); j < mat.cols(); ++j)
+        {
+            if (mat(i, j) != (i == j ? scalar_t(1) : scalar_t(0))) return false;
+        }
+    }
+    return true;
+}
+
+template<class View>
+inline constexpr bool std::experimental::la::view_traits<View>::is_invertible(matrix_t const& mat) noexcept
+{
+    // The factorisation overwrites its input, so it needs a copy whatever the layout
+    return owning_rep_t::is_invertible(copy(mat));
+}
+
+template<class View>
+inline constexpr typename std::experimental::la::view_traits<View>::scalar_t std::experimental::la::view_traits<View>::determinant(matrix_t const& mat) noexcept
+{
+    return owning_rep_t::determinant(copy(mat));
+}
+
+template<class View>
+inline constexpr typename View::owning_t std::experimental::la::view_traits<View>::copy(matrix_t const& mat)
+{
+    auto res = typename View::owning_t(std::pair(mat.rows(), mat.cols()));
+    auto* out = res.begin();
+    for (auto i = size_t(0); i < mat.rows(); ++i)
+    {
+        auto const* in = row(mat, i);
+        for (auto j = size_t(0); j < mat.cols(); ++j) *out++ = in[ptrdiff_t(j) * mat.col_stride()];
+    }
+    return res;
+}
+
+template<class View>
+inline constexpr typename View::element_t* std::experimental::la::view_traits<View>::row(matrix_t const& mat, size_t i) noexcept
+{
+    return mat.data() + ptrdiff_t(i) * mat.row_stride();
+}
+
+template<class View>
+inline constexpr bool std::experimental::la::view_traits<View>::unit_stride(matrix_t const& lhs, matrix_t const& rhs) noexcept
+{
+    return lhs.col_stride() == 1 && rhs.col_stride() == 1 && lhs.cols() >= detail::simd_dispatch_size;
+}
+
+template<class View>
+inline constexpr ptrdiff_t std::experimental::la::view_traits<View>::vector_stride(matrix_t const& vec) noexcept
+{
+    return vec.rows() == 1 ? vec.col_stride() : vec.row_stride();
+}
+
+////////////////////////////////////////////////////////
+// View construction implementation
+////////////////////////////////////////////////////////
+template<class Rep>
+inline constexpr auto std::experimental::la::view(matrix<Rep>& mat) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()));
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::view(matrix<Rep> const& mat) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()));
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::block_view(matrix<Rep>& mat, size_t i, size_t j, size_t rows, size_t cols) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()).block(i, j, rows, cols));
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::block_view(matrix<Rep> const& mat, size_t i, size_t j, size_t rows, size_t cols) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()).block(i, j, rows, cols));
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::row_view(matrix<Rep>& mat, size_t i) noexcept
+{
+    return block_view(mat, i, 0, 1, mat.data().cols());
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::row_view(matrix<Rep> const& mat, size_t i) noexcept
+{
+    return block_view(mat, i, 0, 1, mat.data().cols());
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::column_view(matrix<Rep>& mat, size_t j) noexcept
+{
+    return block_view(mat, 0, j, mat.data().rows(), 1);
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::column_view(matrix<Rep> const& mat, size_t j) noexcept
+{
+    return block_view(mat, 0, j, mat.data().rows(), 1);
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::transpose_view(matrix<Rep>& mat) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()).transposed());
+}
+
+template<class Rep>
+inline constexpr auto std::experimental::la::transpose_view(matrix<Rep> const& mat) noexcept
+{
+    return detail::make_view_matrix(detail::as_view(mat.data()).transposed());
+}
+
+template<class View, class Src, class>
+inline constexpr void std::experimental::la::assign(matrix<view_traits<View>> const& dst, Src const& src) noexcept
+{
+    auto const& out = dst.data();
+    assert(detail::expression_size(src) == std::pair(out.rows(), out.cols()));
+    for (auto i = size_t(0); i < out.rows(); ++i)
+    {
+        for (auto j = size_t(0); j < out.cols(); ++j) out(i, j) = detail::expression_element(src, i * out.cols() + j);
+    }
+}
+
+template<class View>
+inline constexpr std::experimental::la::matrix<typename std::experimental::la::view_traits<View>::owning_rep_t> std::experimental::la::materialize(matrix<view_traits<View>> const& mat)
+{
+    return matrix<typename view_traits<View>::owning_rep_t>(view_traits<View>::copy(mat.data()));
+}
+
+template<class View>
+inline constexpr std::experimental::la::matrix<std::experimental::la::view_traits<View>> std::experimental::la::detail::make_view_matrix(View const& view) noexcept
+{
+    return matrix<view_traits<View>>(view);
+}
+
+#endif
@@ -1,6 +1,26 @@
 #include "matrix_storage.h"
 #include "matrix_traits.h"
 #include "linear_algebra.h"
+#include "matrix_batch.h"
+#include "matrix_view.h"
+#include "matrix_sparse.h"
+#include "matrix_structured.h"
+#include "matrix_iterative.h"
+#include "matrix_mmap.h"
+#include "matrix_instrument.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 void fixed_size_float_test()
 {
@@ -91,22 +111,39 @@ void fixed_size_float_test()
     assert(smf3 == (matrix<matrix_traits<fixed_size_matrix<float, 3, 3>>>{ 1.0f, 1.0f, -1.0f,
         -10.0f, 4.0f, 2.0f,
         7.0f, -3.0f, -1.0f }));
-    assert(is_identity(smf5));    // Rounding error
-    assert(is_identity(smf6));    // Rounding error
+    // 0.2f, 0.4f and 0.6f are not exact, so the products are the identity to within rounding
+    auto near_identity = [](auto const& m)
+    {
+        for (auto i = 0U; i < 2U; ++i)
+            for (auto j = 0U; j < 2U; ++j)
+                if (std::abs(m(i, j) - (i == j ? 1.0f : 0.0f)) > 4.0f * std::numeric_limits<float>::epsilon()) return false;
+        return true;
+    };
+    assert(near_identity(smf5));
+    assert(near_identity(smf6));
 }
 
 void dynamic_size_float_test()
 {
     using namespace std::experimental::la;
-    auto v1 = matrix<matrix_traits<dynamic_size_matrix<float>>>{};
-    auto v2 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 1U) };
-    auto v3 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) };
-    auto v4 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) };
-    auto m1 = matrix<matrix_traits<dynamic_size_matrix<float>>>{};
-    auto m2 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(2U, 2U) };
-    auto m3 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(2U, 3U) };
-    auto m4 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(3U, 2U) };
-    auto m5 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(3U, 3U) };
+    using dynamic_float = matrix<matrix_traits<dynamic_size_matrix<float>>>;
+    auto filled = [](std::pair<unsigned, unsigned> size, std::initializer_list<float> il)
+    {
+        auto res = dynamic_float{ size };
+        std::copy(il.begin(), il.end(), res.data().begin());
+        return res;
+    };
+    auto v1 = dynamic_float{};
+    auto v2 = filled(std::pair(1U, 1U), { 0.0f });
+    auto v3 = filled(std::pair(1U, 2U), { 1.0f, 2.0f });
+    auto v4 = filled(std::pair(1U, 2U), { 1.0f, 2.0f });
+    auto m1 = dynamic_float{};
+    auto m2 = dynamic_float{ std::pair(2U, 2U) };
+    auto m3 = filled(std::pair(2U, 3U), {
+        0.0f, 0.1f, 0.2f,
+        0.3f, 0.4f, 0.5f });
+    auto m4 = dynamic_float{ std::pair(3U, 2U) };
+    auto m5 = dynamic_float{ std::pair(3U, 3U) };
     
     // test accessors
     assert(m3(1, 2) == 0.5f);
@@ -116,17 +153,1946 @@ void dynamic_size_float_test()
     assert(v3 == v4);
     
     // test scalar binary operators
-    auto sbo1 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) } *3.0f;
-    auto sbo2 = 3.0f * matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) };
-    auto sbo3 = matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) } / 4.0f;
+    auto sbo1 = dynamic_float(filled(std::pair(1U, 2U), { 2.0f, 2.0f }) * 3.0f);
+    auto sbo2 = dynamic_float(3.0f * filled(std::pair(1U, 2U), { 2.0f, 2.0f }));
+    auto sbo3 = dynamic_float(filled(std::pair(1U, 2U), { 2.0f, 2.0f }) / 4.0f);
+    
+    assert(sbo1 == filled(std::pair(1U, 2U), { 6.0f, 6.0f }));
+    assert(sbo2 == filled(std::pair(1U, 2U), { 6.0f, 6.0f }));
+    assert(sbo3 == filled(std::pair(1U, 2U), { 0.5f, 0.5f }));
+}
+
+void blocked_multiply_test()
+{
+    using namespace std::experimental::la;
+    // Sizes chosen to exceed the direct-multiply threshold and to leave ragged edge tiles
+    auto m1 = matrix<matrix_traits<dynamic_size_matrix<double>>>{ std::pair(67U, 45U) };
+    auto m2 = matrix<matrix_traits<dynamic_size_matrix<double>>>{ std::pair(45U, 301U) };
+    auto m3 = matrix<matrix_traits<fixed_size_matrix<float, 40, 40>>>{};
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++ % 11) - 5.0;
+    for (auto& el : m2.data()) el = double(i++ % 7) - 3.0;
+    for (auto& el : m3.data()) el = float(i++ % 5) - 2.0f;
+    
+    // test blocked matrix multiply against the definition
+    auto bm1 = m1 * m2;
+    auto bm2 = m3 * m3;
+    assert(bm1.data().rows() == 67U && bm1.data().cols() == 301U);
+    for (auto r = 0U; r < 67U; ++r)
+    {
+        for (auto c = 0U; c < 301U; ++c)
+        {
+            auto dp = 0.0;
+            for (auto k = 0U; k < 45U; ++k) dp += m1.data().begin()[r * 45U + k] * m2.data().begin()[k * 301U + c];
+            assert(bm1.data().begin()[r * 301U + c] == dp);
+        }
+    }
+    for (auto r = 0U; r < 40U; ++r)
+    {
+        for (auto c = 0U; c < 40U; ++c)
+        {
+            auto dp = 0.0f;
+            for (auto k = 0U; k < 40U; ++k) dp += m3.data().begin()[r * 40U + k] * m3.data().begin()[k * 40U + c];
+            assert(bm2.data().begin()[r * 40U + c] == dp);
+        }
+    }
+}
+
+template<class Scalar>
+void simd_kernel_test()
+{
+    using namespace std::experimental::la;
+    using detail::simd_level;
+    constexpr auto n = 103U;        // Not a multiple of any vector width
+    Scalar a[n], b[n], c[n];
+    for (auto i = 0U; i < n; ++i)
+    {
+        a[i] = Scalar(i % 13) - Scalar(6);
+        b[i] = Scalar(i % 5) + Scalar(1);
+    }
+    
+    // test every instruction set the machine supports against the scalar kernels
+    auto const& ref = detail::simd_kernels_for<Scalar>(simd_level::scalar);
+    for (auto level : { simd_level::sse2, simd_level::avx2, simd_level::avx512 })
+    {
+        if (level > detail::active_simd_level()) continue;
+        auto const& k = detail::simd_kernels_for<Scalar>(level);
+        assert(k.inner_product(a, b, n) == ref.inner_product(a, b, n));
+        assert(k.modulus_squared(a, n) == ref.modulus_squared(a, n));
+        assert(k.equal(a, a, n) && !k.equal(a, b, n));
+        std::copy(a, a + n, c);
+        k.add(c, b, n);
+        k.subtract(c, b, n);
+        k.scalar_multiply(c, Scalar(4), n);
+        k.divide(c, Scalar(2), n);
+        for (auto i = 0U; i < n; ++i) assert(c[i] == a[i] * Scalar(2));
+        c[n - 1] += Scalar(1);
+        assert(!k.equal(a, c, n));
+        k.axpby(Scalar(3), b, Scalar(0.5), c, n);
+        for (auto i = 0U; i < n - 1; ++i) assert(c[i] == a[i] + Scalar(3) * b[i]);
+    }
+    
+    // test the dispatched traits on a dynamic vector
+    auto v1 = matrix<matrix_traits<dynamic_size_matrix<Scalar>>>{ std::pair(1U, n) };
+    auto v2 = matrix<matrix_traits<dynamic_size_matrix<Scalar>>>{ std::pair(1U, n) };
+    std::copy(a, a + n, v1.data().begin());
+    std::copy(b, b + n, v2.data().begin());
+    assert(inner_product(v1, v2) == ref.inner_product(a, b, n));
+    assert(modulus_squared(v1) == ref.modulus_squared(a, n));
+    v1 += v2;
+    v1 -= v2;
+    assert(v1.data().begin()[n - 1] == a[n - 1]);
+}
+
+template<class Scalar>
+void gemm_kernel_test()
+{
+    using namespace std::experimental::la;
+    using detail::simd_level;
+    constexpr auto k = size_t(37);
+    
+    // test every micro-kernel the machine supports against the definition, on whole and edge tiles of either layout
+    for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512 })
+    {
+        if (level > detail::active_simd_level()) continue;
+        auto const& kern = detail::gemm_kernels_for<Scalar>(level);
+        auto const mr = kern.mr;
+        auto const nr = kern.nr;
+        auto a = std::vector<Scalar>(mr * k);
+        auto b = std::vector<Scalar>(k * nr);
+        for (auto i = size_t(0); i < a.size(); ++i) a[i] = Scalar(i % 13) - Scalar(6);
+        for (auto i = size_t(0); i < b.size(); ++i) b[i] = Scalar(i % 7) - Scalar(3);
+        auto ap = std::vector<Scalar>(mr * k);
+        auto bp = std::vector<Scalar>(k * nr);
+        for (auto [m, n] : { std::pair(mr, nr), std::pair(mr - 1, nr - 3) })
+        {
+            detail::pack_a<Scalar>(mr, m, k, a.data(), ptrdiff_t(k), 1, ap.data());
+            detail::pack_b<Scalar>(nr, k, n, b.data(), ptrdiff_t(nr), 1, bp.data());
+            for (auto col_major : { false, true })
+            {
+                auto const rsc = col_major ? ptrdiff_t(1) : ptrdiff_t(n);
+                auto const csc = col_major ? ptrdiff_t(m) : ptrdiff_t(1);
+                auto c1 = std::vector<Scalar>(m * n, Scalar(1));
+                auto c2 = std::vector<Scalar>(m * n, Scalar(1));
+                kern.kernel(k, Scalar(0.5), ap.data(), bp.data(), Scalar(2), c1.data(), rsc, csc, m, n);
+                kern.kernel(k, Scalar(1), ap.data(), bp.data(), Scalar(0), c2.data(), rsc, csc, m, n);
+                for (auto i = size_t(0); i < m; ++i)
+                {
+                    for (auto j = size_t(0); j < n; ++j)
+                    {
+                        auto dp = Scalar(0);
+                        for (auto p = size_t(0); p < k; ++p) dp += a[i * k + p] * b[p * nr + j];
+                        assert(c1[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc] == Scalar(0.5) * dp + Scalar(2));
+                        assert(c2[ptrdiff_t(i) * rsc + ptrdiff_t(j) * csc] == dp);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void expression_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<float>>>;
+    auto m1 = dyn{ std::pair(3U, 50U) };
+    auto m2 = dyn{ std::pair(3U, 50U) };
+    auto m3 = dyn{ std::pair(3U, 50U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = float(i++ % 9);
+    for (auto& el : m2.data()) el = float(i++ % 4);
+    for (auto& el : m3.data()) el = float(i++ % 8) * 4.0f;
+    
+    // test fused evaluation of a compound expression
+    dyn e1 = m1 * 2.0f + m2 - m3 / 4.0f;
+    for (auto j = 0U; j < 150U; ++j)
+    {
+        auto const expected = m1.data().begin()[j] * 2.0f + m2.data().begin()[j] - m3.data().begin()[j] / 4.0f;
+        assert(e1.data().begin()[j] == expected);
+    }
+    
+    // test comparison against unevaluated expressions
+    assert(e1 == m1 * 2.0f + m2 - m3 / 4.0f);
+    assert(m1 + m2 != m1 - m2);
+    
+    // test assignment and compound assignment where the expression refers to the target
+    e1 = e1 - m2;
+    e1 += m3 / 4.0f;
+    assert(e1 == 2.0f * m1);
+    
+    // test that temporaries are owned by the expression
+    auto e2 = matrix<matrix_traits<fixed_size_matrix<float, 1, 2>>>{ 1.0f, 2.0f } * 2.0f;
+    auto e3 = (e2 + e2).eval();
+    assert(e2 == (matrix<matrix_traits<fixed_size_matrix<float, 1, 2>>>{ 2.0f, 4.0f }));
+    assert(e3 == (matrix<matrix_traits<fixed_size_matrix<float, 1, 2>>>{ 4.0f, 8.0f }));
+}
+
+void move_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<float>>>;
+    auto m1 = dyn{ std::pair(4U, 5U) };
+    auto m2 = dyn{ std::pair(4U, 5U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = float(i++);
+    for (auto& el : m2.data()) el = 1.0f;
+    
+    // test move construction and assignment leave the source empty
+    auto mv1 = m1;
+    auto const* buffer = mv1.data().begin();
+    auto mv2 = std::move(mv1);
+    assert(mv2.data().begin() == buffer && mv1.data().rows() == 0U && mv1.data().begin() == nullptr);
+    mv1 = std::move(mv2);
+    assert(mv1.data().begin() == buffer && mv1 == m1);
+    
+    // test copy assignment reuses storage of the same size
+    mv2 = dyn{ std::pair(5U, 4U) };
+    auto const* buffer2 = mv2.data().begin();
+    mv2 = m1;
+    assert(mv2.data().begin() == buffer2 && mv2 == m1);
+    
+    // test operators on temporaries update the temporary in place
+    auto ro1 = std::move(mv1) * 2.0f;
+    assert(ro1.data().begin() == buffer);
+    auto ro2 = std::move(ro1) + m2;
+    assert(ro2.data().begin() == buffer);
+    auto ro3 = m2 - std::move(ro2);
+    assert(ro3.data().begin() == buffer);
+    auto ro4 = std::move(ro3) - dyn(m2) / 2.0f;
+    assert(ro4.data().begin() == buffer);
+    assert(ro4 == m1 * -2.0f - m2 / 2.0f);
+}
+
+void lu_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto const n = 150U;
+    auto m1 = dyn{ std::pair(n, n) };
+    auto m2 = dyn{ std::pair(n, n) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++ % 13) - 6.0;
+    for (auto r = 0U; r < n; ++r) m1.data().begin()[r * n + r] += 40.0;
+    
+    // test inverse against the identity, with sizes spanning several factorisation blocks
+    auto im1 = inverse(m1);
+    auto pm1 = m1 * im1;
+    for (auto r = 0U; r < n; ++r)
+    {
+        for (auto c = 0U; c < n; ++c)
+        {
+            assert(std::abs(pm1.data().begin()[r * n + c] - (r == c ? 1.0 : 0.0)) < 1e-12);
+        }
+    }
+    assert(is_invertible(m1));
+    
+    // test determinant of a row-reversed triangular matrix, which factorises exactly
+    std::fill(m2.data().begin(), m2.data().end(), 0.0);
+    auto expected = (n * (n - 1) / 2) % 2 == 0 ? 1.0 : -1.0;
+    for (auto r = 0U; r < n; ++r)
+    {
+        auto const diag = r % 3 == 0 ? 2.0 : r % 3 == 1 ? 0.5 : -1.0;
+        expected *= diag;
+        for (auto c = r; c < n; ++c) m2.data().begin()[(n - 1 - r) * n + c] = c == r ? diag : double(c % 5);
+    }
+    assert(determinant(m2) == expected);
+    
+    // test fixed size beyond the closed forms, and singularity detection
+    auto m3 = matrix<matrix_traits<fixed_size_matrix<double, 4, 4>>>{ 2.0, 0.0, 1.0, 3.0, 1.0, 1.0, 0.0, 2.0, 0.0, 3.0, 1.0, 1.0, 4.0, 1.0, 2.0, 0.0 };
+    auto m4 = matrix<matrix_traits<fixed_size_matrix<double, 4, 4>>>{ 2.0, 0.0, 1.0, 3.0, 1.0, 1.0, 0.0, 2.0, 3.0, 1.0, 1.0, 5.0, 4.0, 1.0, 2.0, 0.0 };
+    assert(std::abs(determinant(m3) + 32.0) < 1e-12);
+    assert(is_invertible(m3));
+    assert(!is_invertible(m4));
+    assert(std::abs(determinant(m4)) < 1e-12);
+    auto am3 = classical_adjoint(m3) * m3;
+    auto am4 = m4 * classical_adjoint(m4);
+    for (auto r = 0U; r < 4U; ++r)
+    {
+        for (auto c = 0U; c < 4U; ++c)
+        {
+            assert(std::abs(am3.data().begin()[r * 4U + c] - (r == c ? -32.0 : 0.0)) < 1e-12);
+            assert(std::abs(am4.data().begin()[r * 4U + c]) < 1e-12);
+        }
+    }
+    assert(classical_adjoint(m4) != m4 * 0.0);
+    
+    // test the rank n-1 adjugate from the factors against cofactors, in both layouts
+    using dyn_cm = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    auto const k = 48U;
+    auto m5 = dyn{ std::pair(k, k) };
+    auto m6 = dyn_cm{ std::pair(k, k) };
+    for (auto r = 0U; r < k; ++r)
+    {
+        for (auto c = 0U; c < k; ++c)
+        {
+            auto const el = r + 1 == k ? m5(0, c) - 2.0 * m5(3, c) : double((r * 7U + c * 3U) % 11U) - 5.0 + (r == c ? 20.0 : 0.0);
+            m5(r, c) = m6(r, c) = el;
+        }
+    }
+    assert(!is_invertible(m5) && !is_invertible(m6));
+    auto const a5 = classical_adjoint(m5);
+    auto const a6 = classical_adjoint(m6);
+    auto cofactors = dyn{ std::pair(k, k) };
+    auto scale = 0.0;
+    for (auto r = 0U; r < k; ++r)
+    {
+        for (auto c = 0U; c < k; ++c)
+        {
+            cofactors(c, r) = ((r + c) % 2 == 0 ? 1.0 : -1.0) * determinant(submatrix(m5, r, c));
+            scale = std::max(scale, std::abs(cofactors(c, r)));
+        }
+    }
+    assert(scale > 0.0);
+    for (auto r = 0U; r < k; ++r)
+    {
+        for (auto c = 0U; c < k; ++c)
+        {
+            assert(std::abs(a5(r, c) - cofactors(r, c)) < 1e-9 * scale);
+            assert(std::abs(a6(r, c) - cofactors(r, c)) < 1e-9 * scale);
+        }
+    }
+}
+
+void solve_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto const n = 200U;
+    auto m1 = dyn{ std::pair(n, n) };
+    auto b1 = dyn{ std::pair(n, 3U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++ % 17) - 8.0;
+    for (auto& el : b1.data()) el = double(i++ % 9) - 4.0;
+    auto spd = m1 * transpose(m1);
+    for (auto r = 0U; r < n; ++r) spd.data().begin()[r * n + r] += double(n);
+    auto const close = [](dyn const& lhs, dyn const& rhs) {
+        for (auto l = lhs.data().cbegin(), r = rhs.data().cbegin(); l != lhs.data().cend(); ++l, ++r)
+        {
+            if (std::abs(*l - *r) > 1e-9) return false;
+        }
+        return true;
+    };
+    
+    // test direct solve with several right-hand sides
+    auto x1 = solve(spd, b1);
+    assert(x1.data().rows() == n && x1.data().cols() == 3U);
+    assert(close(spd * x1, b1));
+    
+    // test reusable factorisations agree with each other and with the direct solve
+    auto f1 = lu(spd);
+    auto f2 = cholesky(spd);
+    assert(f2.is_positive_definite());
+    assert(close(solve(f1, b1), x1));
+    assert(close(solve(f2, b1), x1));
+    for (auto c = 0U; c < 3U; ++c)
+    {
+        auto b2 = dyn{ std::pair(n, 1U) };
+        for (auto r = 0U; r < n; ++r) b2.data().begin()[r] = b1.data().begin()[r * 3U + c];
+        auto x2 = solve(f2, b2);
+        for (auto r = 0U; r < n; ++r) assert(std::abs(x2.data().begin()[r] - x1.data().begin()[r * 3U + c]) < 1e-9);
+    }
+    assert(!cholesky(m1).is_positive_definite());
+    
+    // test fixed size systems
+    auto m3 = matrix<matrix_traits<fixed_size_matrix<double, 3, 3>>>{ 4.0, 2.0, 0.0, 2.0, 5.0, 3.0, 0.0, 3.0, 10.0 };
+    auto b3 = matrix<matrix_traits<fixed_size_matrix<double, 3, 1>>>{ 6.0, 10.0, 13.0 };
+    auto x3 = matrix<matrix_traits<fixed_size_matrix<double, 3, 1>>>{ 1.0, 1.0, 1.0 };
+    auto s3 = solve(m3, b3);
+    auto c3 = solve(cholesky(m3), b3);
+    for (auto r = 0U; r < 3U; ++r)
+    {
+        assert(std::abs(s3.data().begin()[r] - x3.data().begin()[r]) < 1e-12);
+        assert(std::abs(c3.data().begin()[r] - x3.data().begin()[r]) < 1e-12);
+    }
+    assert(std::abs(cholesky(m3).determinant() - 124.0) < 1e-12);
+    assert(std::abs(lu(m3).determinant() - 124.0) < 1e-12);
+}
+
+void parallel_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto pool = thread_pool(4);
+    auto m1 = dyn{ std::pair(300U, 200U) };
+    auto m2 = dyn{ std::pair(200U, 250U) };
+    auto m3 = dyn{ std::pair(300U, 300U) };
+    auto v1 = dyn{ std::pair(1U, 100000U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++ % 11) - 5.0;
+    for (auto& el : m2.data()) el = double(i++ % 7) - 3.0;
+    for (auto& el : m3.data()) el = double(i++ % 13) - 6.0;
+    for (auto& el : v1.data()) el = double(i++ % 3) - 1.0;
+    for (auto r = 0U; r < 300U; ++r) m3.data().begin()[r * 300U + r] += 100.0;
+    
+    // test parallel overloads give the same results as the sequential operations
+    assert(multiply(pool, m1, m2) == m1 * m2);
+    assert(add(pool, m3, m3) == m3 * 2.0);
+    assert(subtract(pool, m3, m3) == m3 * 0.0);
+    assert(multiply(pool, m3, 3.0) == m3 * 3.0);
+    assert(divide(pool, m3, 4.0) == m3 / 4.0);
+    assert(transpose(pool, m1) == transpose(m1));
+    assert(inner_product(pool, v1, v1) == modulus_squared(v1));
+    assert(modulus_squared(pool, v1) == modulus_squared(v1));
+    assert(determinant(pool, m3) == determinant(m3));
+    assert(inverse(pool, m3) == inverse(m3));
+    auto expected = m1 * m2;
+    auto spd = multiply(pool, m3, transpose(pool, m3));
+    assert(solve(pool, cholesky(pool, spd), m3) == solve(cholesky(spd), m3));
+    assert(solve(pool, lu(pool, m3), expected) == solve(lu(m3), expected));
+    assert(solve(pool, m3, m3) == solve(m3, m3));
+#if defined _LA_EXECUTION_POLICY
+    assert(multiply(std::execution::par, m1, m2) == m1 * m2);
+    assert(determinant(std::execution::seq, m3) == determinant(m3));
+#endif
+    
+    // test the pool from several threads at once, with nested loops
+    auto results = std::vector<dyn>(4);
+    auto callers = std::vector<std::thread>();
+    for (auto t = 0U; t < 4U; ++t) callers.emplace_back([&, t] { results[t] = multiply(pool, m1, m2); });
+    for (auto& caller : callers) caller.join();
+    for (auto const& res : results) assert(res == expected);
+    auto counts = std::vector<std::atomic<int>>(64);
+    pool.parallel_for(8, [&](size_t outer) {
+        pool.parallel_for(8, [&](size_t inner) { ++counts[outer * 8 + inner]; });
+    });
+    for (auto const& count : counts) assert(count == 1);
+}
+
+template<class T>
+struct tagged_allocator
+{
+    using value_type = T;
+    
+    tagged_allocator() = default;
+    explicit tagged_allocator(int tag) : _Tag(tag) {}
+    template<class U> tagged_allocator(tagged_allocator<U> const& rhs) : _Tag(rhs._Tag) {}
+    T* allocate(size_t n) { ++live; return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) { --live; std::allocator<T>().deallocate(p, n); }
+    friend bool operator==(tagged_allocator const& lhs, tagged_allocator const& rhs) { return lhs._Tag == rhs._Tag; }
+    friend bool operator!=(tagged_allocator const& lhs, tagged_allocator const& rhs) { return lhs._Tag != rhs._Tag; }
+    
+    static inline int live = 0;
+    int _Tag = 0;
+};
+
+template<class T>
+struct propagating_allocator : tagged_allocator<T>
+{
+    using propagate_on_container_copy_assignment = std::true_type;
+    using tagged_allocator<T>::tagged_allocator;
+};
+
+void allocator_test()
+{
+    using namespace std::experimental::la;
+    {
+        // test storage goes through the allocator, and results use the left operand's allocator
+        using storage = dynamic_size_matrix<double, tagged_allocator<double>>;
+        auto m1 = matrix<matrix_traits<storage>>{ storage(std::pair(3U, 4U), tagged_allocator<double>(1)) };
+        auto m2 = matrix<matrix_traits<storage>>{ storage(std::pair(4U, 2U), tagged_allocator<double>(2)) };
+        for (auto& el : m1.data()) el = 1.0;
+        for (auto& el : m2.data()) el = 2.0;
+        assert(tagged_allocator<double>::live == 2);
+        auto m3 = m1 * m2;
+        auto m4 = transpose(m2);
+        assert(m3.data().get_allocator()._Tag == 1 && m4.data().get_allocator()._Tag == 2);
+        assert(m3 == (m3 * 0.0 + 8.0 / 1.0 * (m3 * 0.0 + m3 / 8.0)));
+        
+        // test assignment without propagation keeps the target's allocator
+        m4 = m1;
+        assert(m4.data().get_allocator()._Tag == 2 && m4 == m1);
+        m4 = std::move(m3);
+        assert(m4.data().get_allocator()._Tag == 2 && m3.data().rows() == 3U);
+        assert(tagged_allocator<double>::live == 4);
+    }
+    assert(tagged_allocator<double>::live == 0);
+    
+    // test aligned storage
+    using aligned = matrix<matrix_traits<aligned_dynamic_size_matrix<float>>>;
+    auto a1 = aligned{ std::pair(33U, 17U) };
+    for (auto& el : a1.data()) el = 1.0f;
+    auto a2 = a1 * transpose(a1);
+    assert(reinterpret_cast<std::uintptr_t>(a1.data().begin()) % 64 == 0);
+    assert(reinterpret_cast<std::uintptr_t>(a2.data().begin()) % 64 == 0);
+    assert(a2.data().begin()[0] == 17.0f);
+    
+#if defined _LA_MEMORY_RESOURCE
+    // test a whole computation running out of a monotonic arena
+    using arena_matrix = matrix<matrix_traits<pmr::dynamic_size_matrix<double>>>;
+    auto buffer = std::vector<std::byte>(1 << 16);
+    auto arena = std::pmr::monotonic_buffer_resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    auto const in_arena = [&](arena_matrix const& mat) {
+        auto const* p = reinterpret_cast<std::byte const*>(mat.data().cbegin());
+        return p >= buffer.data() && p < buffer.data() + buffer.size();
+    };
+    auto p1 = arena_matrix{ pmr::dynamic_size_matrix<double>(std::pair(20U, 20U), &arena) };
+    for (auto& el : p1.data()) el = 0.5;
+    for (auto r = 0U; r < 20U; ++r) p1.data().begin()[r * 20U + r] = 4.0;
+    auto p2 = p1 * p1;
+    auto p3 = inverse(p1);
+    auto p4 = solve(p1, p2);
+    assert(in_arena(p1)); assert(in_arena(p2)); assert(in_arena(p3)); assert(in_arena(p4));
+    for (auto r = 0U; r < 400U; ++r) assert(std::abs(p4.data().begin()[r] - p1.data().begin()[r]) < 1e-12);
+#endif
+}
+
+template<class Scalar, size_t N>
+void batch_test(size_t count)
+{
+    using namespace std::experimental::la;
+    using square = fixed_size_matrix<Scalar, N, N>;
+    using vec = fixed_size_matrix<Scalar, N, 1>;
+    auto close = [](auto const& lhs, auto const& rhs) {
+        for (auto e = size_t(0); e < std::size(lhs.data()._Data); ++e)
+        {
+            auto const x = lhs.data()._Data[e];
+            auto const y = rhs.data()._Data[e];
+            if (std::abs(x - y) > Scalar(1e-3) * (Scalar(1) + std::abs(y))) return false;
+        }
+        return true;
+    };
+    auto a = matrix_batch<square>();
+    auto b = matrix_batch<square>(count);
+    auto v = matrix_batch<vec>(count);
+    auto i = 0;
+    for (auto k = size_t(0); k < count; ++k)
+    {
+        auto m = matrix<matrix_traits<square>>{};
+        for (auto& el : m.data()._Data) el = Scalar(i++ % 13) / Scalar(4) - Scalar(1.5);
+        for (auto d = size_t(0); d < N; ++d) m.data()._Data[d * N + d] += Scalar(N);
+        a.push_back(m);
+        for (auto r = size_t(0); r < N; ++r)
+        {
+            for (auto c = size_t(0); c < N; ++c) b(k, r, c) = Scalar(i++ % 7) - Scalar(3);
+            v(k, r, 0) = Scalar(i++ % 5) - Scalar(2);
+        }
+    }
+    assert(a.size() == count && a.blocks() == (count + a.lanes - 1) / a.lanes);
+    
+    // test every batched operation against the same operation on each matrix
+    auto const ab = a * b;
+    auto const at = transpose(a);
+    auto const det = determinant(a);
+    auto const inv = inverse(a);
+    auto const av = a * v;
+    auto const first = a.get(0);
+    auto const shared = first * v;
+    assert(det.size() == count);
+    for (auto k = size_t(0); k < count; ++k)
+    {
+        assert(close(ab.get(k), a.get(k) * b.get(k)));
+        assert(at.get(k) == transpose(a.get(k)));
+        assert(std::abs(det[k] - determinant(a.get(k))) <= Scalar(1e-3) * std::abs(det[k]));
+        assert(close(a.get(k) * inv.get(k), identity<matrix_traits<square>>()));
+        assert(close(av.get(k), a.get(k) * v.get(k)));
+        assert(close(shared.get(k), first * v.get(k)));
+    }
+    
+    // test slots released by resize come back as zero matrices, even where the padding of a
+    // result was computed into
+    a.resize(count - 1);
+    a.resize(count);
+    assert(a.get(count - 1) == matrix<matrix_traits<square>>{});
+    auto grown = inverse(a);
+    grown.resize(count + a.lanes);
+    for (auto k = count; k < count + a.lanes; ++k) assert(grown.get(k) == matrix<matrix_traits<square>>{});
+}
+
+void view_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto m = dyn{ std::pair(6U, 5U) };
+    auto i = 0;
+    for (auto& el : m.data()) el = double(i++);
+    auto const original = m;
+    auto at = [&](size_t r, size_t c) { return m.data().begin()[r * 5 + c]; };
+    
+    // test views refer to the elements of the matrix they view
+    auto b = block_view(m, 1, 2, 3, 2);
+    assert(b.data().rows() == 3 && b.data().cols() == 2);
+    assert(b(0, 0) == at(1, 2) && b(2, 1) == at(3, 3));
+    assert(row_view(m, 4)(0, 3) == at(4, 3));
+    assert(column_view(m, 1)(5, 0) == at(5, 1));
+    assert(block_view(b, 1, 1, 2, 1)(1, 0) == at(3, 3));
+    auto t = transpose(b);
+    assert(t.data().rows() == 2 && t(1, 2) == at(3, 3));
+    
+    // test updates through a view write to the viewed matrix, and to nothing else
+    b *= 2.0;
+    assert(at(1, 2) == 14.0 && t(0, 0) == 14.0 && at(1, 1) == 6.0 && at(4, 2) == 22.0);
+    b += b;
+    b /= 4.0;
+    assert(m == original);
+    auto scaled = dyn(block_view(m, 1, 2, 3, 2) * 2.0);
+    assert(m == original && scaled.data().begin()[0] == 14.0);
+    auto const sum = dyn(b + b);
+    assert(sum == materialize(b) * 2.0);
+    
+    // test products read views through their strides
+    assert(transpose_view(m) * m == transpose(m) * m);
+    assert(transpose(m) * column_view(m, 2) == transpose(m) * materialize(column_view(m, 2)));
+    assert(inner_product(row_view(m, 1), column_view(transpose_view(m), 2)) == 5.0 * 10.0 + 6.0 * 11.0 + 7.0 * 12.0 + 8.0 * 13.0 + 9.0 * 14.0);
+    assert(submatrix(block_view(m, 0, 0, 3, 3), 1, 1) == submatrix(materialize(block_view(m, 0, 0, 3, 3)), 1, 1));
+    
+    // test assign copies elements into a view, and working copies leave the view alone
+    auto const corner = view(std::as_const(m));
+    auto id = dyn{ std::pair(2U, 2U) };
+    std::fill(id.data().begin(), id.data().end(), 0.0);
+    id.data().begin()[0] = id.data().begin()[3] = 1.0;
+    assign(block_view(m, 0, 0, 2, 2), id);
+    assert(at(0, 0) == 1.0 && at(0, 1) == 0.0 && at(1, 1) == 1.0 && at(0, 2) == 2.0);
+    assert(corner(0, 0) == 1.0);
+    auto sq = block_view(m, 0, 0, 5, 5);
+    auto const before = materialize(sq);
+    auto const x = solve(sq, block_view(m, 0, 4, 5, 1));
+    assert(materialize(sq) == before);
+    assert(x.data().rows() == 5 && x.data().cols() == 1);
+    assert(determinant(sq) == determinant(before));
+}
+
+void layout_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using dyn_cm = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    auto const same = [](auto const& lhs, auto const& rhs, double tolerance) {
+        if (lhs.data().rows() != rhs.data().rows() || lhs.data().cols() != rhs.data().cols()) return false;
+        for (auto r = size_t(0); r < lhs.data().rows(); ++r)
+        {
+            for (auto c = size_t(0); c < lhs.data().cols(); ++c)
+            {
+                if (std::abs(lhs(r, c) - rhs(r, c)) > tolerance) return false;
+            }
+        }
+        return true;
+    };
+    
+    // test element (i, j) lands where each layout puts it, for non-square shapes
+    auto f1 = matrix<matrix_traits<fixed_size_matrix<double, 2, 3>>>{};
+    auto f2 = matrix<matrix_traits<fixed_size_matrix<double, 2, 3, column_major>>>{};
+    for (auto r = 0U; r < 2U; ++r)
+    {
+        for (auto c = 0U; c < 3U; ++c) f1(r, c) = f2(r, c) = 10.0 * r + c;
+    }
+    auto const row_order = std::vector<double>{ 0.0, 1.0, 2.0, 10.0, 11.0, 12.0 };
+    auto const column_order = std::vector<double>{ 0.0, 10.0, 1.0, 11.0, 2.0, 12.0 };
+    assert(std::equal(row_order.begin(), row_order.end(), f1.data().begin()));
+    assert(std::equal(column_order.begin(), column_order.end(), f2.data().begin()));
+    assert(same(transpose(f1), transpose(f2), 0.0));
+    assert(same(submatrix(f1, 1, 0), submatrix(f2, 1, 0), 0.0));
+    
+    // test products, including mixed layouts, agree with the row-major result
+    auto const n = 70U;
+    auto a = dyn{ std::pair(n, n + 9) };
+    auto b = dyn{ std::pair(n + 9, n - 5) };
+    auto i = 0;
+    for (auto& el : a.data()) el = double(i++ % 11) - 5.0;
+    for (auto& el : b.data()) el = double(i++ % 7) - 3.0;
+    auto ac = dyn_cm{ std::pair(n, n + 9) };
+    auto bc = dyn_cm{ std::pair(n + 9, n - 5) };
+    for (auto r = 0U; r < n; ++r)
+    {
+        for (auto c = 0U; c < n + 9; ++c) ac(r, c) = a(r, c);
+    }
+    for (auto r = 0U; r < n + 9; ++r)
+    {
+        for (auto c = 0U; c < n - 5; ++c) bc(r, c) = b(r, c);
+    }
+    auto const ab = a * b;
+    assert(same(ac * bc, ab, 0.0));
+    assert(same(a * bc, ab, 0.0));
+    assert(same(ac * b, ab, 0.0));
+    assert(same(transpose(ac), transpose(a), 0.0));
+    auto f3 = matrix<matrix_traits<fixed_size_matrix<double, 3, 2, column_major>>>{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    auto f4 = matrix<matrix_traits<fixed_size_matrix<double, 3, 2>>>{ 1.0, 4.0, 2.0, 5.0, 3.0, 6.0 };
+    assert(same(f2 * f3, f1 * f4, 0.0));
+    
+    // test decompositions and solves give the same answers in either layout
+    auto sq = dyn{ std::pair(n, n) };
+    auto sqc = dyn_cm{ std::pair(n, n) };
+    for (auto r = 0U; r < n; ++r)
+    {
+        for (auto c = 0U; c < n; ++c) sq(r, c) = sqc(r, c) = double((r * 7 + c * 3) % 13) - 6.0 + (r == c ? 30.0 : 0.0) + (c == 0 ? 2.0 * r : 0.0);
+    }
+    auto rhs = dyn{ std::pair(n, 3U) };
+    auto rhsc = dyn_cm{ std::pair(n, 3U) };
+    for (auto r = 0U; r < n; ++r)
+    {
+        for (auto c = 0U; c < 3U; ++c) rhs(r, c) = rhsc(r, c) = double(r % 5) - double(c);
+    }
+    assert(std::abs(determinant(sqc) / determinant(sq) - 1.0) < 1e-9);
+    assert(same(inverse(sqc), inverse(sq), 1e-12));
+    assert(same(solve(sqc, rhsc), solve(sq, rhs), 1e-12));
+    assert(same(sqc * solve(sqc, rhsc), rhs, 1e-9));
+    auto const spd = sq * transpose(sq);
+    auto const spdc = sqc * transpose(sqc);
+    assert(same(solve(cholesky(spdc), rhsc), solve(cholesky(spd), rhs), 1e-9));
+    auto s3 = matrix<matrix_traits<fixed_size_matrix<double, 3, 3>>>{ 4.0, 2.0, 1.0, 0.0, 5.0, 3.0, 2.0, 3.0, 10.0 };
+    auto s3c = matrix<matrix_traits<fixed_size_matrix<double, 3, 3, column_major>>>{ 4.0, 0.0, 2.0, 2.0, 5.0, 3.0, 1.0, 3.0, 10.0 };
+    assert(same(classical_adjoint(s3c), classical_adjoint(s3), 1e-12));
+    assert(same(inverse(s3c), inverse(s3), 1e-12));
+}
+
+void sparse_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using csr = matrix<sparse_traits<csr_matrix<double>>>;
+    using csc = matrix<sparse_traits<csc_matrix<double>>>;
+    auto const rows = 700U;
+    auto const cols = 500U;
+    auto const close = [](dyn const& lhs, dyn const& rhs) {
+        for (auto l = lhs.data().cbegin(), r = rhs.data().cbegin(); l != lhs.data().cend(); ++l, ++r)
+        {
+            if (std::abs(*l - *r) > 1e-9) return false;
+        }
+        return lhs.data().rows() == rhs.data().rows() && lhs.data().cols() == rhs.data().cols();
+    };
+    
+    // test the builder sums duplicates and sorts each row, whatever the order of the triplets
+    auto seed = std::uint32_t(12345);
+    auto next = [&] { seed = seed * 1664525U + 1013904223U; return seed >> 8; };
+    auto builder1 = sparse_builder<double>(rows, cols);
+    auto builder2 = sparse_builder<double>(rows, cols);
+    for (auto t = 0U; t < 6000U; ++t)
+    {
+        builder1.add(next() % rows, next() % cols, double(next() % 19) - 9.0);
+        builder2.add(next() % rows, next() % cols, double(next() % 7) - 3.0);
+    }
+    builder1.add(3, 4, 1.5);
+    builder1.add(3, 4, 2.5);
+    auto const a = csr(builder1.build());
+    auto const b = csr(builder2.build());
+    auto const da = to_dense(a);
+    auto const db = to_dense(b);
+    assert(a.data().nonzeros() < 6002U && a(3, 4) == da(3, 4));
+    for (auto r = 0U; r < rows; ++r)
+    {
+        auto const& o = a.data().offsets();
+        assert(std::is_sorted(a.data().indices().begin() + o[r], a.data().indices().begin() + o[r + 1]));
+    }
+    assert(to_sparse(da).data().nonzeros() <= a.data().nonzeros());
+    assert(close(to_dense(to_sparse(da)), da));
+    
+    // test products with dense vectors and matrices, in both sparse layouts
+    auto x = dyn{ std::pair(cols, 1U) };
+    auto y = dyn{ std::pair(cols, 7U) };
+    auto i = 0;
+    for (auto& el : x.data()) el = double(i++ % 5) - 2.0;
+    for (auto& el : y.data()) el = double(i++ % 11) - 5.0;
+    auto const ac = to_sparse<column_major>(a);
+    assert(close(to_dense(ac), da));
+    assert(close(a * x, da * x));
+    assert(close(a * y, da * y));
+    assert(close(ac * x, da * x));
+    assert(close(ac * y, da * y));
+    assert(close(a * column_view(y, 3), da * column_view(y, 3)));
+    
+    // test sums, scalar products and the transpose
+    assert(close(to_dense(a + b), da + db));
+    assert(close(to_dense(a - b), da - db));
+    assert(close(to_dense(a * 3.0), da * 3.0));
+    assert(close(to_dense(b / 2.0), db / 2.0));
+    auto c = a;
+    c += b;
+    c -= a;
+    assert(close(to_dense(c), db));
+    csc const at = transpose(a);
+    assert(at.data().rows() == cols && at(4, 3) == a(3, 4));
+    assert(close(to_dense(at), transpose(da)));
+    
+    // test vector functions against the dense forms
+    auto const v1 = to_sparse(x);
+    auto const v2 = to_sparse(dyn(x * 2.0 + x));
+    assert(inner_product(v1, v2) == inner_product(x, dyn(x * 3.0)));
+    assert(modulus_squared(v1) == modulus_squared(x));
+    auto id = sparse_builder<double>(4, 4);
+    for (auto k = 0U; k < 4U; ++k) id.add(k, k, 1.0);
+    assert(is_identity(csr(id.build())));
+    assert(!is_identity(csr(builder2.build())));
+    
+    // test the parallel overloads agree with the sequential ones
+    auto pool = thread_pool(4);
+    auto big = sparse_builder<double>(20000, 20000);
+    for (auto t = 0U; t < 200000U; ++t) big.add(next() % 20000U, next() % 20000U, double(next() % 13) - 6.0);
+    auto const s1 = csr(big.build());
+    auto const s2 = csc(big.build<column_major>());
+    auto z = dyn{ std::pair(20000U, 2U) };
+    for (auto& el : z.data()) el = double(i++ % 9) - 4.0;
+    assert(multiply(pool, s1, z) == s1 * z);
+    assert(close(multiply(pool, s2, z), s1 * z));
+    assert(add(pool, s1, s1) == s1 + s1);
+    assert(subtract(pool, s1, s1 * 0.5) == s1 - s1 * 0.5);
+}
+
+void structured_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using upper = matrix<structured_traits<upper_triangular_matrix<double>>>;
+    using diag = matrix<structured_traits<diagonal_matrix<double>>>;
+    using band = matrix<structured_traits<banded_matrix<double>>>;
+    auto const close = [](dyn const& lhs, dyn const& rhs) {
+        for (auto l = lhs.data().cbegin(), r = rhs.data().cbegin(); l != lhs.data().cend(); ++l, ++r)
+        {
+            if (std::abs(*l - *r) > 1e-9 * std::max(1.0, std::abs(*r))) return false;
+        }
+        return lhs.data().rows() == rhs.data().rows() && lhs.data().cols() == rhs.data().cols();
+    };
+    auto const near = [](double lhs, double rhs) { return std::abs(lhs - rhs) <= 1e-9 * std::abs(rhs); };
+    auto const n = 60U;
+    auto seed = std::uint32_t(2024);
+    auto next = [&] { seed = seed * 1664525U + 1013904223U; return double(seed >> 8) / double(1U << 24) - 0.5; };
+    auto m = dyn{ std::pair(n, n) };
+    for (auto& el : m.data()) el = next();
+    auto b = dyn{ std::pair(n, 3U) };
+    for (auto& el : b.data()) el = next();
+    auto x = dyn{ std::pair(n, 1U) };
+    for (auto& el : x.data()) el = next();
+
+    // test a symmetric positive definite matrix: packed storage, products, Cholesky solve and determinant
+    dyn spd = m * transpose(m);
+    for (auto i = 0U; i < n; ++i) spd(i, i) += double(n);
+    auto const s = to_symmetric(spd);
+    assert(s.data().values().size() == n * (n + 1) / 2);
+    assert(s(3, 7) == spd(7, 3) && s(7, 3) == spd(7, 3));
+    assert(close(to_dense(s), spd));
+    assert(close(s * b, spd * b));
+    assert(close(s * x, spd * x));
+    assert(close(s * column_view(b, 1), spd * column_view(b, 1)));
+    assert(close(solve(s, b), solve(spd, b)));
+    assert(near(determinant(s), determinant(spd)));
+    assert(transpose(s) == s && is_invertible(s));
+    auto s2 = s;
+    s2(2, 5) = 9.0;
+    assert(s2(5, 2) == 9.0 && s2 != s);
+
+    // test a symmetric indefinite matrix falls back to LU
+    auto indefinite = spd;
+    for (auto i = 0U; i < n; ++i) indefinite(i, i) = (i % 2 ? -1.0 : 1.0) * indefinite(i, i);
+    auto const si = to_symmetric(indefinite);
+    assert(close(solve(si, b), solve(indefinite, b)));
+    assert(near(determinant(si), determinant(indefinite)));
+
+    // test the same beyond the order where the factorisation works on a dense copy
+    auto const big = 300U;
+    auto large = dyn{ std::pair(big, big) };
+    for (auto i = 0U; i < big; ++i)
+    {
+        for (auto j = 0U; j < big; ++j) large(i, j) = i == j ? 1.0 + double(i % 3) : 0.01 / (1.0 + i + j);
+    }
+    auto rhs = dyn{ std::pair(big, 2U) };
+    for (auto& el : rhs.data()) el = next();
+    assert(close(solve(to_symmetric(large), rhs), solve(large, rhs)));
+    assert(near(determinant(to_symmetric(large)), determinant(large)));
+    for (auto i = 0U; i < big; i += 2) large(i, i) = -large(i, i);
+    assert(close(solve(to_symmetric(large), rhs), solve(large, rhs)));
+
+    // test triangular matrices in both triangles, and that a transpose swaps them
+    auto dominant = m;
+    for (auto i = 0U; i < n; ++i) dominant(i, i) += 4.0;
+    auto const l = to_triangular(dominant);
+    auto const u = to_triangular<upper_triangle>(dominant);
+    auto const dl = to_dense(l);
+    auto const du = to_dense(u);
+    assert(l(2, 5) == 0.0 && l(5, 2) == dominant(5, 2) && u(2, 5) == dominant(2, 5) && u(5, 2) == 0.0);
+    assert(close(l * b, dl * b) && close(u * b, du * b));
+    assert(close(solve(l, b), solve(dl, b)) && close(solve(u, b), solve(du, b)));
+    assert(near(determinant(l), determinant(dl)) && near(determinant(u), determinant(du)));
+    upper const lt = transpose(l);
+    assert(lt.data().values() == l.data().values() && close(to_dense(lt), transpose(dl)));
+    assert(transpose(lt) == l);
+
+    // test diagonal matrices
+    auto d = diag{ std::pair(n, n) };
+    for (auto i = 0U; i < n; ++i) d(i, i) = double(i % 7) + 1.0;
+    auto const dd = to_dense(d);
+    assert(std::as_const(d)(1, 2) == 0.0 && close(d * b, dd * b) && close(solve(d, b), solve(dd, b)));
+    assert(near(determinant(d), determinant(dd)));
+    assert(!is_identity(d) && is_invertible(d));
+    auto one = diag{ std::pair(4U, 4U) };
+    for (auto i = 0U; i < 4U; ++i) one(i, i) = 1.0;
+    assert(is_identity(one) && is_identity(to_dense(one)));
+
+    // test the finite-difference Laplacian, tridiag(-1, 2, -1), whose determinant is n + 1
+    auto lap = band{ banded_matrix<double>(std::pair(n, n), 1, 1) };
+    for (auto i = 0U; i < n; ++i)
+    {
+        lap(i, i) = 2.0;
+        if (i > 0) lap(i, i - 1) = -1.0;
+        if (i + 1 < n) lap(i, i + 1) = -1.0;
+    }
+    assert(lap.data().values().size() == 3 * n && std::as_const(lap)(0, 5) == 0.0);
+    auto const dlap = to_dense(lap);
+    assert(near(determinant(lap), double(n + 1)));
+    assert(close(lap * b, dlap * b) && close(solve(lap, b), solve(dlap, b)));
+    assert(to_banded(dlap, 1, 1) == lap && transpose(lap) == lap);
+
+    // test an unsymmetric band with a zero diagonal, which needs row interchanges
+    auto const skew = to_banded(m, 2, 1);
+    auto const dskew = to_dense(skew);
+    assert(skew.data().lower_bandwidth() == 2 && skew.data().upper_bandwidth() == 1);
+    assert(close(skew * b, dskew * b));
+    assert(near(determinant(skew), determinant(dskew)));
+    auto zero_diagonal = skew;
+    for (auto i = 0U; i < n; ++i) zero_diagonal(i, i) = 0.0;
+    auto const dzero = to_dense(zero_diagonal);
+    assert(close(solve(zero_diagonal, b), solve(dzero, b)));
+    assert(near(determinant(zero_diagonal), determinant(dzero)));
+    band const skewt = transpose(skew);
+    assert(skewt.data().lower_bandwidth() == 1 && close(to_dense(skewt), transpose(dskew)));
+    assert(!is_invertible(band{ banded_matrix<double>(std::pair(4U, 4U), 1, 2) }));
+
+    // test sums and scalar products keep the structure
+    assert(close(to_dense(s + s), spd * 2.0));
+    assert(close(to_dense(l - l * 0.5), dl * 0.5));
+    assert(close(to_dense(2.0 * lap / 4.0), dlap * 0.5));
+    auto acc = lap;
+    acc += lap;
+    acc -= lap * 3.0;
+    assert(close(to_dense(acc), dlap * -1.0));
+}
+
+void iterative_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using dyn_col = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    using csr = matrix<sparse_traits<csr_matrix<double>>>;
+    auto const tolerance = 1e-10;
+    auto const options = iterative_options<double>{ tolerance, 2000 };
+    auto const residual = [](auto const& a, dyn const& x, dyn const& b) {
+        return std::sqrt(modulus_squared(dyn(b - dyn(a * x))) / modulus_squared(b));
+    };
+    auto const zeros = [](size_t rows, size_t cols) {
+        auto z = dyn{ std::pair(rows, cols) };
+        for (auto& el : z.data()) el = 0.0;
+        return z;
+    };
+
+    // The five-point Laplacian on a g x g grid, and the same with a convection term that
+    // makes it unsymmetric
+    auto const g = 30U;
+    auto const n = g * g;
+    auto poisson = sparse_builder<double>(n, n);
+    auto convection = sparse_builder<double>(n, n);
+    for (auto i = 0U; i < g; ++i)
+    {
+        for (auto j = 0U; j < g; ++j)
+        {
+            auto const k = i * g + j;
+            poisson.add(k, k, 4.0);
+            convection.add(k, k, 4.0);
+            if (i > 0) { poisson.add(k, k - g, -1.0); convection.add(k, k - g, -1.5); }
+            if (i + 1 < g) { poisson.add(k, k + g, -1.0); convection.add(k, k + g, -0.5); }
+            if (j > 0) { poisson.add(k, k - 1, -1.0); convection.add(k, k - 1, -1.2); }
+            if (j + 1 < g) { poisson.add(k, k + 1, -1.0); convection.add(k, k + 1, -0.8); }
+        }
+    }
+    auto const a = csr(poisson.build());
+    auto const c = csr(convection.build());
+    auto b = dyn{ std::pair(n, 1U) };
+    auto seed = std::uint32_t(77);
+    for (auto& el : b.data()) { seed = seed * 1664525U + 1013904223U; el = double(seed >> 8) / double(1U << 24) - 0.5; }
+
+    // test CG on the symmetric problem, and that both preconditioners cut the iteration count
+    auto cg = cg_solver<double>(options);
+    auto x = zeros(n, 1U);
+    auto const plain = cg.solve(a, b, x);
+    assert(plain.converged && plain.residual <= tolerance && residual(a, x, b) <= 10 * tolerance);
+    assert(plain.operator_applications == plain.iterations + 1);
+    x = zeros(n, 1U);
+    auto const jacobi = cg.solve(a, b, x, jacobi_preconditioner(a));
+    assert(jacobi.converged && residual(a, x, b) <= 10 * tolerance);
+    auto const ilu = ilu0_preconditioner(a);
+    assert(ilu.factors().nonzeros() == a.data().nonzeros());
+    x = zeros(n, 1U);
+    auto const incomplete = cg.solve(a, b, x, ilu);
+    assert(incomplete.converged && residual(a, x, b) <= 10 * tolerance);
+    assert(incomplete.iterations < plain.iterations / 2);
+
+    // test the workspace is reused: a second solve of the same size does not reallocate
+    auto const* buffer = cg.workspace()._Buffer.data();
+    x = zeros(n, 1U);
+    assert(cg.solve(a, b, x, ilu).iterations == incomplete.iterations && cg.workspace()._Buffer.data() == buffer);
+
+    // test BiCGSTAB and GMRES on the unsymmetric problem, in both sparse layouts
+    auto bicgstab = bicgstab_solver<double>(options);
+    x = zeros(n, 1U);
+    auto const stab = bicgstab.solve(c, b, x);
+    assert(stab.converged && residual(c, x, b) <= 10 * tolerance);
+    x = zeros(n, 1U);
+    auto const stab_ilu = bicgstab.solve(to_sparse<column_major>(c), b, x, ilu0_preconditioner(to_sparse<column_major>(c)));
+    assert(stab_ilu.converged && stab_ilu.iterations < stab.iterations && residual(c, x, b) <= 10 * tolerance);
+    auto gmres = gmres_solver<double>(options);
+    x = zeros(n, 1U);
+    auto const restarted = gmres.solve(c, b, x);
+    assert(restarted.converged && residual(c, x, b) <= 10 * tolerance);
+    x = zeros(n, 1U);
+    auto const gmres_ilu = gmres.solve(c, b, x, ilu0_preconditioner(c));
+    assert(gmres_ilu.converged && gmres_ilu.iterations < restarted.iterations && residual(c, x, b) <= 10 * tolerance);
+    assert(gmres_ilu.iterations < 30 && gmres_ilu.operator_applications == gmres_ilu.iterations + 2);
+
+    // test dense operators of both layouts against the direct solve, with a row vector for x
+    auto const m = 80U;
+    auto d = dyn{ std::pair(m, m) };
+    auto dc = dyn_col{ std::pair(m, m) };
+    for (auto i = 0U; i < m; ++i)
+    {
+        for (auto j = 0U; j < m; ++j) d(i, j) = dc(i, j) = i == j ? 10.0 : 1.0 / (1.0 + i + 2 * j);
+    }
+    auto db = dyn{ std::pair(m, 1U) };
+    for (auto i = 0U; i < m; ++i) db(i, 0) = double(i % 5) - 2.0;
+    auto const direct = solve(d, db);
+    auto xr = zeros(1U, m);
+    assert(gmres.solve(d, db, xr).converged);
+    assert(bicgstab.solve(dc, db, xr, ilu0_preconditioner(d)).converged);
+    for (auto i = 0U; i < m; ++i) assert(std::abs(xr(0, i) - direct(i, 0)) < 1e-8);
+
+    // test a structured operator, and a callable that applies tridiag(-1, 2, -1) without storing it
+    auto lap = matrix<structured_traits<banded_matrix<double>>>{ banded_matrix<double>(std::pair(m, m), 1, 1) };
+    for (auto i = 0U; i < m; ++i)
+    {
+        lap(i, i) = 2.0;
+        if (i > 0) lap(i, i - 1) = -1.0;
+        if (i + 1 < m) lap(i, i + 1) = -1.0;
+    }
+    auto const exact = solve(lap, db);
+    auto xl = zeros(m, 1U);
+    assert(cg.solve(lap, db, xl, jacobi_preconditioner(lap)).converged);
+    for (auto i = 0U; i < m; ++i) assert(std::abs(xl(i, 0) - exact(i, 0)) < 1e-6);
+    auto const stencil = [](matrix_view<double const> v, matrix_view<double> w) {
+        auto const k = v.rows();
+        for (auto i = size_t(0); i < k; ++i) w(i, 0) = 2.0 * v(i, 0) - (i > 0 ? v(i - 1, 0) : 0.0) - (i + 1 < k ? v(i + 1, 0) : 0.0);
+    };
+    xl = zeros(m, 1U);
+    auto const free = cg.solve(stencil, db, xl);
+    assert(free.converged && free.iterations <= m / 2 + 1);
+    for (auto i = 0U; i < m; ++i) assert(std::abs(xl(i, 0) - exact(i, 0)) < 1e-6);
+
+    // test a good initial guess, a zero right-hand side and the iteration limit
+    assert(cg.solve(lap, db, xl).iterations <= 1);
+    auto const none = cg.solve(lap, zeros(m, 1U), xl);
+    assert(none.converged && none.iterations == 0 && modulus_squared(xl) == 0.0);
+    cg.options().max_iterations = 3;
+    auto const limited = cg.solve(a, b, x = zeros(n, 1U));
+    assert(!limited.converged && limited.iterations == 3 && limited.residual > tolerance);
+    // GMRES forms the true residual before each of its three cycles of at most 10 and once more at exit
+    gmres.options() = iterative_options<double>{ tolerance, 25, 10 };
+    auto const short_gmres = gmres.solve(c, b, x = zeros(n, 1U));
+    assert(!short_gmres.converged && short_gmres.iterations == 25 && short_gmres.operator_applications == 25 + 4);
+}
+
+void unrolled_test()
+{
+    using namespace std::experimental::la;
+    using m22 = matrix<matrix_traits<fixed_size_matrix<double, 2, 2>>>;
+    using m23 = matrix<matrix_traits<fixed_size_matrix<double, 2, 3>>>;
+    using m32c = matrix<matrix_traits<fixed_size_matrix<double, 3, 2, column_major>>>;
+    using m44 = matrix<matrix_traits<fixed_size_matrix<double, 4, 4>>>;
+    using m44c = matrix<matrix_traits<fixed_size_matrix<double, 4, 4, column_major>>>;
+    using v4 = matrix<matrix_traits<fixed_size_matrix<double, 1, 4>>>;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    
+    // test small fixed operations are constant expressions
+    constexpr auto a = m23{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    constexpr auto b = m32c{ 1.0, 0.0, 2.0, 1.0, -1.0, 3.0 };
+    constexpr auto ab = a * b;
+    static_assert(ab == m22{ 7.0, 8.0, 16.0, 17.0 });
+    static_assert(transpose(transpose(a)) == a && transpose(a)(2, 1) == 6.0);
+    static_assert(determinant(ab) == -9.0);
+    static_assert(inverse(m22{ 2.0, 1.0, 1.0, 1.0 }) == m22{ 1.0, -1.0, -1.0, 2.0 });
+    static_assert(is_identity(identity<matrix_traits<fixed_size_matrix<double, 4, 4>>>()));
+    constexpr auto v = v4{ 1.0, 2.0, 3.0, 4.0 };
+    static_assert(inner_product(v, v) == 30.0 && modulus_squared(v) == 30.0);
+    constexpr auto m = m44{ 2.0, 0.0, 1.0, 3.0, 1.0, 1.0, 0.0, 2.0, 0.0, 3.0, 1.0, 1.0, 4.0, 1.0, 2.0, 0.0 };
+    static_assert(determinant(m) == -32.0);
+    static_assert(classical_adjoint(m) * m == identity<matrix_traits<fixed_size_matrix<double, 4, 4>>>() * -32.0);
+    
+    // test the closed forms agree with the general paths, in both layouts
+    auto d = dyn{ std::pair(4U, 4U) };
+    auto mc = m44c{};
+    for (auto r = 0U; r < 4U; ++r)
+    {
+        for (auto c = 0U; c < 4U; ++c) d(r, c) = mc(r, c) = m(r, c);
+    }
+    auto const di = inverse(d);
+    auto const mi = inverse(m);
+    auto const mci = inverse(mc);
+    auto const da = classical_adjoint(d);
+    auto const mca = classical_adjoint(mc);
+    for (auto r = 0U; r < 4U; ++r)
+    {
+        for (auto c = 0U; c < 4U; ++c)
+        {
+            assert(std::abs(mi(r, c) - di(r, c)) < 1e-12 && std::abs(mci(r, c) - di(r, c)) < 1e-12);
+            assert(std::abs(mca(r, c) - da(r, c)) < 1e-12);
+        }
+    }
+    assert(determinant(mc) == determinant(m));
+    auto const sq = m * mc;
+    auto const dsq = d * d;
+    for (auto r = 0U; r < 4U; ++r)
+    {
+        for (auto c = 0U; c < 4U; ++c) assert(sq(r, c) == dsq(r, c));
+    }
+}
+
+void mmap_test()
+{
+    using namespace std::experimental::la;
+    using dynamic_double = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using mapped_double = matrix<matrix_traits<mmap_matrix<double>>>;
+    auto const path = std::filesystem::temp_directory_path() / "lin_alg_mmap_test.lam";
+    auto m1 = dynamic_double{ std::pair(3U, 4U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++) - 5.0;
+    
+    // test the header and a round trip through memory and through a mapping
+    save_matrix(path, m1);
+    auto const header = read_matrix_header(path);
+    assert(header.rows == 3U && header.cols == 4U && header.layout == 0U);
+    assert(header.scalar == matrix_file_scalar_v<double> && header.data_offset % 64U == 0U);
+    assert(load_matrix<double>(path) == m1);
+    {
+        auto const mm1 = map_matrix<double>(path);
+        assert(mm1.data().is_file_backed() && mm1.data().mode() == mmap_mode::read_only);
+        assert(mm1.data().cbegin() != nullptr && reinterpret_cast<uintptr_t>(mm1.data().cbegin()) % 64U == 0U);
+        for (auto r = 0U; r < 3U; ++r)
+            for (auto c = 0U; c < 4U; ++c) assert(mm1(r, c) == m1(r, c));
+        
+        // operations on mapped matrices give anonymous results
+        auto const mm2 = mapped_double(mm1 * 2.0);
+        auto const mm3 = mm1 * transpose(mm1);
+        assert(!mm2.data().is_file_backed() && mm2(2, 3) == 12.0);
+        assert(mm3.data().rows() == 3U && mm3(0, 0) == 25.0 + 16.0 + 9.0 + 4.0);
+        assert(mapped_double(mm1 + mm1) == mm2);
+    }
+    
+    // test copy-on-write leaves the file alone, and read_write writes through
+    {
+        auto mm1 = map_matrix<double>(path, mmap_mode::copy_on_write);
+        mm1(0, 0) = 100.0;
+        assert(load_matrix<double>(path)(0, 0) == -5.0);
+        auto mm2 = map_matrix<double>(path, mmap_mode::read_write);
+        mm2 *= 2.0;
+        mm2.data().flush();
+        assert(mm1(0, 0) == 100.0);
+    }
+    assert(load_matrix<double>(path) == dynamic_double(m1 * 2.0));
+    
+    // test assigning another shape with the same element count leaves the file alone
+    {
+        auto mm1 = map_matrix<double>(path, mmap_mode::read_write);
+        auto const mm2 = mapped_double(transpose(mm1) * 0.0);
+        mm1 = mm2;
+        assert(mm1.data().rows() == 4U && mm1.data().cols() == 3U && !mm1.data().is_file_backed());
+    }
+    assert(load_matrix<double>(path) == dynamic_double(m1 * 2.0));
+    
+    // test storage order: column-major files load into either order but map only as themselves
+    auto m2 = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>{ std::pair(3U, 4U) };
+    for (auto r = 0U; r < 3U; ++r)
+        for (auto c = 0U; c < 4U; ++c) m2(r, c) = m1(r, c);
+    save_matrix(path, m2);
+    assert(read_matrix_header(path).layout == 1U);
+    assert(load_matrix<double>(path) == m1);
+    assert((load_matrix<double, column_major>(path) == m2));
+    assert((map_matrix<double, column_major>(path)(2, 1) == m1(2, 1)));
+    auto threw = false;
+    try { map_matrix<double>(path); } catch (std::runtime_error const&) { threw = true; }
+    assert(threw);
+    threw = false;
+    try { map_matrix<float, column_major>(path); } catch (std::runtime_error const&) { threw = true; }
+    assert(threw);
+    
+    // test views are saved row-major, and new files start zeroed and mapped read_write
+    save_matrix(path, transpose_view(m1));
+    assert(load_matrix<double>(path) == dynamic_double(transpose(m1)));
+    {
+        auto mm1 = create_matrix_file<float>(path, 5U, 7U, 4096U);
+        assert(mm1.data().mode() == mmap_mode::read_write && mm1(4, 6) == 0.0f);
+        mm1(4, 6) = 1.5f;
+    }
+    assert(read_matrix_header(path).data_offset == 4096U);
+    assert(load_matrix<float>(path)(4, 6) == 1.5f);
+    std::filesystem::remove(path);
+}
+
+void out_of_core_test()
+{
+    using namespace std::experimental::la;
+    using dynamic_double = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using mapped_double = matrix<matrix_traits<mmap_matrix<double>>>;
+    auto const budget = out_of_core_budget();
+    // Small enough that every operand below is streamed in several tiles and panels
+    set_out_of_core_budget(size_t(64) << 10);
+    auto const close = [](auto const& lhs, auto const& rhs, double tolerance)
+    {
+        if (lhs.data().rows() != rhs.data().rows() || lhs.data().cols() != rhs.data().cols()) return false;
+        for (auto r = size_t(0); r < lhs.data().rows(); ++r)
+            for (auto c = size_t(0); c < lhs.data().cols(); ++c)
+                if (std::abs(lhs(r, c) - rhs(r, c)) > tolerance) return false;
+        return true;
+    };
+    auto m1 = mapped_double{ std::pair(150U, 170U) };
+    auto m2 = mapped_double{ std::pair(170U, 130U) };
+    auto d1 = dynamic_double{ std::pair(150U, 170U) };
+    auto d2 = dynamic_double{ std::pair(170U, 130U) };
+    auto i = 0;
+    for (auto r = 0U; r < 150U; ++r)
+        for (auto c = 0U; c < 170U; ++c) m1(r, c) = d1(r, c) = double(i++ % 23) - 11.0;
+    for (auto r = 0U; r < 170U; ++r)
+        for (auto c = 0U; c < 130U; ++c) m2(r, c) = d2(r, c) = double(i++ % 19) / 4.0 - 2.0;
+    auto const d3 = d1 * d2;
+    
+    // test tiled products against the in-memory engine, with every operand mix and a pool
+    auto pool = thread_pool(4);
+    assert(!m1.data().is_file_backed());
+    assert(close(m1 * m2, d3, 0.0));
+    assert(close(m1 * d2, d3, 0.0));
+    assert(close(multiply(pool, m1, m2), d3, 0.0));
+    auto const path = std::filesystem::temp_directory_path() / "lin_alg_out_of_core_test.lam";
+    save_matrix(path, m1);
+    {
+        auto const mm1 = map_matrix<double>(path);
+        auto const mm3 = mm1 * m2;
+        assert(mm1.data().is_file_backed() && !mm3.data().is_file_backed());
+        assert(close(mm3, d3, 0.0));
+    }
+    std::filesystem::remove(path);
+    
+    // test that a scratch file that cannot be created surfaces as std::system_error
+    auto const directory = out_of_core_directory();
+    set_out_of_core_directory(std::filesystem::temp_directory_path() / "lin_alg_missing_directory");
+    auto thrown = false;
+    try { auto const mm3 = m1 * m2; }
+    catch (std::system_error const&) { thrown = true; }
+    assert(thrown);
+    set_out_of_core_directory(directory);
+    
+    // test tiled LU against the in-memory factorisation
+    auto m4 = mapped_double{ std::pair(150U, 150U) };
+    auto d4 = dynamic_double{ std::pair(150U, 150U) };
+    for (auto r = 0U; r < 150U; ++r)
+        for (auto c = 0U; c < 150U; ++c) m4(r, c) = d4(r, c) = double((r * 37U + c * 11U) % 29U) - 14.0 + (r == c ? 3.0 : 0.0);
+    auto const lu1 = lu(m4);
+    auto const lu2 = lu(d4);
+    auto const lu3 = lu(pool, m4);
+    assert(lu1.is_invertible() && lu1.pivots() == lu2.pivots() && lu3.pivots() == lu2.pivots());
+    auto const tolerance = 1e-9 * std::abs(lu2.determinant());
+    assert(std::abs(lu1.determinant() - lu2.determinant()) < tolerance);
+    assert(std::abs(lu3.determinant() - lu2.determinant()) < tolerance);
+    auto id = dynamic_double{ std::pair(150U, 150U) };
+    for (auto r = 0U; r < 150U; ++r)
+        for (auto c = 0U; c < 150U; ++c) id(r, c) = r == c ? 1.0 : 0.0;
+    assert(close(solve(lu1, m4), id, 1e-9));
+    set_out_of_core_budget(budget);
+}
+
+template<class Scalar>
+void reduced_precision_test()
+{
+    using namespace std::experimental::la;
+    using detail::simd_level;
+    using limits = std::numeric_limits<Scalar>;
+    auto const bits = [](float f) { auto res = uint32_t(0); std::memcpy(&res, &f, sizeof(res)); return res; };
+    
+    // test rounding to nearest even and the special values
+    auto const eps = float(limits::epsilon());
+    assert(float(Scalar(1.0f + eps / 2.0f)) == 1.0f);
+    assert(float(Scalar(1.0f + 3.0f * eps / 2.0f)) == 1.0f + 2.0f * eps);
+    assert(float(Scalar(1.0f + 3.0f * eps / 4.0f)) == 1.0f + eps);
+    assert(float(Scalar(float(limits::denorm_min()) / 2.0f)) == 0.0f);
+    assert(float(Scalar(float(limits::denorm_min()) * 1.5f)) == 2.0f * float(limits::denorm_min()));
+    assert(std::isinf(float(Scalar(float(limits::max()) * 2.0f))));
+    assert(std::isnan(float(Scalar(std::numeric_limits<float>::quiet_NaN()))));
+    assert(float(-Scalar(2.0f)) == -2.0f && Scalar(0.0f) == -Scalar(0.0f));
+    assert(Scalar(3.0f) * Scalar(0.5f) == Scalar(1.5f) && Scalar(1.0f) < Scalar(2.0f));
+    
+    // test every instruction set the machine supports against the scalar kernels, converting
+    // every bit pattern, and every midpoint between neighbouring values
+    constexpr auto patterns = size_t(1) << 16;
+    auto all = std::vector<Scalar>(patterns);
+    for (auto i = size_t(0); i < patterns; ++i) all[i] = Scalar::from_bits(uint16_t(i));
+    auto const& ref = detail::widened_kernels_for<Scalar>(simd_level::scalar);
+    auto ref_wide = std::vector<float>(patterns);
+    ref.widen(all.data(), ref_wide.data(), patterns);
+    auto points = std::vector<float>(ref_wide);
+    for (auto i = size_t(0); i + 1 < patterns; ++i) points.push_back(ref_wide[i] + (ref_wide[i + 1] - ref_wide[i]) / 2.0f);
+    auto ref_narrow = std::vector<Scalar>(points.size());
+    ref.narrow(points.data(), ref_narrow.data(), points.size());
+    for (auto i = size_t(0); i < patterns; ++i)
+    {
+        assert(std::isnan(ref_wide[i]) ? ref_narrow[i].bits() == (all[i].bits() | (std::is_same_v<Scalar, half> ? 0x200 : 0x40)) : ref_narrow[i].bits() == all[i].bits());
+    }
+    constexpr auto n = 103U;        // Not a multiple of any vector width
+    Scalar a[n], b[n], c[n], d[n];
+    for (auto i = 0U; i < n; ++i)
+    {
+        a[i] = Scalar(float(i % 13) - 6.0f);
+        b[i] = Scalar(float(i % 5) + 1.0f);
+    }
+    for (auto level : { simd_level::avx2, simd_level::avx512 })
+    {
+        if (level > detail::active_simd_level()) continue;
+        auto const& k = detail::widened_kernels_for<Scalar>(level);
+        auto wide = std::vector<float>(patterns);
+        k.widen(all.data(), wide.data(), patterns);
+        for (auto i = size_t(0); i < patterns; ++i) assert(bits(wide[i]) == bits(ref_wide[i]));
+        auto narrow = std::vector<Scalar>(points.size());
+        k.narrow(points.data(), narrow.data(), points.size());
+        for (auto i = size_t(0); i < points.size(); ++i) assert(narrow[i].bits() == ref_narrow[i].bits());
+        assert(k.inner_product(a, b, n) == ref.inner_product(a, b, n));
+        assert(k.modulus_squared(a, n) == ref.modulus_squared(a, n));
+        std::copy(a, a + n, c);
+        std::copy(a, a + n, d);
+        k.add(c, b, n);
+        ref.add(d, b, n);
+        k.scalar_multiply(c, 0.3f, n);
+        ref.scalar_multiply(d, 0.3f, n);
+        k.divide(c, 0.7f, n);
+        ref.divide(d, 0.7f, n);
+        k.subtract(c, b, n);
+        ref.subtract(d, b, n);
+        for (auto i = 0U; i < n; ++i) assert(c[i].bits() == d[i].bits());
+    }
+    
+    // test the reductions accumulate in float: summed in Scalar, ones would stop at 2^digits
+    using dynamic_reduced = matrix<matrix_traits<dynamic_size_matrix<Scalar>>>;
+    using dynamic_float = matrix<matrix_traits<dynamic_size_matrix<float>>>;
+    auto constexpr ones = 1U << (limits::digits + 1);
+    auto v = dynamic_reduced{ std::pair(1U, ones) };
+    std::fill(v.data().begin(), v.data().end(), Scalar(1.0f));
+    auto pool = thread_pool(4);
+    assert(float(inner_product(v, v)) == float(ones));
+    assert(float(modulus_squared(v)) == float(ones));
+    assert(modulus(v) == Scalar(std::sqrt(float(ones))));
+    assert(modulus(pool, v) == Scalar(std::sqrt(float(ones))));
+    
+    // test products round the float product once, through the blocked, parallel and direct paths
+    auto const fill = [](auto& lhs, auto& rhs, size_t rows, size_t cols, size_t seed)
+    {
+        for (auto r = size_t(0); r < rows; ++r)
+        {
+            for (auto c = size_t(0); c < cols; ++c)
+            {
+                rhs(r, c) = float((seed++ * 7) % 23) / 4.0f - 2.75f;
+                lhs(r, c) = Scalar(rhs(r, c));
+            }
+        }
+    };
+    auto h1 = dynamic_reduced{ std::pair(70U, 90U) };
+    auto h2 = dynamic_reduced{ std::pair(90U, 50U) };
+    auto f1 = dynamic_float{ std::pair(70U, 90U) };
+    auto f2 = dynamic_float{ std::pair(90U, 50U) };
+    fill(h1, f1, 70, 90, 0);
+    fill(h2, f2, 90, 50, 3);
+    auto const f3 = f1 * f2;
+    auto const rounded = [&](auto const& res)
+    {
+        for (auto r = size_t(0); r < 70; ++r)
+            for (auto c = size_t(0); c < 50; ++c)
+                if (res(r, c).bits() != Scalar(f3(r, c)).bits()) return false;
+        return true;
+    };
+    assert(rounded(h1 * h2));
+    assert(rounded(multiply(pool, h1, h2)));
+    auto s1 = matrix<matrix_traits<fixed_size_matrix<Scalar, 3, 3>>>{};
+    auto s2 = matrix<matrix_traits<fixed_size_matrix<float, 3, 3>>>{};
+    fill(s1, s2, 3, 3, 5);
+    auto const s3 = s1 * s1;
+    auto const s4 = s2 * s2;
+    for (auto r = 0U; r < 3U; ++r)
+        for (auto c = 0U; c < 3U; ++c) assert(s3(r, c) == Scalar(s4(r, c)));
+    auto h3 = h1;
+    h3 += h1;
+    h3 -= h1;
+    h3 *= Scalar(2.0f);
+    for (auto r = 0U; r < 70U; ++r)
+        for (auto c = 0U; c < 90U; ++c) assert(h3(r, c) == Scalar(f1(r, c) * 2.0f));
+    
+    // test matrix files tag and round trip the element type
+    auto const path = std::filesystem::temp_directory_path() / "lin_alg_reduced_precision_test.lam";
+    save_matrix(path, h1);
+    assert(read_matrix_header(path).scalar == matrix_file_scalar_v<Scalar>);
+    assert(load_matrix<Scalar>(path) == h1);
+    std::filesystem::remove(path);
+}
+
+void small_dynamic_test()
+{
+    using namespace std::experimental::la;
+    using small = matrix<matrix_traits<small_dynamic_matrix<double, 16>>>;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto const to_small = [](dyn const& mat) {
+        auto res = small{ std::pair(mat.data().rows(), mat.data().cols()) };
+        std::copy(mat.data().cbegin(), mat.data().cend(), res.data().begin());
+        return res;
+    };
+    auto const same = [](small const& lhs, dyn const& rhs) {
+        return lhs.data().rows() == rhs.data().rows() && lhs.data().cols() == rhs.data().cols()
+            && std::equal(lhs.data().cbegin(), lhs.data().cend(), rhs.data().cbegin());
+    };
+    auto const in_object = [](small const& mat) {
+        auto const* p = reinterpret_cast<char const*>(mat.data().cbegin());
+        return p >= reinterpret_cast<char const*>(&mat) && p < reinterpret_cast<char const*>(&mat + 1);
+    };
+    
+    // test shapes up to the capacity are held inline and larger ones spill to the heap
+    auto m1 = small{ std::pair(4U, 4U) };
+    auto m2 = small{ std::pair(5U, 5U) };
+    assert(m1.data().is_inline() && in_object(m1) && !m2.data().is_inline() && !in_object(m2));
+    
+    // test operations agree with dynamic_size_matrix, inline and spilled
+    auto pool = thread_pool(2);
+    for (auto n : { 3U, 4U, 6U })
+    {
+        auto a = dyn{ std::pair(n, n) };
+        auto b = dyn{ std::pair(n, n) };
+        auto v = dyn{ std::pair(1U, n) };
+        auto i = 0;
+        for (auto& el : a.data()) el = double(i++ % 7) - 3.0;
+        for (auto& el : b.data()) el = double(i++ % 5) - 2.0;
+        for (auto& el : v.data()) el = double(i++ % 3) + 1.0;
+        for (auto r = 0U; r < n; ++r) a(r, r) += 10.0;
+        auto const sa = to_small(a);
+        auto const sb = to_small(b);
+        auto const sv = to_small(v);
+        assert(sa.data().is_inline() == (n * n <= 16U));
+        assert(same(sa * sb, a * b) && same(multiply(pool, sa, sb), a * b));
+        assert(same(sa * 2.0 + sb, a * 2.0 + b) && same(add(pool, sa, sb), a + b));
+        assert(same(transpose(sa), transpose(a)) && same(submatrix(sa, 1, 2), submatrix(a, 1, 2)));
+        assert(same(inverse(sa), inverse(a)) && same(classical_adjoint(sa), classical_adjoint(a)));
+        assert(determinant(sa) == determinant(a) && is_invertible(sa));
+        assert(same(solve(sa, sb), solve(a, b)) && same(solve(lu(sa), sb), solve(lu(a), b)));
+        assert(inner_product(sv, sv) == inner_product(v, v) && same(unit(sv), unit(v)));
+    }
+    
+    // test moves: heap buffers change hands, inline elements are copied, and sources are left empty
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++);
+    for (auto& el : m2.data()) el = double(i++);
+    auto const m1_copy = m1;
+    auto const m2_copy = m2;
+    auto const* heap = m2.data().begin();
+    auto mv1 = std::move(m1);
+    auto mv2 = std::move(m2);
+    assert(mv1 == m1_copy && mv1.data().is_inline() && in_object(mv1));
+    assert(mv2 == m2_copy && mv2.data().begin() == heap);
+    assert(m1.data().rows() == 0U && m2.data().rows() == 0U && m1.data().is_inline() && m2.data().is_inline());
+    
+    // test assignment takes the inline form whenever the elements fit, and swap across forms
+    m2 = mv2;
+    m2 = mv1;
+    assert(m2 == m1_copy && m2.data().is_inline());
+    mv1.data().swap(mv2.data());
+    assert(mv1 == m2_copy && mv1.data().begin() == heap && mv2 == m1_copy && mv2.data().is_inline());
+    mv1 = std::move(mv2);
+    assert(mv1 == m1_copy && mv1.data().is_inline() && mv2.data().rows() == 0U);
+    
+    // test copy assignment that takes on a different allocator gives spilled elements a new buffer
+    {
+        using storage = small_dynamic_matrix<double, 16, propagating_allocator<double>>;
+        auto p1 = matrix<matrix_traits<storage>>{ storage(std::pair(5U, 5U), propagating_allocator<double>(1)) };
+        auto p2 = matrix<matrix_traits<storage>>{ storage(std::pair(5U, 5U), propagating_allocator<double>(2)) };
+        for (auto& el : p1.data()) el = 1.0;
+        for (auto& el : p2.data()) el = double(i++);
+        p1 = p2;
+        assert(p1 == p2 && !p1.data().is_inline() && p1.data().get_allocator()._Tag == 2);
+        assert(tagged_allocator<double>::live == 2);
+    }
+    assert(tagged_allocator<double>::live == 0);
+    
+    // test that inline results are made without allocating
+    if constexpr (instrumentation_enabled)
+    {
+        auto a = small{ std::pair(4U, 4U) };
+        for (auto r = 0U; r < 4U; ++r)
+            for (auto c = 0U; c < 4U; ++c) a(r, c) = r == c ? 4.0 : 1.0;
+        reset_instrument_counters();
+        auto const x = solve(a, inverse(a * a + a) * 2.0 - transpose(a));
+        for (auto const& rec : instrument_counters(counter_scope::this_thread)) assert(rec.allocations == 0U);
+        assert(!instrument_counters().empty() && x.data().is_inline());
+        reset_instrument_counters();
+    }
+}
+
+template<class Layout>
+void resize_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, Layout>>>;
+    auto const value = [](size_t i, size_t j) { return double(i * 100 + j); };
+    auto const holds = [&](dyn const& mat, size_t rows, size_t cols) {
+        if (mat.data().rows() != rows || mat.data().cols() != cols) return false;
+        for (auto i = size_t(0); i < rows; ++i)
+            for (auto j = size_t(0); j < cols; ++j)
+                if (mat(i, j) != value(i, j)) return false;
+        return true;
+    };
+    
+    // test rows appended one at a time reallocate logarithmically often
+    auto m1 = dyn{};
+    auto reallocations = 0;
+    for (auto i = size_t(0); i < 100; ++i)
+    {
+        auto const* before = m1.data().cbegin();
+        m1.data().append_row({ value(i, 0), value(i, 1), value(i, 2) });
+        if (m1.data().cbegin() != before) ++reallocations;
+        assert(m1.data().capacity() >= 3 * (i + 1));
+    }
+    assert(holds(m1, 100, 3) && reallocations <= 8);
+    
+    // test appended columns keep every element in place, within a reserved buffer
+    auto m2 = dyn{ std::pair(4U, 0U) };
+    m2.data().reserve(6 * 7);
+    auto const* buffer = m2.data().cbegin();
+    for (auto j = size_t(0); j < 6; ++j)
+    {
+        auto const col = std::vector<double>{ value(0, j), value(1, j), value(2, j), value(3, j) };
+        m2.data().append_col(col.begin(), col.end());
+    }
+    assert(holds(m2, 4, 6) && m2.data().cbegin() == buffer);
+    
+    // test resize keeps the overlap and zeroes new elements, growing and shrinking each dimension
+    m2.data().resize(6, 5);
+    assert(m2(5, 4) == 0.0 && m2(4, 0) == 0.0 && m2(3, 4) == value(3, 4));
+    m2.data().resize(3, 7);
+    assert(m2(2, 6) == 0.0 && m2(2, 5) == 0.0 && m2(0, 4) == value(0, 4) && m2(2, 3) == value(2, 3));
+    m2.data().resize(2, 3);
+    assert(holds(m2, 2, 3) && m2.data().cbegin() == buffer);
+    m2.data().shrink_to_fit();
+    assert(holds(m2, 2, 3) && m2.data().capacity() == 6U);
+    
+    // test reshape reuses the buffer and keeps storage order
+    auto const flat = std::vector<double>(m1.data().cbegin(), m1.data().cend());
+    buffer = m1.data().cbegin();
+    m1.data().reshape(30, 10);
+    assert(m1.data().cbegin() == buffer && std::equal(flat.begin(), flat.end(), m1.data().cbegin()));
+    m1.data().reshape(2, 5);
+    assert(m1.data().cbegin() == buffer && std::equal(m1.data().cbegin(), m1.data().cend(), flat.begin()));
+    
+    // test copies are sized to fit, assignment reuses capacity, and moves and swaps carry it
+    auto m3 = m1;
+    assert(m3.data().capacity() == 10U && m3 == m1);
+    m1 = m2;
+    assert(m1.data().cbegin() == buffer && m1 == m2);
+    auto m4 = std::move(m1);
+    assert(m4.data().cbegin() == buffer && m1.data().capacity() == 0U);
+    m4.data().swap(m3.data());
+    assert(m3.data().cbegin() == buffer && m4.data().capacity() == 10U);
+    
+    // test a resized matrix is an ordinary operand
+    auto m5 = dyn{ std::pair(2U, 2U) };
+    m5(0, 0) = 2.0; m5(0, 1) = 1.0; m5(1, 0) = 1.0; m5(1, 1) = 3.0;
+    m5.data().append_row({ 0.0, 0.0 });
+    m5.data().append_col({ 0.0, 0.0, 1.0 });
+    auto const square = m5 * m5;
+    assert(determinant(m5) == 5.0 && square(0, 0) == 5.0 && square(1, 1) == 10.0 && square(2, 2) == 1.0 && square(2, 0) == 0.0);
+}
+
+void transpose_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using dyn_col = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    auto const fill = [](auto& mat) {
+        for (auto i = size_t(0); i < mat.data().rows(); ++i)
+            for (auto j = size_t(0); j < mat.data().cols(); ++j) mat(i, j) = double(i * 1000 + j);
+    };
+    auto const is_transpose = [](auto const& t, auto const& mat) {
+        if (t.data().rows() != mat.data().cols() || t.data().cols() != mat.data().rows()) return false;
+        for (auto i = size_t(0); i < mat.data().rows(); ++i)
+            for (auto j = size_t(0); j < mat.data().cols(); ++j)
+                if (t(j, i) != mat(i, j)) return false;
+        return true;
+    };
+    
+    // test the recursive out-of-place transpose on shapes that split unevenly, in both layouts
+    auto pool = thread_pool(3);
+    for (auto shape : { std::pair(1U, 1U), std::pair(1U, 40U), std::pair(37U, 37U), std::pair(70U, 33U), std::pair(17U, 150U) })
+    {
+        auto a = dyn{ shape };
+        auto c = dyn_col{ shape };
+        fill(a);
+        fill(c);
+        assert(is_transpose(transpose(a), a) && is_transpose(transpose(pool, a), a));
+        assert(is_transpose(transpose(c), c) && is_transpose(transpose(pool, c), c));
+    
+        // test in place agrees with out of place, and keeps the buffer
+        auto const expected = transpose(a);
+        auto const* buffer = a.data().cbegin();
+        transpose_inplace(a);
+        assert(a == expected && a.data().cbegin() == buffer);
+        transpose_inplace(a);
+        assert(is_transpose(expected, a));
+        auto const expected_col = transpose(c);
+        transpose_inplace(c);
+        assert(c == expected_col);
+    }
+    
+    // test square storages that cannot reshape, and constant evaluation
+    auto s = matrix<matrix_traits<small_dynamic_matrix<double, 16>>>{ std::pair(3U, 3U) };
+    fill(s);
+    auto const st = transpose(s);
+    transpose_inplace(s);
+    assert(s == st);
+    constexpr auto f = [] {
+        auto m = matrix<matrix_traits<fixed_size_matrix<int, 2, 2>>>{ 1, 2, 3, 4 };
+        transpose_inplace(m);
+        return m;
+    }();
+    static_assert(f(0, 1) == 3 && f(1, 0) == 2);
+    
+    // test a rectangular transpose in place allocates only its bitmap
+    if constexpr (instrumentation_enabled)
+    {
+        auto a = dyn{ std::pair(64U, 48U) };
+        fill(a);
+        reset_instrument_counters();
+        transpose_inplace(a);
+        auto const rec = instrument_counters(counter_scope::this_thread);
+        assert(rec.size() == 1U && rec[0].allocations == 1U && rec[0].allocated_bytes == 64U * 48U / 8U);
+        reset_instrument_counters();
+    }
+}
+
+void update_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using dyn_col = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    auto seed = 0;
+    auto const fill = [&](auto& mat) {
+        for (auto& el : mat.data()) el = double(seed++ % 7) - 3.0;
+    };
+    
+    // test gemm against the allocating operators, through the direct and blocked engines and in both layouts
+    auto pool = thread_pool(3);
+    for (auto [m, n, k] : { std::tuple(5U, 4U, 3U), std::tuple(70U, 50U, 60U) })
+    {
+        auto a = dyn{ std::pair(m, k) };
+        auto b = dyn{ std::pair(k, n) };
+        auto c = dyn{ std::pair(m, n) };
+        fill(a);
+        fill(b);
+        fill(c);
+        dyn const expected = a * b * 2.0 + c * 0.5;
+        auto c2 = c;
+        gemm(2.0, a, b, 0.5, c);
+        gemm(pool, 2.0, a, b, 0.5, c2);
+        assert(c == expected && c2 == expected);
+        auto ac = dyn_col{ std::pair(m, k) };
+        auto bc = dyn_col{ std::pair(k, n) };
+        auto cc = dyn_col{ std::pair(m, n) };
+        for (auto i = 0U; i < m; ++i)
+            for (auto j = 0U; j < k; ++j) ac(i, j) = a(i, j);
+        for (auto i = 0U; i < k; ++i)
+            for (auto j = 0U; j < n; ++j) bc(i, j) = b(i, j);
+        gemm(2.0, ac, bc, 0.0, cc);
+        for (auto i = 0U; i < m; ++i)
+            for (auto j = 0U; j < n; ++j) assert(cc(i, j) == 2.0 * (a * b)(i, j));
+    }
+    
+    // test fixed-size operands of different shapes
+    auto fa = matrix<matrix_traits<fixed_size_matrix<double, 2, 3>>>{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    auto fb = matrix<matrix_traits<fixed_size_matrix<double, 3, 2>>>{ 1.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+    auto fc = matrix<matrix_traits<fixed_size_matrix<double, 2, 2>>>{ 1.0, 1.0, 1.0, 1.0 };
+    gemm(1.0, fa, fb, -1.0, fc);
+    assert((fc == matrix<matrix_traits<fixed_size_matrix<double, 2, 2>>>{ 3.0, 4.0, 9.0, 10.0 }));
+    
+    // test axpy and axpby
+    auto x = dyn{ std::pair(1U, 103U) };
+    auto y = dyn{ std::pair(1U, 103U) };
+    fill(x);
+    fill(y);
+    dyn const y1 = x * 4.0 + y;
+    axpy(4.0, x, y);
+    assert(y == y1);
+    dyn const y2 = x * 0.5 + y * -2.0;
+    axpby(0.5, x, -2.0, y);
+    assert(y == y2);
+    
+    // test rank-1 and rank-k updates
+    auto u = dyn{ std::pair(1U, 30U) };
+    auto v = dyn{ std::pair(40U, 1U) };
+    auto r1 = dyn{ std::pair(30U, 40U) };
+    fill(u);
+    fill(v);
+    fill(r1);
+    auto const r1_before = r1;
+    rank_1_update(3.0, u, v, r1);
+    for (auto i = 0U; i < 30U; ++i)
+        for (auto j = 0U; j < 40U; ++j) assert(r1(i, j) == r1_before(i, j) + 3.0 * u(0, i) * v(j, 0));
+    auto ak = dyn{ std::pair(35U, 40U) };
+    auto rk = dyn{ std::pair(35U, 35U) };
+    fill(ak);
+    fill(rk);
+    dyn const rk_expected = ak * transpose(ak) * -1.0 + rk * 2.0;
+    rank_k_update(-1.0, ak, 2.0, rk);
+    assert(rk == rk_expected);
+    
+    // test operator*= over several row panels, aliased, on fixed sizes and in constant evaluation
+    auto p1 = dyn{ std::pair(300U, 300U) };
+    auto p2 = dyn{ std::pair(300U, 300U) };
+    fill(p1);
+    fill(p2);
+    auto const product = p1 * p2;
+    auto const* buffer = p1.data().cbegin();
+    p1 *= p2;
+    assert(p1 == product && p1.data().cbegin() == buffer);
+    auto s1 = dyn{ std::pair(6U, 6U) };
+    fill(s1);
+    auto const square = s1 * s1;
+    s1 *= s1;
+    assert(s1 == square);
+    constexpr auto f = [] {
+        auto m = matrix<matrix_traits<fixed_size_matrix<int, 2, 2>>>{ 1, 1, 0, 1 };
+        m *= matrix<matrix_traits<fixed_size_matrix<int, 2, 2>>>{ 1, 1, 0, 1 };
+        return m;
+    }();
+    static_assert(f(0, 1) == 2 && f(1, 1) == 1);
+    
+    // test reduced precision updates accumulate in float
+    using hm = matrix<matrix_traits<dynamic_size_matrix<half>>>;
+    auto ha = hm{ std::pair(40U, 40U) };
+    auto hc = hm{ std::pair(40U, 40U) };
+    for (auto& el : ha.data()) el = half(float(seed++ % 5) - 2.0f);
+    for (auto& el : hc.data()) el = half(float(seed++ % 3));
+    hm const h_expected = ha * ha + hc * half(2.0f);
+    gemm(half(1.0f), ha, ha, half(2.0f), hc);
+    assert(hc == h_expected);
+    
+    // test that steady-state updates allocate nothing
+    if constexpr (instrumentation_enabled)
+    {
+        auto c = dyn{ std::pair(70U, 50U) };
+        auto a1 = dyn{ std::pair(70U, 60U) };
+        auto b1 = dyn{ std::pair(60U, 50U) };
+        auto sq = dyn{ std::pair(50U, 50U) };
+        auto sym = dyn{ std::pair(70U, 70U) };
+        fill(c);
+        fill(a1);
+        fill(b1);
+        fill(sq);
+        fill(sym);
+        gemm(1.0, a1, b1, 1.0, c);
+        c *= sq;
+        reset_instrument_counters();
+        for (auto i = 0; i < 3; ++i)
+        {
+            gemm(0.5, a1, b1, 0.5, c);
+            axpby(1.0, x, 0.5, y);
+            rank_1_update(1.0, u, v, r1);
+            rank_k_update(1.0, a1, 0.0, sym);
+            c *= sq;
+        }
+        auto const rec = instrument_counters(counter_scope::this_thread);
+        assert(rec.size() == 5U);
+        for (auto const& op : rec) assert(op.calls == 3U && op.allocations == 0U);
+        reset_instrument_counters();
+    }
+}
+
+void strassen_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    using dyn_col = matrix<matrix_traits<dynamic_size_matrix<double, std::allocator<double>, column_major>>>;
+    using flt = matrix<matrix_traits<dynamic_size_matrix<float>>>;
+    auto const cutoff = strassen_cutoff();
+    auto seed = std::uint32_t(99);
+    auto const fill = [&](auto& mat) {
+        for (auto& el : mat.data()) { seed = seed * 1664525U + 1013904223U; el = float(seed >> 8) / float(1U << 24) - 0.5f; }
+    };
+    auto const error = [](auto const& lhs, auto const& rhs) {
+        auto res = 0.0;
+        for (auto i = size_t(0); i < lhs.data().rows(); ++i)
+            for (auto j = size_t(0); j < lhs.data().cols(); ++j) res = std::max(res, std::abs(double(lhs(i, j)) - double(rhs(i, j))));
+        return res;
+    };
+
+    // test square, rectangular and odd shapes through up to three levels of recursion. With
+    // elements in [-0.5, 0.5] the bound of matrix_strassen.h is about 2e-11 for these orders.
+    set_strassen_cutoff(8);
+    for (auto [m, n, k] : { std::tuple(64U, 64U, 64U), std::tuple(67U, 45U, 91U), std::tuple(33U, 130U, 17U), std::tuple(101U, 99U, 100U) })
+    {
+        auto a = dyn{ std::pair(m, k) };
+        auto b = dyn{ std::pair(k, n) };
+        fill(a);
+        fill(b);
+        dyn const expected = a * b;
+        auto const fast = strassen_multiply(a, b);
+        assert(fast.data().rows() == m && fast.data().cols() == n && error(fast, expected) < 1e-12);
+
+        // test column-major operands and a strided view on the right
+        auto ac = dyn_col{ std::pair(m, k) };
+        auto bc = dyn_col{ std::pair(k, n) };
+        for (auto i = 0U; i < m; ++i)
+            for (auto j = 0U; j < k; ++j) ac(i, j) = a(i, j);
+        for (auto i = 0U; i < k; ++i)
+            for (auto j = 0U; j < n; ++j) bc(i, j) = b(i, j);
+        assert(error(strassen_multiply(ac, bc), expected) < 1e-12);
+        auto wide = dyn{ std::pair(k + 3, n + 5) };
+        fill(wide);
+        assert(error(strassen_multiply(a, block_view(wide, 2, 4, k, n)), dyn(a * block_view(wide, 2, 4, k, n))) < 1e-12);
+    }
+
+    // test the threshold routes operator* and multiply through the recursion, and only above it
+    auto a = dyn{ std::pair(120U, 120U) };
+    auto b = dyn{ std::pair(120U, 120U) };
+    fill(a);
+    fill(b);
+    auto small = dyn{ std::pair(40U, 40U) };
+    fill(small);
+    dyn const conventional = a * b;
+    dyn const conventional_small = small * small;
+    set_strassen_threshold(100);
+    auto pool = thread_pool(3);
+    assert(conventional != strassen_multiply(a, b));
+    assert(a * b == strassen_multiply(a, b) && multiply(pool, a, b) == strassen_multiply(pool, a, b));
+    assert(small * small == conventional_small);
+    set_strassen_threshold(std::numeric_limits<size_t>::max());
+    assert(a * b == conventional);
+
+    // test float, and that a dimension within the cutoff and fixed sizes multiply as usual
+    auto fa = flt{ std::pair(90U, 70U) };
+    auto fb = flt{ std::pair(70U, 80U) };
+    fill(fa);
+    fill(fb);
+    assert(error(strassen_multiply(fa, fb), flt(fa * fb)) < 1e-4);
+    auto thin = dyn{ std::pair(120U, 6U) };
+    fill(thin);
+    assert(strassen_multiply(thin, transpose(thin)) == thin * transpose(thin));
+    auto const f = matrix<matrix_traits<fixed_size_matrix<double, 2, 3>>>{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    assert(strassen_multiply(f, transpose(f)) == f * transpose(f));
+    set_strassen_cutoff(cutoff);
+}
+
+void instrument_test()
+{
+    using namespace std::experimental::la;
+    using dyn = matrix<matrix_traits<dynamic_size_matrix<double>>>;
+    auto const find = [](std::vector<op_counters> const& ops, std::string const& op) {
+        for (auto const& rec : ops) if (op == rec.op) return rec;
+        return op_counters{};
+    };
+    auto m1 = dyn{ std::pair(20U, 30U) };
+    auto m2 = dyn{ std::pair(30U, 10U) };
+    auto m3 = dyn{ std::pair(30U, 30U) };
+    auto i = 0;
+    for (auto& el : m1.data()) el = double(i++ % 7) - 3.0;
+    for (auto& el : m2.data()) el = double(i++ % 5) - 2.0;
+    for (auto& el : m3.data()) el = double(i++ % 11) - 5.0;
+    for (auto r = 0U; r < 30U; ++r) m3(r, r) += 50.0;
+    reset_instrument_counters();
+    
+    // test that without LA_INSTRUMENT operations record nothing
+    if constexpr (!instrumentation_enabled)
+    {
+        auto const product = m1 * m2;
+        auto const x = solve(m3, m2);
+        assert(product.data().rows() == 20U && x.data().rows() == 30U);
+        assert(instrument_counters().empty() && instrument_counters(counter_scope::this_thread).empty());
+        return;
+    }
+    
+    // test calls, estimates and the allocation of the result
+    auto const product = m1 * m2;
+    auto ops = instrument_counters();
+    auto rec = find(ops, "multiply");
+    assert(ops.size() == 1U && rec.calls == 1U);
+    assert(rec.flops == 2.0 * 20.0 * 30.0 * 10.0 && rec.bytes == (600.0 + 300.0 + 200.0) * sizeof(double));
+    assert(rec.allocations >= 1U && rec.allocated_bytes >= 200U * sizeof(double));
+    dyn sum = m1 * 2.0 + m1;
+    rec = find(instrument_counters(), "evaluate");
+    assert(rec.calls == 1U && rec.flops == 2.0 * 600.0 && rec.bytes == 3.0 * 600.0 * sizeof(double));
+    
+    // test nested operations: time includes the inner call, allocations are charged to the innermost
+    reset_instrument_counters();
+    auto const x = solve(m3, m2);
+    ops = instrument_counters();
+    auto const outer = find(ops, "solve");
+    auto const inner = find(ops, "lu");
+    assert(outer.calls == 1U && inner.calls == 1U && outer.nanoseconds >= inner.nanoseconds);
+    assert(outer.allocations == 1U && outer.allocated_bytes == 300U * sizeof(double));
+    assert(inner.allocations >= 1U);
+    
+    // test that a moved operand removes the working copy
+    reset_instrument_counters();
+    auto copy = m3;
+    auto const factors = lu(std::move(copy));
+    assert(find(instrument_counters(), "lu").allocations == inner.allocations - 1U);
+    assert(factors.size() == 30U && x == solve(factors, m2));
+    
+    // test counters per thread, and that those of finished threads are kept
+    reset_instrument_counters();
+    std::thread([&] { assert(transpose(m1).data().rows() == 30U); }).join();
+    assert(find(instrument_counters(), "transpose").calls == 1U);
+    assert(find(instrument_counters(counter_scope::this_thread), "transpose").calls == 0U);
+    
+    // test the sink sees every call on the thread that made it
+    auto mutex = std::mutex();
+    auto seen = std::vector<std::string>();
+    set_instrument_sink([&](op_counters const& call) {
+        std::lock_guard lock(mutex);
+        assert(call.calls == 1U);
+        seen.push_back(call.op);
+    });
+    auto v = dyn{ std::pair(1U, 8U) };
+    for (auto& el : v.data()) el = 1.0;
+    sum *= 0.5;
+    assert(inner_product(v, v) == 8.0);
+    set_instrument_sink(nullptr);
+    sum /= 2.0;
+    assert((seen == std::vector<std::string>{ "scalar_multiply", "inner_product" }));
     
-    assert(sbo1 == (matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) }));
-    assert(sbo2 == (matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) }));
-    assert(sbo3 == (matrix<matrix_traits<dynamic_size_matrix<float>>>{ std::pair(1U, 2U) }));
+    // test the JSON dump, and that reset clears every thread
+    auto json = std::ostringstream();
+    write_instrument_json(json);
+    assert(json.str().find("\"operation\": \"transpose\", \"calls\": 1,") != std::string::npos);
+    assert(json.str().find("\"operation\": \"divide\"") != std::string::npos);
+    reset_instrument_counters();
+    assert(instrument_counters().empty());
+    assert(product.data().rows() == 20U);
 }
 
 int main()
 {
     fixed_size_float_test();
     dynamic_size_float_test();
+    blocked_multiply_test();
+    simd_kernel_test<float>();
+    simd_kernel_test<double>();
+    gemm_kernel_test<float>();
+    gemm_kernel_test<double>();
+    expression_test();
+    move_test();
+    lu_test();
+    solve_test();
+    parallel_test();
+    allocator_test();
+    batch_test<float, 4>(37);
+    batch_test<double, 3>(20);
+    batch_test<float, 2>(16);
+    batch_test<double, 5>(9);
+    view_test();
+    layout_test();
+    sparse_test();
+    structured_test();
+    iterative_test();
+    unrolled_test();
+    mmap_test();
+    out_of_core_test();
+    reduced_precision_test<std::experimental::la::half>();
+    reduced_precision_test<std::experimental::la::bfloat16>();
+    small_dynamic_test();
+    resize_test<std::experimental::la::row_major>();
+    resize_test<std::experimental::la::column_major>();
+    transpose_test();
+    update_test();
+    strassen_test();
+    instrument_test();
 }